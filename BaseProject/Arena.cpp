@@ -0,0 +1,70 @@
+#include "include/Arena.h"
+#include <string.h>
+
+//Constructor, no memory is reserved until the first allocation.
+Arena::Arena(size_t defaultBlockSize) {
+	blockSize = defaultBlockSize;
+	currentBlock = 0;
+	used = 0;
+	usedInEarlierBlocks = 0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+//Destructor.
+Arena::~Arena() {
+
+	for(int i = 0; i < blocks.size(); i++)
+		delete [] blocks[i].memory;
+	MemoryStats::remove(MEMORY_SCRATCH, stats.bytesReserved);
+
+}
+
+void* Arena::alloc(size_t bytes, size_t alignment) {
+	//Move on through the blocks we already have until one fits.
+	while(currentBlock < blocks.size()) {
+		size_t start = (used + alignment - 1) & ~(alignment - 1);
+		if(start + bytes <= blocks[currentBlock].size) {
+			used = start + bytes;
+
+			stats.allocations++;
+			stats.bytesAllocated += bytes;
+			if(usedInEarlierBlocks + used > stats.peakBytesInUse)
+				stats.peakBytesInUse = usedInEarlierBlocks + used;
+
+			return blocks[currentBlock].memory + start;
+		}
+		usedInEarlierBlocks += used;
+		currentBlock++;
+		used = 0;
+	}
+
+	//Out of room, add a block big enough for this request at least.
+	Block block;
+	block.size = bytes + alignment > blockSize ? bytes + alignment : blockSize;
+	block.memory = new char[block.size];
+	blocks.push_back(block);
+
+	stats.blocks++;
+	stats.bytesReserved += block.size;
+	MemoryStats::add(MEMORY_SCRATCH, block.size);
+
+	return alloc(bytes, alignment);
+}
+
+//Forget every allocation, the blocks stay reserved for next time.
+void Arena::reset() {
+	currentBlock = 0;
+	used = 0;
+	usedInEarlierBlocks = 0;
+	stats.resets++;
+}
+
+const ArenaStats& Arena::getStats() {
+	return stats;
+}
+
+void Arena::printStats(const char* name) {
+	printf("Arena %s: %llu allocations, %llu bytes handed out, %u blocks (%lu bytes reserved, peak %lu in use), %u resets\n",
+		name, stats.allocations, stats.bytesAllocated, stats.blocks,
+		(unsigned long) stats.bytesReserved, (unsigned long) stats.peakBytesInUse, stats.resets);
+}
@@ -0,0 +1,414 @@
+#include "include/AssetLoader.h"
+#include <chrono>
+#include <string.h>
+
+AssetLoader assetLoader;
+
+//Constructor, no threads run until start() is called.
+AssetLoader::AssetLoader() {
+	placeholder = NULL;
+	whiteTexture = 0;
+	stopping = false;
+	mappedBytes = 0;
+	frame = 1;
+
+	//Defaults keep a 60Hz frame well clear of a hitch.
+	uploadByteBudget = 1024 * 1024;
+	uploadTimeBudget = 2.0;
+	textureResidentBudget = TEXTURE_RESIDENT_BUDGET;
+	textureMappedBudget = TEXTURE_MAPPED_BUDGET;
+
+	memset(&stats, 0, sizeof(stats));
+}
+
+//Destructor.
+AssetLoader::~AssetLoader() {
+
+	stop();
+
+	for(map<string, Mesh*>::iterator it = meshes.begin(); it != meshes.end(); ++it)
+		delete it->second;
+	delete placeholder;
+
+	for(map<string, Texture*>::iterator it = textures.begin(); it != textures.end(); ++it)
+		delete it->second;
+	if(whiteTexture != 0)
+		glDeleteTextures(1, &whiteTexture);
+
+}
+
+//Start the worker threads, at least one.
+void AssetLoader::start(int numWorkers) {
+	if(numWorkers < 1)
+		numWorkers = 1;
+
+	stopping = false;
+	for(int i = 0; i < numWorkers; i++)
+		workers.push_back(thread(&AssetLoader::workerLoop, this));
+}
+
+//Ask the workers to finish and wait for them.
+void AssetLoader::stop() {
+	{
+		lock_guard<mutex> guard(queueLock);
+		stopping = true;
+	}
+	queueSignal.notify_all();
+
+	for(int i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+}
+
+Mesh* AssetLoader::requestMesh(string fileName) {
+	map<string, Mesh*>::iterator it = meshes.find(fileName);
+	if(it != meshes.end())
+		return it->second;
+
+	Mesh* mesh = new Mesh(fileName);
+	meshes[fileName] = mesh;
+
+	//Without workers there's nobody to hand it to, so just do it now.
+	if(workers.empty()) {
+		mesh->parse(inlineScratch);
+		noteScratch(inlineScratch);
+		inlineScratch.reset();
+		lock_guard<mutex> guard(queueLock);
+		uploadQueue.push_back(mesh);
+		return mesh;
+	}
+
+	{
+		lock_guard<mutex> guard(queueLock);
+		parseQueue.push_back(mesh);
+	}
+	queueSignal.notify_one();
+
+	return mesh;
+}
+
+//A small octahedron drawn in place of anything still loading. It's tiny, so
+//it is built and uploaded on the spot the first time it's needed.
+Mesh* AssetLoader::getPlaceholder() {
+	if(placeholder != NULL)
+		return placeholder;
+
+	GLdouble positions[] = {
+		 0.1,  0.0,  0.0,	-0.1,  0.0,  0.0,
+		 0.0,  0.1,  0.0,	 0.0, -0.1,  0.0,
+		 0.0,  0.0,  0.1,	 0.0,  0.0, -0.1
+	};
+	GLuint indices[] = {
+		0, 2, 4,	2, 1, 4,	1, 3, 4,	3, 0, 4,
+		2, 0, 5,	1, 2, 5,	3, 1, 5,	0, 3, 5
+	};
+
+	placeholder = new Mesh("placeholder");
+	placeholder->createFromArrays(positions, 6, indices, 24);
+	placeholder->upload(geometry, placeholder->numUploadBytes());
+
+	return placeholder;
+}
+
+void AssetLoader::submitMesh(Mesh* mesh) {
+	lock_guard<mutex> guard(queueLock);
+	uploadQueue.push_back(mesh);
+}
+
+//Render thread, so it can't be part way through an upload.
+void AssetLoader::releaseMesh(Mesh* mesh) {
+	{
+		lock_guard<mutex> guard(queueLock);
+		for(deque<Mesh*>::iterator it = uploadQueue.begin(); it != uploadQueue.end(); ++it) {
+			if(*it == mesh) {
+				uploadQueue.erase(it);
+				break;
+			}
+		}
+	}
+	delete mesh;
+}
+
+Texture* AssetLoader::requestTexture(string fileName) {
+	map<string, Texture*>::iterator it = textures.find(fileName);
+	if(it != textures.end())
+		return it->second;
+
+	Texture* texture = new Texture(fileName);
+	textures[fileName] = texture;
+	queueTexture(texture);
+	return texture;
+}
+
+//Hand a texture to the workers, or prepare it now if there aren't any.
+void AssetLoader::queueTexture(Texture* texture) {
+	texture->setState(TEXTURE_QUEUED);
+
+	if(workers.empty()) {
+		texture->prepare();
+		lock_guard<mutex> guard(queueLock);
+		if(texture->wasTranscoded())
+			stats.texturesTranscoded++;
+		if(texture->getState() == TEXTURE_MAPPED) {
+			mappedBytes += texture->getMappedBytes();
+			textureUploadQueue.push_back(texture);
+		}
+		return;
+	}
+
+	{
+		lock_guard<mutex> guard(queueLock);
+		textureQueue.push_back(texture);
+	}
+	queueSignal.notify_one();
+}
+
+GLuint AssetLoader::useTexture(Texture* texture) {
+	if(texture == NULL)
+		return getWhiteTexture();
+
+	texture->lastUsed = frame;
+	if(texture->getState() == TEXTURE_EVICTED)
+		queueTexture(texture);
+	return texture->isDrawable() ? texture->getName() : getWhiteTexture();
+}
+
+//One white texel, what untextured objects (and textures still on their way)
+//are drawn with, so every program can always sample.
+GLuint AssetLoader::getWhiteTexture() {
+	if(whiteTexture != 0)
+		return whiteTexture;
+
+	GLubyte white[4] = { 255, 255, 255, 255 };
+	glGenTextures(1, &whiteTexture);
+	glBindTexture(GL_TEXTURE_2D, whiteTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return whiteTexture;
+}
+
+void AssetLoader::setTextureBudget(size_t residentBytes, size_t mappedBytes) {
+	{
+		lock_guard<mutex> guard(queueLock);
+		textureResidentBudget = residentBytes;
+		textureMappedBudget = mappedBytes;
+	}
+	queueSignal.notify_all();
+}
+
+GeometryPool& AssetLoader::getGeometry() {
+	return geometry;
+}
+
+void AssetLoader::setUploadBudget(GLuint bytesPerFrame, double millisecondsPerFrame) {
+	uploadByteBudget = bytesPerFrame;
+	uploadTimeBudget = millisecondsPerFrame;
+}
+
+//Upload parsed meshes, then mapped textures, until either budget runs out.
+//Big meshes are split across frames by Mesh::upload and textures go a level
+//at a time, so one asset can never blow the budget by much.
+void AssetLoader::drainUploads() {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	stats.bytesUploaded = 0;
+	stats.meshesCompleted = 0;
+	stats.texturesCompleted = 0;
+	bool outOfTime = false;
+
+	while(stats.bytesUploaded < uploadByteBudget) {
+		Mesh* mesh;
+		{
+			lock_guard<mutex> guard(queueLock);
+			if(uploadQueue.empty())
+				break;
+			mesh = uploadQueue.front();
+		}
+
+		stats.bytesUploaded += mesh->upload(geometry, uploadByteBudget - stats.bytesUploaded);
+
+		if(mesh->getState() == MESH_READY) {
+			lock_guard<mutex> guard(queueLock);
+			uploadQueue.pop_front();
+			stats.meshesCompleted++;
+		}
+
+		double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		if(elapsed >= uploadTimeBudget) {
+			outOfTime = true;
+			break;
+		}
+	}
+
+	while(!outOfTime && stats.bytesUploaded < uploadByteBudget) {
+		Texture* texture;
+		{
+			lock_guard<mutex> guard(queueLock);
+			if(textureUploadQueue.empty())
+				break;
+			texture = textureUploadQueue.front();
+		}
+
+		GLuint mapped = texture->getMappedBytes();
+		stats.bytesUploaded += texture->upload(uploadByteBudget - stats.bytesUploaded);
+
+		//Unmapped now, which may let a worker map the next one.
+		if(texture->getState() == TEXTURE_READY) {
+			{
+				lock_guard<mutex> guard(queueLock);
+				textureUploadQueue.pop_front();
+				mappedBytes -= mapped;
+			}
+			queueSignal.notify_all();
+			stats.texturesCompleted++;
+		}
+
+		double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		outOfTime = elapsed >= uploadTimeBudget;
+	}
+
+	evictTextures();
+	frame++;
+
+	stats.uploadMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	lock_guard<mutex> guard(queueLock);
+	stats.meshesQueued = parseQueue.size();
+	stats.meshesPending = uploadQueue.size();
+	stats.texturesQueued = textureQueue.size();
+	stats.texturesPending = textureUploadQueue.size();
+	stats.textureMappedBytes = mappedBytes;
+}
+
+//Least recently drawn first, until what's on the GPU fits the budget again.
+void AssetLoader::evictTextures() {
+	size_t resident = 0;
+	for(map<string, Texture*>::iterator it = textures.begin(); it != textures.end(); ++it)
+		resident += it->second->getResidentBytes();
+
+	while(resident > textureResidentBudget) {
+		Texture* oldest = NULL;
+		for(map<string, Texture*>::iterator it = textures.begin(); it != textures.end(); ++it) {
+			Texture* texture = it->second;
+			if(texture->getState() == TEXTURE_READY && texture->lastUsed < frame && (oldest == NULL || texture->lastUsed < oldest->lastUsed))
+				oldest = texture;
+		}
+		if(oldest == NULL)
+			break;
+
+		resident -= oldest->getResidentBytes();
+		oldest->evict();
+		stats.texturesEvicted++;
+	}
+
+	stats.texturesResident = 0;
+	for(map<string, Texture*>::iterator it = textures.begin(); it != textures.end(); ++it)
+		stats.texturesResident += it->second->getResidentBytes() > 0;
+	stats.textureResidentBytes = resident;
+}
+
+void AssetLoader::finishAll() {
+	GLuint byteBudget = uploadByteBudget;
+	double timeBudget = uploadTimeBudget;
+	uploadByteBudget = 0xFFFFFFFF;
+	uploadTimeBudget = 1e9;
+
+	bool busy = true;
+	while(busy) {
+		drainUploads();
+		busy = false;
+		for(map<string, Mesh*>::iterator it = meshes.begin(); it != meshes.end(); ++it) {
+			MeshState state = it->second->getState();
+			if(state != MESH_READY && state != MESH_FAILED)
+				busy = true;
+		}
+		for(map<string, Texture*>::iterator it = textures.begin(); it != textures.end(); ++it) {
+			TextureState state = it->second->getState();
+			if(state != TEXTURE_READY && state != TEXTURE_FAILED && state != TEXTURE_EVICTED)
+				busy = true;
+		}
+		if(busy)
+			this_thread::sleep_for(chrono::milliseconds(1));
+	}
+
+	uploadByteBudget = byteBudget;
+	uploadTimeBudget = timeBudget;
+}
+
+//Workers pull files off the parse queues and push the results to the
+//upload queues for the render thread, meshes before textures, and textures
+//only while the mapped caches are under budget.
+//Each worker has its own scratch arena, emptied after every file.
+void AssetLoader::workerLoop() {
+	Arena scratch;
+
+	while(true) {
+		Mesh* mesh = NULL;
+		Texture* texture = NULL;
+		{
+			unique_lock<mutex> guard(queueLock);
+			while(parseQueue.empty() && (textureQueue.empty() || mappedBytes >= textureMappedBudget) && !stopping)
+				queueSignal.wait(guard);
+			if(stopping)
+				return;
+			if(!parseQueue.empty()) {
+				mesh = parseQueue.front();
+				parseQueue.pop_front();
+			}
+			else {
+				texture = textureQueue.front();
+				textureQueue.pop_front();
+			}
+		}
+
+		if(texture != NULL) {
+			texture->prepare();
+
+			lock_guard<mutex> guard(queueLock);
+			if(texture->wasTranscoded())
+				stats.texturesTranscoded++;
+			if(texture->getState() == TEXTURE_MAPPED) {
+				mappedBytes += texture->getMappedBytes();
+				textureUploadQueue.push_back(texture);
+			}
+			continue;
+		}
+
+		mesh->parse(scratch);
+
+		lock_guard<mutex> guard(queueLock);
+		noteScratch(scratch);
+		if(mesh->getState() == MESH_PARSED)
+			uploadQueue.push_back(mesh);
+		scratch.reset();
+	}
+}
+
+//Keep the biggest scratch any one file needed. Callers hold queueLock
+//when workers are running.
+void AssetLoader::noteScratch(Arena& scratch) {
+	const ArenaStats& arenaStats = scratch.getStats();
+	if(arenaStats.peakBytesInUse > stats.scratchPeakBytes)
+		stats.scratchPeakBytes = arenaStats.peakBytesInUse;
+	stats.meshesParsed++;
+}
+
+const AssetStats& AssetLoader::getStats() {
+	return stats;
+}
+
+void AssetLoader::printStats() {
+	printf("Assets: %u queued, %u pending upload, %u completed last frame (%u bytes in %.2f ms)\n",
+		stats.meshesQueued, stats.meshesPending, stats.meshesCompleted,
+		stats.bytesUploaded, stats.uploadMilliseconds);
+	printf("Assets: %u meshes parsed, largest scratch %lu bytes\n",
+		stats.meshesParsed, (unsigned long) stats.scratchPeakBytes);
+	printf("Assets: %u textures queued, %u pending upload (%lu bytes mapped), %u completed last frame, %u resident (%lu bytes), %u transcoded, %u evicted\n",
+		stats.texturesQueued, stats.texturesPending, (unsigned long) stats.textureMappedBytes, stats.texturesCompleted,
+		stats.texturesResident, (unsigned long) stats.textureResidentBytes, stats.texturesTranscoded, stats.texturesEvicted);
+	geometry.printStats();
+}
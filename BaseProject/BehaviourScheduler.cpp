@@ -0,0 +1,213 @@
+#include "include/BehaviourScheduler.h"
+#include "include/Bird.h"
+#include <string.h>
+#include <chrono>
+
+//Constructor, no scripts yet.
+BehaviourScheduler::BehaviourScheduler() {
+	freeSlots = 0;
+	acting = NULL;
+	memset(&stats, 0, sizeof(stats));
+}
+
+//Destructor. The birds may already be gone, so only the scripts are freed.
+BehaviourScheduler::~BehaviourScheduler() {
+
+	for(int i = 0; i < slots.size(); i++) {
+		if(slots[i].handle)
+			slots[i].handle.destroy();
+	}
+
+}
+
+void BehaviourScheduler::start(Bird* bird, BirdScript script) {
+	cancel(bird);
+	if(!script.isValid())
+		return;
+
+	unsigned int slot;
+	if(freeSlots != 0) {
+		slot = freeSlots - 1;
+		freeSlots = slots[slot].nextFree;
+	}
+	else {
+		slot = slots.size();
+		slots.push_back(ScriptSlot());
+	}
+
+	ScriptSlot& started = slots[slot];
+	started.handle = script.release();
+	started.bird = bird;
+	started.waiting = SCRIPT_WAIT_NONE;
+	started.nextFree = 0;
+
+	BirdScript::promise_type& promise = started.handle.promise();
+	promise.scheduler = this;
+	promise.bird = bird;
+	promise.slot = slot;
+	bird->script = slot + 1;
+
+	TimerEntry entry = { 0, slot, started.tag };
+	ready.push_back(entry);
+	stats.scripts++;
+}
+
+void BehaviourScheduler::cancel(Bird* bird) {
+	if(bird->script != 0)
+		release(bird->script - 1);
+}
+
+void BehaviourScheduler::cancelAll() {
+	for(int i = 0; i < slots.size(); i++) {
+		if(slots[i].handle)
+			release(i);
+	}
+}
+
+void BehaviourScheduler::release(unsigned int slot) {
+	ScriptSlot& script = slots[slot];
+	script.handle.destroy();
+	script.handle = BirdScript::Handle();
+	script.bird->script = 0;
+	script.bird = NULL;
+	script.tag++;
+	script.waiting = SCRIPT_WAIT_NONE;
+	script.nextFree = freeSlots;
+	freeSlots = slot + 1;
+	stats.scripts--;
+}
+
+//Events go straight to the bird's own script, nothing else is looked at.
+void BehaviourScheduler::signal(Bird* bird, ScriptEvent event) {
+	if(bird->script == 0)
+		return;
+
+	ScriptSlot& script = slots[bird->script - 1];
+	if(script.waiting != SCRIPT_WAIT_EVENT || script.event != event)
+		return;
+
+	script.waiting = SCRIPT_WAIT_NONE;
+	TimerEntry entry = { 0, bird->script - 1, script.tag };
+	ready.push_back(entry);
+}
+
+void BehaviourScheduler::run(vector<Bird*>& acted) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	acting = &acted;
+	stats.resumed = 0;
+	stats.rechecked = 0;
+	stats.stale = 0;
+
+	fired.clear();
+	timers.tick(fired);
+	for(int i = 0; i < fired.size(); i++) {
+		ScriptSlot& script = slots[fired[i].id];
+		if(script.tag != fired[i].tag) {
+			stats.stale++;
+			continue;
+		}
+
+		//Not there yet, turn towards it again and check back later.
+		if(script.waiting == SCRIPT_WAIT_REACH && !reached(script)) {
+			headFor(fired[i].id);
+			stats.rechecked++;
+			continue;
+		}
+		resume(fired[i].id);
+	}
+
+	//Anything started or signalled since the last step.
+	resuming.swap(ready);
+	for(int i = 0; i < resuming.size(); i++) {
+		if(slots[resuming[i].id].tag == resuming[i].tag)
+			resume(resuming[i].id);
+		else
+			stats.stale++;
+	}
+	resuming.clear();
+
+	acting = NULL;
+	stats.pendingTimers = timers.getPending();
+	stats.runMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//Run a script on to its next co_await, or its end.
+void BehaviourScheduler::resume(unsigned int slot) {
+	slots[slot].waiting = SCRIPT_WAIT_NONE;
+	slots[slot].tag++;
+	acting->push_back(slots[slot].bird);
+
+	slots[slot].handle.resume();
+	stats.resumed++;
+	stats.totalResumed++;
+
+	if(slots[slot].handle.done())
+		release(slot);
+}
+
+bool BehaviourScheduler::suspend(unsigned int slot, ScriptWait& wait) {
+	ScriptSlot& script = slots[slot];
+	Bird* bird = script.bird;
+
+	if(wait.dive)
+		bird->fall(false);
+	if(wait.turnRate != 0.0)
+		bird->setTurnRate(wait.turnRate);
+
+	script.waiting = wait.type;
+	switch(wait.type) {
+		case SCRIPT_WAIT_STEPS:
+			timers.schedule(timers.getNow() + wait.steps, slot, script.tag);
+			break;
+		case SCRIPT_WAIT_REACH:
+			script.target[0] = wait.target[0];
+			script.target[1] = wait.target[1];
+			script.radius = wait.radius;
+			if(reached(script)) {
+				script.waiting = SCRIPT_WAIT_NONE;
+				return false;
+			}
+			headFor(slot);
+			break;
+		case SCRIPT_WAIT_EVENT:
+			script.event = wait.event;
+			break;
+		default:
+			return false;
+	}
+	return true;
+}
+
+bool BehaviourScheduler::reached(ScriptSlot& script) {
+	double* centre = script.bird->getPart(KIND_BIRD_BODY)->getTranslation();
+	double dx = script.target[0] - centre[0];
+	double dz = script.target[1] - centre[2];
+	return dx*dx + dz*dz <= script.radius * script.radius;
+}
+
+//Point the bird at its target and come back when it could be there.
+void BehaviourScheduler::headFor(unsigned int slot) {
+	ScriptSlot& script = slots[slot];
+	Object* body = script.bird->getPart(KIND_BIRD_BODY);
+	double* centre = body->getTranslation();
+	script.bird->steerTowards(script.target[0], script.target[1]);
+	if(acting != NULL)
+		acting->push_back(script.bird);
+
+	double dx = script.target[0] - centre[0];
+	double dz = script.target[1] - centre[2];
+	double speed = body->getSpeed() > SCRIPT_MIN_SPEED ? body->getSpeed() : SCRIPT_MIN_SPEED;
+	double steps = (sqrt(dx*dx + dz*dz) - script.radius) / speed;
+	if(steps > SCRIPT_REAIM_STEPS)
+		steps = SCRIPT_REAIM_STEPS;
+	timers.schedule(timers.getNow() + (steps < 1.0 ? 1 : (unsigned long long) steps), slot, script.tag);
+}
+
+const ScriptStats& BehaviourScheduler::getStats() {
+	return stats;
+}
+
+void BehaviourScheduler::printStats() {
+	printf("Scripts: %u running, %u timers pending, last step resumed %u and rechecked %u (%u stale) in %.3f ms, %llu resumes in all\n",
+		stats.scripts, stats.pendingTimers, stats.resumed, stats.rechecked, stats.stale, stats.runMilliseconds, stats.totalResumed);
+}
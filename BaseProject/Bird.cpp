@@ -1,12 +1,35 @@
 #include "include/Bird.h"
+#include "include/World.h"
+#include <string.h>
 
-vector<Object*> objects;
+Pool<Bird> Bird::pool;
+
+Bird* Bird::create(double locationX, double locationY, double locationZ, double flyingBounds[]) {
+	return pool.create(locationX, locationY, locationZ, flyingBounds);
+}
+
+Bird* Bird::create(const BirdRecord& record) {
+	return pool.create(record);
+}
+
+void Bird::destroy(Bird* bird) {
+	pool.destroy(bird);
+}
+
+void Bird::reservePool(unsigned int count) {
+	pool.reserve(count);
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++)
+		Object::reservePool((EntityKind) i, count);
+}
+
+void Bird::printPoolStats() {
+	pool.printStats("birds");
+}
 
 //Constructor for the object, just initialises most variables.
 Bird::Bird(double locationX, double locationY, double locationZ, double birdFlyingBounds[]) {
 	
-	falling = false;
-	staticDrop = false;
+	createParts();
 
 	birdStartLocationX = locationX;
 	birdStartLocationY = locationY;
@@ -16,117 +39,307 @@ Bird::Bird(double locationX, double locationY, double locationZ, double birdFlyi
 	flyingBounds[0] = birdFlyingBounds[0];
 	flyingBounds[1] = birdFlyingBounds[1];
 	flyingBounds[2] = birdFlyingBounds[2];
+	groundHeight = -flyingBounds[1];
+	groundSampled = false;
 
-	//Add objects to form a bird object collection.
-	objects.push_back(new Object("wing.obj", "WingLeft"));
-	objects.push_back(new Object("wing.obj", "WingRight"));
-	objects.push_back(new Object("sphere.obj", "Head"));
-	objects.push_back(new Object("sphere.obj", "Body"));
-
-	//Setup objects for rendering.
-	for(int i = 0; i < objects.size(); i++) {
-		objects[i]->setupData(0);
-		objects[i]->setSpeed(0.02);
-	}
+	//Offset each bird's flap so a flock doesn't beat in unison.
+	flapPhase = (rand() % 628) / 100.0;
+	flapFrequency = 2.0;
+	flapAmplitude = 40.0;
+
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++)
+		parts[i]->setSpeed(0.02);
 
 	setupBirdSkeleton();
+
+	StepContext start = { false, false, false, true, { locationX, locationY, locationZ }, { 0.0, 0.0, 0.0 } };
+	stepContext = start;
+}
+
+//Constructor for a bird taken over from a record, nothing is set up only
+//to be overwritten.
+Bird::Bird(const BirdRecord& record) {
+
+	createParts();
+	birdStartLocationX = record.parts[KIND_BIRD_BODY].translation[0];
+	birdStartLocationY = record.parts[KIND_BIRD_BODY].translation[1];
+	birdStartLocationZ = record.parts[KIND_BIRD_BODY].translation[2];
+
+	StepContext start = { false, false, false, true, { birdStartLocationX, birdStartLocationY, birdStartLocationZ }, { 0.0, 0.0, 0.0 } };
+	stepContext = start;
+	importRecord(record);
+}
+
+//The parts, and the bookkeeping every bird starts with.
+void Bird::createParts() {
+	id = 0;
+	falling = false;
+	staticDrop = false;
+	asleep = false;
+	sleepStep = 0;
+	worldIndex = listIndex = 0;
+	sleepSerial = 0;
+	contactCell = 0;
+	contactIndex = 0;
+	script = 0;
+
+	//Add objects to form a bird object collection.
+	parts[KIND_STATIC] = NULL;
+	parts[KIND_WING_LEFT] = Object::create("wing.obj", "WingLeft", KIND_WING_LEFT);
+	parts[KIND_WING_RIGHT] = Object::create("wing.obj", "WingRight", KIND_WING_RIGHT);
+	parts[KIND_BIRD_HEAD] = Object::create("sphere.obj", "Head", KIND_BIRD_HEAD);
+	parts[KIND_BIRD_BODY] = Object::create("sphere.obj", "Body", KIND_BIRD_BODY);
 }
 
 //Destructor.
 Bird::~Bird() {
 	
 	//Remove the allocation of memory.
-	for(int i = 0; i < objects.size(); i++) {
-		delete objects[i];
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++) {
+		Object::destroy(parts[i]);
 	}
 
-	delete flyingBounds;
+}
 
+//Setup objects for rendering, needs a GL context so headless runs skip it.
+void Bird::setupRendering() {
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++) {
+		parts[i]->setupData(0, "shaders/birdVertexShader.glsl");
+		parts[i]->setTexture(BIRD_TEXTURE);
+	}
 }
 
 //Basically sets the objects in the object tree so they 
 //are spread out in the shape of a bird's skeleton.
 void Bird::setupBirdSkeleton() {
 	//Body
-	objects[3]->setTranslation( birdStartLocationX, 
+	parts[KIND_BIRD_BODY]->setTranslation( birdStartLocationX, 
 								birdStartLocationY, 
 								birdStartLocationZ );
 	//Left Wing
-	objects[0]->setTranslation( birdStartLocationX + objects[0]->getTranslation()[0] + 0.3, 
-								birdStartLocationY + objects[0]->getTranslation()[1] + 0.1, 
-								birdStartLocationZ + objects[0]->getTranslation()[2] );
+	parts[KIND_WING_LEFT]->setTranslation( birdStartLocationX + parts[KIND_WING_LEFT]->getTranslation()[0] + 0.3, 
+								birdStartLocationY + parts[KIND_WING_LEFT]->getTranslation()[1] + 0.1, 
+								birdStartLocationZ + parts[KIND_WING_LEFT]->getTranslation()[2] );
 	//Right Wing
-	objects[1]->setTranslation( birdStartLocationX + objects[1]->getTranslation()[0] - 0.3, 
-								birdStartLocationY + objects[1]->getTranslation()[1] + 0.1, 
-								birdStartLocationZ + objects[1]->getTranslation()[2] );
+	parts[KIND_WING_RIGHT]->setTranslation( birdStartLocationX + parts[KIND_WING_RIGHT]->getTranslation()[0] - 0.3, 
+								birdStartLocationY + parts[KIND_WING_RIGHT]->getTranslation()[1] + 0.1, 
+								birdStartLocationZ + parts[KIND_WING_RIGHT]->getTranslation()[2] );
 	//Head
-	objects[2]->setTranslation( birdStartLocationX + objects[2]->getTranslation()[0], 
-								birdStartLocationY + objects[2]->getTranslation()[1] + 0.3, 
-								birdStartLocationZ + objects[2]->getTranslation()[2] + 0.3);
+	parts[KIND_BIRD_HEAD]->setTranslation( birdStartLocationX + parts[KIND_BIRD_HEAD]->getTranslation()[0], 
+								birdStartLocationY + parts[KIND_BIRD_HEAD]->getTranslation()[1] + 0.3, 
+								birdStartLocationZ + parts[KIND_BIRD_HEAD]->getTranslation()[2] + 0.3);
 
-	//Set wing flap speeds in Z axis rotation
-	objects[0]->setRotationSpeed(0, 0, -4);
-	objects[1]->setRotationSpeed(0, 0, 4);
+	//Wing flaps hinge at the body, mirrored for each side.
+	int leftSide = KindTraits<KIND_WING_LEFT>::flapSide;
+	int rightSide = KindTraits<KIND_WING_RIGHT>::flapSide;
+	parts[KIND_WING_LEFT]->setFlap(flapPhase, flapFrequency, leftSide * flapAmplitude, leftSide * 0.3);
+	parts[KIND_WING_RIGHT]->setFlap(flapPhase, flapFrequency, rightSide * flapAmplitude, rightSide * 0.3);
 }
 
 //Allow steering of the bird only when in air
 void Bird::steerBird(double angle) {
-	for(int i = 0; i < objects.size(); i++) {
-		if(objects[i]->isCrashed || falling)
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++) {
+		if(parts[i]->isCrashed || falling)
+			break;
+		parts[i]->setRotation(parts[i]->getRotation()[0], 
+							  parts[i]->getRotation()[1] + angle, 
+							  parts[i]->getRotation()[2] );
+	}
+}
+
+//Shortest way round to face the point.
+void Bird::steerTowards(double x, double z) {
+	double* centre = parts[KIND_BIRD_BODY]->getTranslation();
+	double heading = atan2(x - centre[0], z - centre[2]) * 180 / M_PI;
+	steerBird(fmod(heading - parts[KIND_BIRD_BODY]->getRotation()[1] + 540.0, 360.0) - 180.0);
+}
+
+//Circling uses the parts' own rotation speed, so it costs nothing extra
+//each step. Falling spins the bird by the same means, so a falling or
+//crashed bird is left alone.
+void Bird::setTurnRate(double degreesPerStep) {
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++) {
+		if(parts[i]->isCrashed || falling)
 			break;
-		objects[i]->setRotation(objects[i]->getRotation()[0], 
-								objects[i]->getRotation()[1] + angle, 
-								objects[i]->getRotation()[2] );
+		double* rotationSpeed = parts[i]->getRotationSpeed();
+		parts[i]->setRotationSpeed(rotationSpeed[0], degreesPerStep, rotationSpeed[2]);
 	}
 }
 
-//Update all openGL visuals of the bird object (structure)
-void Bird::updateObjectDisplays(MatrixStack projectionStack) {
-	birdCentre[0] = objects[3]->getTranslation()[0];
-	birdCentre[1] = objects[3]->getTranslation()[1];
-	birdCentre[2] = objects[3]->getTranslation()[2];
+//Obstacle avoidance. Straight up or down (the ground) gives nothing to turn by.
+void Bird::steerAway(const float* away, double maxTurn) {
+	double length = sqrt(away[0]*away[0] + away[2]*away[2]);
+	if(length < 1e-4)
+		return;
+
+	double heading = parts[KIND_BIRD_BODY]->getRotation()[1];
+	double facing = (sin(M_PI * heading / 180) * away[0] + cos(M_PI * heading / 180) * away[2]) / length;
+	if(facing > 0.5)
+		return;
+
+	//Shortest way round to the away direction.
+	double turn = fmod(atan2(away[0], away[2]) * 180 / M_PI - heading + 540.0, 360.0) - 180.0;
+	steerBird(turn > maxTurn ? maxTurn : (turn < -maxTurn ? -maxTurn : turn));
+}
+
+void Bird::setDrift(const float* velocity, double scale) {
+	double* centre = parts[KIND_BIRD_BODY]->getTranslation();
+	for(int axis = 0; axis < 3; axis++) {
+		double drift = velocity[axis] * scale;
+		double next = centre[axis] + drift;
+		stepContext.drift[axis] = next > flyingBounds[axis] || next < -flyingBounds[axis] ? 0.0 : drift;
+	}
+}
+
+//Work out this step's context for the bird's parts, the parts themselves
+//are stepped afterwards (see Object::updateBirds).
+bool Bird::prepareStep() {
+	double* birdCentre = stepContext.centre;
+	birdCentre[0] = parts[KIND_BIRD_BODY]->getTranslation()[0];
+	birdCentre[1] = parts[KIND_BIRD_BODY]->getTranslation()[1];
+	birdCentre[2] = parts[KIND_BIRD_BODY]->getTranslation()[2];
 
 	//Check if we've hit the ground
-	if(birdCentre[1] <= -flyingBounds[1]) {
-		for(int i = 0; i < objects.size(); i++) {
-			objects[i]->resetFall();
+	bool landed = false;
+	if(birdCentre[1] <= groundHeight) {
+		landed = true;
+		for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++) {
+			parts[i]->resetFall();
 			if(!staticDrop)
-				objects[i]->initiateCrash();
+				parts[i]->initiateCrash();
 		}
 		staticDrop = false;
 		falling = false;
 	}
 
-	//Go through objects and display.
-	for(int i = 0; i < objects.size(); i++) {
-		objects[i]->updateDisplay(projectionStack, falling, birdCentre[1] >= flyingBounds[1], 
-			staticDrop, withinBounds(), birdCentre);
+	stepContext.falling = falling;
+	stepContext.reachedTop = birdCentre[1] >= flyingBounds[1];
+	stepContext.staticDrop = staticDrop;
+	stepContext.inBounds = withinBounds();
+
+	return landed;
+}
+
+const StepContext& Bird::getStepContext() {
+	return stepContext;
+}
+
+Object* Bird::getPart(EntityKind kind) {
+	return parts[kind];
+}
+
+//Add every part's current transform to a snapshot.
+void Bird::writeSnapshot(vector<SnapshotEntry>& entries) {
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++) {
+		entries.push_back(SnapshotEntry());
+		parts[i]->writeSnapshot(entries.back());
 	}
 }
 
 void Bird::fall(bool drop) {
 	staticDrop = drop;
 	falling = true;
-	for(int i = 0; i < objects.size() && !drop; i++) {
-		objects[i]->setTranslationSpeed(objects[i]->getTranslationSpeed()[0], 
-										0.01, 
-										objects[i]->getTranslationSpeed()[2]);
-		objects[i]->setSpeed(0.05);
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS && !drop; i++) {
+		parts[i]->setTranslationSpeed(parts[i]->getTranslationSpeed()[0], 
+									  0.01, 
+									  parts[i]->getTranslationSpeed()[2]);
+		parts[i]->setSpeed(0.05);
+	}
+}
+
+//A crashed bird crawling along the ground rises and falls with it, keeping
+//whatever height it came to rest at above it.
+void Bird::setGround(double height) {
+	if(groundSampled && parts[KIND_BIRD_BODY]->isCrashed && !falling) {
+		double rise = height - groundHeight;
+		for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++) {
+			double* translation = parts[i]->getTranslation();
+			parts[i]->setTranslation(translation[0], translation[1] + rise, translation[2]);
+		}
 	}
+	groundHeight = height;
+	groundSampled = true;
 }
 
 bool Bird::isFalling() {
 	return falling;
 }
 
+const bool* Bird::getFallingFlag() {
+	return &falling;
+}
+
+//Crashed, not falling and slowed to the crash crawl.
+bool Bird::isSettled() {
+	return parts[KIND_BIRD_BODY]->isCrashed && !falling && parts[KIND_BIRD_BODY]->getSpeed() <= 0.0015;
+}
+
+//Steps until the crash wears off and the bird flies again.
+double Bird::crashStepsLeft() {
+	return 150 - parts[KIND_BIRD_BODY]->getCrashTravel();
+}
+
+//Catch up on the crash timer after sleeping. The crawl along the ground
+//while settled is not replayed, the bird rests where it settled.
+void Bird::wake(double stepsAsleep) {
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++)
+		parts[i]->skipCrashTravel(stepsAsleep);
+}
+
+double* Bird::getCentre() {
+	return stepContext.centre;
+}
+
+void Bird::exportRecord(BirdRecord& record) {
+	memset(&record, 0, sizeof(record));
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++)
+		parts[i]->exportState(record.parts[i]);
+	for(int i = 0; i < 3; i++)
+		record.flyingBounds[i] = flyingBounds[i];
+	record.flapPhase = flapPhase;
+	record.flapFrequency = flapFrequency;
+	record.flapAmplitude = flapAmplitude;
+	record.falling = falling;
+	record.staticDrop = staticDrop;
+	record.id = id;
+	record.groundSampled = groundSampled;
+	record.groundHeight = groundHeight;
+}
+
+//Take over a bird exported elsewhere, exactly as it was.
+void Bird::importRecord(const BirdRecord& record) {
+	for(int i = 0; i < 3; i++)
+		flyingBounds[i] = record.flyingBounds[i];
+	groundHeight = record.groundHeight;
+	groundSampled = record.groundSampled != 0;
+	flapPhase = record.flapPhase;
+	flapFrequency = record.flapFrequency;
+	flapAmplitude = record.flapAmplitude;
+	falling = record.falling != 0;
+	staticDrop = record.staticDrop != 0;
+	id = record.id;
+
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++)
+		parts[i]->importState(record.parts[i]);
+
+	int leftSide = KindTraits<KIND_WING_LEFT>::flapSide;
+	int rightSide = KindTraits<KIND_WING_RIGHT>::flapSide;
+	parts[KIND_WING_LEFT]->setFlap(flapPhase, flapFrequency, leftSide * flapAmplitude, leftSide * 0.3);
+	parts[KIND_WING_RIGHT]->setFlap(flapPhase, flapFrequency, rightSide * flapAmplitude, rightSide * 0.3);
+
+	double* centre = parts[KIND_BIRD_BODY]->getTranslation();
+	for(int i = 0; i < 3; i++)
+		stepContext.centre[i] = centre[i];
+}
+
 bool Bird::withinBounds() {
 	//Let's get the location that we think we're going to be in due to steering.
 	double nextXLocation = 
-		objects[3]->getTranslation()[0] + 
-		sin(M_PI * objects[3]->getRotation()[1] / 180) * objects[3]->getSpeed();
+		parts[KIND_BIRD_BODY]->getTranslation()[0] + 
+		sin(M_PI * parts[KIND_BIRD_BODY]->getRotation()[1] / 180) * parts[KIND_BIRD_BODY]->getSpeed();
 	double nextZLocation = 
-		objects[3]->getTranslation()[2] + 
-		cos(M_PI * objects[3]->getRotation()[1] / 180) * objects[3]->getSpeed();
+		parts[KIND_BIRD_BODY]->getTranslation()[2] + 
+		cos(M_PI * parts[KIND_BIRD_BODY]->getRotation()[1] / 180) * parts[KIND_BIRD_BODY]->getSpeed();
 
 	//Is it within our bounds?
 	if(flyingBounds[0] < nextXLocation || -flyingBounds[0] > nextXLocation ||
@@ -0,0 +1,101 @@
+#include "include/BirdScript.h"
+#include "include/BehaviourScheduler.h"
+#include "include/Bird.h"
+#include <string.h>
+
+BirdScript BirdScript::promise_type::get_return_object() {
+	return BirdScript(Handle::from_promise(*this));
+}
+
+//Constructor, an empty script.
+BirdScript::BirdScript() {
+}
+
+BirdScript::BirdScript(Handle scriptHandle) {
+	handle = scriptHandle;
+}
+
+BirdScript::BirdScript(BirdScript&& other) {
+	handle = other.release();
+}
+
+BirdScript& BirdScript::operator=(BirdScript&& other) {
+	if(this != &other) {
+		if(handle)
+			handle.destroy();
+		handle = other.release();
+	}
+	return *this;
+}
+
+//Destructor, a script never handed to a scheduler goes with us.
+BirdScript::~BirdScript() {
+
+	if(handle)
+		handle.destroy();
+
+}
+
+BirdScript::Handle BirdScript::release() {
+	Handle released = handle;
+	handle = Handle();
+	return released;
+}
+
+bool ScriptWait::await_suspend(BirdScript::Handle script) {
+	BirdScript::promise_type& promise = script.promise();
+	bird = promise.bird;
+	return promise.scheduler->suspend(promise.slot, *this);
+}
+
+//Circling stops with the wait, unless the bird has started falling since
+//(the fall spins it).
+void ScriptWait::await_resume() {
+	if(turnRate != 0.0 && bird != NULL)
+		bird->setTurnRate(0.0);
+}
+
+static ScriptWait makeWait(ScriptWaitType type) {
+	ScriptWait wait;
+	memset(&wait, 0, sizeof(wait));
+	wait.type = type;
+	return wait;
+}
+
+ScriptWait waitSteps(unsigned long long steps) {
+	ScriptWait wait = makeWait(steps > 0 ? SCRIPT_WAIT_STEPS : SCRIPT_WAIT_NONE);
+	wait.steps = steps;
+	return wait;
+}
+
+ScriptWait waitFor(ScriptEvent event) {
+	ScriptWait wait = makeWait(SCRIPT_WAIT_EVENT);
+	wait.event = event;
+	return wait;
+}
+
+ScriptWait flyTo(double x, double z, double radius) {
+	ScriptWait wait = makeWait(SCRIPT_WAIT_REACH);
+	wait.target[0] = x;
+	wait.target[1] = z;
+	wait.radius = radius;
+	return wait;
+}
+
+ScriptWait circle(double turns, double degreesPerStep) {
+	ScriptWait wait = makeWait(SCRIPT_WAIT_NONE);
+	if(turns <= 0.0 || degreesPerStep == 0.0)
+		return wait;
+
+	wait.type = SCRIPT_WAIT_STEPS;
+	wait.steps = (unsigned long long) ceil(turns * 360.0 / fabs(degreesPerStep));
+	wait.turnRate = degreesPerStep;
+	return wait;
+}
+
+ScriptWait dive() {
+	ScriptWait wait = makeWait(SCRIPT_WAIT_EVENT);
+	wait.event = SCRIPT_EVENT_LANDED;
+	wait.dive = true;
+	return wait;
+}
@@ -0,0 +1,47 @@
+#include "include/BirdScripts.h"
+
+//Somewhere within SCRIPT_RANGE, from a little generator each script keeps
+//for itself so a flock's scripts don't all pick the same places.
+static double pickPlace(unsigned int& seed) {
+	seed = seed * 1664525u + 1013904223u;
+	return ((seed >> 8) % 10001) / 10000.0 * 2.0 * SCRIPT_RANGE - SCRIPT_RANGE;
+}
+
+BirdScript patrolScript(Bird* bird, unsigned int seed) {
+	while(true) {
+		double x = pickPlace(seed);
+		double z = pickPlace(seed);
+		co_await flyTo(x, z, 0.2);
+		co_await circle(3, SCRIPT_CIRCLE_RATE);
+		co_await dive();
+
+		//Back in the air once the crash wears off.
+		co_await waitSteps((unsigned long long) bird->crashStepsLeft() + 1);
+	}
+}
+
+BirdScript wanderScript(Bird* bird, unsigned int seed) {
+	while(true) {
+		double x = pickPlace(seed);
+		double z = pickPlace(seed);
+		co_await flyTo(x, z, 0.3);
+		co_await waitSteps(60 + (seed >> 8) % 240);
+
+		//Knocked down on the way, rest before setting off again.
+		if(bird->isFalling())
+			co_await waitFor(SCRIPT_EVENT_LANDED);
+		if(bird->getPart(KIND_BIRD_BODY)->isCrashed)
+			co_await waitSteps((unsigned long long) bird->crashStepsLeft() + 1);
+	}
+}
+
+BirdScript makeBirdScript(BirdScriptKind kind, Bird* bird) {
+	switch(kind) {
+		case SCRIPT_PATROL:
+			return patrolScript(bird, bird->id * 2654435761u + 1);
+		case SCRIPT_WANDER:
+			return wanderScript(bird, bird->id * 2654435761u + 1);
+		default:
+			return BirdScript();
+	}
+}
@@ -0,0 +1,123 @@
+#include "include/CameraRig.h"
+#include <string.h>
+
+//Constructor, the orbit camera alone until told otherwise.
+CameraRig::CameraRig() {
+	numViews = 1;
+	memset(views, 0, sizeof(views));
+	memset(viewMatrices, 0, sizeof(viewMatrices));
+	memset(eyes, 0, sizeof(eyes));
+	for(int i = 0; i < MAX_VIEWS; i++)
+		aspects[i] = 1.0;
+
+	chaseTarget[0] = chaseTarget[1] = chaseTarget[2] = 0.0;
+	chaseHeading[0] = 0.0;
+	chaseHeading[1] = 1.0;
+}
+
+//Destructor.
+CameraRig::~CameraRig() {
+
+}
+
+void CameraRig::setNumViews(int count) {
+	numViews = max(1, min(count, (int) NUM_CAMERA_MODES));
+}
+
+int CameraRig::getNumViews() {
+	return numViews;
+}
+
+void CameraRig::update(double orbitAngle, const WorldSnapshot& snapshot, int width, int height) {
+	if(numViews > 1)
+		follow(snapshot);
+
+	if(numViews == 1) {
+		place(0, CAMERA_ORBIT, orbitAngle, 0, 0, width, height);
+		return;
+	}
+
+	//The main view on the left, the rest stacked down the right, top first.
+	GLint half = width / 2;
+	place(0, CAMERA_ORBIT, orbitAngle, 0, 0, half, height);
+	for(int i = 1; i < numViews; i++) {
+		GLint top = height - height * (i - 1) / (numViews - 1);
+		GLint bottom = height - height * i / (numViews - 1);
+		place(i, (CameraMode) i, orbitAngle, half, bottom, width - half, top - bottom);
+	}
+}
+
+//The chase camera keeps to the first bird body in the snapshot. Its heading
+//is where the body's forward (z) axis points, flattened onto the ground.
+void CameraRig::follow(const WorldSnapshot& snapshot) {
+	for(int i = 0; i < snapshot.entries.size(); i++) {
+		const SnapshotEntry& entry = snapshot.entries[i];
+		if(entry.object->kind != KIND_BIRD_BODY)
+			continue;
+
+		chaseTarget[0] = entry.modelView[12];
+		chaseTarget[1] = entry.modelView[13];
+		chaseTarget[2] = entry.modelView[14];
+		double length = sqrt(entry.modelView[8] * entry.modelView[8] + entry.modelView[10] * entry.modelView[10]);
+		if(length > 1e-6) {
+			chaseHeading[0] = entry.modelView[8] / length;
+			chaseHeading[1] = entry.modelView[10] / length;
+		}
+		return;
+	}
+}
+
+void CameraRig::place(int index, CameraMode mode, double orbitAngle, GLint x, GLint y, GLint width, GLint height) {
+	RenderView& view = views[index];
+	view.viewport[0] = x;
+	view.viewport[1] = y;
+	view.viewport[2] = max(width, 1);
+	view.viewport[3] = max(height, 1);
+	aspects[index] = (double) view.viewport[2] / view.viewport[3];
+
+	MatrixStack camera(1);
+	camera.loadIdentity();
+	GLdouble* eye = eyes[index];
+	if(mode == CAMERA_CHASE) {
+		eye[0] = chaseTarget[0] - chaseHeading[0] * CHASE_DISTANCE;
+		eye[1] = chaseTarget[1] + CHASE_HEIGHT;
+		eye[2] = chaseTarget[2] - chaseHeading[1] * CHASE_DISTANCE;
+		camera.lookAt(eye[0], eye[1], eye[2], chaseTarget[0] + chaseHeading[0], chaseTarget[1], chaseTarget[2] + chaseHeading[1], 0.0, 1.0, 0.0);
+	}
+	else if(mode == CAMERA_TOP) {
+		//Looking straight down, so up on screen has to be along the ground.
+		eye[0] = 0.0;
+		eye[1] = TOP_HEIGHT;
+		eye[2] = 0.0;
+		camera.lookAt(eye[0], eye[1], eye[2], 0.0, 0.0, 0.0, 0.0, 0.0, -1.0);
+	}
+	else {
+		eye[0] = sin(orbitAngle * 2) * 5;
+		eye[1] = 1.0;
+		eye[2] = cos(orbitAngle * 2) * 5;
+		camera.lookAt(eye[0], eye[1], eye[2], 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
+	}
+	memcpy(viewMatrices[index], camera.getMatrixd(), sizeof(viewMatrices[index]));
+
+	MatrixStack projection(1);
+	projection.loadIdentity();
+	projection.perspective(CAMERA_FOV, aspects[index], CAMERA_NEAR, CAMERA_FAR);
+	projection.multMatrixd(viewMatrices[index]);
+	memcpy(view.projection, projection.getMatrixf(), sizeof(view.projection));
+}
+
+const RenderView* CameraRig::getViews() {
+	return views;
+}
+
+const GLdouble* CameraRig::getViewMatrix(int index) {
+	return viewMatrices[index];
+}
+
+double CameraRig::getAspect(int index) {
+	return aspects[index];
+}
+
+const GLdouble* CameraRig::getEye(int index) {
+	return eyes[index];
+}
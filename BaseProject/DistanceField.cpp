@@ -0,0 +1,489 @@
+#include "include/DistanceField.h"
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <thread>
+#include <functional>
+#include <chrono>
+
+//Every x86 target we build for has SSE2, anything else takes the plain path.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DISTANCE_FIELD_SSE
+#include <emmintrin.h>
+#endif
+
+//Sample range of a 16 bit distance.
+#define DISTANCE_QUANTISE 32767.0f
+
+//Closest point on triangle abc to p (Real-Time Collision Detection, 5.1.5).
+static void closestOnTriangle(const float* p, const float* a, const float* b, const float* c, float* closest) {
+	float ab[3], ac[3], ap[3];
+	for(int i = 0; i < 3; i++) {
+		ab[i] = b[i] - a[i];
+		ac[i] = c[i] - a[i];
+		ap[i] = p[i] - a[i];
+	}
+	float d1 = ab[0]*ap[0] + ab[1]*ap[1] + ab[2]*ap[2];
+	float d2 = ac[0]*ap[0] + ac[1]*ap[1] + ac[2]*ap[2];
+	if(d1 <= 0.0f && d2 <= 0.0f) {
+		memcpy(closest, a, 3 * sizeof(float));
+		return;
+	}
+
+	float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+	float d3 = ab[0]*bp[0] + ab[1]*bp[1] + ab[2]*bp[2];
+	float d4 = ac[0]*bp[0] + ac[1]*bp[1] + ac[2]*bp[2];
+	if(d3 >= 0.0f && d4 <= d3) {
+		memcpy(closest, b, 3 * sizeof(float));
+		return;
+	}
+
+	float vc = d1*d4 - d3*d2;
+	if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		float v = d1 / (d1 - d3);
+		for(int i = 0; i < 3; i++)
+			closest[i] = a[i] + v * ab[i];
+		return;
+	}
+
+	float cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+	float d5 = ab[0]*cp[0] + ab[1]*cp[1] + ab[2]*cp[2];
+	float d6 = ac[0]*cp[0] + ac[1]*cp[1] + ac[2]*cp[2];
+	if(d6 >= 0.0f && d5 <= d6) {
+		memcpy(closest, c, 3 * sizeof(float));
+		return;
+	}
+
+	float vb = d5*d2 - d1*d6;
+	if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		float w = d2 / (d2 - d6);
+		for(int i = 0; i < 3; i++)
+			closest[i] = a[i] + w * ac[i];
+		return;
+	}
+
+	float va = d3*d6 - d5*d4;
+	if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		for(int i = 0; i < 3; i++)
+			closest[i] = b[i] + w * (c[i] - b[i]);
+		return;
+	}
+
+	float denominator = 1.0f / (va + vb + vc);
+	float v = vb * denominator;
+	float w = vc * denominator;
+	for(int i = 0; i < 3; i++)
+		closest[i] = a[i] + ab[i] * v + ac[i] * w;
+}
+
+//Constructor, empty until baked.
+DistanceField::DistanceField() {
+	memset(origin, 0, sizeof(origin));
+	memset(bricks, 0, sizeof(bricks));
+	memset(cells, 0, sizeof(cells));
+	voxelSize = 1.0f;
+	inverseVoxelSize = 1.0f;
+	truncation = 0.0f;
+	bakeMilliseconds = 0.0;
+}
+
+//Destructor.
+DistanceField::~DistanceField() {
+
+	clear();
+
+}
+
+void DistanceField::clear() {
+	MemoryStats::remove(MEMORY_DISTANCE_FIELDS, numBytes());
+	vector<int>().swap(brickOffsets);
+	vector<short>().swap(samples);
+	memset(bricks, 0, sizeof(bricks));
+	memset(cells, 0, sizeof(cells));
+}
+
+bool DistanceField::isEmpty() {
+	return brickOffsets.empty();
+}
+
+void DistanceField::bake(const vector<float>& triangles, float newVoxelSize, float newTruncation, int numThreads) {
+	clear();
+
+	int numTriangles = triangles.size() / 9;
+	if(numTriangles == 0)
+		return;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	voxelSize = newVoxelSize;
+	inverseVoxelSize = 1.0f / voxelSize;
+	truncation = newTruncation;
+
+	//Each triangle's box, grown by the truncation so it covers every sample
+	//the triangle can affect.
+	vector<float> bounds(numTriangles * 6);
+	float low[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float high[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for(int t = 0; t < numTriangles; t++) {
+		const float* corners = &triangles[t * 9];
+		for(int axis = 0; axis < 3; axis++) {
+			float lowest = fminf(corners[axis], fminf(corners[3 + axis], corners[6 + axis])) - truncation;
+			float highest = fmaxf(corners[axis], fmaxf(corners[3 + axis], corners[6 + axis])) + truncation;
+			bounds[t * 6 + axis] = lowest;
+			bounds[t * 6 + 3 + axis] = highest;
+			low[axis] = fminf(low[axis], lowest);
+			high[axis] = fmaxf(high[axis], highest);
+		}
+	}
+
+	//Everything outside low..high is at least the truncation away. One
+	//more brick than needed all round, so the outermost samples are always
+	//free space for the flood fill to start from.
+	for(int axis = 0; axis < 3; axis++) {
+		bricks[axis] = (int) ceil((high[axis] - low[axis]) / (voxelSize * DISTANCE_BRICK_CELLS)) + 2;
+		cells[axis] = bricks[axis] * DISTANCE_BRICK_CELLS;
+		origin[axis] = low[axis] - voxelSize * DISTANCE_BRICK_CELLS;
+	}
+
+	//Unsigned distances for the whole grid first, bricks shared out between
+	//the threads. Each brick writes only its own samples (the far faces
+	//belong to the next brick over) so no two threads touch the same one.
+	vector<float> distances((cells[0] + 1) * (cells[1] + 1) * (cells[2] + 1), truncation);
+	atomic<int> nextBrick(0);
+
+	if(numThreads < 1)
+		numThreads = 1;
+	vector<thread> workers;
+	for(int i = 1; i < numThreads; i++)
+		workers.push_back(thread(&DistanceField::bakeBricks, this, cref(triangles), cref(bounds), ref(distances), ref(nextBrick)));
+	bakeBricks(triangles, bounds, distances, nextBrick);
+	for(int i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	applySigns(distances);
+	packBricks(distances);
+	MemoryStats::add(MEMORY_DISTANCE_FIELDS, numBytes());
+
+	bakeMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//Worker loop, bricks are handed out one at a time.
+void DistanceField::bakeBricks(const vector<float>& triangles, const vector<float>& bounds, vector<float>& distances, atomic<int>& nextBrick) {
+	int total = bricks[0] * bricks[1] * bricks[2];
+	for(int brick = nextBrick++; brick < total; brick = nextBrick++)
+		bakeBrick(brick, triangles, bounds, distances);
+}
+
+//Every triangle scatters into the samples within its grown box, so only
+//nearby pairs are ever measured.
+void DistanceField::bakeBrick(int brick, const vector<float>& triangles, const vector<float>& bounds, vector<float>& distances) {
+	int brickCell[3] = {
+		(brick % bricks[0]) * DISTANCE_BRICK_CELLS,
+		(brick / bricks[0] % bricks[1]) * DISTANCE_BRICK_CELLS,
+		(brick / (bricks[0] * bricks[1])) * DISTANCE_BRICK_CELLS
+	};
+	int owned[3];
+	float brickLow[3], brickHigh[3];
+	for(int axis = 0; axis < 3; axis++) {
+		owned[axis] = brickCell[axis] + DISTANCE_BRICK_CELLS == cells[axis] ? DISTANCE_BRICK_CELLS : DISTANCE_BRICK_CELLS - 1;
+		brickLow[axis] = origin[axis] + brickCell[axis] * voxelSize;
+		brickHigh[axis] = brickLow[axis] + owned[axis] * voxelSize;
+	}
+
+	float nearest[DISTANCE_BRICK_SAMPLES];
+	for(int i = 0; i < DISTANCE_BRICK_SAMPLES; i++)
+		nearest[i] = truncation * truncation;
+
+	int numTriangles = triangles.size() / 9;
+	for(int t = 0; t < numTriangles; t++) {
+		const float* box = &bounds[t * 6];
+		if(box[0] > brickHigh[0] || box[3] < brickLow[0] ||
+		   box[1] > brickHigh[1] || box[4] < brickLow[1] ||
+		   box[2] > brickHigh[2] || box[5] < brickLow[2])
+			continue;
+
+		const float* a = &triangles[t * 9];
+		int first[3], last[3];
+		for(int axis = 0; axis < 3; axis++) {
+			first[axis] = (int) ceil((box[axis] - brickLow[axis]) * inverseVoxelSize);
+			last[axis] = (int) floor((box[3 + axis] - brickLow[axis]) * inverseVoxelSize);
+			if(first[axis] < 0)
+				first[axis] = 0;
+			if(last[axis] > owned[axis])
+				last[axis] = owned[axis];
+		}
+
+		for(int z = first[2]; z <= last[2]; z++) {
+			for(int y = first[1]; y <= last[1]; y++) {
+				for(int x = first[0]; x <= last[0]; x++) {
+					float point[3] = { brickLow[0] + x * voxelSize, brickLow[1] + y * voxelSize, brickLow[2] + z * voxelSize };
+					float closest[3];
+					closestOnTriangle(point, a, a + 3, a + 6, closest);
+					float offset[3] = { point[0] - closest[0], point[1] - closest[1], point[2] - closest[2] };
+					float squared = offset[0]*offset[0] + offset[1]*offset[1] + offset[2]*offset[2];
+
+					int index = (z * DISTANCE_BRICK_SIDE + y) * DISTANCE_BRICK_SIDE + x;
+					if(squared < nearest[index])
+						nearest[index] = squared;
+				}
+			}
+		}
+	}
+
+	for(int z = 0; z <= owned[2]; z++)
+		for(int y = 0; y <= owned[1]; y++)
+			for(int x = 0; x <= owned[0]; x++)
+				distances[gridIndex(brickCell[0] + x, brickCell[1] + y, brickCell[2] + z)] =
+					sqrtf(nearest[(z * DISTANCE_BRICK_SIDE + y) * DISTANCE_BRICK_SIDE + x]);
+}
+
+//Inside and outside come from the grid rather than the triangles, so
+//scenery with open edges or inconsistent winding still gets sensible signs.
+//Flood fill from the border through every sample more than half a cell
+//from a surface (nothing can slip between two neighbouring samples without
+//passing that close to one of them). Whatever the fill can't reach is
+//enclosed, and goes negative.
+void DistanceField::applySigns(vector<float>& distances) {
+	int side[3] = { cells[0] + 1, cells[1] + 1, cells[2] + 1 };
+	float wall = voxelSize * 0.5f;
+
+	vector<unsigned char> outside(distances.size(), 0);
+	vector<int> queue;
+	for(int z = 0; z < side[2]; z++)
+		for(int y = 0; y < side[1]; y++)
+			for(int x = 0; x < side[0]; x++)
+				if(x == 0 || y == 0 || z == 0 || x == cells[0] || y == cells[1] || z == cells[2]) {
+					outside[gridIndex(x, y, z)] = 1;
+					queue.push_back(gridIndex(x, y, z));
+				}
+
+	int steps[6] = { 1, -1, side[0], -side[0], side[0] * side[1], -side[0] * side[1] };
+	for(int head = 0; head < queue.size(); head++) {
+		int index = queue[head];
+		int x = index % side[0], y = index / side[0] % side[1], z = index / (side[0] * side[1]);
+		bool open[6] = { x < cells[0], x > 0, y < cells[1], y > 0, z < cells[2], z > 0 };
+		for(int i = 0; i < 6; i++) {
+			int next = index + steps[i];
+			if(open[i] && !outside[next] && distances[next] > wall) {
+				outside[next] = 1;
+				queue.push_back(next);
+			}
+		}
+	}
+
+	//Samples on a surface are outside if they touch the fill.
+	for(int index = 0; index < distances.size(); index++) {
+		if(outside[index])
+			continue;
+		bool touching = false;
+		if(distances[index] <= wall) {
+			int x = index % side[0], y = index / side[0] % side[1], z = index / (side[0] * side[1]);
+			if(x > 0 && x < cells[0] && y > 0 && y < cells[1] && z > 0 && z < cells[2])
+				for(int i = 0; i < 6 && !touching; i++)
+					touching = outside[index + steps[i]] == 1;
+		}
+		if(!touching)
+			distances[index] = -distances[index];
+	}
+}
+
+//Quantise into bricks, anything flat at +-truncation shares a brick.
+void DistanceField::packBricks(const vector<float>& distances) {
+	int total = bricks[0] * bricks[1] * bricks[2];
+	brickOffsets.resize(total);
+
+	samples.resize(2 * DISTANCE_BRICK_SAMPLES);
+	for(int i = 0; i < DISTANCE_BRICK_SAMPLES; i++) {
+		samples[i] = (short) DISTANCE_QUANTISE;
+		samples[DISTANCE_BRICK_SAMPLES + i] = (short) -DISTANCE_QUANTISE;
+	}
+
+	short brick[DISTANCE_BRICK_SAMPLES];
+	for(int b = 0; b < total; b++) {
+		int brickCell[3] = {
+			(b % bricks[0]) * DISTANCE_BRICK_CELLS,
+			(b / bricks[0] % bricks[1]) * DISTANCE_BRICK_CELLS,
+			(b / (bricks[0] * bricks[1])) * DISTANCE_BRICK_CELLS
+		};
+
+		int i = 0;
+		bool flat = true;
+		for(int z = 0; z < DISTANCE_BRICK_SIDE; z++)
+			for(int y = 0; y < DISTANCE_BRICK_SIDE; y++)
+				for(int x = 0; x < DISTANCE_BRICK_SIDE; x++, i++) {
+					float distance = distances[gridIndex(brickCell[0] + x, brickCell[1] + y, brickCell[2] + z)];
+					float value = floorf(distance / truncation * DISTANCE_QUANTISE + 0.5f);
+					brick[i] = (short) (value > DISTANCE_QUANTISE ? DISTANCE_QUANTISE : (value < -DISTANCE_QUANTISE ? -DISTANCE_QUANTISE : value));
+					if(brick[i] != brick[0] || (brick[i] != (short) DISTANCE_QUANTISE && brick[i] != (short) -DISTANCE_QUANTISE))
+						flat = false;
+				}
+
+		if(flat)
+			brickOffsets[b] = brick[0] > 0 ? 0 : DISTANCE_BRICK_SAMPLES;
+		else {
+			brickOffsets[b] = samples.size();
+			samples.insert(samples.end(), brick, brick + DISTANCE_BRICK_SAMPLES);
+		}
+	}
+
+	//Trim the growth slack, the arrays are kept until the next bake.
+	vector<short>(samples).swap(samples);
+}
+
+int DistanceField::gridIndex(int x, int y, int z) const {
+	return (z * (cells[1] + 1) + y) * (cells[0] + 1) + x;
+}
+
+void DistanceField::sample(const float* points, int count, float* distances, float* gradients) const {
+	if(brickOffsets.empty()) {
+		for(int i = 0; i < count; i++) {
+			distances[i] = truncation;
+			gradients[i*3+0] = gradients[i*3+1] = gradients[i*3+2] = 0.0f;
+		}
+		return;
+	}
+
+	int i = 0;
+#ifdef DISTANCE_FIELD_SSE
+	for(; i + 4 <= count; i += 4)
+		sampleFour(points + i*3, distances + i, gradients + i*3);
+#endif
+	for(; i < count; i++)
+		sampleOne(points + i*3, distances + i, gradients + i*3);
+}
+
+//Trilinear filter of the eight samples around the point. The gradient is the
+//filter's own derivative, so it's exactly consistent with the distance.
+void DistanceField::sampleOne(const float* point, float* distance, float* gradient) const {
+	int cell[3];
+	float fraction[3];
+	for(int axis = 0; axis < 3; axis++) {
+		float position = (point[axis] - origin[axis]) * inverseVoxelSize;
+		float highest = cells[axis] - 0.001f;
+		position = position < 0.0f ? 0.0f : (position > highest ? highest : position);
+		cell[axis] = (int) position;
+		fraction[axis] = position - cell[axis];
+	}
+
+	int brick = ((cell[2] / DISTANCE_BRICK_CELLS) * bricks[1] + cell[1] / DISTANCE_BRICK_CELLS) * bricks[0] + cell[0] / DISTANCE_BRICK_CELLS;
+	const short* base = &samples[brickOffsets[brick] +
+		((cell[2] % DISTANCE_BRICK_CELLS) * DISTANCE_BRICK_SIDE + cell[1] % DISTANCE_BRICK_CELLS) * DISTANCE_BRICK_SIDE + cell[0] % DISTANCE_BRICK_CELLS];
+
+	const int Y = DISTANCE_BRICK_SIDE;
+	const int Z = DISTANCE_BRICK_SIDE * DISTANCE_BRICK_SIDE;
+	float c000 = base[0],		c100 = base[1];
+	float c010 = base[Y],		c110 = base[Y + 1];
+	float c001 = base[Z],		c101 = base[Z + 1];
+	float c011 = base[Z + Y],	c111 = base[Z + Y + 1];
+
+	float fx = fraction[0], fy = fraction[1], fz = fraction[2];
+	float c00 = c000 + fx * (c100 - c000);
+	float c10 = c010 + fx * (c110 - c010);
+	float c01 = c001 + fx * (c101 - c001);
+	float c11 = c011 + fx * (c111 - c011);
+	float c0 = c00 + fy * (c10 - c00);
+	float c1 = c01 + fy * (c11 - c01);
+
+	float dx0 = (c100 - c000) + fy * ((c110 - c010) - (c100 - c000));
+	float dx1 = (c101 - c001) + fy * ((c111 - c011) - (c101 - c001));
+
+	float scale = truncation / DISTANCE_QUANTISE;
+	*distance = (c0 + fz * (c1 - c0)) * scale;
+	gradient[0] = (dx0 + fz * (dx1 - dx0)) * scale * inverseVoxelSize;
+	gradient[1] = ((c10 - c00) + fz * ((c11 - c01) - (c10 - c00))) * scale * inverseVoxelSize;
+	gradient[2] = (c1 - c0) * scale * inverseVoxelSize;
+}
+
+#ifdef DISTANCE_FIELD_SSE
+//sampleOne for four points at once, one per lane. Only fetching the
+//corners is done lane by lane, SSE2 has no gather.
+void DistanceField::sampleFour(const float* points, float* distances, float* gradients) const {
+	__m128 fraction[3];
+	int cell[3][4];
+	for(int axis = 0; axis < 3; axis++) {
+		__m128 p = _mm_set_ps(points[9 + axis], points[6 + axis], points[3 + axis], points[axis]);
+		p = _mm_mul_ps(_mm_sub_ps(p, _mm_set1_ps(origin[axis])), _mm_set1_ps(inverseVoxelSize));
+		p = _mm_min_ps(_mm_max_ps(p, _mm_setzero_ps()), _mm_set1_ps(cells[axis] - 0.001f));
+		__m128i whole = _mm_cvttps_epi32(p);
+		fraction[axis] = _mm_sub_ps(p, _mm_cvtepi32_ps(whole));
+		_mm_storeu_si128((__m128i*) cell[axis], whole);
+	}
+
+	const int Y = DISTANCE_BRICK_SIDE;
+	const int Z = DISTANCE_BRICK_SIDE * DISTANCE_BRICK_SIDE;
+	float corners[8][4];
+	const short* data = &samples[0];
+	const int* offsets = &brickOffsets[0];
+	for(int lane = 0; lane < 4; lane++) {
+		unsigned int x = cell[0][lane], y = cell[1][lane], z = cell[2][lane];
+		unsigned int brick = ((z / DISTANCE_BRICK_CELLS) * bricks[1] + y / DISTANCE_BRICK_CELLS) * bricks[0] + x / DISTANCE_BRICK_CELLS;
+		const short* base = data + offsets[brick] +
+			((z % DISTANCE_BRICK_CELLS) * DISTANCE_BRICK_SIDE + y % DISTANCE_BRICK_CELLS) * DISTANCE_BRICK_SIDE + x % DISTANCE_BRICK_CELLS;
+		corners[0][lane] = base[0];
+		corners[1][lane] = base[1];
+		corners[2][lane] = base[Y];
+		corners[3][lane] = base[Y + 1];
+		corners[4][lane] = base[Z];
+		corners[5][lane] = base[Z + 1];
+		corners[6][lane] = base[Z + Y];
+		corners[7][lane] = base[Z + Y + 1];
+	}
+
+	__m128 c000 = _mm_loadu_ps(corners[0]), c100 = _mm_loadu_ps(corners[1]);
+	__m128 c010 = _mm_loadu_ps(corners[2]), c110 = _mm_loadu_ps(corners[3]);
+	__m128 c001 = _mm_loadu_ps(corners[4]), c101 = _mm_loadu_ps(corners[5]);
+	__m128 c011 = _mm_loadu_ps(corners[6]), c111 = _mm_loadu_ps(corners[7]);
+	__m128 fx = fraction[0], fy = fraction[1], fz = fraction[2];
+
+	__m128 x00 = _mm_sub_ps(c100, c000);
+	__m128 x10 = _mm_sub_ps(c110, c010);
+	__m128 x01 = _mm_sub_ps(c101, c001);
+	__m128 x11 = _mm_sub_ps(c111, c011);
+	__m128 c00 = _mm_add_ps(c000, _mm_mul_ps(fx, x00));
+	__m128 c10 = _mm_add_ps(c010, _mm_mul_ps(fx, x10));
+	__m128 c01 = _mm_add_ps(c001, _mm_mul_ps(fx, x01));
+	__m128 c11 = _mm_add_ps(c011, _mm_mul_ps(fx, x11));
+	__m128 c0 = _mm_add_ps(c00, _mm_mul_ps(fy, _mm_sub_ps(c10, c00)));
+	__m128 c1 = _mm_add_ps(c01, _mm_mul_ps(fy, _mm_sub_ps(c11, c01)));
+
+	__m128 dx0 = _mm_add_ps(x00, _mm_mul_ps(fy, _mm_sub_ps(x10, x00)));
+	__m128 dx1 = _mm_add_ps(x01, _mm_mul_ps(fy, _mm_sub_ps(x11, x01)));
+	__m128 dy0 = _mm_sub_ps(c10, c00);
+	__m128 dy1 = _mm_sub_ps(c11, c01);
+
+	__m128 scale = _mm_set1_ps(truncation / DISTANCE_QUANTISE);
+	__m128 gradientScale = _mm_set1_ps(truncation / DISTANCE_QUANTISE * inverseVoxelSize);
+	__m128 distance = _mm_mul_ps(_mm_add_ps(c0, _mm_mul_ps(fz, _mm_sub_ps(c1, c0))), scale);
+	__m128 gx = _mm_mul_ps(_mm_add_ps(dx0, _mm_mul_ps(fz, _mm_sub_ps(dx1, dx0))), gradientScale);
+	__m128 gy = _mm_mul_ps(_mm_add_ps(dy0, _mm_mul_ps(fz, _mm_sub_ps(dy1, dy0))), gradientScale);
+	__m128 gz = _mm_mul_ps(_mm_sub_ps(c1, c0), gradientScale);
+
+	_mm_storeu_ps(distances, distance);
+	float g[3][4];
+	_mm_storeu_ps(g[0], gx);
+	_mm_storeu_ps(g[1], gy);
+	_mm_storeu_ps(g[2], gz);
+	for(int lane = 0; lane < 4; lane++) {
+		gradients[lane*3+0] = g[0][lane];
+		gradients[lane*3+1] = g[1][lane];
+		gradients[lane*3+2] = g[2][lane];
+	}
+}
+#endif
+
+float DistanceField::getTruncation()	{ return truncation;						}
+int DistanceField::numBricks()			{ return brickOffsets.size();				}
+
+int DistanceField::numStoredBricks() {
+	return samples.empty() ? 0 : samples.size() / DISTANCE_BRICK_SAMPLES - 2;
+}
+
+size_t DistanceField::numBytes() {
+	return brickOffsets.size() * sizeof(int) + samples.size() * sizeof(short);
+}
+
+void DistanceField::printStats() {
+	printf("Distance field: %dx%dx%d cells of %.3f, %d of %d bricks stored, %lu bytes, baked in %.1f ms\n",
+		cells[0], cells[1], cells[2], voxelSize, numStoredBricks(), numBricks(), (unsigned long) numBytes(), bakeMilliseconds);
+}
@@ -0,0 +1,263 @@
+#include "include/DynamicResolution.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+//Constructor, nothing is allocated until create().
+DynamicResolution::DynamicResolution() {
+	enabled = true;
+	created = false;
+	target = 1000.0 / 60.0;
+	width = height = 0;
+	framebuffer = colorBuffer = depthBuffer = 0;
+	memset(queries, 0, sizeof(queries));
+	memset(queryPending, 0, sizeof(queryPending));
+	nextQuery = 0;
+	timerQueries = false;
+	framesSinceChange = 0;
+
+	memset(&stats, 0, sizeof(stats));
+	stats.scale = 1.0;
+}
+
+//Destructor.
+DynamicResolution::~DynamicResolution() {
+
+	//GL objects go with the context, which is gone by now at exit.
+
+}
+
+bool DynamicResolution::create(int windowWidth, int windowHeight) {
+	width = windowWidth;
+	height = windowHeight;
+
+	timerQueries = GLEW_ARB_timer_query != 0;
+	if(timerQueries)
+		glGenQueries(RESOLUTION_QUERIES, queries);
+
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &colorBuffer);
+	glGenRenderbuffers(1, &depthBuffer);
+	allocateTargets();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	created = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if(!created) {
+		printf("Dynamic resolution: offscreen buffer incomplete, rendering at full size\n");
+		releaseTargets();
+	}
+
+	stats.scale = 1.0;
+	stats.lodBias = 0.0;
+	updateRenderSize();
+	return created;
+}
+
+//The offscreen buffer is always the full window size, smaller frames only
+//use its bottom left corner so changing scale never reallocates anything.
+void DynamicResolution::resize(int windowWidth, int windowHeight) {
+	width = windowWidth;
+	height = windowHeight;
+	if(created)
+		allocateTargets();
+	updateRenderSize();
+}
+
+void DynamicResolution::allocateTargets() {
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width > 0 ? width : 1, height > 0 ? height : 1);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width > 0 ? width : 1, height > 0 ? height : 1);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+}
+
+void DynamicResolution::releaseTargets() {
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &colorBuffer);
+	glDeleteRenderbuffers(1, &depthBuffer);
+	framebuffer = colorBuffer = depthBuffer = 0;
+}
+
+void DynamicResolution::setTarget(double milliseconds) {
+	if(milliseconds > 0.0)
+		target = milliseconds;
+}
+
+//Switching off goes straight back to full size and full shading.
+void DynamicResolution::setEnabled(bool enable) {
+	enabled = enable;
+	if(!enabled) {
+		stats.scale = 1.0;
+		stats.lodBias = 0.0;
+		updateRenderSize();
+	}
+	framesSinceChange = 0;
+}
+
+bool DynamicResolution::isEnabled() {
+	return enabled;
+}
+
+void DynamicResolution::beginFrame() {
+	frameStart = chrono::steady_clock::now();
+	if(timerQueries)
+		glBeginQuery(GL_TIME_ELAPSED, queries[nextQuery]);
+
+	if(created && enabled) {
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glViewport(0, 0, stats.renderWidth, stats.renderHeight);
+	}
+	else {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, width, height);
+	}
+}
+
+void DynamicResolution::endFrame() {
+	if(created && enabled) {
+		//Nearest is exact at full size, linear smooths the upscale otherwise.
+		bool scaled = stats.renderWidth != width || stats.renderHeight != height;
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, stats.renderWidth, stats.renderHeight, 0, 0, width, height,
+			GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, width, height);
+	}
+
+	if(timerQueries) {
+		glEndQuery(GL_TIME_ELAPSED);
+		queryPending[nextQuery] = true;
+		nextQuery = (nextQuery + 1) % RESOLUTION_QUERIES;
+
+		double milliseconds;
+		if(readTimings(&milliseconds)) {
+			stats.gpuTimed = true;
+			control(milliseconds);
+		}
+	}
+	else {
+		stats.gpuTimed = false;
+		control(chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count());
+	}
+}
+
+//Collect whatever timer results have come back, oldest first, stopping at
+//the first one that hasn't. Gives the newest frame time found.
+bool DynamicResolution::readTimings(double* milliseconds) {
+	bool found = false;
+	for(int i = 0; i < RESOLUTION_QUERIES; i++) {
+		int query = (nextQuery + i) % RESOLUTION_QUERIES;
+		if(!queryPending[query])
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+		if(!available)
+			break;
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(queries[query], GL_QUERY_RESULT, &nanoseconds);
+		queryPending[query] = false;
+		*milliseconds = nanoseconds / 1000000.0;
+		found = true;
+	}
+	return found;
+}
+
+//Frame time goes roughly with the number of pixels shaded, so the scale that
+//would just meet the target is sqrt(target / time) of this one. Each change
+//goes part of the way there, and growing back is half as eager as shrinking
+//so a borderline load doesn't flicker between sizes.
+void DynamicResolution::control(double milliseconds) {
+	stats.lastMilliseconds = milliseconds;
+	stats.frames++;
+	if(milliseconds > target)
+		stats.framesOverTarget++;
+
+	//Results still in flight after a change were rendered at the old size,
+	//so skip those, start the average afresh, then give it time to settle.
+	framesSinceChange++;
+	if(stats.frames == 1 || framesSinceChange == RESOLUTION_QUERIES)
+		stats.frameMilliseconds = milliseconds;
+	else
+		stats.frameMilliseconds += RESOLUTION_SMOOTHING * (milliseconds - stats.frameMilliseconds);
+
+	if(!enabled || framesSinceChange < 2 * RESOLUTION_QUERIES)
+		return;
+
+	//Anything over the target is acted on, but there has to be real headroom
+	//before growing again or it would just go straight back over.
+	double ratio = target / stats.frameMilliseconds;
+	if(ratio >= 1.0 && ratio < 1.0 + RESOLUTION_DEADBAND)
+		return;
+	if(ratio < 0.25) ratio = 0.25;
+	if(ratio > 4.0) ratio = 4.0;
+
+	double scale = stats.scale;
+	double lodBias = stats.lodBias;
+
+	if(ratio < 1.0) {
+		//Over budget, lose resolution first and then shading detail.
+		if(scale > RESOLUTION_MIN_SCALE)
+			scale = max(RESOLUTION_MIN_SCALE, scale * pow(ratio, 0.5 * RESOLUTION_GAIN));
+		else
+			lodBias = min(1.0, lodBias + LOD_BIAS_STEP);
+	}
+	else {
+		//Headroom, win back shading detail before resolution.
+		if(lodBias > 0.0)
+			lodBias = max(0.0, lodBias - LOD_BIAS_STEP);
+		else
+			scale = min(1.0, scale * pow(ratio, 0.25 * RESOLUTION_GAIN));
+	}
+
+	if(lodBias != stats.lodBias) {
+		stats.lodBias = lodBias;
+		stats.lodChanges++;
+		framesSinceChange = 0;
+	}
+	if(scale != stats.scale) {
+		int oldWidth = stats.renderWidth;
+		int oldHeight = stats.renderHeight;
+		stats.scale = scale;
+		updateRenderSize();
+		if(stats.renderWidth != oldWidth || stats.renderHeight != oldHeight)
+			stats.scaleChanges++;
+		framesSinceChange = 0;
+	}
+}
+
+void DynamicResolution::updateRenderSize() {
+	stats.renderWidth = width;
+	stats.renderHeight = height;
+	if(stats.scale >= 1.0)
+		return;
+
+	int w = (int) floor(width * stats.scale / RESOLUTION_GRANULARITY + 0.5) * RESOLUTION_GRANULARITY;
+	int h = (int) floor(height * stats.scale / RESOLUTION_GRANULARITY + 0.5) * RESOLUTION_GRANULARITY;
+	stats.renderWidth = max(RESOLUTION_GRANULARITY, min(width, w));
+	stats.renderHeight = max(RESOLUTION_GRANULARITY, min(height, h));
+}
+
+double DynamicResolution::getShadingDistance() {
+	return LOD_SHADING_FAR - stats.lodBias * (LOD_SHADING_FAR - LOD_SHADING_NEAR);
+}
+
+const ResolutionStats& DynamicResolution::getStats() {
+	return stats;
+}
+
+void DynamicResolution::printStats() {
+	printf("Resolution: %s, target %.2f ms, frame %.2f ms (last %.2f ms, %s), %llu of %llu frames over\n",
+		!enabled ? "off" : (created ? "on" : "no offscreen buffer"), target,
+		stats.frameMilliseconds, stats.lastMilliseconds, stats.gpuTimed ? "GPU timed" : "CPU timed",
+		stats.framesOverTarget, stats.frames);
+	printf("Resolution: rendering %dx%d of %dx%d (scale %.2f), LOD bias %.2f (full shading within %.1f), %llu resizes, %llu LOD changes\n",
+		stats.renderWidth, stats.renderHeight, width, height, stats.scale,
+		stats.lodBias, getShadingDistance(), stats.scaleChanges, stats.lodChanges);
+}
@@ -0,0 +1,210 @@
+#include "include/FrameScheduler.h"
+#include <math.h>
+#include <string.h>
+#include <thread>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#pragma comment(lib, "winmm.lib")
+#else
+#include <time.h>
+#endif
+
+FrameScheduler* FrameScheduler::active = NULL;
+
+//CPU time used so far by the calling thread, and by the whole process.
+static double threadCpuMilliseconds() {
+#ifdef _WIN32
+	FILETIME created, exited, kernel, user;
+	if(!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user))
+		return 0.0;
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime; u.HighPart = user.dwHighDateTime;
+	return (k.QuadPart + u.QuadPart) / 10000.0;
+#else
+	timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+}
+
+static double processCpuMilliseconds() {
+#ifdef _WIN32
+	FILETIME created, exited, kernel, user;
+	if(!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user))
+		return 0.0;
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime; u.HighPart = user.dwHighDateTime;
+	return (k.QuadPart + u.QuadPart) / 10000.0;
+#else
+	timespec now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+}
+
+//Constructor, 60 frames a second drawn continuously until told otherwise.
+FrameScheduler::FrameScheduler() {
+	onDemand = false;
+	redrawRequested = true;
+	changeCheck = NULL;
+	frameCpuStart = 0.0;
+	havePresent = false;
+	historyCount = 0;
+	historyNext = 0;
+	processCpuMark = 0.0;
+	memset(intervals, 0, sizeof(intervals));
+	memset(cpuTimes, 0, sizeof(cpuTimes));
+	memset(&stats, 0, sizeof(stats));
+	setRate(60.0);
+}
+
+//Destructor.
+FrameScheduler::~FrameScheduler() {
+
+	if(active == this)
+		active = NULL;
+
+}
+
+void FrameScheduler::start(double framesPerSecond) {
+	setRate(framesPerSecond);
+	active = this;
+
+#ifdef _WIN32
+	//Otherwise GLUT's timers and our sleeps are only good to ~15 ms.
+	timeBeginPeriod(1);
+#endif
+
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	processCpuMark = processCpuMilliseconds();
+	processWallMark = now;
+	nextFrame = now;
+	arm(now);
+}
+
+void FrameScheduler::setRate(double framesPerSecond) {
+	if(framesPerSecond <= 0.0)
+		return;
+	intervalMilliseconds = 1000.0 / framesPerSecond;
+	interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(intervalMilliseconds));
+}
+
+void FrameScheduler::setOnDemand(bool demand) {
+	onDemand = demand;
+	redrawRequested = true;
+}
+
+bool FrameScheduler::isOnDemand() {
+	return onDemand;
+}
+
+void FrameScheduler::setChangeCheck(bool (*check)()) {
+	changeCheck = check;
+}
+
+void FrameScheduler::requestRedraw() {
+	redrawRequested = true;
+}
+
+void FrameScheduler::onTimer(int value) {
+	if(active != NULL)
+		active->tick();
+}
+
+//The timer fires a little before the frame is due, the rest of the wait is
+//yielded away so the frame starts on time without spinning a whole core.
+void FrameScheduler::tick() {
+	while(chrono::steady_clock::now() < nextFrame)
+		this_thread::yield();
+
+	if(!onDemand || redrawRequested || (changeCheck != NULL && changeCheck()))
+		glutPostRedisplay();
+	else {
+		stats.framesSkipped++;
+		//The gap to whatever's drawn next isn't a frame interval.
+		havePresent = false;
+	}
+
+	//Running behind, start again from now rather than rushing out the
+	//frames that were missed.
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	nextFrame += interval;
+	if(nextFrame < now)
+		nextFrame = now;
+	arm(now);
+}
+
+void FrameScheduler::arm(chrono::steady_clock::time_point now) {
+	double wait = chrono::duration<double, milli>(nextFrame - now).count() - FRAME_SPIN_MILLISECONDS;
+	glutTimerFunc(wait > 0.0 ? (unsigned int) wait : 0, onTimer, 0);
+}
+
+void FrameScheduler::beginFrame() {
+	frameCpuStart = threadCpuMilliseconds();
+	redrawRequested = false;
+}
+
+void FrameScheduler::endFrame() {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+	cpuTimes[historyNext] = threadCpuMilliseconds() - frameCpuStart;
+	intervals[historyNext] = havePresent ? chrono::duration<double, milli>(now - lastPresent).count() : -1.0;
+	historyNext = (historyNext + 1) % FRAME_HISTORY;
+	if(historyCount < FRAME_HISTORY)
+		historyCount++;
+
+	stats.framesRendered++;
+	if(havePresent && intervals[(historyNext + FRAME_HISTORY - 1) % FRAME_HISTORY] > 1.5 * intervalMilliseconds)
+		stats.framesLate++;
+
+	lastPresent = now;
+	havePresent = true;
+}
+
+//Averages over the history, and process CPU use since the last call.
+void FrameScheduler::updateStats() {
+	double total = 0.0, totalSquared = 0.0, worst = 0.0, cpu = 0.0;
+	int timed = 0;
+	for(int i = 0; i < historyCount; i++) {
+		cpu += cpuTimes[i];
+		if(intervals[i] < 0.0)
+			continue;
+		total += intervals[i];
+		totalSquared += intervals[i] * intervals[i];
+		if(intervals[i] > worst)
+			worst = intervals[i];
+		timed++;
+	}
+
+	stats.renderCpuMilliseconds = historyCount > 0 ? cpu / historyCount : 0.0;
+	stats.averageMilliseconds = timed > 0 ? total / timed : 0.0;
+	stats.jitterMilliseconds = timed > 1 ? sqrt(max(0.0, totalSquared / timed - stats.averageMilliseconds * stats.averageMilliseconds)) : 0.0;
+	stats.worstMilliseconds = worst;
+
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double processCpu = processCpuMilliseconds();
+	double wall = chrono::duration<double, milli>(now - processWallMark).count();
+	if(wall > 0.0)
+		stats.processCpuPercent = 100.0 * (processCpu - processCpuMark) / wall;
+	processCpuMark = processCpu;
+	processWallMark = now;
+}
+
+const FrameStats& FrameScheduler::getStats() {
+	updateStats();
+	return stats;
+}
+
+void FrameScheduler::printStats() {
+	updateStats();
+	printf("Frames: %s at %.1f fps, %llu drawn, %llu skipped as unchanged, %llu late\n",
+		onDemand ? "on demand" : "continuous", 1000.0 / intervalMilliseconds,
+		stats.framesRendered, stats.framesSkipped, stats.framesLate);
+	printf("Frames: interval %.2f ms (jitter %.2f ms, worst %.2f ms), render thread CPU %.2f ms a frame, process CPU %.0f%% since last asked\n",
+		stats.averageMilliseconds, stats.jitterMilliseconds, stats.worstMilliseconds,
+		stats.renderCpuMilliseconds, stats.processCpuPercent);
+}
@@ -0,0 +1,155 @@
+#include "include/GeometryPool.h"
+#include "include/Mesh.h"
+
+//Constructor, nothing touches GL until the first allocation.
+GeometryPool::GeometryPool() {
+	vao = 0;
+	positionBuffer = normalBuffer = texCoordBuffer = indexBuffer = 0;
+	numRanges = 0;
+	numGrows = 0;
+}
+
+//Destructor.
+GeometryPool::~GeometryPool() {
+
+	if(vao != 0) {
+		GLuint buffers[4] = { positionBuffer, normalBuffer, texCoordBuffer, indexBuffer };
+		glDeleteBuffers(4, buffers);
+		glDeleteVertexArrays(1, &vao);
+		MemoryStats::remove(MEMORY_GL_BUFFERS,
+			(long long) vertices.getCapacity() * GEOMETRY_BYTES_PER_VERTEX + (long long) indices.getCapacity() * sizeof(GLuint));
+	}
+
+}
+
+void GeometryPool::create() {
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &positionBuffer);
+	glGenBuffers(1, &normalBuffer);
+	glGenBuffers(1, &texCoordBuffer);
+	glGenBuffers(1, &indexBuffer);
+
+	resizeBuffer(GL_ARRAY_BUFFER, positionBuffer, 0, GEOMETRY_INITIAL_VERTICES * GEOMETRY_VERTEX_BYTES);
+	resizeBuffer(GL_ARRAY_BUFFER, normalBuffer, 0, GEOMETRY_INITIAL_VERTICES * GEOMETRY_VERTEX_BYTES);
+	resizeBuffer(GL_ARRAY_BUFFER, texCoordBuffer, 0, GEOMETRY_INITIAL_VERTICES * GEOMETRY_TEXCOORD_BYTES);
+	resizeBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer, 0, GEOMETRY_INITIAL_INDICES * sizeof(GLuint));
+	vertices.grow(GEOMETRY_INITIAL_VERTICES);
+	indices.grow(GEOMETRY_INITIAL_INDICES);
+	MemoryStats::add(MEMORY_GL_BUFFERS, GEOMETRY_INITIAL_VERTICES * GEOMETRY_BYTES_PER_VERTEX + GEOMETRY_INITIAL_INDICES * sizeof(GLuint));
+
+	bindLayout();
+}
+
+void GeometryPool::allocate(GLuint numVertices, GLuint numIndices, GeometryRange& range) {
+	if(vao == 0)
+		create();
+
+	long long vertex = vertices.allocate(numVertices);
+	if(vertex < 0) {
+		growVertices(numVertices);
+		vertex = vertices.allocate(numVertices);
+	}
+	long long index = indices.allocate(numIndices);
+	if(index < 0) {
+		growIndices(numIndices);
+		index = indices.allocate(numIndices);
+	}
+
+	range.baseVertex = (GLint) vertex;
+	range.firstIndex = (GLuint) index;
+	range.numVertices = numVertices;
+	range.numIndices = numIndices;
+	numRanges++;
+}
+
+void GeometryPool::release(const GeometryRange& range) {
+	vertices.release(range.baseVertex, range.numVertices);
+	indices.release(range.firstIndex, range.numIndices);
+	numRanges--;
+}
+
+//Double until the request fits in one free range on the end.
+void GeometryPool::growVertices(GLuint needed) {
+	GLuint oldCapacity = vertices.getCapacity();
+	GLuint newCapacity = oldCapacity;
+	while(newCapacity - oldCapacity < needed)
+		newCapacity *= 2;
+
+	resizeBuffer(GL_ARRAY_BUFFER, positionBuffer, oldCapacity * GEOMETRY_VERTEX_BYTES, newCapacity * GEOMETRY_VERTEX_BYTES);
+	resizeBuffer(GL_ARRAY_BUFFER, normalBuffer, oldCapacity * GEOMETRY_VERTEX_BYTES, newCapacity * GEOMETRY_VERTEX_BYTES);
+	resizeBuffer(GL_ARRAY_BUFFER, texCoordBuffer, oldCapacity * GEOMETRY_TEXCOORD_BYTES, newCapacity * GEOMETRY_TEXCOORD_BYTES);
+	vertices.grow(newCapacity);
+	MemoryStats::add(MEMORY_GL_BUFFERS, (long long) (newCapacity - oldCapacity) * GEOMETRY_BYTES_PER_VERTEX);
+	numGrows++;
+
+	bindLayout();
+}
+
+void GeometryPool::growIndices(GLuint needed) {
+	GLuint oldCapacity = indices.getCapacity();
+	GLuint newCapacity = oldCapacity;
+	while(newCapacity - oldCapacity < needed)
+		newCapacity *= 2;
+
+	resizeBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer, oldCapacity * sizeof(GLuint), newCapacity * sizeof(GLuint));
+	indices.grow(newCapacity);
+	MemoryStats::add(MEMORY_GL_BUFFERS, (long long) (newCapacity - oldCapacity) * sizeof(GLuint));
+	numGrows++;
+
+	bindLayout();
+}
+
+//Swap a buffer for a bigger one with the old contents copied to the front,
+//GPU side so nothing comes back to us.
+void GeometryPool::resizeBuffer(GLenum target, GLuint& buffer, GLuint oldBytes, GLuint newBytes) {
+	//Element buffers are vao state, so only touch them with no vao bound.
+	glBindVertexArray(0);
+
+	GLuint bigger;
+	glGenBuffers(1, &bigger);
+	glBindBuffer(target, bigger);
+	glBufferData(target, newBytes, NULL, GL_STATIC_DRAW);
+	glBindBuffer(target, 0);
+
+	if(oldBytes > 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+	}
+	else if(buffer != 0)
+		glDeleteBuffers(1, &buffer);
+
+	buffer = bigger;
+}
+
+//Point the vao at the current buffers, after creating or growing them.
+void GeometryPool::bindLayout() {
+	glBindVertexArray( vao );
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer );
+
+	glBindBuffer( GL_ARRAY_BUFFER, positionBuffer );
+	glEnableVertexAttribArray( ATTRIBUTE_POSITION );
+	glVertexAttribPointer( ATTRIBUTE_POSITION, 4, GL_DOUBLE, GL_FALSE, 0, BUFFER_OFFSET(0) );
+
+	glBindBuffer( GL_ARRAY_BUFFER, normalBuffer );
+	glEnableVertexAttribArray( ATTRIBUTE_NORMAL );
+	glVertexAttribPointer( ATTRIBUTE_NORMAL, 4, GL_DOUBLE, GL_FALSE, 0, BUFFER_OFFSET(0) );
+
+	glBindBuffer( GL_ARRAY_BUFFER, texCoordBuffer );
+	glEnableVertexAttribArray( ATTRIBUTE_TEXCOORD );
+	glVertexAttribPointer( ATTRIBUTE_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0) );
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void GeometryPool::printStats() {
+	printf("Geometry: %u meshes, %u of %u vertices (%u free ranges, largest %u), %u of %u indices (%u free ranges, largest %u), grown %u times\n",
+		numRanges, vertices.getUsed(), vertices.getCapacity(), vertices.numFreeRanges(), vertices.largestFreeRange(),
+		indices.getUsed(), indices.getCapacity(), indices.numFreeRanges(), indices.largestFreeRange(), numGrows);
+}
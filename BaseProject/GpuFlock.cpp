@@ -0,0 +1,296 @@
+#include "include/GpuFlock.h"
+#include "include/InitShader.h"
+#include "include/AssetLoader.h"
+#include "include/RenderQueue.h"
+#include <string.h>
+#include <chrono>
+
+//Inputs of both passes, bound to these locations in this order.
+static const char* flockInputs[] = { "vTranslation", "vRotation", "vMotion", "vFlags", "vPivot", "vBounds", "vFlapShape" };
+static const char* stepOutputs[] = { "oTranslation", "oRotation", "oMotion", "oFlags", "oPivot" };
+static const char* partOutputs[] = { "oModelView0", "oModelView1", "oModelView2", "oModelView3", "oFlap" };
+
+#define NUM_BIRD_PARTS (NUM_ENTITY_KINDS - FIRST_BIRD_KIND)
+
+//Constructor, nothing touches GL until create().
+GpuFlock::GpuFlock() {
+	stepProgram = partsProgram = 0;
+	numCommandsLocation = commandsLocation = -1;
+	stateBuffers[0] = stateBuffers[1] = 0;
+	stateVaos[0] = stateVaos[1] = 0;
+	current = 0;
+	shapeBuffer = partBuffer = 0;
+	drawVao = 0;
+	for(int i = 0; i < NUM_ENTITY_KINDS; i++)
+		proxies[i] = NULL;
+	numBirds = 0;
+	started = false;
+	startSeconds = 0.0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+//Destructor.
+GpuFlock::~GpuFlock() {
+
+	if(stateVaos[0] != 0) {
+		glDeleteBuffers(2, stateBuffers);
+		glDeleteBuffers(1, &shapeBuffer);
+		glDeleteBuffers(1, &partBuffer);
+		glDeleteVertexArrays(2, stateVaos);
+		glDeleteVertexArrays(1, &drawVao);
+	}
+
+	for(int i = 0; i < NUM_ENTITY_KINDS; i++)
+		Object::destroy(proxies[i]);
+
+}
+
+bool GpuFlock::isSupported() {
+	return GLEW_VERSION_3_2;
+}
+
+bool GpuFlock::create(const vector<BirdRecord>& birds) {
+	if(!isSupported()) {
+		fprintf(stderr, "GPU flock: transform feedback isn't supported here\n");
+		return false;
+	}
+	numBirds = birds.size();
+	stats.birds = numBirds;
+	if(numBirds == 0)
+		return true;
+
+	stepProgram = InitFeedbackShader("shaders/flockStep.glsl", flockInputs, 7, stepOutputs, 5);
+	numCommandsLocation = glGetUniformLocation(stepProgram, "NumCommands");
+	commandsLocation = glGetUniformLocation(stepProgram, "Commands");
+	partsProgram = InitFeedbackShader("shaders/flockParts.glsl", flockInputs, 7, partOutputs, 5);
+
+	//Everything the shaders need comes from the body, the other parts only
+	//differ from it by their place on the skeleton.
+	vector<GLfloat> state(numBirds * GPU_BIRD_STATE_FLOATS);
+	vector<GLfloat> shape(numBirds * GPU_BIRD_SHAPE_FLOATS);
+	for(unsigned int i = 0; i < numBirds; i++) {
+		const BirdRecord& bird = birds[i];
+		const PartState& body = bird.parts[KIND_BIRD_BODY];
+		GLfloat* s = &state[i * GPU_BIRD_STATE_FLOATS];
+		GLfloat values[GPU_BIRD_STATE_FLOATS] = {
+			(GLfloat) body.translation[0], (GLfloat) body.translation[1], (GLfloat) body.translation[2], (GLfloat) body.crashTravel,
+			(GLfloat) body.rotation[0], (GLfloat) body.rotation[1], (GLfloat) body.rotation[2], (GLfloat) body.forwardSpeed,
+			(GLfloat) body.rotationSpeed[0], (GLfloat) body.rotationSpeed[1], (GLfloat) body.rotationSpeed[2], (GLfloat) body.translationSpeed[1],
+			(GLfloat) (bird.falling != 0), (GLfloat) (bird.staticDrop != 0), (GLfloat) (body.isCrashed != 0), 0.0f,
+			(GLfloat) body.translation[0], (GLfloat) body.translation[1], (GLfloat) body.translation[2], 0.0f
+		};
+		memcpy(s, values, sizeof(values));
+
+		GLfloat* f = &shape[i * GPU_BIRD_SHAPE_FLOATS];
+		GLfloat fixed[GPU_BIRD_SHAPE_FLOATS] = {
+			(GLfloat) bird.flyingBounds[0], (GLfloat) bird.flyingBounds[1], (GLfloat) bird.flyingBounds[2], 0.0f,
+			(GLfloat) bird.flapPhase, (GLfloat) bird.flapFrequency, (GLfloat) bird.flapAmplitude, 0.0f
+		};
+		memcpy(f, fixed, sizeof(fixed));
+	}
+
+	glGenBuffers(2, stateBuffers);
+	for(int i = 0; i < 2; i++) {
+		glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[i]);
+		glBufferData(GL_ARRAY_BUFFER, state.size() * sizeof(GLfloat), &state[0], GL_DYNAMIC_COPY);
+	}
+	glGenBuffers(1, &shapeBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, shapeBuffer);
+	glBufferData(GL_ARRAY_BUFFER, shape.size() * sizeof(GLfloat), &shape[0], GL_STATIC_DRAW);
+	glGenBuffers(1, &partBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, partBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (size_t) numBirds * NUM_BIRD_PARTS * INSTANCE_FLOATS * sizeof(GLfloat), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenVertexArrays(2, stateVaos);
+	for(int i = 0; i < 2; i++)
+		bindInputs(stateVaos[i], stateBuffers[i]);
+	glGenVertexArrays(1, &drawVao);
+
+	//Same meshes and shader as a bird's own parts.
+	const char* files[NUM_ENTITY_KINDS] = { NULL, "sphere.obj", "sphere.obj", "wing.obj", "wing.obj" };
+	for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++) {
+		proxies[i] = Object::create((char*) files[i], "GpuFlockProxy", (EntityKind) i);
+		proxies[i]->setupData(0, "shaders/birdVertexShader.glsl");
+		proxies[i]->setTexture(BIRD_TEXTURE);
+	}
+
+	//Something to draw before the first step.
+	writeParts();
+	return true;
+}
+
+//A state buffer and the fixed data, as attributes one bird per vertex.
+void GpuFlock::bindInputs(GLuint vao, GLuint stateBuffer) {
+	GLsizei stateStride = GPU_BIRD_STATE_FLOATS * sizeof(GLfloat);
+	GLsizei shapeStride = GPU_BIRD_SHAPE_FLOATS * sizeof(GLfloat);
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, stateBuffer);
+	for(int i = 0; i < 5; i++) {
+		glEnableVertexAttribArray(i);
+		glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, stateStride, BUFFER_OFFSET(i * 4 * sizeof(GLfloat)));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, shapeBuffer);
+	for(int i = 0; i < 2; i++) {
+		glEnableVertexAttribArray(5 + i);
+		glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, shapeStride, BUFFER_OFFSET(i * 4 * sizeof(GLfloat)));
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GpuFlock::sendCommand(WorldCommandType type, double value) {
+	if(type != COMMAND_STEER && type != COMMAND_FALL)
+		return;
+	commands.push_back((GLfloat) type);
+	commands.push_back((GLfloat) value);
+}
+
+//One step: the state pass into the other buffer, then the parts from it.
+void GpuFlock::step() {
+	if(numBirds == 0)
+		return;
+
+	int count = min((int) commands.size() / 2, GPU_FLOCK_MAX_COMMANDS);
+
+	glUseProgram(stepProgram);
+	glUniform1i(numCommandsLocation, count);
+	if(count > 0)
+		glUniform2fv(commandsLocation, count, &commands[0]);
+	commands.erase(commands.begin(), commands.begin() + count * 2);
+
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(stateVaos[current]);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, stateBuffers[1 - current]);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, numBirds);
+	glEndTransformFeedback();
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	current = 1 - current;
+	writeParts();
+	stats.steps++;
+}
+
+//Instance i of the draw is part i, and feedback captures whole instances
+//in turn, so the parts come out grouped by kind.
+void GpuFlock::writeParts() {
+	glUseProgram(partsProgram);
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(stateVaos[current]);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, partBuffer);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArraysInstanced(GL_POINTS, 0, numBirds, NUM_BIRD_PARTS);
+	glEndTransformFeedback();
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+}
+
+void GpuFlock::advance(double seconds, double stepsPerSecond) {
+	if(!started) {
+		startSeconds = seconds;
+		started = true;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	unsigned long long due = (unsigned long long) ((seconds - startSeconds) * stepsPerSecond);
+	unsigned long long ran = stats.steps + stats.stepsDropped;
+	if(due > ran + GPU_FLOCK_MAX_CATCHUP) {
+		stats.stepsDropped += due - ran - GPU_FLOCK_MAX_CATCHUP;
+		ran = due - GPU_FLOCK_MAX_CATCHUP;
+	}
+	for(; ran < due; ran++)
+		step();
+
+	stats.submitMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//Each kind is one instanced draw straight from the part buffer, through a
+//vao of our own pointed at the shared geometry (which may have grown).
+void GpuFlock::draw(const GLfloat* projection, GLfloat seconds) {
+	if(numBirds == 0)
+		return;
+
+	GeometryPool& geometry = assetLoader.getGeometry();
+	if(geometry.getVao() == 0)
+		return;
+
+	glBindVertexArray(drawVao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.getIndexBuffer());
+	glBindBuffer(GL_ARRAY_BUFFER, geometry.getPositionBuffer());
+	glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+	glVertexAttribPointer(ATTRIBUTE_POSITION, 4, GL_DOUBLE, GL_FALSE, 0, BUFFER_OFFSET(0));
+	glBindBuffer(GL_ARRAY_BUFFER, geometry.getNormalBuffer());
+	glEnableVertexAttribArray(ATTRIBUTE_NORMAL);
+	glVertexAttribPointer(ATTRIBUTE_NORMAL, 4, GL_DOUBLE, GL_FALSE, 0, BUFFER_OFFSET(0));
+	glBindBuffer(GL_ARRAY_BUFFER, geometry.getTexCoordBuffer());
+	glEnableVertexAttribArray(ATTRIBUTE_TEXCOORD);
+	glVertexAttribPointer(ATTRIBUTE_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+
+	glBindBuffer(GL_ARRAY_BUFFER, partBuffer);
+	for(int column = 0; column < 4; column++) {
+		glEnableVertexAttribArray(ATTRIBUTE_MODELVIEW + column);
+		glVertexAttribDivisor(ATTRIBUTE_MODELVIEW + column, 1);
+	}
+	glEnableVertexAttribArray(ATTRIBUTE_FLAP);
+	glVertexAttribDivisor(ATTRIBUTE_FLAP, 1);
+
+	GLsizei stride = INSTANCE_FLOATS * sizeof(GLfloat);
+	for(int kind = FIRST_BIRD_KIND; kind < NUM_ENTITY_KINDS; kind++) {
+		Mesh* mesh = proxies[kind]->getMesh();
+		if(mesh->getState() != MESH_READY)
+			mesh = assetLoader.getPlaceholder();
+		if(mesh->getNumIndices() == 0)
+			continue;
+
+		const ShadingProgram& use = proxies[kind]->getShading(SHADING_FULL);
+		glUseProgram(use.program);
+		glBindTexture(GL_TEXTURE_2D, assetLoader.useTexture(proxies[kind]->getTexture()));
+		glUniformMatrix4fv(use.projection, 1, GL_FALSE, projection);
+		if(use.time >= 0)
+			glUniform1f(use.time, seconds);
+
+		size_t base = (size_t) (kind - FIRST_BIRD_KIND) * numBirds * stride;
+		for(int column = 0; column < 4; column++)
+			glVertexAttribPointer(ATTRIBUTE_MODELVIEW + column, 4, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(base + column * 4 * sizeof(GLfloat)));
+		glVertexAttribPointer(ATTRIBUTE_FLAP, 4, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(base + 16 * sizeof(GLfloat)));
+
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh->getNumIndices(), GL_UNSIGNED_INT,
+			BUFFER_OFFSET(mesh->getFirstIndex() * sizeof(GLuint)), numBirds, mesh->getBaseVertex());
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GpuFlock::readState(vector<GLfloat>& state) {
+	state.resize(numBirds * GPU_BIRD_STATE_FLOATS);
+	if(numBirds == 0)
+		return;
+	glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[current]);
+	glGetBufferSubData(GL_ARRAY_BUFFER, 0, state.size() * sizeof(GLfloat), &state[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GpuFlock::readParts(vector<GLfloat>& parts) {
+	parts.resize((size_t) numBirds * NUM_BIRD_PARTS * INSTANCE_FLOATS);
+	if(numBirds == 0)
+		return;
+	glBindBuffer(GL_ARRAY_BUFFER, partBuffer);
+	glGetBufferSubData(GL_ARRAY_BUFFER, 0, parts.size() * sizeof(GLfloat), &parts[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+const GpuFlockStats& GpuFlock::getStats() {
+	return stats;
+}
+
+void GpuFlock::printStats() {
+	printf("GPU flock: %u birds, %llu steps (%llu dropped catching up), %.3f ms to issue last frame's steps\n",
+		stats.birds, stats.steps, stats.stepsDropped, stats.submitMilliseconds);
+}
@@ -0,0 +1,97 @@
+#include "include/GpuParity.h"
+#include "include/RandomRange.h"
+#include <stdlib.h>
+#include <math.h>
+
+//The same input to both sides, picked up at the start of the next step.
+static void parityCommand(World& world, GpuFlock& flock, WorldCommandType type, double value) {
+	world.sendCommand(type, value);
+	flock.sendCommand(type, value);
+}
+
+int runGpuParity(int numBirds, int steps, double tolerance) {
+	printf("GPU parity: %d birds for %d steps, tolerance %g\n", numBirds, steps, tolerance);
+
+	//Start low down so every bird lands within a few steps of the others,
+	//contact wakes are a CPU only detail and nobody is asleep to be woken.
+	srand(1);
+	World world(true);
+	for(int i = 0; i < numBirds; i++)
+		world.spawnBird(randomRange(-1.8, 1.8), randomRange(0.0, 0.2), randomRange(-1.8, 1.8));
+	world.sendCommand(COMMAND_WIND, 0.0);
+
+	const vector<Bird*>& birds = world.getBirds();
+	vector<BirdRecord> records(birds.size());
+	for(int i = 0; i < birds.size(); i++)
+		birds[i]->exportRecord(records[i]);
+
+	GpuFlock flock;
+	if(!flock.create(records))
+		return 1;
+
+	//Compared after every step, so a bird is caught the moment it diverges.
+	vector<GLfloat> state;
+	vector<GLfloat> parts;
+	vector<bool> diverged(numBirds, false);
+	unsigned int numDiverged = 0;
+	double worstPosition = 0.0;
+	double worstMatrix = 0.0;
+
+	for(int step = 1; step <= steps; step++) {
+		if(step == 1)
+			parityCommand(world, flock, COMMAND_FALL, 0.0);
+		else if(step == 320 || step == 480)
+			parityCommand(world, flock, COMMAND_STEER, step == 320 ? 30.0 : -45.0);
+		else if(step == 360)
+			parityCommand(world, flock, COMMAND_FALL, 1.0);
+
+		world.step();
+		flock.step();
+
+		flock.readState(state);
+		flock.readParts(parts);
+
+		unsigned int falling = 0, crashed = 0, asleep = 0;
+		for(int i = 0; i < numBirds; i++) {
+			Object* body = birds[i]->getPart(KIND_BIRD_BODY);
+			falling += birds[i]->isFalling();
+			crashed += body->isCrashed;
+			asleep += birds[i]->asleep;
+			if(diverged[i])
+				continue;
+
+			const GLfloat* s = &state[i * GPU_BIRD_STATE_FLOATS];
+			double position = 0.0;
+			for(int axis = 0; axis < 3; axis++)
+				position = max(position, fabs(body->getTranslation()[axis] - s[axis]));
+
+			double matrix = 0.0;
+			for(int kind = FIRST_BIRD_KIND; kind < NUM_ENTITY_KINDS; kind++) {
+				SnapshotEntry entry;
+				birds[i]->getPart((EntityKind) kind)->writeSnapshot(entry);
+				const GLfloat* p = &parts[((kind - FIRST_BIRD_KIND) * numBirds + i) * INSTANCE_FLOATS];
+				for(int k = 0; k < 16; k++)
+					matrix = max(matrix, (double) fabs(entry.modelView[k] - p[k]));
+			}
+
+			//Falling, crashed and asleep have to agree as well.
+			bool sameState = (s[12] != 0.0f) == birds[i]->isFalling() && (s[14] != 0.0f) == body->isCrashed && (s[15] != 0.0f) == birds[i]->asleep;
+			if(!sameState || position > tolerance || matrix > tolerance) {
+				diverged[i] = true;
+				numDiverged++;
+				continue;
+			}
+			worstPosition = max(worstPosition, position);
+			worstMatrix = max(worstMatrix, matrix);
+		}
+
+		if(step % GPU_PARITY_INTERVAL == 0 || step == steps)
+			printf("Step %d (%u falling, %u crashed, %u asleep): largest position difference %.2e, matrix difference %.2e, %u birds diverged\n",
+				step, falling, crashed, asleep, worstPosition, worstMatrix, numDiverged);
+	}
+
+	bool passed = numDiverged <= numBirds * GPU_PARITY_MAX_DIVERGED;
+	printf("GPU parity: %s, %u of %d birds diverged, the rest within %.2e in position and %.2e in every matrix entry\n",
+		passed ? "passed" : "FAILED", numDiverged, numBirds, worstPosition, worstMatrix);
+	return passed ? 0 : 1;
+}
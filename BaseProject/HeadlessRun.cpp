@@ -0,0 +1,75 @@
+#include "include/HeadlessRun.h"
+#include "include/RandomRange.h"
+#include <stdlib.h>
+#include <signal.h>
+#include <chrono>
+
+//Set from the interrupt handler, the run winds down cleanly so the
+//published memory's name is given back.
+static volatile sig_atomic_t interrupted = 0;
+
+static void onInterrupt(int signalNumber) {
+	interrupted = 1;
+}
+
+int runHeadless(double seconds, int numBirds, const char* sceneFile, const char* publishName) {
+	World world(true);
+	world.create(0, sceneFile);
+	srand(1234);
+	for(int i = 0; i < numBirds; i++)
+		world.spawnBird(randomRange(-1.5, 1.5), randomRange(-1.0, 1.5), randomRange(-1.5, 1.5));
+
+	SnapshotPublisher publisher;
+	if(publishName != NULL) {
+		if(!publisher.create(publishName))
+			return EXIT_FAILURE;
+		world.setPublisher(&publisher);
+	}
+
+	signal(SIGINT, onInterrupt);
+	signal(SIGTERM, onInterrupt);
+	if(seconds > 0.0)
+		printf("Headless: %d birds for %.0f seconds\n", world.numBirds(), seconds);
+	else
+		printf("Headless: %d birds until interrupted\n", world.numBirds());
+
+	//Stepped here rather than on the world's own thread, paced to 60 a second.
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	chrono::steady_clock::time_point due = start;
+	chrono::steady_clock::duration interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / 60.0));
+	double elapsed = 0.0;
+	double nextReport = HEADLESS_REPORT_SECONDS;
+	double stepMilliseconds = 0.0;
+	double maxStepMilliseconds = 0.0;
+	unsigned long long reportSteps = 0;
+
+	while((seconds <= 0.0 || elapsed < seconds) && !interrupted) {
+		chrono::steady_clock::time_point stepStart = chrono::steady_clock::now();
+		world.step();
+		double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - stepStart).count();
+		stepMilliseconds += milliseconds;
+		maxStepMilliseconds = max(maxStepMilliseconds, milliseconds);
+		reportSteps++;
+
+		//Fallen behind, carry on from now rather than rushing to catch up.
+		due += interval;
+		if(due < chrono::steady_clock::now())
+			due = chrono::steady_clock::now();
+		this_thread::sleep_until(due);
+		elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		if(elapsed >= nextReport) {
+			printf("Headless: %.0f seconds, step %llu, %.3f ms a step (max %.3f)\n",
+				elapsed, world.getStepCount(), stepMilliseconds / reportSteps, maxStepMilliseconds);
+			publisher.printStats();
+			stepMilliseconds = maxStepMilliseconds = 0.0;
+			reportSteps = 0;
+			nextReport += HEADLESS_REPORT_SECONDS;
+		}
+	}
+	world.setPublisher(NULL);
+
+	printf("Headless: stopped at step %llu after %.1f seconds\n", world.getStepCount(), elapsed);
+	publisher.printStats();
+	return EXIT_SUCCESS;
+}
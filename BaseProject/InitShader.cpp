@@ -3,7 +3,9 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <map>
 #include "include/InitShader.h"
+#include "include/Mesh.h"
 using namespace std;
 
 static char*
@@ -26,31 +28,51 @@ readShaderSource(const char* shaderFile)
     return buf;
 }
 
+// Defines go straight after the #version line, which has to stay first
+static string
+addDefines(const char* source, const char* defines)
+{
+    string text(source);
+    if ( defines == NULL )
+	return text;
+
+    size_t lineEnd = text.find('\n');
+    if ( lineEnd == string::npos )
+	return text + "\n" + defines;
+    return text.insert(lineEnd + 1, defines);
+}
+
 // Create a GLSL program object from vertex and fragment shader files
 GLuint
-InitShader(const char* vShaderFile, const char* fShaderFile)
+InitShader(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile, const char* defines)
 {
     struct Shader {
 	const char*  filename;
 	GLenum       type;
 	GLchar*      source;
-    }  shaders[2] = {
+    }  shaders[3] = {
 	{ vShaderFile, GL_VERTEX_SHADER, NULL },
-	{ fShaderFile, GL_FRAGMENT_SHADER, NULL }
+	{ fShaderFile, GL_FRAGMENT_SHADER, NULL },
+	{ gShaderFile, GL_GEOMETRY_SHADER, NULL }
     };
 
     GLuint program = glCreateProgram();
     
-    for ( int i = 0; i < 2; ++i ) {
+    for ( int i = 0; i < 3; ++i ) {
 	Shader& s = shaders[i];
+	if ( s.filename == NULL )
+	    continue;
+
 	s.source = readShaderSource( s.filename );
 	if ( shaders[i].source == NULL ) {
 	    std::cerr << "Failed to read " << s.filename << std::endl;
 	    exit( EXIT_FAILURE );
 	}
 
+	string text = addDefines( s.source, defines );
+	const GLchar* source = text.c_str();
 	GLuint shader = glCreateShader( s.type );
-	glShaderSource( shader, 1, (const GLchar**) &s.source, NULL );
+	glShaderSource( shader, 1, &source, NULL );
 	glCompileShader( shader );
 
 	GLint  compiled;
@@ -72,6 +94,14 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
 	glAttachShader( program, shader );
     }
 
+    /* fixed attribute slots so a mesh's vao works with any program */
+    glBindAttribLocation(program, ATTRIBUTE_POSITION, "vPosition");
+    glBindAttribLocation(program, ATTRIBUTE_NORMAL, "vNormal");
+    glBindAttribLocation(program, ATTRIBUTE_MODELVIEW, "vModelView");
+    glBindAttribLocation(program, ATTRIBUTE_FLAP, "vFlap");
+    glBindAttribLocation(program, ATTRIBUTE_VIEW, "vView");
+    glBindAttribLocation(program, ATTRIBUTE_TEXCOORD, "vTexCoord");
+
     /* link  and error check */
     glLinkProgram(program);
 
@@ -95,3 +125,81 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
     return program;
 }
 
+// Programs already built by GetShaderProgram, keyed on the file names and defines
+static map<string, GLuint> programCache;
+
+GLuint
+GetShaderProgram(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile, const char* defines)
+{
+    string key = string(vShaderFile) + "|" + fShaderFile + "|" + (gShaderFile != NULL ? gShaderFile : "") + "|" + (defines != NULL ? defines : "");
+
+    map<string, GLuint>::iterator it = programCache.find(key);
+    if ( it != programCache.end() ) {
+	glUseProgram(it->second);
+	return it->second;
+    }
+
+    GLuint program = InitShader(vShaderFile, fShaderFile, gShaderFile, defines);
+    programCache[key] = program;
+    return program;
+}
+
+// Create a transform feedback program from a single vertex shader file
+GLuint
+InitFeedbackShader(const char* vShaderFile, const char** attributes, int numAttributes,
+                   const char** varyings, int numVaryings)
+{
+    GLchar* source = readShaderSource( vShaderFile );
+    if ( source == NULL ) {
+	std::cerr << "Failed to read " << vShaderFile << std::endl;
+	exit( EXIT_FAILURE );
+    }
+
+    GLuint shader = glCreateShader( GL_VERTEX_SHADER );
+    glShaderSource( shader, 1, (const GLchar**) &source, NULL );
+    glCompileShader( shader );
+    delete [] source;
+
+    GLint  compiled;
+    glGetShaderiv( shader, GL_COMPILE_STATUS, &compiled );
+    if ( !compiled ) {
+	std::cerr << vShaderFile << " failed to compile:" << std::endl;
+	GLint  logSize;
+	glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &logSize );
+	char* logMsg = new char[logSize];
+	glGetShaderInfoLog( shader, logSize, NULL, logMsg );
+	std::cerr << logMsg << std::endl;
+	delete [] logMsg;
+
+	exit( EXIT_FAILURE );
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader( program, shader );
+
+    for ( int i = 0; i < numAttributes; ++i )
+	glBindAttribLocation( program, i, attributes[i] );
+
+    /* outputs have to be named before linking */
+    glTransformFeedbackVaryings( program, numVaryings, varyings, GL_INTERLEAVED_ATTRIBS );
+
+    glLinkProgram( program );
+
+    GLint  linked;
+    glGetProgramiv( program, GL_LINK_STATUS, &linked );
+    if ( !linked ) {
+	std::cerr << vShaderFile << " failed to link" << std::endl;
+	GLint  logSize;
+	glGetProgramiv( program, GL_INFO_LOG_LENGTH, &logSize);
+	char* logMsg = new char[logSize];
+	glGetProgramInfoLog( program, logSize, NULL, logMsg );
+	std::cerr << logMsg << std::endl;
+	delete [] logMsg;
+
+	exit( EXIT_FAILURE );
+    }
+
+    glUseProgram(program);
+
+    return program;
+}
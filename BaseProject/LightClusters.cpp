@@ -0,0 +1,318 @@
+#include "include/LightClusters.h"
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+//Constructor, a white key light up and to the side and a blue ambient, as
+//the scene has always been lit.
+LightClusters::LightClusters() {
+	numVisible = 0;
+	xScale = yScale = 1.0f;
+	blockBuffer = 0;
+	memset(buffers, 0, sizeof(buffers));
+	memset(textures, 0, sizeof(textures));
+	created = false;
+	jobGeneration = 0;
+	busyWorkers = 0;
+	stopping = false;
+	nextSlice = 0;
+
+	memset(&block, 0, sizeof(block));
+	memset(&stats, 0, sizeof(stats));
+	grid.assign(CLUSTER_COUNT * 2, 0);
+	for(int i = 0; i < 4; i++)
+		block.view[i * 5] = 1.0f;
+
+	GLfloat position[] = { 1.0, 2.0, 0.0, 1.0 };
+	GLfloat colour[] = { 1.0, 1.0, 1.0, 1.0 };
+	GLfloat ambient[] = { 0.2, 0.2, 0.6, 1.0 };
+	setKeyLight(position, colour);
+	setAmbient(ambient);
+}
+
+//Destructor.
+LightClusters::~LightClusters() {
+
+	stop();
+
+}
+
+//Workers start from the current job, so a build straight after this can't
+//slip past one that hasn't got going yet.
+void LightClusters::start(int numThreads) {
+	stopping = false;
+	for(int i = 0; i < numThreads; i++)
+		workers.push_back(thread(&LightClusters::workerLoop, this, jobGeneration));
+}
+
+void LightClusters::stop() {
+	{
+		lock_guard<mutex> guard(jobLock);
+		stopping = true;
+	}
+	jobSignal.notify_all();
+	for(int i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+}
+
+//Every buffer is a texture buffer, read with texelFetch: light data as two
+//RGBA32F texels a light, the grid as an (offset, count) pair a cluster and
+//the lists as one index each.
+void LightClusters::create() {
+	glGenBuffers(1, &blockBuffer);
+	glGenBuffers(3, buffers);
+	glGenTextures(3, textures);
+
+	GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+	for(int i = 0; i < 3; i++) {
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	created = true;
+}
+
+void LightClusters::setKeyLight(const GLfloat* position, const GLfloat* colour) {
+	memcpy(keyPosition, position, sizeof(keyPosition));
+	memcpy(block.keyColour, colour, sizeof(block.keyColour));
+}
+
+void LightClusters::setAmbient(const GLfloat* colour) {
+	memcpy(block.ambient, colour, sizeof(block.ambient));
+}
+
+void LightClusters::build(const vector<PointLight>& lights, const GLdouble* view,
+	double fovY, double aspect, double zNear, double zFar, int viewportWidth, int viewportHeight) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	double f = 1.0 / tan(fovY * M_PI / 360.0);
+	xScale = (float) (f / aspect);
+	yScale = (float) f;
+	for(int i = 0; i <= CLUSTER_SLICES; i++)
+		sliceDepths[i] = zNear * pow(zFar / zNear, (double) i / CLUSTER_SLICES);
+
+	//Into view space, keeping only what reaches into the frustum. The side
+	//planes go through the eye, so a light is outside one if it's further
+	//than its radius on the wrong side.
+	float sideX = 1.0f / sqrt(xScale * xScale + 1.0f);
+	float sideY = 1.0f / sqrt(yScale * yScale + 1.0f);
+	lightData.clear();
+	numVisible = 0;
+	for(int i = 0; i < lights.size() && numVisible < CLUSTER_MAX_LIGHTS; i++) {
+		const PointLight& light = lights[i];
+		const float* p = light.position;
+		float x = (float) (view[0] * p[0] + view[4] * p[1] + view[8] * p[2] + view[12]);
+		float y = (float) (view[1] * p[0] + view[5] * p[1] + view[9] * p[2] + view[13]);
+		float z = (float) (view[2] * p[0] + view[6] * p[1] + view[10] * p[2] + view[14]);
+		float depth = -z;
+		float r = light.radius;
+
+		if(depth + r < zNear || depth - r > zFar)
+			continue;
+		if((x * xScale - depth) * sideX > r || (-x * xScale - depth) * sideX > r)
+			continue;
+		if((y * yScale - depth) * sideY > r || (-y * yScale - depth) * sideY > r)
+			continue;
+
+		GLfloat data[8] = { x, y, z, r,
+			light.colour[0] * light.intensity, light.colour[1] * light.intensity, light.colour[2] * light.intensity, 0.0f };
+		lightData.insert(lightData.end(), data, data + 8);
+		numVisible++;
+	}
+
+	//Everything the shader needs to find its cluster and light it.
+	for(int i = 0; i < 16; i++)
+		block.view[i] = (GLfloat) view[i];
+	for(int i = 0; i < 4; i++)
+		block.keyLight[i] = (GLfloat) (view[i] * keyPosition[0] + view[4 + i] * keyPosition[1] + view[8 + i] * keyPosition[2] + view[12 + i] * keyPosition[3]);
+	double slicesPerLog = CLUSTER_SLICES / log(zFar / zNear);
+	block.clusterScale[0] = (GLfloat) CLUSTER_TILES_X / max(viewportWidth, 1);
+	block.clusterScale[1] = (GLfloat) CLUSTER_TILES_Y / max(viewportHeight, 1);
+	block.clusterScale[2] = (GLfloat) slicesPerLog;
+	block.clusterScale[3] = (GLfloat) (-log(zNear) * slicesPerLog);
+	block.clusterDims[0] = CLUSTER_TILES_X;
+	block.clusterDims[1] = CLUSTER_TILES_Y;
+	block.clusterDims[2] = CLUSTER_SLICES;
+	block.clusterDims[3] = numVisible;
+
+	//Slices are independent, so hand them out to whoever's free and
+	//take some ourselves.
+	{
+		lock_guard<mutex> guard(jobLock);
+		nextSlice = 0;
+		busyWorkers = workers.size();
+		jobGeneration++;
+	}
+	jobSignal.notify_all();
+	runSlices();
+	{
+		unique_lock<mutex> guard(jobLock);
+		while(busyWorkers > 0)
+			doneSignal.wait(guard);
+	}
+
+	//Join the slices' lists end to end.
+	indices.clear();
+	stats.occupiedClusters = 0;
+	stats.mostInCluster = 0;
+	for(int slice = 0; slice < CLUSTER_SLICES; slice++) {
+		GLuint base = indices.size();
+		GLuint* cells = &grid[slice * CLUSTER_TILES_X * CLUSTER_TILES_Y * 2];
+		for(int cell = 0; cell < CLUSTER_TILES_X * CLUSTER_TILES_Y; cell++) {
+			cells[cell * 2] += base;
+			if(cells[cell * 2 + 1] > 0)
+				stats.occupiedClusters++;
+			stats.mostInCluster = max(stats.mostInCluster, cells[cell * 2 + 1]);
+		}
+		indices.insert(indices.end(), sliceIndices[slice].begin(), sliceIndices[slice].end());
+	}
+
+	stats.lights = lights.size();
+	stats.visibleLights = numVisible;
+	stats.assignments = indices.size();
+	stats.buildMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void LightClusters::workerLoop(unsigned long long seen) {
+	while(true) {
+		{
+			unique_lock<mutex> guard(jobLock);
+			while(jobGeneration == seen && !stopping)
+				jobSignal.wait(guard);
+			if(stopping)
+				return;
+			seen = jobGeneration;
+		}
+
+		runSlices();
+
+		lock_guard<mutex> guard(jobLock);
+		if(--busyWorkers == 0)
+			doneSignal.notify_one();
+	}
+}
+
+void LightClusters::runSlices() {
+	int slice;
+	while((slice = nextSlice.fetch_add(1)) < CLUSTER_SLICES)
+		buildSlice(slice);
+}
+
+//Two passes over the lights touching this slice: count per cluster, then
+//with the counts turned into offsets, fill in the lists.
+void LightClusters::buildSlice(int slice) {
+	float nearDepth = (float) sliceDepths[slice];
+	float farDepth = (float) sliceDepths[slice + 1];
+	GLuint* cells = &grid[slice * CLUSTER_TILES_X * CLUSTER_TILES_Y * 2];
+	for(int cell = 0; cell < CLUSTER_TILES_X * CLUSTER_TILES_Y; cell++)
+		cells[cell * 2 + 1] = 0;
+
+	vector<TileRect>& rects = sliceRects[slice];
+	rects.clear();
+	for(unsigned int i = 0; i < numVisible; i++) {
+		const GLfloat* light = &lightData[i * 8];
+		float depth = -light[2];
+		float radius = light[3];
+		if(depth - radius >= farDepth || depth + radius <= nearDepth)
+			continue;
+
+		TileRect rect;
+		rect.light = i;
+		if(!projectRange(light[0], depth, radius, nearDepth, farDepth, xScale, CLUSTER_TILES_X, rect.x0, rect.x1))
+			continue;
+		if(!projectRange(light[1], depth, radius, nearDepth, farDepth, yScale, CLUSTER_TILES_Y, rect.y0, rect.y1))
+			continue;
+		rects.push_back(rect);
+
+		for(int y = rect.y0; y <= rect.y1; y++)
+			for(int x = rect.x0; x <= rect.x1; x++)
+				cells[(y * CLUSTER_TILES_X + x) * 2 + 1]++;
+	}
+
+	GLuint offset = 0;
+	for(int cell = 0; cell < CLUSTER_TILES_X * CLUSTER_TILES_Y; cell++) {
+		cells[cell * 2] = offset;
+		offset += cells[cell * 2 + 1];
+		cells[cell * 2 + 1] = 0;
+	}
+
+	vector<GLuint>& out = sliceIndices[slice];
+	out.resize(offset);
+	for(int i = 0; i < rects.size(); i++) {
+		const TileRect& rect = rects[i];
+		for(int y = rect.y0; y <= rect.y1; y++)
+			for(int x = rect.x0; x <= rect.x1; x++) {
+				GLuint* cell = &cells[(y * CLUSTER_TILES_X + x) * 2];
+				out[cell[0] + cell[1]++] = rect.light;
+			}
+	}
+}
+
+//Tiles along one screen axis covered by a light's bounding box, clipped to
+//the slice in depth. Projection is centre / depth, which is monotonic in
+//depth, so the box's extremes are at its nearest and furthest depths.
+bool LightClusters::projectRange(float centre, float depth, float radius, float nearDepth, float farDepth, float scale, int tiles, int& first, int& last) {
+	float nearest = max(depth - radius, nearDepth);
+	float furthest = min(depth + radius, farDepth);
+
+	float low = min((centre - radius) / nearest, (centre - radius) / furthest) * scale;
+	float high = max((centre + radius) / nearest, (centre + radius) / furthest) * scale;
+	if(high < -1.0f || low > 1.0f)
+		return false;
+
+	first = (int) floor((low * 0.5f + 0.5f) * tiles);
+	last = (int) floor((high * 0.5f + 0.5f) * tiles);
+	first = max(0, min(tiles - 1, first));
+	last = max(0, min(tiles - 1, last));
+	return true;
+}
+
+void LightClusters::upload() {
+	if(!created)
+		return;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, blockBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(block), &block, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTING_BLOCK_BINDING, blockBuffer);
+
+	//Empty buffers can't back a texture, keep at least a texel in each.
+	const void* data[3] = { lightData.empty() ? NULL : &lightData[0], &grid[0], indices.empty() ? NULL : &indices[0] };
+	size_t bytes[3] = { lightData.size() * sizeof(GLfloat), grid.size() * sizeof(GLuint), indices.size() * sizeof(GLuint) };
+	GLenum units[3] = { LIGHT_DATA_UNIT, CLUSTER_GRID_UNIT, LIGHT_INDEX_UNIT };
+	for(int i = 0; i < 3; i++) {
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, bytes[i] > 0 ? bytes[i] : 16, data[i], GL_STREAM_DRAW);
+		glActiveTexture(GL_TEXTURE0 + units[i]);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::setupProgram(GLuint program) {
+	glUniform1i(glGetUniformLocation(program, "LightData"), LIGHT_DATA_UNIT);
+	glUniform1i(glGetUniformLocation(program, "ClusterGrid"), CLUSTER_GRID_UNIT);
+	glUniform1i(glGetUniformLocation(program, "LightIndices"), LIGHT_INDEX_UNIT);
+
+	GLuint index = glGetUniformBlockIndex(program, "Lighting");
+	if(index != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, index, LIGHTING_BLOCK_BINDING);
+}
+
+const ClusterStats& LightClusters::getStats() {
+	return stats;
+}
+
+void LightClusters::printStats() {
+	printf("Lights: %u of %u in view, %u cluster assignments, %u of %u clusters lit (most %u lights), built in %.3f ms on %d threads\n",
+		stats.visibleLights, stats.lights, stats.assignments, stats.occupiedClusters, CLUSTER_COUNT,
+		stats.mostInCluster, stats.buildMilliseconds, (int) workers.size() + 1);
+}
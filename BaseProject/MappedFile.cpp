@@ -0,0 +1,89 @@
+#include "include/MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Constructor, nothing is mapped until open().
+MappedFile::MappedFile() {
+	data = NULL;
+	size = 0;
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#endif
+}
+
+//Destructor.
+MappedFile::~MappedFile() {
+
+	close();
+
+}
+
+bool MappedFile::open(string fileName) {
+	close();
+
+#ifdef _WIN32
+	file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	LARGE_INTEGER fileSize;
+	if(file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if(mapping != NULL) {
+			data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			size = (size_t) fileSize.QuadPart;
+		}
+	}
+#else
+	int fd = ::open(fileName.c_str(), O_RDONLY);
+	if(fd >= 0) {
+		struct stat status;
+		if(fstat(fd, &status) == 0 && status.st_size > 0) {
+			void* mapped = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(mapped != MAP_FAILED) {
+				//Read front to back, let the kernel read ahead.
+				madvise(mapped, status.st_size, MADV_SEQUENTIAL);
+				data = mapped;
+				size = status.st_size;
+			}
+		}
+		::close(fd);
+	}
+#endif
+
+	if(data == NULL) {
+		fprintf(stderr, "Failed to map %s\n", fileName.c_str());
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if(data != NULL)
+		UnmapViewOfFile(data);
+	if(mapping != NULL)
+		CloseHandle(mapping);
+	if(file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if(data != NULL)
+		munmap((void*) data, size);
+#endif
+
+	data = NULL;
+	size = 0;
+}
+
+const void* MappedFile::getData()	{ return data;	}
+size_t MappedFile::getSize()		{ return size;	}
@@ -1,12 +1,20 @@
 #include "include/MatrixStack.h"
+#include "include/MemoryStats.h"
 #include <stdio.h>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
-MatrixStack::MatrixStack(unsigned int num):stack_(0),tos(0)
+MatrixStack::MatrixStack(unsigned int num):stack_(0),tos(0),size_(num),ownsStack_(true)
 {
 
     stack_ = new GLdouble[16*num];
+    MemoryStats::add(MEMORY_TRANSFORM_STACKS, 16*num*sizeof(GLdouble));
+    loadIdentity();
+}
+
+MatrixStack::MatrixStack(unsigned int num, GLdouble *storage):stack_(storage),tos(0),size_(num),ownsStack_(false)
+{
+
     loadIdentity();
 }
 
@@ -14,7 +22,11 @@ MatrixStack::MatrixStack(unsigned int num):stack_(0),tos(0)
 MatrixStack::~MatrixStack()
 {
 
-    if (!stack_) delete [] stack_;
+    if (ownsStack_)
+        {
+            delete [] stack_;
+            MemoryStats::remove(MEMORY_TRANSFORM_STACKS, 16*size_*sizeof(GLdouble));
+        }
 
 }
 
@@ -0,0 +1,64 @@
+#include "include/MemoryStats.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+atomic<long long> MemoryStats::currentBytes[NUM_MEMORY_CATEGORIES];
+atomic<long long> MemoryStats::peakBytes[NUM_MEMORY_CATEGORIES];
+
+void MemoryStats::add(MemoryCategory category, long long bytes) {
+	long long now = currentBytes[category].fetch_add(bytes) + bytes;
+
+	//Raise the peak unless another thread already pushed it higher.
+	long long highest = peakBytes[category].load();
+	while(now > highest && !peakBytes[category].compare_exchange_weak(highest, now))
+		;
+}
+
+void MemoryStats::remove(MemoryCategory category, long long bytes) {
+	currentBytes[category].fetch_sub(bytes);
+}
+
+long long MemoryStats::current(MemoryCategory category)	{ return currentBytes[category].load();	}
+long long MemoryStats::peak(MemoryCategory category)		{ return peakBytes[category].load();	}
+
+long long MemoryStats::total() {
+	long long bytes = 0;
+	for(int i = 0; i < NUM_MEMORY_CATEGORIES; i++)
+		bytes += currentBytes[i].load();
+	return bytes;
+}
+
+size_t MemoryStats::processBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.WorkingSetSize;
+	return 0;
+#else
+	//Second field of statm is the resident set, in pages.
+	FILE* fp = fopen("/proc/self/statm", "r");
+	if(fp == NULL)
+		return 0;
+	unsigned long size = 0, resident = 0;
+	int read = fscanf(fp, "%lu %lu", &size, &resident);
+	fclose(fp);
+	return read == 2 ? resident * (size_t) sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+const char* MemoryStats::name(MemoryCategory category) {
+	const char* names[NUM_MEMORY_CATEGORIES] = { "mesh (cpu)", "gl buffers", "gl textures", "entity pools", "transform stacks", "scratch", "distance fields", "wind fields", "terrain" };
+	return names[category];
+}
+
+void MemoryStats::print() {
+	for(int i = 0; i < NUM_MEMORY_CATEGORIES; i++)
+		printf("Memory %s: %lld bytes (peak %lld)\n", name((MemoryCategory) i), current((MemoryCategory) i), peak((MemoryCategory) i));
+	printf("Memory total: %lld bytes tracked, %lu bytes resident\n", total(), (unsigned long) processBytes());
+}
@@ -0,0 +1,426 @@
+#include "include/Mesh.h"
+#include <stdlib.h>
+#include <string.h>
+
+//Constructor, nothing is read until parse() is called.
+Mesh::Mesh(string meshFileName) {
+	fileName = meshFileName;
+
+	numVertices = 0;
+	numIndices  = 0;
+	numNormals  = 0;
+	boundingRadius = 0.0f;
+
+	streamBlock = NULL;
+	vertexPositions = NULL;
+	vertexNormals = NULL;
+	vertexTexCoords = NULL;
+	vertexIndices = NULL;
+	hasTexCoords = false;
+
+	uploadedBytes = 0;
+	pool = NULL;
+	range.baseVertex = 0;
+	range.firstIndex = 0;
+	range.numVertices = range.numIndices = 0;
+
+	state = MESH_QUEUED;
+}
+
+//Destructor.
+Mesh::~Mesh() {
+
+	if(pool != NULL)
+		pool->release(range);
+
+	if(streamBlock != NULL)
+		MemoryStats::remove(MEMORY_MESH_CPU, numStreamBytes());
+	delete [] streamBlock;
+
+}
+
+//Reads the file in and grabs vertex information, face information etc.
+//The file is read whole into scratch memory and counted first, so every
+//final array is allocated once at its exact size.
+void Mesh::parse(Arena& scratch) {
+	FILE* fp = fopen(fileName.c_str(), "rb");
+
+	if(fp == NULL) {
+		cerr << "Failed to read " << fileName << endl;
+		setState(MESH_FAILED);
+		return;
+	}
+
+	fseek(fp, 0L, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0L, SEEK_SET);
+
+	char* text = scratch.alloc<char>(size + 1);
+	size = fread(text, 1, size, fp);
+	text[size] = '\0';
+	fclose(fp);
+
+	//First pass, count position ("v"), texture coordinate ("vt") and face ("f") lines.
+	int numTexCoords = 0;
+	for(char* line = text; *line != '\0'; ) {
+		if((line[0] == 'v' || line[0] == 'f') && (line[1] == ' ' || line[1] == '\t')) {
+			if(line[0] == 'v')
+				numVertices += 1;
+			else
+				numIndices += 3;
+		}
+		else if(line[0] == 'v' && line[1] == 't' && (line[2] == ' ' || line[2] == '\t'))
+			numTexCoords += 1;
+		char* next = strchr(line, '\n');
+		line = next != NULL ? next + 1 : line + strlen(line);
+	}
+
+	//Vertices are position and uv pairs, only known once the faces are read.
+	if(numTexCoords > 0) {
+		if(parseTexturedFaces(text, numVertices, numTexCoords, scratch))
+			finishBuild();
+		return;
+	}
+
+	allocateStreams();
+
+	//Second pass, parse straight into the final arrays.
+	int vertex = 0;
+	int index = 0;
+	for(char* line = text; *line != '\0'; ) {
+		char* next = strchr(line, '\n');
+
+		//Fetch a line with vertices
+		if(line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) {
+			char* cursor = line + 2;
+			vertexPositions[vertex*4+0] = strtod(cursor, &cursor);
+			vertexPositions[vertex*4+1] = strtod(cursor, &cursor);
+			vertexPositions[vertex*4+2] = strtod(cursor, &cursor);
+			vertexPositions[vertex*4+3] = 1.0;
+			vertex++;
+		}
+
+		//Fetch a line with vertex indices. Only the position index of each
+		//corner is used, anything after a '/' is skipped.
+		if(line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+			char* cursor = line + 2;
+			for(int corner = 0; corner < 3; corner++) {
+				unsigned long value = strtoul(cursor, &cursor, 10);
+				while(*cursor != '\0' && *cursor != ' ' && *cursor != '\t' && *cursor != '\n')
+					cursor++;
+
+				if(value < 1 || value > (unsigned long) numVertices) {
+					cerr << fileName << " has a face with a bad vertex index" << endl;
+					setState(MESH_FAILED);
+					return;
+				}
+				vertexIndices[index++] = (GLuint) value - 1;
+			}
+		}
+
+		line = next != NULL ? next + 1 : line + strlen(line);
+	}
+
+	finishBuild();
+}
+
+//Second pass for files with texture coordinates. Positions, uvs and each
+//corner's pair of indices go into scratch, then every distinct pair becomes
+//one vertex through an open addressed table, so shared corners stay shared
+//and only seams are split.
+bool Mesh::parseTexturedFaces(char* text, int numPositions, int numTexCoords, Arena& scratch) {
+	GLdouble* positions = scratch.alloc<GLdouble>(numPositions * 3);
+	GLfloat* texCoords = scratch.alloc<GLfloat>(numTexCoords * 2);
+	GLuint* corners = scratch.alloc<GLuint>(numIndices * 2);
+
+	int position = 0;
+	int texCoord = 0;
+	int corner = 0;
+	for(char* line = text; *line != '\0'; ) {
+		char* next = strchr(line, '\n');
+
+		if(line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) {
+			char* cursor = line + 2;
+			for(int i = 0; i < 3; i++)
+				positions[position*3+i] = strtod(cursor, &cursor);
+			position++;
+		}
+		else if(line[0] == 'v' && line[1] == 't' && (line[2] == ' ' || line[2] == '\t')) {
+			char* cursor = line + 3;
+			texCoords[texCoord*2+0] = strtof(cursor, &cursor);
+			texCoords[texCoord*2+1] = strtof(cursor, &cursor);
+			texCoord++;
+		}
+		else if(line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+			//Each corner is v, v/vt, v//vn or v/vt/vn. A corner without a uv
+			//gets the first one.
+			char* cursor = line + 2;
+			for(int i = 0; i < 3; i++) {
+				unsigned long value = strtoul(cursor, &cursor, 10);
+				unsigned long uv = 1;
+				if(*cursor == '/' && cursor[1] != '/')
+					uv = strtoul(cursor + 1, &cursor, 10);
+				while(*cursor != '\0' && *cursor != ' ' && *cursor != '\t' && *cursor != '\n')
+					cursor++;
+
+				if(value < 1 || value > (unsigned long) numPositions || uv < 1 || uv > (unsigned long) numTexCoords) {
+					cerr << fileName << " has a face with a bad vertex or texture coordinate index" << endl;
+					setState(MESH_FAILED);
+					return false;
+				}
+				corners[corner*2+0] = (GLuint) value - 1;
+				corners[corner*2+1] = (GLuint) uv - 1;
+				corner++;
+			}
+		}
+
+		line = next != NULL ? next + 1 : line + strlen(line);
+	}
+
+	//At most half full, so probes stay short.
+	GLuint tableSize = 16;
+	while(tableSize < (GLuint) numIndices * 2)
+		tableSize *= 2;
+	GLuint* table = scratch.alloc<GLuint>(tableSize);
+	for(GLuint i = 0; i < tableSize; i++)
+		table[i] = 0xFFFFFFFF;
+
+	//Indices are corners' first uses for now, renumbered once the count is known.
+	GLuint* firstUse = scratch.alloc<GLuint>(numIndices);
+	numVertices = 0;
+	for(int i = 0; i < numIndices; i++) {
+		GLuint hash = (corners[i*2+0] * 0x9E3779B1u) ^ (corners[i*2+1] * 0x85EBCA77u);
+		GLuint slot = (hash ^ (hash >> 15)) & (tableSize - 1);
+		while(table[slot] != 0xFFFFFFFF && (corners[table[slot]*2+0] != corners[i*2+0] || corners[table[slot]*2+1] != corners[i*2+1]))
+			slot = (slot + 1) & (tableSize - 1);
+		if(table[slot] == 0xFFFFFFFF) {
+			table[slot] = i;
+			numVertices++;
+		}
+		firstUse[i] = table[slot];
+	}
+
+	allocateStreams();
+
+	//Vertices in order of first use, a corner's vertex is its first use's.
+	GLuint* vertexOf = scratch.alloc<GLuint>(numIndices);
+	int vertex = 0;
+	for(int i = 0; i < numIndices; i++) {
+		if(firstUse[i] == (GLuint) i) {
+			const GLdouble* p = &positions[corners[i*2+0]*3];
+			const GLfloat* uv = &texCoords[corners[i*2+1]*2];
+			vertexPositions[vertex*4+0] = p[0];
+			vertexPositions[vertex*4+1] = p[1];
+			vertexPositions[vertex*4+2] = p[2];
+			vertexPositions[vertex*4+3] = 1.0;
+			vertexTexCoords[vertex*2+0] = uv[0];
+			vertexTexCoords[vertex*2+1] = uv[1];
+			vertexOf[i] = vertex++;
+		}
+		vertexIndices[i] = vertexOf[firstUse[i]];
+	}
+
+	hasTexCoords = true;
+	return true;
+}
+
+//Builds a mesh from in-memory data rather than a file. Positions are xyz
+//triples and indices start at zero. Without uvs they're projected as for a
+//file that has none.
+void Mesh::createFromArrays(const GLdouble* positions, int vertexCount, const GLuint* indices, int indexCount, const GLfloat* texCoords) {
+	numVertices = vertexCount;
+	numIndices = indexCount;
+
+	allocateStreams();
+
+	for(int i = 0; i < vertexCount; i++) {
+		vertexPositions[i*4+0] = positions[i*3+0];
+		vertexPositions[i*4+1] = positions[i*3+1];
+		vertexPositions[i*4+2] = positions[i*3+2];
+		vertexPositions[i*4+3] = 1.0;
+	}
+	for(int i = 0; i < indexCount; i++)
+		vertexIndices[i] = indices[i];
+	if(texCoords != NULL) {
+		memcpy(vertexTexCoords, texCoords, numVertexTexCoordBytes());
+		hasTexCoords = true;
+	}
+
+	finishBuild();
+}
+
+//One block holds every stream: positions, normals, uvs then indices.
+void Mesh::allocateStreams() {
+	streamBlock = new char[numStreamBytes()];
+	MemoryStats::add(MEMORY_MESH_CPU, numStreamBytes());
+
+	vertexPositions = (GLdouble*) streamBlock;
+	vertexNormals = (GLdouble*) (streamBlock + numVertexPositionBytes());
+	vertexTexCoords = (GLfloat*) (streamBlock + numVertexPositionBytes() + numVertexNormalBytes());
+	vertexIndices = (GLuint*) (streamBlock + numVertexPositionBytes() + numVertexNormalBytes() + numVertexTexCoordBytes());
+}
+
+//Calculates normals (and any missing uvs) once positions and indices are in place.
+void Mesh::finishBuild() {
+	//Setup normal array for insertion
+	for(int i = 0; i < numIndices*4; i++)
+		vertexNormals[i] = 0.0;
+
+	//Calculate normals
+	for(int i = 0; i < numIndices; i += 3) {
+		int x = vertexIndices[i+0];
+		int y = vertexIndices[i+1];
+		int z = vertexIndices[i+2];
+
+		GLdouble* p1 = &vertexPositions[x*4];
+		GLdouble* p2 = &vertexPositions[y*4];
+		GLdouble* p3 = &vertexPositions[z*4];
+		GLdouble pointNormals[3];
+		calcNormal(p1, p2, p3, pointNormals);
+
+		vertexNormals[x*4+0] += pointNormals[0];
+        vertexNormals[x*4+1] += pointNormals[1];
+        vertexNormals[x*4+2] += pointNormals[2];
+
+        vertexNormals[y*4+0] += pointNormals[0];
+        vertexNormals[y*4+1] += pointNormals[1];
+        vertexNormals[y*4+2] += pointNormals[2];
+
+        vertexNormals[z*4+0] += pointNormals[0];
+        vertexNormals[z*4+1] += pointNormals[1];
+        vertexNormals[z*4+2] += pointNormals[2];
+	}
+
+	double furthest = 0.0;
+	for(int i = 0; i < numVertices; i++) {
+		const GLdouble* p = &vertexPositions[i*4];
+		furthest = max(furthest, p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+	}
+	boundingRadius = (float) sqrt(furthest);
+
+	if(!hasTexCoords)
+		projectTexCoords();
+
+	setState(MESH_PARSED);
+}
+
+//Looking down on the mesh, its bounds in x and z stretched over the texture.
+void Mesh::projectTexCoords() {
+	GLdouble low[3] = { 0.0, 0.0, 0.0 };
+	GLdouble high[3] = { 0.0, 0.0, 0.0 };
+	for(int i = 0; i < numVertices; i++) {
+		for(int axis = 0; axis < 3; axis += 2) {
+			GLdouble value = vertexPositions[i*4+axis];
+			if(i == 0 || value < low[axis])
+				low[axis] = value;
+			if(i == 0 || value > high[axis])
+				high[axis] = value;
+		}
+	}
+
+	GLdouble width = high[0] > low[0] ? high[0] - low[0] : 1.0;
+	GLdouble depth = high[2] > low[2] ? high[2] - low[2] : 1.0;
+	for(int i = 0; i < numVertices; i++) {
+		vertexTexCoords[i*2+0] = (GLfloat) ((vertexPositions[i*4+0] - low[0]) / width);
+		vertexTexCoords[i*2+1] = (GLfloat) ((vertexPositions[i*4+2] - low[2]) / depth);
+	}
+	hasTexCoords = true;
+}
+
+//Calculate the normal of object triangles using 3 vertices.
+void Mesh::calcNormal(const GLdouble* p1, const GLdouble* p2, const GLdouble* p3, GLdouble* normal) {
+	GLdouble V1[3] = { p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2] };
+	GLdouble V2[3] = { p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2] };
+    normal[0] =  (V1[1] * V2[2]) - (V1[2] * V2[1]);
+    normal[1] =  (V1[2] * V2[0]) - (V1[0] * V2[2]);
+    normal[2] =  (V1[0] * V2[1]) - (V1[1] * V2[0]);
+
+	GLdouble length = sqrt(normal[0]*normal[0]+normal[1]*normal[1]+normal[2]*normal[2]);
+
+	normal[0] /= length;
+	normal[1] /= length;
+	normal[2] /= length;
+}
+
+//Uploads the parsed data in pieces. The first call takes a range of the
+//shared buffers, every call after that continues where the last one stopped,
+//so a big mesh can be spread over several frames.
+GLuint Mesh::upload(GeometryPool& geometry, GLuint byteBudget) {
+	if(getState() != MESH_PARSED && getState() != MESH_UPLOADING)
+		return 0;
+
+	if(getState() == MESH_PARSED) {
+		pool = &geometry;
+		pool->allocate(numVertices, numIndices, range);
+		setState(MESH_UPLOADING);
+	}
+
+	//The four streams laid end to end, in the order they are sent. Buffers
+	//are looked up each call, the pool may have grown into new ones since.
+	struct Stream {
+		GLenum target;
+		GLuint buffer;
+		GLuint bufferOffset;
+		const GLubyte* data;
+		GLuint bytes;
+	} streams[4] = {
+		{ GL_ARRAY_BUFFER, pool->getPositionBuffer(), (GLuint) (range.baseVertex * GEOMETRY_VERTEX_BYTES), (const GLubyte*) vertexPositions, numVertexPositionBytes() },
+		{ GL_ARRAY_BUFFER, pool->getNormalBuffer(), (GLuint) (range.baseVertex * GEOMETRY_VERTEX_BYTES), (const GLubyte*) vertexNormals, numUploadNormalBytes() },
+		{ GL_ARRAY_BUFFER, pool->getTexCoordBuffer(), (GLuint) (range.baseVertex * GEOMETRY_TEXCOORD_BYTES), (const GLubyte*) vertexTexCoords, numVertexTexCoordBytes() },
+		{ GL_ELEMENT_ARRAY_BUFFER, pool->getIndexBuffer(), range.firstIndex * (GLuint) sizeof(GLuint), (const GLubyte*) vertexIndices, numVertexIndexBytes() }
+	};
+
+	GLuint sent = 0;
+	GLuint streamStart = 0;
+	for(int i = 0; i < 4 && sent < byteBudget; i++) {
+		GLuint streamEnd = streamStart + streams[i].bytes;
+		if(uploadedBytes < streamEnd) {
+			GLuint offset = uploadedBytes - streamStart;
+			GLuint count = streamEnd - uploadedBytes;
+			if(count > byteBudget - sent)
+				count = byteBudget - sent;
+
+			//Element buffers are vao state, so only touch them with no vao bound.
+			glBindVertexArray(0);
+			glBindBuffer(streams[i].target, streams[i].buffer);
+			glBufferSubData(streams[i].target, streams[i].bufferOffset + offset, count, streams[i].data + offset);
+			glBindBuffer(streams[i].target, 0);
+
+			uploadedBytes += count;
+			sent += count;
+		}
+		streamStart = streamEnd;
+	}
+
+	//Everything is on the GPU, the pool's vao already describes the layout.
+	if(uploadedBytes == numUploadBytes())
+		setState(MESH_READY);
+
+	return sent;
+}
+
+MeshState Mesh::getState()				{ return (MeshState) state.load();	}
+void Mesh::setState(MeshState newState) { state.store(newState);			}
+
+GLuint Mesh::getVao()			{ return pool != NULL ? pool->getVao() : 0;	}
+GLint Mesh::getBaseVertex()		{ return range.baseVertex;	}
+GLuint Mesh::getFirstIndex()	{ return range.firstIndex;	}
+int Mesh::getNumIndices()	{ return numIndices;	}
+int Mesh::getNumVertices()	{ return numVertices;	}
+float Mesh::getBoundingRadius()	{ return boundingRadius;	}
+
+const GLdouble* Mesh::getPositions()	{ return vertexPositions;	}
+const GLfloat* Mesh::getTexCoords()	{ return vertexTexCoords;	}
+const GLuint* Mesh::getIndices()		{ return vertexIndices;		}
+
+GLuint Mesh::numUploadBytes()			{ return numVertexPositionBytes() + numUploadNormalBytes() + numVertexTexCoordBytes() + numVertexIndexBytes(); }
+GLuint Mesh::numRemainingUploadBytes()	{ return numUploadBytes() - uploadedBytes; }
+
+GLuint Mesh::numStreamBytes()			{ return numVertexPositionBytes() + numVertexNormalBytes() + numVertexTexCoordBytes() + numVertexIndexBytes(); }
+
+GLuint Mesh::numVertexPositionBytes()	{ return numVertices*4*sizeof(GLdouble);	}
+GLuint Mesh::numVertexTexCoordBytes()	{ return numVertices*2*sizeof(GLfloat);		}
+GLuint Mesh::numVertexNormalBytes()		{ return numIndices*4*sizeof(GLdouble);	}
+//Only the first numVertices normals are ever filled in, so that's all that goes up.
+GLuint Mesh::numUploadNormalBytes()		{ return numVertices*4*sizeof(GLdouble);	}
+GLuint Mesh::numVertexIndexBytes()		{ return numIndices*sizeof(GLuint);			}
@@ -0,0 +1,76 @@
+#include "include/RangeAllocator.h"
+
+//Constructor, empty until grown.
+RangeAllocator::RangeAllocator() {
+	capacity = 0;
+	used = 0;
+}
+
+//Destructor.
+RangeAllocator::~RangeAllocator() {
+
+}
+
+long long RangeAllocator::allocate(unsigned int count) {
+	//Nothing to place, anywhere will do.
+	if(count == 0)
+		return 0;
+
+	for(map<unsigned int, unsigned int>::iterator it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+		if(it->second < count)
+			continue;
+
+		//Take the front of the range, whatever's left stays free.
+		unsigned int start = it->first;
+		unsigned int left = it->second - count;
+		freeRanges.erase(it);
+		if(left > 0)
+			freeRanges[start + count] = left;
+		used += count;
+		return start;
+	}
+	return -1;
+}
+
+void RangeAllocator::release(unsigned int start, unsigned int count) {
+	if(count == 0)
+		return;
+	used -= count;
+
+	//Merge with the free range after us, then the one before.
+	map<unsigned int, unsigned int>::iterator next = freeRanges.find(start + count);
+	if(next != freeRanges.end()) {
+		count += next->second;
+		freeRanges.erase(next);
+	}
+
+	map<unsigned int, unsigned int>::iterator previous = freeRanges.lower_bound(start);
+	if(previous != freeRanges.begin()) {
+		--previous;
+		if(previous->first + previous->second == start) {
+			previous->second += count;
+			return;
+		}
+	}
+	freeRanges[start] = count;
+}
+
+void RangeAllocator::grow(unsigned int newCapacity) {
+	if(newCapacity <= capacity)
+		return;
+
+	//The new space is released like any other range so it joins a free tail.
+	unsigned int added = newCapacity - capacity;
+	unsigned int start = capacity;
+	capacity = newCapacity;
+	used += added;
+	release(start, added);
+}
+
+unsigned int RangeAllocator::largestFreeRange() {
+	unsigned int largest = 0;
+	for(map<unsigned int, unsigned int>::iterator it = freeRanges.begin(); it != freeRanges.end(); ++it)
+		if(it->second > largest)
+			largest = it->second;
+	return largest;
+}
@@ -0,0 +1,475 @@
+#include "include/RenderQueue.h"
+#include "include/Mesh.h"
+#include <algorithm>
+#include <string.h>
+
+//Constructor, the queue starts empty with no known GL state.
+RenderQueue::RenderQueue() {
+	numPackets = 0;
+	numLowShading = 0;
+	shadingDistance = 1e30f;
+	currentProgram = 0;
+	currentVao = 0;
+	currentTexture = 0;
+	instanceBuffer = indirectBuffer = 0;
+	instanceCapacity = indirectCapacity = 0;
+	buffersCreated = false;
+	multiDrawAllowed = true;
+	multiDraw = false;
+	memset(views, 0, sizeof(views));
+	memset(planes, 0, sizeof(planes));
+	memset(culled, 0, sizeof(culled));
+	memset(passStarts, 0, sizeof(passStarts));
+	numViews = 1;
+	viewsRouted = false;
+	time = 0.0f;
+	memset(&stats, 0, sizeof(stats));
+}
+
+//Destructor.
+RenderQueue::~RenderQueue() {
+
+}
+
+//Build a sort key. Program takes the top 12 bits, the mesh (vao) the next 8,
+//the texture the 12 after and the view depth the bottom 32. Depth is a
+//positive float so its bit pattern already sorts in the same order as its
+//value (nearest first).
+uint64_t RenderQueue::makeKey(GLuint program, GLuint vao, GLuint texture, float depth) {
+	if(!(depth > 0.0f))
+		depth = 0.0f;
+
+	uint32_t depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	return ((uint64_t)(program & 0xFFF) << 52) |
+		   ((uint64_t)(vao & 0xFF) << 44) |
+		   ((uint64_t)(texture & 0xFFF) << 32) |
+		   depthBits;
+}
+
+//Start a new frame, the projection and time are shared by every packet in it.
+void RenderQueue::beginFrame(const GLfloat* projectionMatrix, GLfloat seconds) {
+	RenderView view;
+	memcpy(view.projection, projectionMatrix, sizeof(view.projection));
+	memset(view.viewport, 0, sizeof(view.viewport));
+	beginFrame(&view, 1, seconds);
+}
+
+//A single view leaves the viewport alone, several each set their own.
+void RenderQueue::beginFrame(const RenderView* frameViews, unsigned int count, GLfloat seconds) {
+	numViews = max(1u, min(count, (unsigned int) MAX_VIEWS));
+	memcpy(views, frameViews, numViews * sizeof(RenderView));
+	viewsRouted = numViews > 1 && viewRoutingSupported();
+
+	//Planes from the rows of each projection, w plus or minus x, y and z.
+	for(unsigned int v = 0; v < numViews; v++) {
+		const GLfloat* m = views[v].projection;
+		for(int plane = 0; plane < 6; plane++) {
+			int row = plane / 2;
+			GLfloat sign = plane % 2 == 0 ? 1.0f : -1.0f;
+			GLfloat* p = planes[v][plane];
+			for(int column = 0; column < 4; column++)
+				p[column] = m[column * 4 + 3] + sign * m[column * 4 + row];
+			GLfloat length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+			for(int column = 0; column < 4; column++)
+				p[column] /= length;
+		}
+		culled[v] = 0;
+	}
+
+	time = seconds;
+	numPackets = 0;
+	numLowShading = 0;
+
+	//Anything outside of the queue may have touched GL state since last frame.
+	currentProgram = 0;
+	currentVao = 0;
+	currentTexture = 0;
+	frameUniformsUploaded.clear();
+}
+
+//The sphere is out of a view if it's wholly behind any one of its planes.
+unsigned int RenderQueue::cull(const GLfloat* modelView, float radius) {
+	unsigned int all = (1u << numViews) - 1;
+	if(radius < 0.0f)
+		return all;
+
+	//Scaled by the longest axis, for models that are stretched.
+	float scale = 0.0f;
+	for(int column = 0; column < 3; column++) {
+		const GLfloat* axis = &modelView[column * 4];
+		scale = max(scale, axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	}
+	float reach = -radius * sqrtf(scale);
+	const GLfloat* centre = &modelView[12];
+
+	unsigned int visible = 0;
+	for(unsigned int v = 0; v < numViews; v++) {
+		bool inside = true;
+		for(int plane = 0; plane < 6 && inside; plane++) {
+			const GLfloat* p = planes[v][plane];
+			inside = p[0] * centre[0] + p[1] * centre[1] + p[2] * centre[2] + p[3] >= reach;
+		}
+		if(inside)
+			visible |= 1u << v;
+		else
+			culled[v]++;
+	}
+	return visible;
+}
+
+bool RenderQueue::routesViews() {
+	return viewsRouted;
+}
+
+//Routing needs a geometry shader that can pick the viewport.
+bool RenderQueue::viewRoutingSupported() {
+	return GLEW_VERSION_4_1 || GLEW_ARB_viewport_array;
+}
+
+//Hand out the next packet to fill in. The pointer is only valid until the
+//next call to submit().
+DrawPacket* RenderQueue::submit() {
+	if(numPackets == packets.size())
+		packets.push_back(DrawPacket());
+	return &packets[numPackets++];
+}
+
+unsigned int RenderQueue::mark() {
+	return numPackets;
+}
+
+//Low shading counts aren't taken back, they're only statistics.
+void RenderQueue::rewind(unsigned int mark) {
+	if(mark < numPackets)
+		numPackets = mark;
+}
+
+void RenderQueue::setShadingDistance(float distance) {
+	shadingDistance = distance;
+}
+
+//Which program an object at this view depth should submit with.
+ShadingLevel RenderQueue::shadingFor(float depth) {
+	if(depth > shadingDistance) {
+		numLowShading++;
+		return SHADING_LOW;
+	}
+	return SHADING_FULL;
+}
+
+//Multi-draw needs glMultiDrawElementsIndirect, and base instances so each
+//command can find its own per-draw data.
+static bool multiDrawSupported() {
+	return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+void RenderQueue::setMultiDraw(bool allowed) {
+	multiDrawAllowed = allowed;
+	if(buffersCreated)
+		multiDraw = multiDrawAllowed && multiDrawSupported();
+
+	//The per-draw fallback leaves instanced attributes pointing anywhere.
+	preparedVaos.clear();
+}
+
+//Sort everything submitted this frame and issue the draws.
+void RenderQueue::flush() {
+	stats.packets = numPackets;
+	stats.drawCalls = 0;
+	stats.programBinds = 0;
+	stats.vaoBinds = 0;
+	stats.textureBinds = 0;
+	stats.uniformUploads = 0;
+	stats.redundantBinds = 0;
+	stats.lowShadingDraws = numLowShading;
+	stats.multiDraw = multiDraw;
+	stats.numViews = numViews;
+	stats.viewsRouted = viewsRouted;
+	for(unsigned int v = 0; v < numViews; v++) {
+		stats.views[v].draws = 0;
+		stats.views[v].culled = culled[v];
+		stats.views[v].triangles = 0;
+	}
+
+	if(numPackets == 0)
+		return;
+
+	if(!buffersCreated)
+		createBuffers();
+
+	//Sort small (key, index) pairs rather than the packets themselves.
+	sorted.resize(numPackets);
+	for(unsigned int i = 0; i < numPackets; i++) {
+		sorted[i].key = packets[i].key;
+		sorted[i].index = i;
+	}
+	sort(sorted.begin(), sorted.end());
+
+	uploadDrawData();
+
+	if(numViews == 1)
+		drawPass(0, commands.size(), 0);
+	else {
+		GLint target[4];
+		glGetIntegerv(GL_VIEWPORT, target);
+
+		if(viewsRouted) {
+			for(unsigned int v = 0; v < numViews; v++)
+				glViewportIndexedf(v, (GLfloat) views[v].viewport[0], (GLfloat) views[v].viewport[1], (GLfloat) views[v].viewport[2], (GLfloat) views[v].viewport[3]);
+			drawPass(0, commands.size(), -1);
+		}
+		else {
+			//The first view last, so programs are left set up for it.
+			for(int v = numViews - 1; v >= 0; v--) {
+				glViewport(views[v].viewport[0], views[v].viewport[1], views[v].viewport[2], views[v].viewport[3]);
+				frameUniformsUploaded.clear();
+				drawPass(passStarts[v], passStarts[v + 1], v);
+			}
+		}
+
+		//Sets every viewport back to the whole target.
+		glViewport(target[0], target[1], target[2], target[3]);
+	}
+
+	numPackets = 0;
+}
+
+//Commands [first, end) in runs sharing a program, vao and texture. A view
+//of -1 is every view at once through the multi-view programs.
+void RenderQueue::drawPass(unsigned int first, unsigned int end, int view) {
+	//One run per program, vao and texture, which with every mesh in the one
+	//vao is one run per program and texture.
+	while(first < end) {
+		const DrawPacket& packet = packets[commandPackets[first]];
+
+		unsigned int runEnd = first + 1;
+		while(runEnd < end && packets[commandPackets[runEnd]].program == packet.program && packets[commandPackets[runEnd]].vao == packet.vao &&
+			  packets[commandPackets[runEnd]].texture == packet.texture)
+			runEnd++;
+
+		bindProgram(packet.program);
+
+		//Projection and time only change per frame (or pass), so upload them once per program.
+		if(find(frameUniformsUploaded.begin(), frameUniformsUploaded.end(), packet.program) == frameUniformsUploaded.end()) {
+			if(view < 0) {
+				GLfloat projections[16 * MAX_VIEWS];
+				for(unsigned int v = 0; v < numViews; v++)
+					memcpy(&projections[16 * v], views[v].projection, sizeof(views[v].projection));
+				glUniformMatrix4fv(packet.projectionLocation, numViews, GL_FALSE, projections);
+			}
+			else
+				glUniformMatrix4fv(packet.projectionLocation, 1, GL_FALSE, views[view].projection);
+			stats.uniformUploads++;
+			if(packet.timeLocation != -1) {
+				glUniform1f(packet.timeLocation, time);
+				stats.uniformUploads++;
+			}
+			//Point lights are clustered for the first view alone.
+			if(packet.clusterViewLocation != -1) {
+				GLfloat origin[2] = { 0.0f, 0.0f };
+				if(numViews > 1) {
+					origin[0] = (GLfloat) views[0].viewport[0];
+					origin[1] = (GLfloat) views[0].viewport[1];
+				}
+				glUniform3f(packet.clusterViewLocation, origin[0], origin[1], view > 0 ? 1.0f : 0.0f);
+				stats.uniformUploads++;
+			}
+			frameUniformsUploaded.push_back(packet.program);
+		}
+
+		//The vao already holds the element buffer and attribute bindings.
+		bindVertexArray(packet.vao);
+		bindTexture(packet.texture);
+
+		drawRun(first, runEnd - first);
+		first = runEnd;
+	}
+}
+
+void RenderQueue::createBuffers() {
+	glGenBuffers(1, &instanceBuffer);
+	glGenBuffers(1, &indirectBuffer);
+	multiDraw = multiDrawAllowed && multiDrawSupported();
+	stats.multiDraw = multiDraw;
+	buffersCreated = true;
+}
+
+//Per-draw data and draw commands in sorted order, each draw's base instance
+//picking out its own model-view and flap. Routed, a draw seen in several
+//views is one command with an instance for each. Otherwise every view gets
+//its own run of commands. Buffers are orphaned rather than overwritten so
+//we never wait on last frame's draws.
+void RenderQueue::uploadDrawData() {
+	instances.clear();
+	commands.clear();
+	commandPackets.clear();
+
+	DrawElementsIndirectCommand command;
+	command.instanceCount = 1;
+	if(viewsRouted) {
+		for(unsigned int i = 0; i < numPackets; i++) {
+			const DrawPacket& packet = packets[sorted[i].index];
+			command.baseInstance = instances.size() / INSTANCE_FLOATS;
+			for(unsigned int v = 0; v < numViews; v++) {
+				if(packet.views & (1u << v))
+					writeInstance(packet, v);
+			}
+			command.count = packet.numIndices;
+			command.instanceCount = instances.size() / INSTANCE_FLOATS - command.baseInstance;
+			command.firstIndex = packet.firstIndex;
+			command.baseVertex = packet.baseVertex;
+			commands.push_back(command);
+			commandPackets.push_back(sorted[i].index);
+		}
+	}
+	else {
+		for(unsigned int v = 0; v < numViews; v++) {
+			passStarts[v] = commands.size();
+			for(unsigned int i = 0; i < numPackets; i++) {
+				const DrawPacket& packet = packets[sorted[i].index];
+				if(!(packet.views & (1u << v)))
+					continue;
+				command.baseInstance = instances.size() / INSTANCE_FLOATS;
+				writeInstance(packet, v);
+				command.count = packet.numIndices;
+				command.firstIndex = packet.firstIndex;
+				command.baseVertex = packet.baseVertex;
+				commands.push_back(command);
+				commandPackets.push_back(sorted[i].index);
+			}
+		}
+		passStarts[numViews] = commands.size();
+	}
+
+	if(commands.empty())
+		return;
+
+	GLuint instanceBytes = instances.size() * sizeof(GLfloat);
+	if(instanceBytes > instanceCapacity)
+		instanceCapacity = max(instanceBytes, instanceCapacity * 2);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, instanceCapacity, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instanceBytes, &instances[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if(multiDraw) {
+		GLuint commandBytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+		if(commandBytes > indirectCapacity)
+			indirectCapacity = max(commandBytes, indirectCapacity * 2);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, &commands[0]);
+	}
+}
+
+void RenderQueue::writeInstance(const DrawPacket& packet, unsigned int view) {
+	size_t at = instances.size();
+	instances.resize(at + INSTANCE_FLOATS);
+	memcpy(&instances[at], packet.modelView, sizeof(packet.modelView));
+	memcpy(&instances[at + 16], packet.flap, sizeof(packet.flap));
+	instances[at + 20] = (GLfloat) view;
+
+	stats.views[view].draws++;
+	stats.views[view].triangles += packet.numIndices / 3;
+}
+
+//Either the whole run in one call, or a draw per packet with the instanced
+//attributes moved along to its data each time.
+void RenderQueue::drawRun(unsigned int first, unsigned int count) {
+	if(multiDraw) {
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, BUFFER_OFFSET(first * sizeof(DrawElementsIndirectCommand)), count, 0);
+		stats.drawCalls++;
+		return;
+	}
+
+	for(unsigned int i = first; i < first + count; i++) {
+		pointInstanceAttributes(commands[i].baseInstance);
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, commands[i].count, GL_UNSIGNED_INT,
+			BUFFER_OFFSET(commands[i].firstIndex * sizeof(GLuint)), commands[i].instanceCount, commands[i].baseVertex);
+		stats.drawCalls++;
+	}
+}
+
+//Model-view as four columns, flap then view, one step of the instance buffer
+//per instance. The bound vao keeps these, so multi-draw only sets them once.
+void RenderQueue::pointInstanceAttributes(GLuint instance) {
+	GLsizei stride = INSTANCE_FLOATS * sizeof(GLfloat);
+	size_t base = (size_t) instance * stride;
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for(int column = 0; column < 4; column++)
+		glVertexAttribPointer(ATTRIBUTE_MODELVIEW + column, 4, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(base + column * 4 * sizeof(GLfloat)));
+	glVertexAttribPointer(ATTRIBUTE_FLAP, 4, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(base + 16 * sizeof(GLfloat)));
+	glVertexAttribPointer(ATTRIBUTE_VIEW, 1, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(base + 20 * sizeof(GLfloat)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void RenderQueue::bindProgram(GLuint program) {
+	if(program == currentProgram) {
+		stats.redundantBinds++;
+		return;
+	}
+	glUseProgram(program);
+	currentProgram = program;
+	stats.programBinds++;
+}
+
+//Every program samples its texture from unit 0.
+void RenderQueue::bindTexture(GLuint texture) {
+	if(texture == currentTexture) {
+		stats.redundantBinds++;
+		return;
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
+	currentTexture = texture;
+	stats.textureBinds++;
+}
+
+void RenderQueue::bindVertexArray(GLuint vao) {
+	if(vao == currentVao) {
+		stats.redundantBinds++;
+		return;
+	}
+	glBindVertexArray(vao);
+	currentVao = vao;
+	stats.vaoBinds++;
+
+	//First time we've seen this vao, hook its instanced attributes up.
+	if(find(preparedVaos.begin(), preparedVaos.end(), vao) == preparedVaos.end()) {
+		for(int column = 0; column < 4; column++) {
+			glEnableVertexAttribArray(ATTRIBUTE_MODELVIEW + column);
+			glVertexAttribDivisor(ATTRIBUTE_MODELVIEW + column, 1);
+		}
+		glEnableVertexAttribArray(ATTRIBUTE_FLAP);
+		glVertexAttribDivisor(ATTRIBUTE_FLAP, 1);
+		glEnableVertexAttribArray(ATTRIBUTE_VIEW);
+		glVertexAttribDivisor(ATTRIBUTE_VIEW, 1);
+		pointInstanceAttributes(0);
+		preparedVaos.push_back(vao);
+	}
+}
+
+const RenderStats& RenderQueue::getStats() {
+	return stats;
+}
+
+//Dump the last frame's counters to the console.
+void RenderQueue::printStats() {
+	printf("Render: %u packets, %u draw calls (%s), %u program binds, %u vao binds, %u texture binds, %u uniform uploads (%u redundant binds skipped), %u with low shading\n",
+		stats.packets, stats.drawCalls, stats.multiDraw ? "multi-draw indirect" : "one per packet", stats.programBinds, stats.vaoBinds,
+		stats.textureBinds, stats.uniformUploads, stats.redundantBinds, stats.lowShadingDraws);
+
+	//What each view added. Draws and triangles are instances drawn in it,
+	//its share of the frame's triangles is roughly its share of the GPU time.
+	if(stats.numViews < 2)
+		return;
+	unsigned long long triangles = 0;
+	for(unsigned int v = 0; v < stats.numViews; v++)
+		triangles += stats.views[v].triangles;
+	printf("Views: %u in %s\n", stats.numViews, stats.viewsRouted ? "one pass, routed by viewport" : "a pass each");
+	for(unsigned int v = 0; v < stats.numViews; v++)
+		printf("  View %u: %u draws, %u culled, %llu triangles (%.0f%%)\n", v, stats.views[v].draws, stats.views[v].culled,
+			stats.views[v].triangles, triangles > 0 ? 100.0 * stats.views[v].triangles / triangles : 0.0);
+}
@@ -0,0 +1,336 @@
+#include "include/SceneFile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+//Constructor, an empty scene.
+SceneFile::SceneFile() {
+	clear();
+}
+
+//Destructor.
+SceneFile::~SceneFile() {
+
+}
+
+void SceneFile::clear() {
+	file.close();
+	meshes.clear();
+	groups.clear();
+	placementStorage.clear();
+	birdStorage.clear();
+	placements = NULL;
+	numPlacements = 0;
+	birds = NULL;
+	numBirds = 0;
+	terrainSet = false;
+	memset(&terrain, 0, sizeof(terrain));
+	loadMilliseconds = 0.0;
+}
+
+bool SceneFile::load(string fileName) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	clear();
+
+	if(!file.open(fileName)) {
+		fprintf(stderr, "Scene: can't read %s\n", fileName.c_str());
+		return false;
+	}
+
+	bool loaded;
+	if(file.getSize() >= sizeof(SceneHeader) && memcmp(file.getData(), SCENE_MAGIC, 8) == 0)
+		loaded = loadBinary(fileName);
+	else {
+		//Copied so the parser can rely on a terminator.
+		string text((const char*) file.getData(), file.getSize());
+		file.close();
+		loaded = loadText(fileName, text.c_str());
+	}
+
+	if(!loaded) {
+		clear();
+		return false;
+	}
+	loadMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+//Past blanks and comments, counting lines as we go.
+static const char* skipBlanks(const char* p, int& line) {
+	while(*p != '\0') {
+		if(*p == '#') {
+			while(*p != '\0' && *p != '\n')
+				p++;
+		}
+		else if(*p == '\n') {
+			line++;
+			p++;
+		}
+		else if(*p == ' ' || *p == '\t' || *p == '\r')
+			p++;
+		else
+			break;
+	}
+	return p;
+}
+
+static const char* readWord(const char* p, int& line, string& word) {
+	p = skipBlanks(p, line);
+	const char* start = p;
+	while(*p != '\0' && *p != '#' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+		p++;
+	word.assign(start, p - start);
+	return p;
+}
+
+//Count sets of width floats onto the end of values, NULL if any of them isn't
+//a number. Every number takes a character and a blank after it, so a count
+//the rest of the text (up to end) can't hold is turned down before anything
+//is allocated.
+static const char* readFloats(const char* p, const char* end, int& line, unsigned long long count, unsigned int width, vector<float>& values) {
+	if(count > (unsigned long long) (end - p + 1) / 2 / width)
+		return NULL;
+	count *= width;
+	size_t first = values.size();
+	values.resize(first + count);
+	for(unsigned long long i = 0; i < count; i++) {
+		p = skipBlanks(p, line);
+		char* last;
+		values[first + i] = strtof(p, &last);
+		if(last == p)
+			return NULL;
+		p = last;
+	}
+	return p;
+}
+
+bool SceneFile::loadText(string fileName, const char* text) {
+	const char* p = text;
+	const char* textEnd = text + strlen(text);
+	int line = 1;
+	string keyword, name, value;
+
+	while(*(p = skipBlanks(p, line)) != '\0') {
+		int keywordLine = line;
+		p = readWord(p, line, keyword);
+
+		if(keyword == "mesh") {
+			p = readWord(p, line, name);
+			p = readWord(p, line, value);
+			if(name.empty() || value.empty() || name.size() >= SCENE_NAME_BYTES || value.size() >= SCENE_NAME_BYTES) {
+				fprintf(stderr, "Scene: %s line %d: mesh needs a name and a file, each under %d characters\n", fileName.c_str(), keywordLine, SCENE_NAME_BYTES);
+				return false;
+			}
+			SceneMesh mesh;
+			memset(&mesh, 0, sizeof(mesh));
+			strcpy(mesh.name, name.c_str());
+			strcpy(mesh.fileName, value.c_str());
+
+			//Anything else on the line is the texture.
+			while(*p == ' ' || *p == '\t' || *p == '\r')
+				p++;
+			if(*p != '\0' && *p != '\n' && *p != '#') {
+				p = readWord(p, line, value);
+				if(value.size() >= SCENE_NAME_BYTES) {
+					fprintf(stderr, "Scene: %s line %d: texture names are under %d characters\n", fileName.c_str(), keywordLine, SCENE_NAME_BYTES);
+					return false;
+				}
+				strcpy(mesh.texture, value.c_str());
+			}
+			meshes.push_back(mesh);
+		}
+		else if(keyword == "place") {
+			p = readWord(p, line, name);
+			p = readWord(p, line, value);
+
+			SceneGroup group;
+			group.mesh = meshes.size();
+			for(unsigned int i = 0; i < meshes.size(); i++) {
+				if(name == meshes[i].name)
+					group.mesh = i;
+			}
+			char* end;
+			group.count = strtoull(value.c_str(), &end, 10);
+			if(group.mesh == meshes.size() || value.empty() || *end != '\0') {
+				fprintf(stderr, "Scene: %s line %d: place needs a mesh named before it and a count\n", fileName.c_str(), keywordLine);
+				return false;
+			}
+
+			//Anything else on the line is flags.
+			group.flags = 0;
+			while(*p == ' ' || *p == '\t' || *p == '\r')
+				p++;
+			if(strncmp(p, "solid", 5) == 0) {
+				group.flags |= SCENE_SOLID;
+				p += 5;
+			}
+
+			group.first = placementStorage.size() / SCENE_PLACEMENT_FLOATS;
+			p = readFloats(p, textEnd, line, group.count, SCENE_PLACEMENT_FLOATS, placementStorage);
+			if(p == NULL) {
+				fprintf(stderr, "Scene: %s line %d: place %s wants %llu transforms of %d numbers\n",
+					fileName.c_str(), line, name.c_str(), group.count, SCENE_PLACEMENT_FLOATS);
+				return false;
+			}
+			groups.push_back(group);
+		}
+		else if(keyword == "terrain") {
+			vector<float> values;
+			p = readWord(p, line, value);
+			char* end;
+			terrain.seed = (unsigned int) strtoul(value.c_str(), &end, 10);
+			if(value.empty() || *end != '\0' || (p = readFloats(p, textEnd, line, 1, 3, values)) == NULL || values[2] <= 0.0f) {
+				fprintf(stderr, "Scene: %s line %d: terrain wants a seed, base height, relief and a feature size above 0\n", fileName.c_str(), keywordLine);
+				return false;
+			}
+			terrain.baseHeight = values[0];
+			terrain.relief = values[1];
+			terrain.featureSize = values[2];
+
+			//Anything else on the line is the texture.
+			while(*p == ' ' || *p == '\t' || *p == '\r')
+				p++;
+			if(*p != '\0' && *p != '\n' && *p != '#') {
+				p = readWord(p, line, value);
+				if(value.size() >= TERRAIN_NAME_BYTES) {
+					fprintf(stderr, "Scene: %s line %d: texture names are under %d characters\n", fileName.c_str(), keywordLine, TERRAIN_NAME_BYTES);
+					return false;
+				}
+				strcpy(terrain.texture, value.c_str());
+			}
+			terrainSet = true;
+		}
+		else if(keyword == "birds") {
+			p = readWord(p, line, value);
+			char* end;
+			unsigned long long count = strtoull(value.c_str(), &end, 10);
+			if(value.empty() || *end != '\0' || (p = readFloats(p, textEnd, line, count, 3, birdStorage)) == NULL) {
+				fprintf(stderr, "Scene: %s line %d: birds wants a count and then that many positions\n", fileName.c_str(), keywordLine);
+				return false;
+			}
+		}
+		else {
+			fprintf(stderr, "Scene: %s line %d: don't know '%s'\n", fileName.c_str(), keywordLine, keyword.c_str());
+			return false;
+		}
+	}
+
+	placements = placementStorage.empty() ? NULL : &placementStorage[0];
+	numPlacements = placementStorage.size() / SCENE_PLACEMENT_FLOATS;
+	birds = birdStorage.empty() ? NULL : &birdStorage[0];
+	numBirds = birdStorage.size() / 3;
+	return true;
+}
+
+bool SceneFile::loadBinary(string fileName) {
+	const char* base = (const char*) file.getData();
+	const SceneHeader* header = (const SceneHeader*) base;
+	if(header->version != SCENE_VERSION || header->headerBytes != sizeof(SceneHeader)) {
+		fprintf(stderr, "Scene: %s isn't a scene this build can read\n", fileName.c_str());
+		return false;
+	}
+	//Sections in order, none overlapping the one before or running past the
+	//end. Counts are checked against the room left before they're
+	//multiplied by anything, so a huge one can't wrap round to fit.
+	unsigned long long offsets[4] = { header->meshesOffset, header->groupsOffset, header->placementsOffset, header->birdsOffset };
+	unsigned long long counts[4] = { header->numMeshes, header->numGroups, header->numPlacements, header->numBirds };
+	unsigned long long elementBytes[4] = { sizeof(SceneMesh), sizeof(SceneGroup), SCENE_PLACEMENT_FLOATS * sizeof(float), 3 * sizeof(float) };
+	unsigned long long sectionEnd = sizeof(SceneHeader);
+	bool fits = header->fileBytes <= file.getSize();
+	for(int i = 0; i < 4 && fits; i++) {
+		fits = offsets[i] >= sectionEnd && offsets[i] % SCENE_ALIGN == 0 && offsets[i] <= header->fileBytes &&
+			counts[i] <= (header->fileBytes - offsets[i]) / elementBytes[i];
+		if(fits)
+			sectionEnd = offsets[i] + counts[i] * elementBytes[i];
+	}
+	if(!fits) {
+		fprintf(stderr, "Scene: %s is truncated or damaged\n", fileName.c_str());
+		return false;
+	}
+
+	const SceneMesh* savedMeshes = (const SceneMesh*) (base + header->meshesOffset);
+	meshes.assign(savedMeshes, savedMeshes + header->numMeshes);
+	const SceneGroup* savedGroups = (const SceneGroup*) (base + header->groupsOffset);
+	groups.assign(savedGroups, savedGroups + header->numGroups);
+
+	for(int i = 0; i < meshes.size(); i++) {
+		meshes[i].name[SCENE_NAME_BYTES - 1] = '\0';
+		meshes[i].fileName[SCENE_NAME_BYTES - 1] = '\0';
+		meshes[i].texture[SCENE_NAME_BYTES - 1] = '\0';
+	}
+	for(int i = 0; i < groups.size(); i++) {
+		if(groups[i].mesh >= meshes.size() || groups[i].count > header->numPlacements ||
+		   groups[i].first > header->numPlacements - groups[i].count) {
+			fprintf(stderr, "Scene: %s has a group outside the scene\n", fileName.c_str());
+			return false;
+		}
+	}
+
+	terrainSet = header->hasTerrain != 0;
+	if(terrainSet) {
+		terrain = header->terrain;
+		terrain.texture[TERRAIN_NAME_BYTES - 1] = '\0';
+	}
+
+	//The big arrays stay where they are in the mapping.
+	numPlacements = header->numPlacements;
+	placements = numPlacements > 0 ? (const float*) (base + header->placementsOffset) : NULL;
+	numBirds = header->numBirds;
+	birds = numBirds > 0 ? (const float*) (base + header->birdsOffset) : NULL;
+	return true;
+}
+
+bool SceneFile::saveBinary(string fileName) {
+	string tempName = fileName + ".tmp";
+	FILE* fp = fopen(tempName.c_str(), "wb");
+	if(fp == NULL) {
+		fprintf(stderr, "Scene: can't write %s\n", tempName.c_str());
+		return false;
+	}
+	setvbuf(fp, NULL, _IOFBF, 1 << 20);
+
+	SceneHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SCENE_MAGIC, sizeof(header.magic));
+	header.version = SCENE_VERSION;
+	header.headerBytes = sizeof(SceneHeader);
+	header.numMeshes = meshes.size();
+	header.numGroups = groups.size();
+	header.hasTerrain = terrainSet;
+	header.terrain = terrain;
+	header.numPlacements = numPlacements;
+	header.numBirds = numBirds;
+	header.meshesOffset = sceneAlign(sizeof(SceneHeader));
+	header.groupsOffset = sceneAlign(header.meshesOffset + header.numMeshes * sizeof(SceneMesh));
+	header.placementsOffset = sceneAlign(header.groupsOffset + header.numGroups * sizeof(SceneGroup));
+	header.birdsOffset = sceneAlign(header.placementsOffset + header.numPlacements * SCENE_PLACEMENT_FLOATS * sizeof(float));
+	header.fileBytes = header.birdsOffset + header.numBirds * 3 * sizeof(float);
+
+	//Each section padded out to where the next one starts.
+	const void* sections[5] = { &header, meshes.empty() ? NULL : &meshes[0], groups.empty() ? NULL : &groups[0], placements, birds };
+	unsigned long long starts[5] = { 0, header.meshesOffset, header.groupsOffset, header.placementsOffset, header.birdsOffset };
+	unsigned long long sizes[5] = { sizeof(header), header.numMeshes * sizeof(SceneMesh), header.numGroups * sizeof(SceneGroup),
+		header.numPlacements * SCENE_PLACEMENT_FLOATS * sizeof(float), header.numBirds * 3 * sizeof(float) };
+
+	char padding[SCENE_ALIGN];
+	memset(padding, 0, sizeof(padding));
+	bool written = true;
+	for(int i = 0; i < 5 && written; i++) {
+		written = sizes[i] == 0 || fwrite(sections[i], 1, sizes[i], fp) == sizes[i];
+		unsigned long long gap = i < 4 ? starts[i + 1] - starts[i] - sizes[i] : 0;
+		written = written && (gap == 0 || fwrite(padding, 1, gap, fp) == gap);
+	}
+
+	written = fclose(fp) == 0 && written;
+#ifdef _WIN32
+	//Windows won't rename over an existing file.
+	if(written)
+		remove(fileName.c_str());
+#endif
+	if(!written || rename(tempName.c_str(), fileName.c_str()) != 0) {
+		fprintf(stderr, "Scene: failed writing %s\n", fileName.c_str());
+		remove(tempName.c_str());
+		return false;
+	}
+	return true;
+}
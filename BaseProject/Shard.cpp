@@ -0,0 +1,192 @@
+#include "include/Shard.h"
+#include "include/RandomRange.h"
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+
+//Constructor, nothing happens until run().
+Shard::Shard() {
+	header = NULL;
+	control = NULL;
+	left = NULL;
+	right = NULL;
+	index = 0;
+	world = NULL;
+}
+
+int Shard::run(string memoryName, unsigned int shardIndex) {
+	if(!memory.open(memoryName))
+		return EXIT_FAILURE;
+
+	header = shardHeader(memory.getData());
+	if(header->magic != SHARD_MAGIC || header->version != SHARD_VERSION || shardIndex >= header->numShards) {
+		fprintf(stderr, "Shard %u: %s isn't a shard region this build understands\n", shardIndex, memoryName.c_str());
+		return EXIT_FAILURE;
+	}
+
+	index = shardIndex;
+	control = shardControl(memory.getData(), index);
+	left = index > 0 ? shardControl(memory.getData(), index - 1) : NULL;
+	right = index + 1 < header->numShards ? shardControl(memory.getData(), index + 1) : NULL;
+
+	World shardWorld(true);
+	world = &shardWorld;
+	//Room for 64M birds' ids per shard before they could meet.
+	world->setNextBirdId(index << 26);
+	world->create(0, header->sceneFile, false);
+	spawnBirds();
+	control->state.store(SHARD_RUNNING);
+
+	//Same fixed step as World::run, but the exchange with the neighbours
+	//has to sit between steps so it's done here rather than on a thread.
+	chrono::steady_clock::duration interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / 60.0));
+	chrono::steady_clock::time_point next = chrono::steady_clock::now();
+
+	unsigned long long heartbeat = header->heartbeat.load();
+	chrono::steady_clock::time_point heartbeatSeen = next;
+
+	while(!header->quit.load()) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		//Nobody left to draw us, don't hang around.
+		if(header->heartbeat.load() != heartbeat) {
+			heartbeat = header->heartbeat.load();
+			heartbeatSeen = start;
+		}
+		else if(start - heartbeatSeen > chrono::seconds(10)) {
+			fprintf(stderr, "Shard %u: coordinator stopped responding, exiting\n", index);
+			break;
+		}
+
+		receive();
+		sendBirds();
+		world->step();
+		sendLandings();
+
+		double stepMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		publishView(stepMilliseconds);
+
+		control->birds.store(world->numBirds());
+		control->steps.fetch_add(1);
+
+		next += interval;
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if(next < now - interval * 4)
+			next = now;
+		this_thread::sleep_until(next);
+	}
+
+	world = NULL;
+	control->state.store(SHARD_EXITED);
+	return EXIT_SUCCESS;
+}
+
+//Each shard starts with its share of the flock spread over its own slab.
+void Shard::spawnBirds() {
+	double minX = control->minX > -WORLD_HALF_SIZE ? control->minX : -WORLD_HALF_SIZE;
+	double maxX = control->maxX < WORLD_HALF_SIZE ? control->maxX : WORLD_HALF_SIZE;
+
+	srand(1234 + index);
+	for(unsigned int i = 0; i < control->initialBirds; i++) {
+		double x = randomRange(minX, maxX);
+		double y = randomRange(-1.0, 1.5);
+		double z = randomRange(-WORLD_HALF_SIZE, WORLD_HALF_SIZE);
+		world->spawnBird(x, y, z);
+	}
+}
+
+//Take in input, birds arriving from either side and landings next door.
+void Shard::receive() {
+	WorldCommand command;
+	while(control->commands.pop(command))
+		world->sendCommand(command.type, command.value);
+
+	BirdRecord record;
+	while(control->birdsFromLeft.pop(record) || control->birdsFromRight.pop(record)) {
+		world->adoptBird(record);
+		control->birdsReceived.fetch_add(1);
+	}
+
+	Landing landing;
+	while(control->landingsFromLeft.pop(landing) || control->landingsFromRight.pop(landing))
+		world->wakeBirdsNear(landing.centre, SHARD_CONTACT_MARGIN);
+}
+
+//Birds that flew out of our slab go to whichever neighbour they flew into.
+//If its inbox is full the bird stays here a step and tries again.
+void Shard::sendBirds() {
+	outgoing.clear();
+	world->takeBirdsOutside(control->minX, control->maxX, outgoing);
+
+	for(int i = 0; i < outgoing.size(); i++) {
+		bool toLeft = outgoing[i].parts[KIND_BIRD_BODY].translation[0] < control->minX;
+		ShardControl* neighbour = toLeft ? left : right;
+
+		bool sent = neighbour != NULL && (toLeft ? neighbour->birdsFromRight.push(outgoing[i]) : neighbour->birdsFromLeft.push(outgoing[i]));
+		if(sent) {
+			control->birdsSent.fetch_add(1);
+		}
+		else {
+			world->adoptBird(outgoing[i]);
+			control->handoffRetries.fetch_add(1);
+		}
+	}
+}
+
+//A landing close to an edge can disturb birds resting on the other side.
+void Shard::sendLandings() {
+	const vector<Landing>& landings = world->getLandings();
+	for(int i = 0; i < landings.size(); i++) {
+		double x = landings[i].centre[0];
+		//Dropped rather than waited on if the neighbour is behind.
+		if(left != NULL && x - control->minX < SHARD_CONTACT_MARGIN && left->landingsFromRight.push(landings[i]))
+			control->landingsSent.fetch_add(1);
+		if(right != NULL && control->maxX - x < SHARD_CONTACT_MARGIN && right->landingsFromLeft.push(landings[i]))
+			control->landingsSent.fetch_add(1);
+	}
+}
+
+//Write the view the coordinator isn't reading from, under its seqlock, then
+//point the coordinator at it.
+void Shard::publishView(double stepMilliseconds) {
+	unsigned int side = 1 - control->latestView.load(memory_order_relaxed);
+	ShardViewHeader* view = shardView(memory.getData(), index, side);
+	ShardEntry* entries = shardViewEntries(view);
+
+	unsigned int sequence = view->sequence.load(memory_order_relaxed);
+	view->sequence.store(sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	const WorldSnapshot& snapshot = world->readSnapshot();
+	const SleepingLayer& sleeping = world->readSleepingLayer();
+	const vector<SnapshotEntry>* layers[2] = { &snapshot.entries, &sleeping.entries };
+
+	unsigned int count = 0;
+	unsigned int dropped = 0;
+	for(int layer = 0; layer < 2; layer++) {
+		for(int i = 0; i < layers[layer]->size(); i++) {
+			const SnapshotEntry& entry = (*layers[layer])[i];
+
+			//Scenery is the coordinator's own to draw.
+			if(entry.object->kind < FIRST_BIRD_KIND)
+				continue;
+			if(count == header->entriesPerView) {
+				dropped++;
+				continue;
+			}
+			entries[count].kind = entry.object->kind;
+			memcpy(entries[count].modelView, entry.modelView, sizeof(entry.modelView));
+			memcpy(entries[count].position, entry.position, sizeof(entry.position));
+			memcpy(entries[count].flap, entry.flap, sizeof(entry.flap));
+			count++;
+		}
+	}
+
+	view->count = count;
+	view->dropped = dropped;
+	view->step = snapshot.step;
+	view->stepMilliseconds = stepMilliseconds;
+
+	view->sequence.store(sequence + 2, memory_order_release);
+	control->latestView.store(side, memory_order_release);
+}
@@ -0,0 +1,264 @@
+#include "include/ShardCoordinator.h"
+#include "include/Bird.h"
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <spawn.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+//Constructor, no shards run until start() is called.
+ShardCoordinator::ShardCoordinator() {
+	numShards = 0;
+	readRetries = 0;
+	staleFrames = 0;
+	for(int i = 0; i < NUM_ENTITY_KINDS; i++)
+		proxies[i] = NULL;
+}
+
+//Destructor.
+ShardCoordinator::~ShardCoordinator() {
+
+	stop();
+
+	for(int i = 0; i < NUM_ENTITY_KINDS; i++)
+		Object::destroy(proxies[i]);
+
+}
+
+bool ShardCoordinator::start(int shards, int totalBirds, string sceneFile) {
+	if(shards < 1 || shards > MAX_SHARDS) {
+		fprintf(stderr, "Shards: between 1 and %d shards please\n", MAX_SHARDS);
+		return false;
+	}
+	if(sceneFile.size() >= SHARD_NAME_BYTES) {
+		fprintf(stderr, "Shards: scene file name %s is too long to pass on\n", sceneFile.c_str());
+		return false;
+	}
+	numShards = shards;
+
+	//Room for twice a fair share, birds drift between slabs.
+	unsigned int birdsPerShard = (totalBirds + numShards - 1) / numShards;
+	unsigned int entriesPerView = (2 * birdsPerShard + 16) * (NUM_ENTITY_KINDS - FIRST_BIRD_KIND);
+
+	memoryName = SharedMemory::uniqueName("flocksim");
+	if(!memory.create(memoryName, shardRegionBytes(numShards, entriesPerView)))
+		return false;
+
+	ShardHeader* header = new (memory.getData()) ShardHeader();
+	header->magic = SHARD_MAGIC;
+	header->version = SHARD_VERSION;
+	header->numShards = numShards;
+	header->entriesPerView = entriesPerView;
+	header->quit.store(false);
+	header->heartbeat.store(0);
+	strcpy(header->sceneFile, sceneFile.c_str());
+
+	//Equal slabs across the flying bounds. The outside edges are open so a
+	//bird pushed past the bounds always has somewhere to be.
+	double slabWidth = 2.0 * WORLD_HALF_SIZE / numShards;
+	for(unsigned int i = 0; i < numShards; i++) {
+		ShardControl* control = new (shardControl(memory.getData(), i)) ShardControl();
+		control->minX = i == 0 ? -1e30 : -WORLD_HALF_SIZE + i * slabWidth;
+		control->maxX = i == numShards - 1 ? 1e30 : -WORLD_HALF_SIZE + (i + 1) * slabWidth;
+		control->initialBirds = totalBirds / numShards + (i < totalBirds % numShards ? 1 : 0);
+
+		for(unsigned int side = 0; side < 2; side++) {
+			ShardViewHeader* view = new (shardView(memory.getData(), i, side)) ShardViewHeader();
+			view->sequence.store(0);
+			view->count = 0;
+			view->dropped = 0;
+			view->step = 0;
+			view->stepMilliseconds = 0.0;
+		}
+	}
+
+	views.assign(numShards, vector<ShardEntry>());
+	viewSteps.assign(numShards, 0);
+
+	for(unsigned int i = 0; i < numShards; i++) {
+		if(!spawn(i)) {
+			stop();
+			return false;
+		}
+	}
+
+	printf("Shards: %u processes simulating %d birds through %s\n", numShards, totalBirds, memoryName.c_str());
+	return true;
+}
+
+//Start one copy of ourselves in shard mode.
+bool ShardCoordinator::spawn(unsigned int shard) {
+	char index[16];
+	sprintf(index, "%u", shard);
+
+#ifdef _WIN32
+	char path[MAX_PATH];
+	GetModuleFileNameA(NULL, path, MAX_PATH);
+	string commandLine = string("\"") + path + "\" --shard " + index + " " + memoryName;
+
+	STARTUPINFOA startup;
+	PROCESS_INFORMATION process;
+	ZeroMemory(&startup, sizeof(startup));
+	startup.cb = sizeof(startup);
+	if(!CreateProcessA(path, &commandLine[0], NULL, NULL, FALSE, 0, NULL, NULL, &startup, &process)) {
+		fprintf(stderr, "Shards: failed to start shard %u\n", shard);
+		return false;
+	}
+	CloseHandle(process.hThread);
+	processes.push_back(process.hProcess);
+#else
+	char path[4096];
+	ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+	if(length <= 0) {
+		fprintf(stderr, "Shards: can't find our own executable\n");
+		return false;
+	}
+	path[length] = '\0';
+
+	char shardFlag[] = "--shard";
+	char* arguments[] = { path, shardFlag, index, &memoryName[0], NULL };
+	pid_t pid;
+	if(posix_spawn(&pid, path, NULL, NULL, arguments, environ) != 0) {
+		fprintf(stderr, "Shards: failed to start shard %u\n", shard);
+		return false;
+	}
+	processes.push_back(pid);
+#endif
+
+	return true;
+}
+
+//Tell every shard to finish, wait for them and release the memory.
+void ShardCoordinator::stop() {
+	if(memory.getData() != NULL) {
+		shardHeader(memory.getData())->quit.store(true);
+		waitForShards();
+	}
+	memory.close();
+}
+
+void ShardCoordinator::waitForShards() {
+	for(int i = 0; i < processes.size(); i++) {
+#ifdef _WIN32
+		if(WaitForSingleObject(processes[i], 5000) != WAIT_OBJECT_0)
+			TerminateProcess(processes[i], 1);
+		CloseHandle(processes[i]);
+#else
+		//Give it a few seconds to notice, then stop asking nicely.
+		int status;
+		bool exited = false;
+		for(int wait = 0; wait < 500 && !exited; wait++) {
+			exited = waitpid(processes[i], &status, WNOHANG) == processes[i];
+			if(!exited)
+				this_thread::sleep_for(chrono::milliseconds(10));
+		}
+		if(!exited) {
+			kill(processes[i], SIGKILL);
+			waitpid(processes[i], &status, 0);
+		}
+#endif
+	}
+	processes.clear();
+}
+
+//Input goes to every shard, like it goes to every bird in one world.
+void ShardCoordinator::sendCommand(WorldCommandType type, double value) {
+	WorldCommand command;
+	command.type = type;
+	command.value = value;
+	for(unsigned int i = 0; i < numShards && memory.getData() != NULL; i++)
+		shardControl(memory.getData(), i)->commands.push(command);
+}
+
+//Copy out the shard's latest view. Returns false (keeping the last good
+//copy) if the shard kept writing over it.
+bool ShardCoordinator::readView(unsigned int shard) {
+	ShardControl* control = shardControl(memory.getData(), shard);
+
+	for(int attempt = 0; attempt < 4; attempt++) {
+		ShardViewHeader* view = shardView(memory.getData(), shard, control->latestView.load(memory_order_acquire));
+
+		unsigned int before = view->sequence.load(memory_order_acquire);
+		if(before & 1) {
+			readRetries++;
+			continue;
+		}
+
+		unsigned int count = view->count;
+		if(count > shardHeader(memory.getData())->entriesPerView)
+			count = 0;
+		views[shard].resize(count);
+		if(count > 0)
+			memcpy(&views[shard][0], shardViewEntries(view), count * sizeof(ShardEntry));
+		unsigned long long step = view->step;
+
+		atomic_thread_fence(memory_order_acquire);
+		if(view->sequence.load(memory_order_relaxed) == before) {
+			viewSteps[shard] = step;
+			return true;
+		}
+		readRetries++;
+	}
+	return false;
+}
+
+void ShardCoordinator::submitDraws(MatrixStack& projectionStack, RenderQueue* queue) {
+	if(memory.getData() == NULL)
+		return;
+
+	shardHeader(memory.getData())->heartbeat.fetch_add(1);
+
+	//Same meshes and shader as a bird's own parts, made on first use since
+	//they need the GL context.
+	if(proxies[FIRST_BIRD_KIND] == NULL) {
+		const char* files[NUM_ENTITY_KINDS] = { NULL, "sphere.obj", "sphere.obj", "wing.obj", "wing.obj" };
+		for(int i = FIRST_BIRD_KIND; i < NUM_ENTITY_KINDS; i++) {
+			proxies[i] = Object::create((char*) files[i], "ShardProxy", (EntityKind) i);
+			proxies[i]->setupData(0, "shaders/birdVertexShader.glsl");
+			proxies[i]->setTexture(BIRD_TEXTURE);
+		}
+	}
+
+	for(unsigned int shard = 0; shard < numShards; shard++) {
+		if(!readView(shard))
+			staleFrames++;
+
+		SnapshotEntry entry;
+		for(int i = 0; i < views[shard].size(); i++) {
+			const ShardEntry& shardEntry = views[shard][i];
+			if(shardEntry.kind < FIRST_BIRD_KIND || shardEntry.kind >= NUM_ENTITY_KINDS)
+				continue;
+
+			entry.object = proxies[shardEntry.kind];
+			memcpy(entry.modelView, shardEntry.modelView, sizeof(entry.modelView));
+			memcpy(entry.position, shardEntry.position, sizeof(entry.position));
+			memcpy(entry.flap, shardEntry.flap, sizeof(entry.flap));
+			entry.object->submitDraw(entry, projectionStack, queue);
+		}
+	}
+}
+
+void ShardCoordinator::printStats() {
+	if(memory.getData() == NULL)
+		return;
+
+	for(unsigned int i = 0; i < numShards; i++) {
+		ShardControl* control = shardControl(memory.getData(), i);
+		ShardViewHeader* view = shardView(memory.getData(), i, control->latestView.load());
+		printf("Shard %u: %s, %u birds, step %llu (%.3f ms), %llu sent, %llu received, %llu landings passed on, %llu handoff retries, %u entries dropped\n",
+			i, control->state.load() == SHARD_RUNNING ? "running" : control->state.load() == SHARD_EXITED ? "exited" : "starting",
+			control->birds.load(), viewSteps[i], view->stepMilliseconds,
+			control->birdsSent.load(), control->birdsReceived.load(), control->landingsSent.load(),
+			control->handoffRetries.load(), view->dropped);
+	}
+	printf("Shards: %llu view read retries, %llu stale frames\n", readRetries, staleFrames);
+}
@@ -0,0 +1,137 @@
+#include "include/SharedMemory.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Constructor, nothing is mapped until create() or open().
+SharedMemory::SharedMemory() {
+	data = NULL;
+	size = 0;
+	owner = false;
+#ifdef _WIN32
+	mapping = NULL;
+#endif
+}
+
+//Destructor.
+SharedMemory::~SharedMemory() {
+
+	close();
+
+}
+
+//New pages read as zero on both platforms.
+bool SharedMemory::create(string blockName, size_t bytes) {
+	close();
+	name = blockName;
+
+#ifdef _WIN32
+	mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+		(DWORD) ((unsigned long long) bytes >> 32), (DWORD) (bytes & 0xFFFFFFFF), name.c_str());
+	if(mapping == NULL || GetLastError() == ERROR_ALREADY_EXISTS) {
+		fprintf(stderr, "Failed to create shared memory %s\n", name.c_str());
+		close();
+		return false;
+	}
+	data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+#else
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if(fd < 0) {
+		fprintf(stderr, "Failed to create shared memory %s\n", name.c_str());
+		return false;
+	}
+	owner = true;
+	if(ftruncate(fd, bytes) == 0) {
+		data = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(data == MAP_FAILED)
+			data = NULL;
+	}
+	::close(fd);
+#endif
+
+	if(data == NULL) {
+		fprintf(stderr, "Failed to map %lu bytes of shared memory %s\n", (unsigned long) bytes, name.c_str());
+		close();
+		return false;
+	}
+
+	owner = true;
+	size = bytes;
+	return true;
+}
+
+bool SharedMemory::open(string blockName) {
+	close();
+	name = blockName;
+
+#ifdef _WIN32
+	mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+	if(mapping != NULL)
+		data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if(data != NULL) {
+		MEMORY_BASIC_INFORMATION info;
+		VirtualQuery(data, &info, sizeof(info));
+		size = info.RegionSize;
+	}
+#else
+	int fd = shm_open(name.c_str(), O_RDWR, 0600);
+	if(fd >= 0) {
+		struct stat status;
+		if(fstat(fd, &status) == 0 && status.st_size > 0) {
+			data = mmap(NULL, status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if(data == MAP_FAILED)
+				data = NULL;
+			else
+				size = status.st_size;
+		}
+		::close(fd);
+	}
+#endif
+
+	if(data == NULL) {
+		fprintf(stderr, "Failed to open shared memory %s\n", name.c_str());
+		close();
+		return false;
+	}
+	return true;
+}
+
+void SharedMemory::close() {
+#ifdef _WIN32
+	if(data != NULL)
+		UnmapViewOfFile(data);
+	if(mapping != NULL)
+		CloseHandle(mapping);
+	mapping = NULL;
+#else
+	if(data != NULL)
+		munmap(data, size);
+	if(owner)
+		shm_unlink(name.c_str());
+#endif
+
+	data = NULL;
+	size = 0;
+	owner = false;
+}
+
+void* SharedMemory::getData()	{ return data;	}
+size_t SharedMemory::getSize()	{ return size;	}
+
+string SharedMemory::uniqueName(const char* prefix) {
+	char buffer[128];
+#ifdef _WIN32
+	sprintf(buffer, "Local\\%s-%lu", prefix, (unsigned long) GetCurrentProcessId());
+#else
+	sprintf(buffer, "/%s-%lu", prefix, (unsigned long) getpid());
+#endif
+	return buffer;
+}
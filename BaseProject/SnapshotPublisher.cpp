@@ -0,0 +1,204 @@
+#include "include/SnapshotPublisher.h"
+#include <string.h>
+#include <new>
+
+//Constructor, nothing is published until create().
+SnapshotPublisher::SnapshotPublisher() {
+	lastMesh = 0;
+	lastHeartbeat = 0;
+	lastHeartbeatStep = 0;
+	restingSent = false;
+	memset(&stats, 0, sizeof(stats));
+}
+
+//Destructor.
+SnapshotPublisher::~SnapshotPublisher() {
+
+	close();
+
+}
+
+bool SnapshotPublisher::create(string publishName, unsigned int activeCapacity, unsigned int restingCapacity) {
+	close();
+	name = publishName;
+	if(!memory.create(viewMemoryName(name), viewRegionBytes(activeCapacity, restingCapacity)))
+		return false;
+
+	ViewHeader* header = new (memory.getData()) ViewHeader();
+	header->magic = VIEW_MAGIC;
+	header->version = VIEW_VERSION;
+	header->activeCapacity = activeCapacity;
+	header->restingCapacity = restingCapacity;
+	header->numMeshes.store(0);
+	header->latestActive.store(0);
+	header->latestResting.store(0);
+	header->published.store(0);
+	header->viewers.store(0);
+	header->heartbeat.store(0);
+	header->hasTerrain.store(false);
+
+	for(unsigned int i = 0; i < VIEW_SLOTS; i++) {
+		ViewSlotHeader* slots[2] = { viewActiveSlot(memory.getData(), i), viewRestingSlot(memory.getData(), i) };
+		for(int j = 0; j < 2; j++) {
+			new (slots[j]) ViewSlotHeader();
+			slots[j]->sequence.store(0);
+			slots[j]->count = 0;
+			slots[j]->dropped = 0;
+			slots[j]->step = 0;
+			slots[j]->stepMilliseconds = 0.0;
+		}
+	}
+
+	meshes.clear();
+	textures.clear();
+	kinds.clear();
+	restingSent = false;
+	header->live.store(true, memory_order_release);
+	printf("Publishing as %s for viewers to attach to\n", name.c_str());
+	return true;
+}
+
+//Viewers still attached see the world has gone and stop drawing it.
+void SnapshotPublisher::close() {
+	if(memory.getData() != NULL)
+		viewHeader(memory.getData())->live.store(false, memory_order_release);
+	memory.close();
+}
+
+//Watched while some viewer is attached and its heartbeat keeps moving.
+bool SnapshotPublisher::checkWatched(unsigned long long step) {
+	ViewHeader* header = viewHeader(memory.getData());
+	if(header->viewers.load(memory_order_acquire) == 0)
+		return false;
+
+	unsigned long long heartbeat = header->heartbeat.load(memory_order_relaxed);
+	if(heartbeat != lastHeartbeat || lastHeartbeatStep == 0) {
+		lastHeartbeat = heartbeat;
+		lastHeartbeatStep = step;
+	}
+	return step - lastHeartbeatStep <= VIEW_DETACH_STEPS;
+}
+
+void SnapshotPublisher::publish(const WorldSnapshot& snapshot) {
+	if(memory.getData() == NULL)
+		return;
+
+	stats.watched = checkWatched(snapshot.step);
+	if(!stats.watched) {
+		stats.stepsUnwatched++;
+		restingSent = false;
+		return;
+	}
+
+	ViewHeader* header = viewHeader(memory.getData());
+	unsigned int slot = (header->latestActive.load(memory_order_relaxed) + 1) % VIEW_SLOTS;
+	writeSlot(viewActiveSlot(memory.getData(), slot), header->activeCapacity, snapshot.entries, snapshot.step, snapshot.stepMilliseconds);
+	header->latestActive.store(slot, memory_order_release);
+	header->published.fetch_add(1, memory_order_release);
+	stats.activePublished++;
+}
+
+void SnapshotPublisher::publishResting(const SleepingLayer& layer, unsigned long long step) {
+	if(memory.getData() == NULL)
+		return;
+
+	ViewHeader* header = viewHeader(memory.getData());
+	if(header->viewers.load(memory_order_acquire) == 0) {
+		restingSent = false;
+		return;
+	}
+
+	unsigned int slot = (header->latestResting.load(memory_order_relaxed) + 1) % VIEW_SLOTS;
+	writeSlot(viewRestingSlot(memory.getData(), slot), header->restingCapacity, layer.entries, step, 0.0);
+	header->latestResting.store(slot, memory_order_release);
+	header->published.fetch_add(1, memory_order_release);
+	restingSent = true;
+	stats.restingPublished++;
+}
+
+void SnapshotPublisher::publishTerrain(const TerrainSettings& settings) {
+	if(memory.getData() == NULL)
+		return;
+	ViewHeader* header = viewHeader(memory.getData());
+	header->terrain = settings;
+	header->hasTerrain.store(true, memory_order_release);
+}
+
+bool SnapshotPublisher::wantsResting() {
+	return memory.getData() != NULL && !restingSent && viewHeader(memory.getData())->viewers.load(memory_order_acquire) > 0;
+}
+
+//Seqlocked: odd while the entries are going in, even again once they're done.
+void SnapshotPublisher::writeSlot(ViewSlotHeader* slot, unsigned int capacity, const vector<SnapshotEntry>& entries, unsigned long long step, double stepMilliseconds) {
+	unsigned int sequence = slot->sequence.load(memory_order_relaxed);
+	slot->sequence.store(sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	ViewEntry* out = viewSlotEntries(slot);
+	unsigned int count = 0;
+	unsigned int dropped = 0;
+	for(int i = 0; i < entries.size(); i++) {
+		unsigned int mesh = meshIndex(entries[i].object);
+		if(count == capacity || mesh == VIEW_MAX_MESHES) {
+			dropped++;
+			continue;
+		}
+		out[count].mesh = mesh;
+		memcpy(out[count].modelView, entries[i].modelView, sizeof(out[count].modelView));
+		memcpy(out[count].position, entries[i].position, sizeof(out[count].position));
+		memcpy(out[count].flap, entries[i].flap, sizeof(out[count].flap));
+		count++;
+	}
+	slot->count = count;
+	slot->dropped = dropped;
+	slot->step = step;
+	slot->stepMilliseconds = stepMilliseconds;
+	stats.entriesDropped = dropped;
+
+	slot->sequence.store(sequence + 2, memory_order_release);
+}
+
+//Where an object's mesh is in the shared table, adding it the first time.
+//Runs of entries share a mesh, so the last one found is tried first.
+unsigned int SnapshotPublisher::meshIndex(Object* object) {
+	Mesh* mesh = object->getMesh();
+	Texture* texture = object->getTexture();
+	if(lastMesh < meshes.size() && meshes[lastMesh] == mesh && textures[lastMesh] == texture && kinds[lastMesh] == object->kind)
+		return lastMesh;
+
+	for(unsigned int i = 0; i < meshes.size(); i++) {
+		if(meshes[i] == mesh && textures[i] == texture && kinds[i] == object->kind) {
+			lastMesh = i;
+			return i;
+		}
+	}
+	if(meshes.size() == VIEW_MAX_MESHES)
+		return VIEW_MAX_MESHES;
+
+	ViewMesh* table = viewMeshes(memory.getData());
+	unsigned int index = meshes.size();
+	memset(&table[index], 0, sizeof(ViewMesh));
+	strncpy(table[index].fileName, mesh->fileName.c_str(), VIEW_NAME_BYTES - 1);
+	if(texture != NULL)
+		strncpy(table[index].texture, texture->fileName.c_str(), VIEW_NAME_BYTES - 1);
+	table[index].kind = object->kind;
+	meshes.push_back(mesh);
+	textures.push_back(texture);
+	kinds.push_back(object->kind);
+	viewHeader(memory.getData())->numMeshes.store(meshes.size(), memory_order_release);
+
+	lastMesh = index;
+	return index;
+}
+
+const PublishStats& SnapshotPublisher::getStats() {
+	return stats;
+}
+
+void SnapshotPublisher::printStats() {
+	if(memory.getData() == NULL)
+		return;
+	printf("Publishing %s: %s, %llu steps and %llu resting layers sent, %llu steps unwatched, %u entries dropped last step\n",
+		name.c_str(), stats.watched ? "watched" : "nobody watching", stats.activePublished, stats.restingPublished,
+		stats.stepsUnwatched, stats.entriesDropped);
+}
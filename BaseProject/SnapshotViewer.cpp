@@ -0,0 +1,174 @@
+#include "include/SnapshotViewer.h"
+#include <string.h>
+
+//Constructor, nothing to draw until attach().
+SnapshotViewer::SnapshotViewer() {
+	memset(&stats, 0, sizeof(stats));
+}
+
+//Destructor.
+SnapshotViewer::~SnapshotViewer() {
+
+	detach();
+
+	for(int i = 0; i < proxies.size(); i++)
+		Object::destroy(proxies[i]);
+
+}
+
+bool SnapshotViewer::attach(string publishName) {
+	detach();
+	name = publishName;
+	if(!memory.open(viewMemoryName(name))) {
+		fprintf(stderr, "Viewer: nothing published as %s\n", name.c_str());
+		return false;
+	}
+
+	ViewHeader* header = viewHeader(memory.getData());
+	if(memory.getSize() < sizeof(ViewHeader) || header->magic != VIEW_MAGIC || header->version != VIEW_VERSION ||
+	   memory.getSize() < viewRegionBytes(header->activeCapacity, header->restingCapacity)) {
+		fprintf(stderr, "Viewer: %s isn't a world this build can show\n", name.c_str());
+		memory.close();
+		return false;
+	}
+
+	//Counted in, the world starts writing from its next step.
+	header->viewers.fetch_add(1);
+	printf("Viewer: attached to %s\n", name.c_str());
+	return true;
+}
+
+void SnapshotViewer::detach() {
+	if(memory.getData() == NULL)
+		return;
+	viewHeader(memory.getData())->viewers.fetch_sub(1);
+	memory.close();
+}
+
+//The stand-in for a published mesh. Birds' parts use the bird shader, the
+//scenery its own id like the world gives it, and both the same texture.
+Object* SnapshotViewer::proxyFor(unsigned int mesh) {
+	if(mesh < proxies.size() && proxies[mesh] != NULL)
+		return proxies[mesh];
+	if(mesh >= proxies.size())
+		proxies.resize(mesh + 1, NULL);
+
+	const ViewMesh& published = viewMeshes(memory.getData())[mesh];
+	char fileName[VIEW_NAME_BYTES];
+	char texture[VIEW_NAME_BYTES];
+	memcpy(fileName, published.fileName, VIEW_NAME_BYTES);
+	memcpy(texture, published.texture, VIEW_NAME_BYTES);
+	fileName[VIEW_NAME_BYTES - 1] = '\0';
+	texture[VIEW_NAME_BYTES - 1] = '\0';
+	int kind = published.kind;
+	if(kind < 0 || kind >= NUM_ENTITY_KINDS)
+		kind = KIND_STATIC;
+
+	proxies[mesh] = Object::create(fileName, "ViewerProxy", (EntityKind) kind);
+	if(kind >= FIRST_BIRD_KIND)
+		proxies[mesh]->setupData(0, "shaders/birdVertexShader.glsl");
+	else
+		proxies[mesh]->setupData(mesh + 1);
+	if(texture[0] != '\0')
+		proxies[mesh]->setTexture(texture);
+	return proxies[mesh];
+}
+
+//Draws straight out of a slot, checking its sequence on the way in and out.
+//If the world wrote to it meanwhile the draws are taken back and it's read
+//again from whichever slot is latest by then.
+bool SnapshotViewer::drawSlot(ViewSlotHeader* slot, unsigned int capacity, unsigned long long& step, double& stepMilliseconds, MatrixStack& projectionStack, RenderQueue* queue) {
+	unsigned int before = slot->sequence.load(memory_order_acquire);
+	if(before & 1)
+		return false;
+
+	unsigned int mark = queue->mark();
+	unsigned int numMeshes = viewHeader(memory.getData())->numMeshes.load(memory_order_acquire);
+	unsigned int count = slot->count;
+	if(count > capacity)
+		count = 0;
+
+	const ViewEntry* entries = viewSlotEntries(slot);
+	SnapshotEntry entry;
+	for(unsigned int i = 0; i < count; i++) {
+		unsigned int mesh = entries[i].mesh;
+		if(mesh >= numMeshes)
+			continue;
+
+		entry.object = proxyFor(mesh);
+		memcpy(entry.modelView, entries[i].modelView, sizeof(entry.modelView));
+		memcpy(entry.position, entries[i].position, sizeof(entry.position));
+		memcpy(entry.flap, entries[i].flap, sizeof(entry.flap));
+		entry.object->submitDraw(entry, projectionStack, queue);
+	}
+	unsigned long long slotStep = slot->step;
+	double slotMilliseconds = slot->stepMilliseconds;
+
+	atomic_thread_fence(memory_order_acquire);
+	if(slot->sequence.load(memory_order_relaxed) != before) {
+		queue->rewind(mark);
+		return false;
+	}
+	step = slotStep;
+	stepMilliseconds = slotMilliseconds;
+	return true;
+}
+
+void SnapshotViewer::submitDraws(MatrixStack& projectionStack, RenderQueue* queue) {
+	if(memory.getData() == NULL)
+		return;
+
+	//Tells the world someone is still watching.
+	ViewHeader* header = viewHeader(memory.getData());
+	header->heartbeat.fetch_add(1, memory_order_relaxed);
+	stats.frames++;
+
+	bool activeRead = false;
+	bool restingRead = false;
+	for(int attempt = 0; attempt < 4 && !activeRead; attempt++) {
+		ViewSlotHeader* slot = viewActiveSlot(memory.getData(), header->latestActive.load(memory_order_acquire));
+		activeRead = drawSlot(slot, header->activeCapacity, stats.activeStep, stats.stepMilliseconds, projectionStack, queue);
+		if(!activeRead)
+			stats.readRetries++;
+	}
+	for(int attempt = 0; attempt < 4 && !restingRead; attempt++) {
+		ViewSlotHeader* slot = viewRestingSlot(memory.getData(), header->latestResting.load(memory_order_acquire));
+		restingRead = drawSlot(slot, header->restingCapacity, stats.restingStep, stats.restingMilliseconds, projectionStack, queue);
+		if(!restingRead)
+			stats.readRetries++;
+	}
+	if(!activeRead || !restingRead)
+		stats.staleFrames++;
+}
+
+bool SnapshotViewer::isLive() {
+	return memory.getData() != NULL && viewHeader(memory.getData())->live.load(memory_order_acquire);
+}
+
+unsigned long long SnapshotViewer::getChangeCount() {
+	if(memory.getData() == NULL)
+		return 0;
+	return viewHeader(memory.getData())->published.load(memory_order_acquire);
+}
+
+bool SnapshotViewer::getTerrain(TerrainSettings& settings) {
+	if(memory.getData() == NULL)
+		return false;
+	ViewHeader* header = viewHeader(memory.getData());
+	if(!header->hasTerrain.load(memory_order_acquire))
+		return false;
+	settings = header->terrain;
+	return true;
+}
+
+const ViewerStats& SnapshotViewer::getStats() {
+	return stats;
+}
+
+void SnapshotViewer::printStats() {
+	if(memory.getData() == NULL)
+		return;
+	printf("Viewer %s: %s, step %llu (%.3f ms), resting layer from step %llu, %llu frames, %llu read retries, %llu stale frames\n",
+		name.c_str(), isLive() ? "live" : "world gone", stats.activeStep, stats.stepMilliseconds, stats.restingStep,
+		stats.frames, stats.readRetries, stats.staleFrames);
+}
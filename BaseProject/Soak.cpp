@@ -0,0 +1,87 @@
+#include "include/Soak.h"
+#include "include/RandomRange.h"
+#include <stdlib.h>
+#include <chrono>
+
+//One full life cycle, everything made here is gone again when it returns.
+static void soakRound(Arena& scratch) {
+	World world(true);
+	world.create();
+	for(int i = 0; i < SOAK_BIRDS; i++)
+		world.spawnBird(randomRange(-1.5, 1.5), randomRange(-1.0, 1.5), randomRange(-1.5, 1.5));
+
+	//Stepped by hand, with some input thrown in so birds fall, crash, sleep and wake.
+	for(int i = 0; i < SOAK_STEPS; i++) {
+		if(i % 50 == 25)
+			world.sendCommand(COMMAND_FALL, rand() % 2);
+		else if(i % 10 == 0)
+			world.sendCommand(COMMAND_STEER, randomRange(-5.0, 5.0));
+		world.step();
+	}
+
+	//A mesh of our own rather than the loader's shared copy, so it's
+	//loaded and freed every round.
+	Mesh mesh("sphere.obj");
+	mesh.parse(scratch);
+	scratch.reset();
+}
+
+int runSoak(double seconds) {
+	printf("Soak: running headless for %.0f seconds\n", seconds);
+
+	Arena scratch;
+	for(int i = 0; i < SOAK_WARMUP_ROUNDS; i++)
+		soakRound(scratch);
+
+	long long baseline[NUM_MEMORY_CATEGORIES];
+	for(int i = 0; i < NUM_MEMORY_CATEGORIES; i++)
+		baseline[i] = MemoryStats::current((MemoryCategory) i);
+	size_t baselineResident = MemoryStats::processBytes();
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	double elapsed = 0.0;
+	double nextReport = 10.0;
+	unsigned long long rounds = 0;
+	long long largestGrowth = 0;
+	int failures = 0;
+
+	while(elapsed < seconds && failures == 0) {
+		soakRound(scratch);
+		rounds++;
+
+		//Tracked memory has to come back exactly, pools and arenas keep what
+		//they grew to so there's no reason for it to move after warm up.
+		for(int i = 0; i < NUM_MEMORY_CATEGORIES; i++) {
+			long long now = MemoryStats::current((MemoryCategory) i);
+			if(now != baseline[i]) {
+				printf("Soak: %s went from %lld to %lld bytes in round %llu\n",
+					MemoryStats::name((MemoryCategory) i), baseline[i], now, rounds);
+				failures++;
+			}
+		}
+
+		//Anything untracked shows up in the process as a whole.
+		long long growth = (long long) MemoryStats::processBytes() - (long long) baselineResident;
+		if(growth > largestGrowth)
+			largestGrowth = growth;
+		if(growth > SOAK_RESIDENT_SLACK) {
+			printf("Soak: process grew by %lld bytes by round %llu\n", growth, rounds);
+			failures++;
+		}
+
+		elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		if(elapsed >= nextReport) {
+			printf("Soak: %.0f s, %llu rounds, %lld bytes tracked, resident growth %lld bytes\n",
+				elapsed, rounds, MemoryStats::total(), growth);
+			nextReport += 10.0;
+		}
+	}
+
+	MemoryStats::print();
+	Bird::printPoolStats();
+	Object::printPoolStats();
+	printf("Soak: %s after %llu rounds in %.0f s, largest resident growth %lld bytes\n",
+		failures == 0 ? "flat" : "FAILED", rounds, elapsed, largestGrowth);
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
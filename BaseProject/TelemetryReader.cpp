@@ -0,0 +1,221 @@
+#include "include/TelemetryReader.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+static bool byFirstStep(const TelemetryIndexEntry& a, const TelemetryIndexEntry& b) {
+	return a.firstStep < b.firstStep;
+}
+
+//Constructor.
+TelemetryReader::TelemetryReader() {
+	memset(&header, 0, sizeof(header));
+}
+
+//Destructor.
+TelemetryReader::~TelemetryReader() {
+
+	close();
+
+}
+
+bool TelemetryReader::open(string fileName) {
+	close();
+
+	if(!file.open(fileName))
+		return false;
+
+	const unsigned char* data = (const unsigned char*) file.getData();
+	if(file.getSize() < sizeof(header)) {
+		fprintf(stderr, "Telemetry: %s is too small\n", fileName.c_str());
+		close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if(memcmp(header.magic, TELEMETRY_MAGIC, sizeof(header.magic)) != 0 || header.version != TELEMETRY_VERSION) {
+		fprintf(stderr, "Telemetry: %s isn't a version %d recording\n", fileName.c_str(), TELEMETRY_VERSION);
+		close();
+		return false;
+	}
+
+	if(header.indexOffset != 0 && header.indexOffset + header.indexCount * sizeof(TelemetryIndexEntry) <= file.getSize()) {
+		index.resize(header.indexCount);
+		if(header.indexCount > 0)
+			memcpy(&index[0], data + header.indexOffset, header.indexCount * sizeof(TelemetryIndexEntry));
+	}
+	else {
+		//Never closed properly, whatever whole chunks made it out are still good.
+		scanChunks();
+	}
+
+	sort(index.begin(), index.end(), byFirstStep);
+	return true;
+}
+
+void TelemetryReader::close() {
+	file.close();
+	index.clear();
+	memset(&header, 0, sizeof(header));
+}
+
+//Walks chunk headers from the start of the file, stopping at the first that
+//doesn't check out.
+void TelemetryReader::scanChunks() {
+	const unsigned char* data = (const unsigned char*) file.getData();
+	size_t offset = header.headerBytes;
+	while(offset + sizeof(TelemetryChunkHeader) <= file.getSize()) {
+		TelemetryChunkHeader chunk;
+		memcpy(&chunk, data + offset, sizeof(chunk));
+		if(chunk.magic != TELEMETRY_CHUNK_MAGIC || offset + sizeof(chunk) + chunk.payloadBytes > file.getSize())
+			break;
+
+		TelemetryIndexEntry entry;
+		entry.firstStep = chunk.firstStep;
+		entry.numSteps = chunk.numSteps;
+		entry.reserved = 0;
+		entry.offset = offset;
+		entry.bytes = sizeof(chunk) + chunk.payloadBytes;
+		index.push_back(entry);
+
+		offset += entry.bytes;
+	}
+}
+
+bool TelemetryReader::read(double fromSeconds, double toSeconds, vector<TelemetryFrame>& frames) {
+	frames.clear();
+	if(index.empty() || toSeconds <= fromSeconds)
+		return true;
+
+	unsigned long long fromStep = fromSeconds <= 0.0 ? 0 : (unsigned long long) ceil(fromSeconds * header.stepsPerSecond);
+	unsigned long long toStep = (unsigned long long) ceil(toSeconds * header.stepsPerSecond);
+
+	//Chunks are sorted and don't overlap, so binary search for the first one
+	//that ends after fromStep.
+	int low = 0;
+	int high = index.size();
+	while(low < high) {
+		int middle = (low + high) / 2;
+		if(index[middle].firstStep + index[middle].numSteps <= fromStep)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	for(int i = low; i < index.size() && index[i].firstStep < toStep; i++) {
+		if(!decode(index[i], fromStep, toStep, frames))
+			return false;
+	}
+	return true;
+}
+
+//Undoes TelemetryRecorder::encode for one chunk, keeping steps in range.
+bool TelemetryReader::decode(const TelemetryIndexEntry& entry, unsigned long long fromStep, unsigned long long toStep, vector<TelemetryFrame>& frames) {
+	if(entry.offset + entry.bytes > file.getSize())
+		return false;
+
+	const unsigned char* data = (const unsigned char*) file.getData() + entry.offset;
+	TelemetryChunkHeader chunk;
+	memcpy(&chunk, data, sizeof(chunk));
+	if(chunk.magic != TELEMETRY_CHUNK_MAGIC || sizeof(chunk) + chunk.payloadBytes > entry.bytes)
+		return false;
+
+	const unsigned char* cursors[NUM_TELEMETRY_COLUMNS];
+	const unsigned char* ends[NUM_TELEMETRY_COLUMNS];
+	const unsigned char* column = data + sizeof(chunk);
+	for(int i = 0; i < NUM_TELEMETRY_COLUMNS; i++) {
+		cursors[i] = column;
+		column += chunk.columnBytes[i];
+		ends[i] = column;
+	}
+	if(column > data + sizeof(chunk) + chunk.payloadBytes)
+		return false;
+
+	//Every step is decoded (each depends on the one before), only the ones
+	//in range are kept.
+	vector<unsigned int> ids, previousIds;
+	vector<unsigned int> values[4], previousValues[4];
+	vector<unsigned char> states, previousStates;
+
+	for(unsigned int step = 0; step < chunk.numSteps; step++) {
+		unsigned int count;
+		if(!telemetryGetVarint(cursors[COLUMN_COUNTS], ends[COLUMN_COUNTS], count) || cursors[COLUMN_SAME_IDS] >= ends[COLUMN_SAME_IDS])
+			return false;
+		bool same = *cursors[COLUMN_SAME_IDS]++ != 0;
+		if(same && count != previousIds.size())
+			return false;
+
+		ids.resize(count);
+		if(same)
+			ids = previousIds;
+		else {
+			unsigned int id = 0;
+			for(unsigned int i = 0; i < count; i++) {
+				unsigned int delta;
+				if(!telemetryGetVarint(cursors[COLUMN_IDS], ends[COLUMN_IDS], delta))
+					return false;
+				id += (unsigned int) telemetryUnzigzag(delta);
+				ids[i] = id;
+			}
+		}
+
+		for(int c = 0; c < 4; c++) {
+			values[c].resize(count);
+			for(unsigned int i = 0; i < count; i++) {
+				unsigned int delta;
+				if(!telemetryGetVarint(cursors[COLUMN_X + c], ends[COLUMN_X + c], delta))
+					return false;
+				unsigned int reference = same ? previousValues[c][i] : (i > 0 ? values[c][i - 1] : 0);
+				values[c][i] = reference + (unsigned int) telemetryUnzigzag(delta);
+			}
+		}
+
+		states.resize(count);
+		unsigned int i = 0;
+		while(i < count) {
+			unsigned int run;
+			if(cursors[COLUMN_STATE] >= ends[COLUMN_STATE])
+				return false;
+			unsigned char value = *cursors[COLUMN_STATE]++;
+			if(!telemetryGetVarint(cursors[COLUMN_STATE], ends[COLUMN_STATE], run) || run == 0 || i + run > count)
+				return false;
+			for(; run > 0; run--, i++)
+				states[i] = value ^ (same ? previousStates[i] : 0);
+		}
+
+		unsigned long long stepNumber = chunk.firstStep + step;
+		if(stepNumber >= fromStep && stepNumber < toStep) {
+			frames.push_back(TelemetryFrame());
+			TelemetryFrame& frame = frames.back();
+			frame.step = stepNumber;
+			frame.seconds = header.stepsPerSecond > 0.0 ? stepNumber / header.stepsPerSecond : 0.0;
+			frame.samples.resize(count);
+			for(unsigned int j = 0; j < count; j++) {
+				TelemetrySample& sample = frame.samples[j];
+				sample.bird = ids[j];
+				sample.position[0] = (float) ((int) values[0][j] * header.positionScale);
+				sample.position[1] = (float) ((int) values[1][j] * header.positionScale);
+				sample.position[2] = (float) ((int) values[2][j] * header.positionScale);
+				sample.heading = (float) ((int) values[3][j] * header.headingScale);
+				sample.state = states[j];
+			}
+		}
+
+		previousIds.swap(ids);
+		for(int c = 0; c < 4; c++)
+			previousValues[c].swap(values[c]);
+		previousStates.swap(states);
+	}
+
+	return true;
+}
+
+double TelemetryReader::getStepsPerSecond()		{ return header.stepsPerSecond;	}
+int TelemetryReader::numChunks()				{ return index.size();			}
+
+unsigned long long TelemetryReader::getFirstStep() {
+	return index.empty() ? 0 : index.front().firstStep;
+}
+
+unsigned long long TelemetryReader::getLastStep() {
+	return index.empty() ? 0 : index.back().firstStep + index.back().numSteps - 1;
+}
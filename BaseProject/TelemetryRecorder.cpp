@@ -0,0 +1,346 @@
+#include "include/TelemetryRecorder.h"
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <chrono>
+
+//Constructor, nothing is recorded until start().
+TelemetryRecorder::TelemetryRecorder() {
+	file = NULL;
+	current = NULL;
+	fileOffset = 0;
+	nextSequence = nextWrite = 0;
+	stopping = false;
+	stepsRecorded = stepsDropped = rawBytes = 0;
+	recordMilliseconds = 0.0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+//Destructor.
+TelemetryRecorder::~TelemetryRecorder() {
+
+	stop();
+
+}
+
+bool TelemetryRecorder::start(string fileName, double stepsPerSecond, int numWorkers, int numChunks) {
+	stop();
+
+	file = fopen(fileName.c_str(), "wb");
+	if(file == NULL) {
+		fprintf(stderr, "Telemetry: can't write %s\n", fileName.c_str());
+		return false;
+	}
+
+	TelemetryFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TELEMETRY_MAGIC, sizeof(header.magic));
+	header.version = TELEMETRY_VERSION;
+	header.headerBytes = sizeof(header);
+	header.stepsPerSecond = stepsPerSecond;
+	header.positionScale = TELEMETRY_POSITION_SCALE;
+	header.headingScale = TELEMETRY_HEADING_SCALE;
+	fwrite(&header, sizeof(header), 1, file);
+	fileOffset = sizeof(header);
+
+	memset(&stats, 0, sizeof(stats));
+	stats.fileBytes = fileOffset;
+	stepsRecorded = stepsDropped = rawBytes = 0;
+	recordMilliseconds = 0.0;
+	index.clear();
+	nextSequence = nextWrite = 0;
+
+	chunks.clear();
+	chunks.resize(numChunks < 2 ? 2 : numChunks);
+	freeChunks.clear();
+	for(int i = 0; i < chunks.size(); i++)
+		freeChunks.push_back(&chunks[i]);
+	encodedChunks.clear();
+	current = NULL;
+
+	stopping = false;
+	for(int i = 0; i < (numWorkers < 1 ? 1 : numWorkers); i++)
+		workers.push_back(thread(&TelemetryRecorder::workerLoop, this));
+	writer = thread(&TelemetryRecorder::writerLoop, this);
+
+	return true;
+}
+
+void TelemetryRecorder::stop() {
+	if(file == NULL)
+		return;
+
+	//The partly filled chunk still counts.
+	if(current != NULL && current->numSteps > 0)
+		submitCurrent();
+	current = NULL;
+
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	signal.notify_all();
+	for(int i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+	encodedSignal.notify_one();
+	writer.join();
+
+	//Index at the end, then point the header at it.
+	if(!index.empty())
+		fwrite(&index[0], sizeof(TelemetryIndexEntry), index.size(), file);
+	unsigned long long indexOffset = fileOffset;
+	unsigned long long indexCount = index.size();
+	fseek(file, offsetof(TelemetryFileHeader, indexOffset), SEEK_SET);
+	fwrite(&indexOffset, sizeof(indexOffset), 1, file);
+	fwrite(&indexCount, sizeof(indexCount), 1, file);
+	fclose(file);
+	file = NULL;
+
+	lock_guard<mutex> guard(lock);
+	stats.fileBytes += indexCount * sizeof(TelemetryIndexEntry);
+}
+
+bool TelemetryRecorder::isRecording() {
+	return file != NULL;
+}
+
+TelemetryRecorder::Chunk* TelemetryRecorder::takeFreeChunk() {
+	lock_guard<mutex> guard(lock);
+	if(freeChunks.empty())
+		return NULL;
+	Chunk* chunk = freeChunks.back();
+	freeChunks.pop_back();
+	return chunk;
+}
+
+void TelemetryRecorder::submitCurrent() {
+	{
+		lock_guard<mutex> guard(lock);
+		current->sequence = nextSequence++;
+		fullChunks.push_back(current);
+	}
+	signal.notify_one();
+	current = NULL;
+}
+
+void TelemetryRecorder::record(unsigned long long step, const vector<Bird*>& birds) {
+	if(file == NULL)
+		return;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	if(current == NULL) {
+		current = takeFreeChunk();
+		if(current == NULL) {
+			stepsDropped.store(stepsDropped.load(memory_order_relaxed) + 1, memory_order_relaxed);
+			return;
+		}
+		current->firstStep = step;
+		current->numSteps = 0;
+		current->counts.clear();
+		current->ids.clear();
+		for(int i = 0; i < 4; i++)
+			current->columns[i].clear();
+		current->states.clear();
+	}
+
+	//A dropped step would leave a gap, so a chunk only ever holds a run.
+	if(current->firstStep + current->numSteps != step) {
+		submitCurrent();
+		record(step, birds);
+		return;
+	}
+
+	current->counts.push_back(birds.size());
+	for(int i = 0; i < birds.size(); i++) {
+		Bird* bird = birds[i];
+		Object* body = bird->getPart(KIND_BIRD_BODY);
+		double* position = body->getTranslation();
+		double heading = fmod(body->getRotation()[1], 360.0);
+		if(heading < 0.0)
+			heading += 360.0;
+
+		current->ids.push_back(bird->id);
+		current->columns[0].push_back((int) floor(position[0] / TELEMETRY_POSITION_SCALE + 0.5));
+		current->columns[1].push_back((int) floor(position[1] / TELEMETRY_POSITION_SCALE + 0.5));
+		current->columns[2].push_back((int) floor(position[2] / TELEMETRY_POSITION_SCALE + 0.5));
+		current->columns[3].push_back((int) floor(heading / TELEMETRY_HEADING_SCALE + 0.5));
+		current->states.push_back((bird->isFalling() ? TELEMETRY_FALLING : 0) |
+			(body->isCrashed ? TELEMETRY_CRASHED : 0) | (bird->asleep ? TELEMETRY_ASLEEP : 0));
+	}
+	current->numSteps++;
+
+	stepsRecorded.store(stepsRecorded.load(memory_order_relaxed) + 1, memory_order_relaxed);
+	rawBytes.store(rawBytes.load(memory_order_relaxed) + birds.size() * (sizeof(unsigned int) + 4 * sizeof(int) + 1), memory_order_relaxed);
+
+	if(current->numSteps == TELEMETRY_CHUNK_STEPS)
+		submitCurrent();
+
+	double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	recordMilliseconds.store(recordMilliseconds.load(memory_order_relaxed) + milliseconds, memory_order_relaxed);
+}
+
+void TelemetryRecorder::workerLoop() {
+	while(true) {
+		Chunk* chunk;
+		{
+			unique_lock<mutex> guard(lock);
+			while(fullChunks.empty() && !stopping)
+				signal.wait(guard);
+			//Finish everything queued before going.
+			if(fullChunks.empty())
+				return;
+			chunk = fullChunks.front();
+			fullChunks.pop_front();
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		encode(chunk);
+		double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		{
+			lock_guard<mutex> guard(lock);
+			stats.compressMilliseconds += milliseconds;
+			encodedChunks.push_back(chunk);
+		}
+		encodedSignal.notify_one();
+	}
+}
+
+//Chunks go in the file in the order they were filled, whichever worker
+//finishes first. Only this thread touches the file until stop().
+void TelemetryRecorder::writerLoop() {
+	while(true) {
+		Chunk* chunk = NULL;
+		{
+			unique_lock<mutex> guard(lock);
+			while(true) {
+				for(int i = 0; i < encodedChunks.size() && chunk == NULL; i++) {
+					if(encodedChunks[i]->sequence == nextWrite) {
+						chunk = encodedChunks[i];
+						encodedChunks[i] = encodedChunks.back();
+						encodedChunks.pop_back();
+					}
+				}
+				if(chunk != NULL)
+					break;
+				//Once stopping, the workers finish every chunk submitted.
+				if(stopping && nextWrite == nextSequence)
+					return;
+				encodedSignal.wait(guard);
+			}
+		}
+
+		write(chunk);
+	}
+}
+
+//Column by column, see TelemetryFormat.h.
+void TelemetryRecorder::encode(Chunk* chunk) {
+	for(int i = 0; i < NUM_TELEMETRY_COLUMNS; i++)
+		chunk->encoded[i].clear();
+
+	unsigned int start = 0;
+	unsigned int previousStart = 0;
+	unsigned int previousCount = 0;
+	for(unsigned int step = 0; step < chunk->numSteps; step++) {
+		unsigned int count = chunk->counts[step];
+		bool same = step > 0 && count == previousCount &&
+			memcmp(&chunk->ids[start], &chunk->ids[previousStart], count * sizeof(unsigned int)) == 0;
+
+		telemetryPutVarint(chunk->encoded[COLUMN_COUNTS], count);
+		chunk->encoded[COLUMN_SAME_IDS].push_back(same);
+		if(!same) {
+			unsigned int previousId = 0;
+			for(unsigned int i = 0; i < count; i++) {
+				telemetryPutVarint(chunk->encoded[COLUMN_IDS], telemetryZigzag((int) (chunk->ids[start + i] - previousId)));
+				previousId = chunk->ids[start + i];
+			}
+		}
+
+		//Against the same bird last step, or else the bird before.
+		for(int column = 0; column < 4; column++) {
+			const vector<int>& values = chunk->columns[column];
+			vector<unsigned char>& out = chunk->encoded[COLUMN_X + column];
+			for(unsigned int i = 0; i < count; i++) {
+				unsigned int reference = same ? values[previousStart + i] : (i > 0 ? values[start + i - 1] : 0);
+				telemetryPutVarint(out, telemetryZigzag((int) ((unsigned int) values[start + i] - reference)));
+			}
+		}
+
+		//States barely change, xor with the reference and run length the result.
+		vector<unsigned char>& states = chunk->encoded[COLUMN_STATE];
+		unsigned int i = 0;
+		while(i < count) {
+			unsigned char value = chunk->states[start + i] ^ (same ? chunk->states[previousStart + i] : 0);
+			unsigned int run = 1;
+			while(i + run < count && (chunk->states[start + i + run] ^ (same ? chunk->states[previousStart + i + run] : 0)) == value)
+				run++;
+			states.push_back(value);
+			telemetryPutVarint(states, run);
+			i += run;
+		}
+
+		previousStart = start;
+		previousCount = count;
+		start += count;
+	}
+}
+
+//Writer thread, the lock is only taken to hand the chunk back.
+void TelemetryRecorder::write(Chunk* chunk) {
+	TelemetryChunkHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = TELEMETRY_CHUNK_MAGIC;
+	header.numSteps = chunk->numSteps;
+	header.firstStep = chunk->firstStep;
+	header.numSamples = chunk->ids.size();
+	for(int i = 0; i < NUM_TELEMETRY_COLUMNS; i++) {
+		header.columnBytes[i] = chunk->encoded[i].size();
+		header.payloadBytes += header.columnBytes[i];
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+	for(int i = 0; i < NUM_TELEMETRY_COLUMNS; i++) {
+		if(!chunk->encoded[i].empty())
+			fwrite(&chunk->encoded[i][0], 1, chunk->encoded[i].size(), file);
+	}
+
+	TelemetryIndexEntry entry;
+	entry.firstStep = chunk->firstStep;
+	entry.numSteps = chunk->numSteps;
+	entry.reserved = 0;
+	entry.offset = fileOffset;
+	entry.bytes = sizeof(header) + header.payloadBytes;
+	fileOffset += entry.bytes;
+
+	lock_guard<mutex> guard(lock);
+	index.push_back(entry);
+	stats.fileBytes += entry.bytes;
+	stats.chunksWritten++;
+	freeChunks.push_back(chunk);
+	nextWrite++;
+}
+
+TelemetryStats TelemetryRecorder::getStats() {
+	TelemetryStats current;
+	{
+		lock_guard<mutex> guard(lock);
+		current = stats;
+	}
+	current.stepsRecorded = stepsRecorded.load(memory_order_relaxed);
+	current.stepsDropped = stepsDropped.load(memory_order_relaxed);
+	current.rawBytes = rawBytes.load(memory_order_relaxed);
+	current.recordMilliseconds = recordMilliseconds.load(memory_order_relaxed);
+	return current;
+}
+
+void TelemetryRecorder::printStats() {
+	TelemetryStats current = getStats();
+	printf("Telemetry: %llu steps recorded, %llu dropped, %llu chunks, %llu raw bytes to %llu in the file (%.1fx), record %.3f ms/step, compress %.3f ms/step\n",
+		current.stepsRecorded, current.stepsDropped, current.chunksWritten, current.rawBytes, current.fileBytes,
+		current.fileBytes > 0 ? (double) current.rawBytes / current.fileBytes : 0.0,
+		current.stepsRecorded > 0 ? current.recordMilliseconds / current.stepsRecorded : 0.0,
+		current.stepsRecorded > 0 ? current.compressMilliseconds / current.stepsRecorded : 0.0);
+}
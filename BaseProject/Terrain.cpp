@@ -0,0 +1,219 @@
+#include "include/Terrain.h"
+#include <math.h>
+#include <string.h>
+#include <chrono>
+
+//A value in [-1, 1] for every lattice point, the same on every machine.
+static double latticeValue(unsigned int seed, int x, int z) {
+	unsigned int hash = seed * 0x9E3779B9u ^ (unsigned int) x * 0x85EBCA6Bu ^ (unsigned int) z * 0xC2B2AE35u;
+	hash ^= hash >> 16;
+	hash *= 0x7FEB352Du;
+	hash ^= hash >> 15;
+	hash *= 0x846CA68Bu;
+	hash ^= hash >> 16;
+	return hash / 2147483647.5 - 1.0;
+}
+
+//Lattice values blended with a smoothstep, so slopes carry on across
+//lattice lines.
+static double valueNoise(unsigned int seed, double x, double z) {
+	double cellX = floor(x);
+	double cellZ = floor(z);
+	int latticeX = (int) cellX;
+	int latticeZ = (int) cellZ;
+	double tx = x - cellX;
+	double tz = z - cellZ;
+	tx = tx * tx * (3.0 - 2.0 * tx);
+	tz = tz * tz * (3.0 - 2.0 * tz);
+
+	double a = latticeValue(seed, latticeX, latticeZ);
+	double b = latticeValue(seed, latticeX + 1, latticeZ);
+	double c = latticeValue(seed, latticeX, latticeZ + 1);
+	double d = latticeValue(seed, latticeX + 1, latticeZ + 1);
+	return a + (b - a) * tx + (c - a) * tz + (a - b - c + d) * tx * tz;
+}
+
+double terrainHeight(const TerrainSettings& settings, double x, double z) {
+	double sum = 0.0;
+	double total = 0.0;
+	double amplitude = 1.0;
+	double frequency = 1.0 / settings.featureSize;
+	for(int octave = 0; octave < TERRAIN_OCTAVES; octave++) {
+		sum += amplitude * valueNoise(settings.seed + octave * 101, x * frequency, z * frequency);
+		total += amplitude;
+		amplitude *= 0.5;
+		frequency *= 2.0;
+	}
+	return settings.baseHeight + settings.relief * sum / total;
+}
+
+//Constructor, no terrain until create() is called.
+Terrain::Terrain() {
+	enabled = false;
+	memset(&settings, 0, sizeof(settings));
+	useCount = 0;
+	lastTile = NULL;
+	memset(&stats, 0, sizeof(stats));
+}
+
+//Destructor.
+Terrain::~Terrain() {
+
+	clear();
+
+}
+
+//Every tile slot is set aside now, none of them is filled until a query
+//needs it.
+void Terrain::create(const TerrainSettings& terrainSettings) {
+	clear();
+	settings = terrainSettings;
+	settings.texture[TERRAIN_NAME_BYTES - 1] = '\0';
+	enabled = true;
+
+	tiles.resize(TERRAIN_MAX_TILES);
+	slots.reserve(TERRAIN_MAX_TILES);
+	MemoryStats::add(MEMORY_TERRAIN, numBytes());
+}
+
+void Terrain::clear() {
+	MemoryStats::remove(MEMORY_TERRAIN, numBytes());
+	tiles.clear();
+	tiles.shrink_to_fit();
+	slots.clear();
+	lastTile = NULL;
+	enabled = false;
+}
+
+bool Terrain::isEmpty() {
+	return !enabled;
+}
+
+const TerrainSettings& Terrain::getSettings() {
+	return settings;
+}
+
+void Terrain::sample(const float* points, int count, float* heights, float* normals) {
+	if(!enabled) {
+		for(int i = 0; i < count; i++) {
+			heights[i] = settings.baseHeight;
+			if(normals != NULL) {
+				normals[i*3+0] = normals[i*3+2] = 0.0f;
+				normals[i*3+1] = 1.0f;
+			}
+		}
+		return;
+	}
+
+	useCount++;
+	stats.queries += count;
+	for(int i = 0; i < count; i++)
+		sampleOne(points + i*3, heights + i, normals != NULL ? normals + i*3 : NULL);
+}
+
+//The cell's two triangles split it from its low corner to its high one,
+//the same way the renderer's meshes do.
+void Terrain::sampleOne(const float* point, float* height, float* normal) {
+	int tileX = terrainTileOf(point[0]);
+	int tileZ = terrainTileOf(point[2]);
+	Tile* tile = lastTile;
+	if(tile == NULL || tile->x != tileX || tile->z != tileZ)
+		tile = lastTile = findTile(tileX, tileZ);
+	tile->lastUsed = useCount;
+
+	double localX = (point[0] - tileX * TERRAIN_TILE_SIZE) / TERRAIN_CELL_SIZE;
+	double localZ = (point[2] - tileZ * TERRAIN_TILE_SIZE) / TERRAIN_CELL_SIZE;
+	int cellX = max(0, min((int) localX, TERRAIN_TILE_CELLS - 1));
+	int cellZ = max(0, min((int) localZ, TERRAIN_TILE_CELLS - 1));
+	float fx = (float) (localX - cellX);
+	float fz = (float) (localZ - cellZ);
+
+	const float* corner = &tile->heights[cellZ * TERRAIN_TILE_SIDE + cellX];
+	float a = corner[0];
+	float b = corner[1];
+	float c = corner[TERRAIN_TILE_SIDE];
+	float d = corner[TERRAIN_TILE_SIDE + 1];
+
+	//Rise per cell along x and z on whichever triangle the point is in.
+	float riseX, riseZ;
+	if(fx >= fz) {
+		riseX = b - a;
+		riseZ = d - b;
+	}
+	else {
+		riseX = d - c;
+		riseZ = c - a;
+	}
+	*height = a + riseX * fx + riseZ * fz;
+
+	if(normal != NULL) {
+		float slopeX = riseX / (float) TERRAIN_CELL_SIZE;
+		float slopeZ = riseZ / (float) TERRAIN_CELL_SIZE;
+		float length = sqrtf(slopeX * slopeX + 1.0f + slopeZ * slopeZ);
+		normal[0] = -slopeX / length;
+		normal[1] = 1.0f / length;
+		normal[2] = -slopeZ / length;
+	}
+}
+
+//The tile if it's already made, otherwise it's made in a free slot or the
+//one used longest ago.
+Terrain::Tile* Terrain::findTile(int x, int z) {
+	unordered_map<unsigned long long, int>::iterator it = slots.find(terrainTileKey(x, z));
+	if(it != slots.end())
+		return &tiles[it->second];
+
+	int slot = slots.size();
+	if(slot >= (int) tiles.size()) {
+		slot = 0;
+		for(int i = 1; i < tiles.size(); i++) {
+			if(tiles[i].lastUsed < tiles[slot].lastUsed)
+				slot = i;
+		}
+		slots.erase(terrainTileKey(tiles[slot].x, tiles[slot].z));
+		stats.tilesDropped++;
+	}
+
+	buildTile(tiles[slot], x, z);
+	slots[terrainTileKey(x, z)] = slot;
+	return &tiles[slot];
+}
+
+//Grid points are worked out from whole cell counts, so neighbouring tiles
+//agree exactly on the samples along their shared edge.
+void Terrain::buildTile(Tile& tile, int x, int z) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	tile.x = x;
+	tile.z = z;
+	tile.lastUsed = useCount;
+	for(int row = 0; row < TERRAIN_TILE_SIDE; row++) {
+		double sampleZ = (z * TERRAIN_TILE_CELLS + row) * TERRAIN_CELL_SIZE;
+		for(int column = 0; column < TERRAIN_TILE_SIDE; column++) {
+			double sampleX = (x * TERRAIN_TILE_CELLS + column) * TERRAIN_CELL_SIZE;
+			tile.heights[row * TERRAIN_TILE_SIDE + column] = (float) terrainHeight(settings, sampleX, sampleZ);
+		}
+	}
+
+	stats.tilesBuilt++;
+	stats.buildMilliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int Terrain::numTiles() {
+	return slots.size();
+}
+
+size_t Terrain::numBytes() {
+	return tiles.size() * sizeof(Tile);
+}
+
+const TerrainStats& Terrain::getStats() {
+	return stats;
+}
+
+void Terrain::printStats() {
+	if(!enabled)
+		return;
+	printf("Terrain: %d of %d tiles held (%lu bytes), %llu built in %.1f ms, %llu dropped, %llu heights queried\n",
+		numTiles(), TERRAIN_MAX_TILES, (unsigned long) numBytes(), stats.tilesBuilt, stats.buildMilliseconds, stats.tilesDropped, stats.queries);
+}
@@ -0,0 +1,307 @@
+#include "include/TerrainRenderer.h"
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+//Constructor, nothing is made until create().
+TerrainRenderer::TerrainRenderer() {
+	created = false;
+	memset(&settings, 0, sizeof(settings));
+	prototype = NULL;
+	frame = 0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+//Destructor.
+TerrainRenderer::~TerrainRenderer() {
+
+	destroy();
+
+}
+
+void TerrainRenderer::create(const TerrainSettings& terrainSettings) {
+	destroy();
+	settings = terrainSettings;
+
+	//Every tile is drawn as this is, with a mesh of its own.
+	prototype = Object::create(NULL, "terrain", KIND_STATIC);
+	prototype->setupData(0);
+	if(settings.texture[0] != '\0')
+		prototype->setTexture(settings.texture);
+
+	created = true;
+}
+
+void TerrainRenderer::destroy() {
+	for(unordered_map<unsigned long long, Patch>::iterator it = patches.begin(); it != patches.end(); ++it)
+		releasePatch(it->second);
+	patches.clear();
+
+	Object::destroy(prototype);
+	prototype = NULL;
+	created = false;
+}
+
+bool TerrainRenderer::isCreated() {
+	return created;
+}
+
+bool TerrainRenderer::buildsFirst(const Patch* a, const Patch* b) {
+	if((a->mesh == NULL) != (b->mesh == NULL))
+		return a->mesh == NULL;
+	return a->distance < b->distance;
+}
+
+void TerrainRenderer::releasePatch(Patch& patch) {
+	if(patch.mesh != NULL)
+		assetLoader.releaseMesh(patch.mesh);
+	if(patch.pending != NULL)
+		assetLoader.releaseMesh(patch.pending);
+	Object::destroy(patch.object);
+	patch.mesh = patch.pending = NULL;
+	patch.object = NULL;
+}
+
+//A tile some camera is distance away from. Tiles only start being drawn
+//inside the view distance but are kept a tile further, so one on the edge
+//doesn't come and go as the camera moves about.
+void TerrainRenderer::notePatch(int x, int z, double distance, bool inView) {
+	unsigned long long key = terrainTileKey(x, z);
+	unordered_map<unsigned long long, Patch>::iterator it = patches.find(key);
+	if(it == patches.end()) {
+		if(!inView)
+			return;
+		Patch patch;
+		patch.x = x;
+		patch.z = z;
+		patch.distance = distance;
+		patch.wantedLevel = 0;
+		patch.seen = frame;
+		patch.mesh = patch.pending = NULL;
+		patch.level = patch.pendingLevel = -1;
+		patch.object = NULL;
+		patches[key] = patch;
+		return;
+	}
+
+	Patch& patch = it->second;
+	if(patch.seen != frame || distance < patch.distance)
+		patch.distance = distance;
+	patch.seen = frame;
+}
+
+void TerrainRenderer::update(CameraRig& cameras) {
+	if(!created)
+		return;
+
+	frame++;
+	stats.built = stats.released = 0;
+	stats.buildMilliseconds = 0.0;
+
+	//Every tile near enough to some camera, at its distance from the nearest
+	//one. Distance is to the closest point of the tile on the ground plan.
+	double reach = TERRAIN_VIEW_DISTANCE + TERRAIN_TILE_SIZE;
+	for(int view = 0; view < cameras.getNumViews(); view++) {
+		const GLdouble* eye = cameras.getEye(view);
+		int lowX = terrainTileOf(eye[0] - reach), highX = terrainTileOf(eye[0] + reach);
+		int lowZ = terrainTileOf(eye[2] - reach), highZ = terrainTileOf(eye[2] + reach);
+		for(int z = lowZ; z <= highZ; z++) {
+			for(int x = lowX; x <= highX; x++) {
+				double dx = max(0.0, max(x * TERRAIN_TILE_SIZE - eye[0], eye[0] - (x + 1) * TERRAIN_TILE_SIZE));
+				double dz = max(0.0, max(z * TERRAIN_TILE_SIZE - eye[2], eye[2] - (z + 1) * TERRAIN_TILE_SIZE));
+				double distance = sqrt(dx*dx + dz*dz);
+				if(distance <= reach)
+					notePatch(x, z, distance, distance <= TERRAIN_VIEW_DISTANCE);
+			}
+		}
+	}
+
+	//Let go of what no camera is near, and see what the rest want.
+	wanting.clear();
+	for(unordered_map<unsigned long long, Patch>::iterator it = patches.begin(); it != patches.end(); ) {
+		Patch& patch = it->second;
+		if(patch.seen != frame) {
+			releasePatch(patch);
+			stats.released++;
+			it = patches.erase(it);
+			continue;
+		}
+
+		//A level down every time the distance doubles.
+		int level = 0;
+		for(double limit = TERRAIN_LOD_DISTANCE; patch.distance >= limit && level < TERRAIN_LODS - 1; limit *= 2.0)
+			level++;
+		patch.wantedLevel = level;
+
+		//A replacement on the GPU takes over from what was drawn.
+		if(patch.pending != NULL && patch.pending->getState() == MESH_READY) {
+			if(patch.mesh != NULL) {
+				assetLoader.releaseMesh(patch.mesh);
+				stats.released++;
+			}
+			patch.mesh = patch.pending;
+			patch.level = patch.pendingLevel;
+			patch.pending = NULL;
+			patch.pendingLevel = -1;
+			if(patch.object == NULL)
+				patch.object = Object::createInstance(prototype);
+			patch.object->setMesh(patch.mesh);
+		}
+
+		//One still uploading at a level no longer wanted isn't worth finishing.
+		if(patch.pending != NULL && patch.pendingLevel != patch.wantedLevel) {
+			assetLoader.releaseMesh(patch.pending);
+			patch.pending = NULL;
+			patch.pendingLevel = -1;
+			stats.released++;
+		}
+
+		if(patch.pending == NULL && patch.level != patch.wantedLevel)
+			wanting.push_back(&patch);
+		++it;
+	}
+
+	//Only a few a frame, the rest keep drawing what they have meanwhile.
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	int builds = min((int) wanting.size(), TERRAIN_BUILDS_PER_FRAME);
+	partial_sort(wanting.begin(), wanting.begin() + builds, wanting.end(), buildsFirst);
+	for(int i = 0; i < builds; i++) {
+		Patch& patch = *wanting[i];
+		patch.pending = buildMesh(patch.x, patch.z, patch.wantedLevel);
+		patch.pendingLevel = patch.wantedLevel;
+		assetLoader.submitMesh(patch.pending);
+		stats.built++;
+	}
+	stats.buildMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	stats.patches = (unsigned int) patches.size();
+	stats.drawable = stats.pending = 0;
+	stats.vertices = 0;
+	for(int i = 0; i < TERRAIN_LODS; i++)
+		stats.perLevel[i] = 0;
+	for(unordered_map<unsigned long long, Patch>::iterator it = patches.begin(); it != patches.end(); ++it) {
+		Patch& patch = it->second;
+		if(patch.mesh != NULL) {
+			stats.drawable++;
+			stats.perLevel[patch.level]++;
+			stats.vertices += patch.mesh->getNumVertices();
+		}
+		if(patch.pending != NULL)
+			stats.pending++;
+	}
+}
+
+//A tile's grid every 1 << level cells, relative to the middle of the tile
+//and the base height so its bounds are tight. Each edge has a skirt hanging
+//below it, a row of its own vertices so the ground's normals are left alone.
+Mesh* TerrainRenderer::buildMesh(int x, int z, int level) {
+	int step = 1 << level;
+	int cells = TERRAIN_TILE_CELLS / step;
+	int side = cells + 1;
+	double half = TERRAIN_TILE_SIZE / 2.0;
+	double centreX = x * TERRAIN_TILE_SIZE + half;
+	double centreZ = z * TERRAIN_TILE_SIZE + half;
+
+	//Far enough down to cover the biggest step between neighbouring levels.
+	double skirt = settings.relief + TERRAIN_CELL_SIZE;
+
+	int numVertices = side * side + 8 * side;
+	positions.resize(numVertices * 3);
+	texCoords.resize(numVertices * 2);
+	indices.clear();
+
+	//Grid points are whole cells from the tile's corner, like the heights
+	//the simulation samples, so both agree exactly where they meet.
+	for(int j = 0; j < side; j++) {
+		for(int i = 0; i < side; i++) {
+			double worldX = x * TERRAIN_TILE_SIZE + i * step * TERRAIN_CELL_SIZE;
+			double worldZ = z * TERRAIN_TILE_SIZE + j * step * TERRAIN_CELL_SIZE;
+			int v = j * side + i;
+			positions[v*3+0] = worldX - centreX;
+			positions[v*3+1] = terrainHeight(settings, worldX, worldZ) - settings.baseHeight;
+			positions[v*3+2] = worldZ - centreZ;
+			texCoords[v*2+0] = (GLfloat) (worldX / TERRAIN_TEXTURE_SIZE);
+			texCoords[v*2+1] = (GLfloat) (worldZ / TERRAIN_TEXTURE_SIZE);
+		}
+	}
+
+	//The same two triangles a cell is sampled with, facing up.
+	for(int j = 0; j < cells; j++) {
+		for(int i = 0; i < cells; i++) {
+			GLuint a = j * side + i, b = a + 1, c = a + side, d = c + 1;
+			GLuint cell[6] = { a, d, b, a, c, d };
+			indices.insert(indices.end(), cell, cell + 6);
+		}
+	}
+
+	//Each edge walked so the skirt faces out: top row copied from the
+	//grid, bottom row the same dropped by skirt.
+	int edgeStart[4] = { 0, side - 1, side * side - 1, side * (side - 1) };
+	int edgeStep[4] = { 1, side, -1, -side };
+	for(int edge = 0; edge < 4; edge++) {
+		GLuint top = side * side + edge * 2 * side;
+		GLuint bottom = top + side;
+		for(int k = 0; k < side; k++) {
+			int from = edgeStart[edge] + k * edgeStep[edge];
+			for(int row = 0; row < 2; row++) {
+				GLuint v = (row == 0 ? top : bottom) + k;
+				positions[v*3+0] = positions[from*3+0];
+				positions[v*3+1] = positions[from*3+1] - (row == 0 ? 0.0 : skirt);
+				positions[v*3+2] = positions[from*3+2];
+				texCoords[v*2+0] = texCoords[from*2+0];
+				texCoords[v*2+1] = texCoords[from*2+1];
+			}
+			if(k > 0) {
+				GLuint quad[6] = { top + k - 1, top + k, bottom + k, top + k - 1, bottom + k, bottom + k - 1 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	Mesh* mesh = new Mesh("terrain");
+	mesh->createFromArrays(&positions[0], numVertices, &indices[0], (int) indices.size(), &texCoords[0]);
+	return mesh;
+}
+
+void TerrainRenderer::submitDraws(MatrixStack& projectionStack, RenderQueue* queue) {
+	if(!created)
+		return;
+
+	SnapshotEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	for(int i = 0; i < 16; i++)
+		entry.modelView[i] = i % 5 == 0 ? 1.0f : 0.0f;
+
+	for(unordered_map<unsigned long long, Patch>::iterator it = patches.begin(); it != patches.end(); ++it) {
+		Patch& patch = it->second;
+		if(patch.object == NULL)
+			continue;
+
+		entry.object = patch.object;
+		entry.position[0] = entry.modelView[12] = (GLfloat) ((patch.x + 0.5) * TERRAIN_TILE_SIZE);
+		entry.position[1] = entry.modelView[13] = settings.baseHeight;
+		entry.position[2] = entry.modelView[14] = (GLfloat) ((patch.z + 0.5) * TERRAIN_TILE_SIZE);
+		patch.object->submitDraw(entry, projectionStack, queue);
+	}
+}
+
+bool TerrainRenderer::isSettled() {
+	if(!created)
+		return true;
+	for(unordered_map<unsigned long long, Patch>::iterator it = patches.begin(); it != patches.end(); ++it)
+		if(it->second.level != it->second.wantedLevel || it->second.pending != NULL)
+			return false;
+	return true;
+}
+
+const TerrainRenderStats& TerrainRenderer::getStats() {
+	return stats;
+}
+
+void TerrainRenderer::printStats() {
+	if(!created)
+		return;
+	printf("Terrain drawing: %u tiles, %u drawn (%u/%u/%u/%u by level, %llu vertices), %u uploading, %u built in %.2f ms last frame\n",
+		stats.patches, stats.drawable, stats.perLevel[0], stats.perLevel[1], stats.perLevel[2], stats.perLevel[3],
+		stats.vertices, stats.pending, stats.built, stats.buildMilliseconds);
+}
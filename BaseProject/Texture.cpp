@@ -0,0 +1,174 @@
+#include "include/Texture.h"
+#include <string.h>
+
+//Constructor, nothing is read until prepare() is called.
+Texture::Texture(string sourceFile) {
+	fileName = sourceFile;
+	lastUsed = 0;
+
+	header = NULL;
+	transcoded = false;
+	name = 0;
+	nextLevel = -1;
+	nextRow = 0;
+	residentBytes = 0;
+
+	state = TEXTURE_QUEUED;
+}
+
+//Destructor.
+Texture::~Texture() {
+
+	if(name != 0) {
+		glDeleteTextures(1, &name);
+		MemoryStats::remove(MEMORY_GL_TEXTURES, residentBytes);
+	}
+
+}
+
+//Transcode the source if its cache is missing or out of date, then map
+//the cache ready for upload.
+void Texture::prepare() {
+	string cacheFile = textureCacheName(fileName);
+
+	transcoded = false;
+	if(!textureCacheCurrent(fileName, cacheFile)) {
+		if(!compileTexture(fileName, cacheFile)) {
+			setState(TEXTURE_FAILED);
+			return;
+		}
+		transcoded = true;
+	}
+
+	if(!cache.open(cacheFile) || !textureHeaderValid(cache.getData(), cache.getSize())) {
+		fprintf(stderr, "Texture: %s isn't a texture cache this build can read\n", cacheFile.c_str());
+		cache.close();
+		setState(TEXTURE_FAILED);
+		return;
+	}
+
+	header = (const TextureHeader*) cache.getData();
+	nextLevel = header->numLevels - 1;
+	nextRow = 0;
+	setState(TEXTURE_MAPPED);
+}
+
+//Levels go up smallest first, each one lowering the base level so the
+//texture can be drawn (blurred) from the first on. Big levels are split into
+//rows of blocks across calls, so the budget is overshot by a row at most.
+GLuint Texture::upload(GLuint byteBudget) {
+	if(getState() != TEXTURE_MAPPED && getState() != TEXTURE_UPLOADING)
+		return 0;
+
+	if(getState() == TEXTURE_MAPPED) {
+		glGenTextures(1, &name);
+		glBindTexture(GL_TEXTURE_2D, name);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->numLevels - 1);
+		setState(TEXTURE_UPLOADING);
+	}
+	else
+		glBindTexture(GL_TEXTURE_2D, name);
+
+	GLuint sent = 0;
+	while(nextLevel >= 0 && (sent == 0 || sent < byteBudget)) {
+		const TextureLevel& level = header->levels[nextLevel];
+		GLuint rowBytes = ((level.width + 3) / 4) * TEXTURE_BLOCK_BYTES;
+		unsigned int numRows = (level.height + 3) / 4;
+
+		//Storage for the whole level first, then rows into it.
+		if(nextRow == 0) {
+			if(GLEW_EXT_texture_compression_s3tc)
+				glCompressedTexImage2D(GL_TEXTURE_2D, nextLevel, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, level.width, level.height, 0, (GLsizei) level.bytes, NULL);
+			else
+				glTexImage2D(GL_TEXTURE_2D, nextLevel, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			GLuint bytes = GLEW_EXT_texture_compression_s3tc ? (GLuint) level.bytes : level.width * level.height * 4;
+			residentBytes += bytes;
+			MemoryStats::add(MEMORY_GL_TEXTURES, bytes);
+		}
+
+		unsigned int rows = max(1u, (byteBudget - min(sent, byteBudget)) / rowBytes);
+		rows = min(rows, numRows - nextRow);
+		uploadRows(nextLevel, nextRow, rows);
+		sent += rows * rowBytes;
+		nextRow += rows;
+
+		if(nextRow == numRows) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, nextLevel);
+			nextLevel--;
+			nextRow = 0;
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	//Everything is on the GPU, the mapping isn't needed any more.
+	if(nextLevel < 0) {
+		header = NULL;
+		cache.close();
+		decoded.clear();
+		decoded.shrink_to_fit();
+		setState(TEXTURE_READY);
+	}
+
+	return sent;
+}
+
+//Rows of blocks straight from the mapping where the driver takes BC1,
+//otherwise decoded to plain texels first.
+void Texture::uploadRows(unsigned int level, unsigned int firstRow, unsigned int numRows) {
+	const TextureLevel& info = header->levels[level];
+	unsigned int blocksWide = (info.width + 3) / 4;
+	const unsigned char* blocks = (const unsigned char*) cache.getData() + info.offset + (size_t) firstRow * blocksWide * TEXTURE_BLOCK_BYTES;
+	unsigned int top = firstRow * 4;
+	unsigned int height = min(numRows * 4, info.height - top);
+
+	if(GLEW_EXT_texture_compression_s3tc) {
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, top, info.width, height, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+			numRows * blocksWide * TEXTURE_BLOCK_BYTES, blocks);
+		return;
+	}
+
+	decoded.resize((size_t) info.width * height * 4);
+	unsigned char texels[16 * 4];
+	for(unsigned int blockY = 0; blockY < height; blockY += 4) {
+		for(unsigned int blockX = 0; blockX < info.width; blockX += 4) {
+			decodeBlockBC1(blocks, texels);
+			blocks += TEXTURE_BLOCK_BYTES;
+			for(int i = 0; i < 16; i++) {
+				unsigned int x = blockX + i % 4;
+				unsigned int y = blockY + i / 4;
+				if(x < info.width && y < height)
+					memcpy(&decoded[((size_t) y * info.width + x) * 4], &texels[i * 4], 4);
+			}
+		}
+	}
+	glTexSubImage2D(GL_TEXTURE_2D, level, 0, top, info.width, height, GL_RGBA, GL_UNSIGNED_BYTE, &decoded[0]);
+}
+
+//Frees the GPU copy, prepare() and upload() bring it back from the cache.
+void Texture::evict() {
+	if(getState() != TEXTURE_READY)
+		return;
+
+	glDeleteTextures(1, &name);
+	MemoryStats::remove(MEMORY_GL_TEXTURES, residentBytes);
+	name = 0;
+	residentBytes = 0;
+	setState(TEXTURE_EVICTED);
+}
+
+TextureState Texture::getState()				{ return (TextureState) state.load();	}
+void Texture::setState(TextureState newState)	{ state.store(newState);				}
+
+bool Texture::isDrawable() {
+	TextureState current = getState();
+	return current == TEXTURE_READY || (current == TEXTURE_UPLOADING && nextLevel < (int) header->numLevels - 1);
+}
+
+GLuint Texture::getName()				{ return name;				}
+GLuint Texture::getResidentBytes()		{ return residentBytes;		}
+GLuint Texture::getMappedBytes()		{ return (GLuint) cache.getSize();	}
+bool Texture::wasTranscoded()			{ return transcoded;		}
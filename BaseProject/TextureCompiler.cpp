@@ -0,0 +1,408 @@
+#include "include/TextureCompiler.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+
+string textureCacheName(string sourceFile) {
+	size_t dot = sourceFile.find_last_of('.');
+	size_t slash = sourceFile.find_last_of("/\\");
+	if(dot == string::npos || (slash != string::npos && dot < slash))
+		return sourceFile + TEXTURE_CACHE_EXTENSION;
+	return sourceFile.substr(0, dot) + TEXTURE_CACHE_EXTENSION;
+}
+
+//Size and modification time of a source, false if it isn't there.
+static bool sourceStamp(string sourceFile, unsigned long long& bytes, unsigned long long& modified) {
+	struct stat status;
+	if(stat(sourceFile.c_str(), &status) != 0)
+		return false;
+	bytes = (unsigned long long) status.st_size;
+	modified = (unsigned long long) status.st_mtime;
+	return true;
+}
+
+bool textureHeaderValid(const void* data, size_t size) {
+	const TextureHeader* header = (const TextureHeader*) data;
+	if(data == NULL || size < sizeof(TextureHeader) || memcmp(header->magic, TEXTURE_MAGIC, sizeof(header->magic)) != 0 ||
+	   header->version != TEXTURE_VERSION || header->headerBytes != sizeof(TextureHeader) || header->format != TEXTURE_FORMAT_BC1 ||
+	   header->numLevels < 1 || header->numLevels > TEXTURE_MAX_LEVELS || header->fileBytes > size)
+		return false;
+
+	for(unsigned int i = 0; i < header->numLevels; i++) {
+		const TextureLevel& level = header->levels[i];
+		if(level.width < 1 || level.height < 1 || level.bytes != textureLevelBytes(level.width, level.height) ||
+		   level.offset < sizeof(TextureHeader) || level.offset + level.bytes > header->fileBytes)
+			return false;
+	}
+	return true;
+}
+
+bool textureCacheCurrent(string sourceFile, string cacheFile) {
+	FILE* fp = fopen(cacheFile.c_str(), "rb");
+	if(fp == NULL)
+		return false;
+
+	TextureHeader header;
+	bool read = fread(&header, 1, sizeof(header), fp) == sizeof(header);
+	fseek(fp, 0L, SEEK_END);
+	long size = ftell(fp);
+	fclose(fp);
+	if(!read || size < 0 || !textureHeaderValid(&header, (size_t) size))
+		return false;
+
+	unsigned long long bytes, modified;
+	if(!sourceStamp(sourceFile, bytes, modified))
+		return true;
+	return header.sourceBytes == bytes && header.sourceModified == modified;
+}
+
+//Truecolour TGA, plain or run length encoded, stored either way up.
+static bool loadTga(const unsigned char* file, size_t size, vector<unsigned char>& rgba, unsigned int& width, unsigned int& height) {
+	if(size < 18)
+		return false;
+	unsigned int idBytes = file[0];
+	unsigned int imageType = file[2];
+	width = file[12] | (file[13] << 8);
+	height = file[14] | (file[15] << 8);
+	unsigned int bytesPerPixel = file[16] / 8;
+	bool topFirst = (file[17] & 0x20) != 0;
+	if(file[1] != 0 || (imageType != 2 && imageType != 10) || (bytesPerPixel != 3 && bytesPerPixel != 4) || width == 0 || height == 0)
+		return false;
+
+	rgba.resize((size_t) width * height * 4);
+	const unsigned char* p = file + 18 + idBytes;
+	const unsigned char* end = file + size;
+	size_t numPixels = (size_t) width * height;
+	size_t pixel = 0;
+	while(pixel < numPixels) {
+		//Raw images are one long raw packet.
+		size_t run = numPixels - pixel;
+		bool repeat = false;
+		if(imageType == 10) {
+			if(p >= end)
+				return false;
+			run = (*p & 0x7F) + 1;
+			repeat = (*p & 0x80) != 0;
+			p++;
+			if(run > numPixels - pixel)
+				return false;
+		}
+		for(size_t i = 0; i < run; i++) {
+			if(p + bytesPerPixel > end)
+				return false;
+			size_t x = (pixel + i) % width;
+			size_t y = (pixel + i) / width;
+			unsigned char* out = &rgba[((topFirst ? height - 1 - y : y) * width + x) * 4];
+			out[0] = p[2];
+			out[1] = p[1];
+			out[2] = p[0];
+			out[3] = bytesPerPixel == 4 ? p[3] : 255;
+			if(!repeat || i + 1 == run)
+				p += bytesPerPixel;
+		}
+		pixel += run;
+	}
+	return true;
+}
+
+//Binary PPM, one byte a channel, stored top row first.
+static bool loadPpm(const unsigned char* file, size_t size, vector<unsigned char>& rgba, unsigned int& width, unsigned int& height) {
+	if(size < 2 || file[0] != 'P' || file[1] != '6')
+		return false;
+
+	//Width, height and the largest value, any of them after comments.
+	unsigned long values[3];
+	size_t at = 2;
+	for(int i = 0; i < 3; i++) {
+		while(at < size && (isspace(file[at]) || file[at] == '#')) {
+			if(file[at] == '#')
+				while(at < size && file[at] != '\n')
+					at++;
+			else
+				at++;
+		}
+		values[i] = 0;
+		while(at < size && isdigit(file[at]))
+			values[i] = values[i] * 10 + (file[at++] - '0');
+	}
+	at++;
+	width = values[0];
+	height = values[1];
+	if(width == 0 || height == 0 || values[2] != 255 || at + (size_t) width * height * 3 > size)
+		return false;
+
+	rgba.resize((size_t) width * height * 4);
+	for(unsigned int y = 0; y < height; y++) {
+		const unsigned char* in = file + at + (size_t) (height - 1 - y) * width * 3;
+		unsigned char* out = &rgba[(size_t) y * width * 4];
+		for(unsigned int x = 0; x < width; x++) {
+			out[x*4+0] = in[x*3+0];
+			out[x*4+1] = in[x*3+1];
+			out[x*4+2] = in[x*3+2];
+			out[x*4+3] = 255;
+		}
+	}
+	return true;
+}
+
+bool loadSourceImage(string fileName, vector<unsigned char>& rgba, unsigned int& width, unsigned int& height) {
+	FILE* fp = fopen(fileName.c_str(), "rb");
+	if(fp == NULL) {
+		fprintf(stderr, "Texture: can't read %s\n", fileName.c_str());
+		return false;
+	}
+	fseek(fp, 0L, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0L, SEEK_SET);
+	vector<unsigned char> file(size > 0 ? size : 1);
+	size = fread(&file[0], 1, size > 0 ? size : 0, fp);
+	fclose(fp);
+
+	bool loaded = file.size() >= 2 && file[0] == 'P' && file[1] == '6' ?
+		loadPpm(&file[0], size, rgba, width, height) : loadTga(&file[0], size, rgba, width, height);
+	if(!loaded)
+		fprintf(stderr, "Texture: %s isn't a TGA or PPM image this build can read\n", fileName.c_str());
+	return loaded;
+}
+
+//Half the size each way (never below one), each texel the average of the
+//two by two it covers. An odd edge reuses its last row or column.
+static void halveImage(const vector<unsigned char>& in, unsigned int width, unsigned int height, vector<unsigned char>& out) {
+	unsigned int outWidth = max(1u, width / 2);
+	unsigned int outHeight = max(1u, height / 2);
+	out.resize((size_t) outWidth * outHeight * 4);
+	for(unsigned int y = 0; y < outHeight; y++) {
+		unsigned int y0 = min(y * 2, height - 1);
+		unsigned int y1 = min(y * 2 + 1, height - 1);
+		for(unsigned int x = 0; x < outWidth; x++) {
+			unsigned int x0 = min(x * 2, width - 1);
+			unsigned int x1 = min(x * 2 + 1, width - 1);
+			for(int c = 0; c < 4; c++) {
+				unsigned int sum = in[((size_t) y0 * width + x0) * 4 + c] + in[((size_t) y0 * width + x1) * 4 + c] +
+								   in[((size_t) y1 * width + x0) * 4 + c] + in[((size_t) y1 * width + x1) * 4 + c];
+				out[((size_t) y * outWidth + x) * 4 + c] = (unsigned char) ((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+static unsigned short packColour(const float* colour) {
+	int r = (int) (colour[0] * 31.0f / 255.0f + 0.5f);
+	int g = (int) (colour[1] * 63.0f / 255.0f + 0.5f);
+	int b = (int) (colour[2] * 31.0f / 255.0f + 0.5f);
+	return (unsigned short) ((min(max(r, 0), 31) << 11) | (min(max(g, 0), 63) << 5) | min(max(b, 0), 31));
+}
+
+static void unpackColour(unsigned short packed, int* colour) {
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	colour[0] = (r << 3) | (r >> 2);
+	colour[1] = (g << 2) | (g >> 4);
+	colour[2] = (b << 3) | (b >> 2);
+}
+
+//End points along the block's principal axis, pulled in a little from the
+//extremes, then each texel picks the nearest of the four colours between.
+void encodeBlockBC1(const unsigned char* texels, unsigned char* block) {
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for(int i = 0; i < 16; i++)
+		for(int c = 0; c < 3; c++)
+			mean[c] += texels[i*4+c] / 16.0f;
+
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for(int i = 0; i < 16; i++) {
+		float d[3] = { texels[i*4+0] - mean[0], texels[i*4+1] - mean[1], texels[i*4+2] - mean[2] };
+		covariance[0] += d[0]*d[0];	covariance[1] += d[0]*d[1];	covariance[2] += d[0]*d[2];
+		covariance[3] += d[1]*d[1];	covariance[4] += d[1]*d[2];	covariance[5] += d[2]*d[2];
+	}
+
+	//A few rounds of power iteration find the axis well enough.
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for(int round = 0; round < 4; round++) {
+		float next[3] = {
+			covariance[0]*axis[0] + covariance[1]*axis[1] + covariance[2]*axis[2],
+			covariance[1]*axis[0] + covariance[3]*axis[1] + covariance[4]*axis[2],
+			covariance[2]*axis[0] + covariance[4]*axis[1] + covariance[5]*axis[2]
+		};
+		float length = sqrtf(next[0]*next[0] + next[1]*next[1] + next[2]*next[2]);
+		if(length < 1e-6f)
+			break;
+		for(int c = 0; c < 3; c++)
+			axis[c] = next[c] / length;
+	}
+
+	float low = 0.0f, high = 0.0f;
+	for(int i = 0; i < 16; i++) {
+		float along = (texels[i*4+0] - mean[0])*axis[0] + (texels[i*4+1] - mean[1])*axis[1] + (texels[i*4+2] - mean[2])*axis[2];
+		low = min(low, along);
+		high = max(high, along);
+	}
+	float inset = (high - low) / 16.0f;
+	low += inset;
+	high -= inset;
+
+	float endPoints[2][3];
+	for(int c = 0; c < 3; c++) {
+		endPoints[0][c] = min(max(mean[c] + axis[c]*high, 0.0f), 255.0f);
+		endPoints[1][c] = min(max(mean[c] + axis[c]*low, 0.0f), 255.0f);
+	}
+	unsigned short colour0 = packColour(endPoints[0]);
+	unsigned short colour1 = packColour(endPoints[1]);
+
+	//Four colour blocks need the first end point to be the larger.
+	if(colour0 < colour1)
+		swap(colour0, colour1);
+	unsigned int picks = 0;
+	if(colour0 != colour1) {
+		int palette[4][3];
+		unpackColour(colour0, palette[0]);
+		unpackColour(colour1, palette[1]);
+		for(int c = 0; c < 3; c++) {
+			palette[2][c] = (2*palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2*palette[1][c]) / 3;
+		}
+
+		for(int i = 0; i < 16; i++) {
+			int best = 0;
+			int bestDistance = 1 << 30;
+			for(int p = 0; p < 4; p++) {
+				int dr = texels[i*4+0] - palette[p][0];
+				int dg = texels[i*4+1] - palette[p][1];
+				int db = texels[i*4+2] - palette[p][2];
+				int distance = dr*dr + dg*dg + db*db;
+				if(distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			picks |= (unsigned int) best << (i * 2);
+		}
+	}
+
+	block[0] = colour0 & 0xFF;
+	block[1] = colour0 >> 8;
+	block[2] = colour1 & 0xFF;
+	block[3] = colour1 >> 8;
+	for(int i = 0; i < 4; i++)
+		block[4 + i] = (picks >> (i * 8)) & 0xFF;
+}
+
+void decodeBlockBC1(const unsigned char* block, unsigned char* texels) {
+	unsigned short colour0 = block[0] | (block[1] << 8);
+	unsigned short colour1 = block[2] | (block[3] << 8);
+	unsigned int picks = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int) block[7] << 24);
+
+	int palette[4][4];
+	unpackColour(colour0, palette[0]);
+	unpackColour(colour1, palette[1]);
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+	for(int c = 0; c < 3; c++) {
+		if(colour0 > colour1) {
+			palette[2][c] = (2*palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2*palette[1][c]) / 3;
+		}
+		else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	if(colour0 <= colour1)
+		palette[3][3] = 0;
+
+	for(int i = 0; i < 16; i++) {
+		const int* colour = palette[(picks >> (i * 2)) & 3];
+		for(int c = 0; c < 4; c++)
+			texels[i*4+c] = (unsigned char) colour[c];
+	}
+}
+
+//Blocks a row at a time from the bottom, texels past an edge repeat it.
+static void compressLevel(const vector<unsigned char>& rgba, unsigned int width, unsigned int height, unsigned char* out) {
+	unsigned char texels[16 * 4];
+	for(unsigned int blockY = 0; blockY < height; blockY += 4) {
+		for(unsigned int blockX = 0; blockX < width; blockX += 4) {
+			for(int i = 0; i < 16; i++) {
+				unsigned int x = min(blockX + i % 4, width - 1);
+				unsigned int y = min(blockY + i / 4, height - 1);
+				memcpy(&texels[i * 4], &rgba[((size_t) y * width + x) * 4], 4);
+			}
+			encodeBlockBC1(texels, out);
+			out += TEXTURE_BLOCK_BYTES;
+		}
+	}
+}
+
+bool compileTexture(string sourceFile, string cacheFile) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	vector<unsigned char> image;
+	unsigned int width, height;
+	if(!loadSourceImage(sourceFile, image, width, height))
+		return false;
+
+	TextureHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TEXTURE_MAGIC, sizeof(header.magic));
+	header.version = TEXTURE_VERSION;
+	header.headerBytes = sizeof(TextureHeader);
+	header.format = TEXTURE_FORMAT_BC1;
+	header.width = width;
+	header.height = height;
+	sourceStamp(sourceFile, header.sourceBytes, header.sourceModified);
+
+	//Every level down to one texel, as many as fit in the header.
+	unsigned long long offset = textureAlign(sizeof(TextureHeader));
+	unsigned int levelWidth = width, levelHeight = height;
+	while(header.numLevels < TEXTURE_MAX_LEVELS) {
+		TextureLevel& level = header.levels[header.numLevels++];
+		level.width = levelWidth;
+		level.height = levelHeight;
+		level.offset = offset;
+		level.bytes = textureLevelBytes(levelWidth, levelHeight);
+		offset = textureAlign(offset + level.bytes);
+		if(levelWidth == 1 && levelHeight == 1)
+			break;
+		levelWidth = max(1u, levelWidth / 2);
+		levelHeight = max(1u, levelHeight / 2);
+	}
+	header.fileBytes = header.levels[header.numLevels - 1].offset + header.levels[header.numLevels - 1].bytes;
+
+	vector<unsigned char> file(header.fileBytes, 0);
+	memcpy(&file[0], &header, sizeof(header));
+	vector<unsigned char> smaller;
+	for(unsigned int i = 0; i < header.numLevels; i++) {
+		if(i > 0) {
+			halveImage(image, header.levels[i - 1].width, header.levels[i - 1].height, smaller);
+			image.swap(smaller);
+		}
+		compressLevel(image, header.levels[i].width, header.levels[i].height, &file[header.levels[i].offset]);
+	}
+
+	string tempName = cacheFile + ".tmp";
+	FILE* fp = fopen(tempName.c_str(), "wb");
+	if(fp == NULL) {
+		fprintf(stderr, "Texture: can't write %s\n", tempName.c_str());
+		return false;
+	}
+	bool written = fwrite(&file[0], 1, file.size(), fp) == file.size();
+	written = fclose(fp) == 0 && written;
+#ifdef _WIN32
+	//Windows won't rename over an existing file.
+	if(written)
+		remove(cacheFile.c_str());
+#endif
+	if(!written || rename(tempName.c_str(), cacheFile.c_str()) != 0) {
+		fprintf(stderr, "Texture: failed writing %s\n", cacheFile.c_str());
+		remove(tempName.c_str());
+		return false;
+	}
+
+	printf("Texture: transcoded %s (%ux%u, %u levels, %llu bytes) in %.1f ms\n", sourceFile.c_str(), width, height,
+		header.numLevels, header.fileBytes, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	return true;
+}
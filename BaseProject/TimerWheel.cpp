@@ -0,0 +1,66 @@
+#include "include/TimerWheel.h"
+
+//Constructor, the wheel starts at tick 0.
+TimerWheel::TimerWheel() {
+	now = 0;
+	pending = 0;
+}
+
+//Destructor.
+TimerWheel::~TimerWheel() {
+
+}
+
+void TimerWheel::schedule(unsigned long long due, unsigned int id, unsigned int tag) {
+	TimerEntry entry;
+	entry.due = due > now ? due : now + 1;
+	entry.id = id;
+	entry.tag = tag;
+	place(entry);
+}
+
+//A timer goes on the lowest level it shares every higher bit with now, so
+//it's only looked at again when the levels below have turned round to it.
+void TimerWheel::place(const TimerEntry& entry) {
+	pending++;
+	for(int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		int shift = TIMER_WHEEL_BITS * (level + 1);
+		if((entry.due >> shift) == (now >> shift)) {
+			slots[level][(entry.due >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1)].push_back(entry);
+			return;
+		}
+	}
+
+	//Past the top level, park it in the top slot furthest from now.
+	int shift = TIMER_WHEEL_BITS * (TIMER_WHEEL_LEVELS - 1);
+	slots[TIMER_WHEEL_LEVELS - 1][((now >> shift) - 1) & (TIMER_WHEEL_SLOTS - 1)].push_back(entry);
+}
+
+void TimerWheel::tick(vector<TimerEntry>& fired) {
+	now++;
+
+	//Every level whose turn has just come round spreads its current slot
+	//over the levels below, highest first so its timers can keep falling.
+	for(int level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+		int shift = TIMER_WHEEL_BITS * level;
+		if((now & ((1ULL << shift) - 1)) != 0)
+			continue;
+
+		cascading.swap(slots[level][(now >> shift) & (TIMER_WHEEL_SLOTS - 1)]);
+		pending -= cascading.size();
+		for(int i = 0; i < cascading.size(); i++)
+			place(cascading[i]);
+		cascading.clear();
+	}
+
+	vector<TimerEntry>& slot = slots[0][now & (TIMER_WHEEL_SLOTS - 1)];
+	pending -= slot.size();
+	for(int i = 0; i < slot.size(); i++) {
+		//Parked timers from further out than the wheel reaches go round again.
+		if(slot[i].due > now)
+			place(slot[i]);
+		else
+			fired.push_back(slot[i]);
+	}
+	slot.clear();
+}
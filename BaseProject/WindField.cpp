@@ -0,0 +1,302 @@
+#include "include/WindField.h"
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+//Same test as DistanceField.cpp.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WIND_FIELD_SSE
+#include <emmintrin.h>
+#endif
+
+//Size of the noise's swirls in world units, and how much the finer second
+//octave adds.
+#define WIND_NOISE_SCALE 1.5f
+#define WIND_DETAIL 0.5f
+
+//Pseudo random in [-1, 1) for a lattice point, a key frame is the fourth axis.
+static float latticeValue(unsigned int seed, int x, int y, int z, int w) {
+	unsigned int h = seed;
+	h ^= (unsigned int) x * 0x85EBCA6Bu;
+	h = (h << 13 | h >> 19) * 5 + 0xE6546B64u;
+	h ^= (unsigned int) y * 0xC2B2AE35u;
+	h = (h << 13 | h >> 19) * 5 + 0xE6546B64u;
+	h ^= (unsigned int) z * 0x27D4EB2Fu;
+	h = (h << 13 | h >> 19) * 5 + 0xE6546B64u;
+	h ^= (unsigned int) w * 0x165667B1u;
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	return (h >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+static float fade(float t) {
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+//Smooth value noise at a point for one key frame.
+static float valueNoise(unsigned int seed, float x, float y, float z, int w) {
+	float fx = floorf(x), fy = floorf(y), fz = floorf(z);
+	int ix = (int) fx, iy = (int) fy, iz = (int) fz;
+	float u = fade(x - fx), v = fade(y - fy), t = fade(z - fz);
+
+	float c[2][2];
+	for(int dz = 0; dz < 2; dz++)
+		for(int dy = 0; dy < 2; dy++) {
+			float low = latticeValue(seed, ix, iy + dy, iz + dz, w);
+			float high = latticeValue(seed, ix + 1, iy + dy, iz + dz, w);
+			c[dz][dy] = low + u * (high - low);
+		}
+	float near = c[0][0] + v * (c[0][1] - c[0][0]);
+	float far = c[1][0] + v * (c[1][1] - c[1][0]);
+	return near + t * (far - near);
+}
+
+//Constructor, no wind until create().
+WindField::WindField() {
+	memset(origin, 0, sizeof(origin));
+	memset(spacing, 0, sizeof(spacing));
+	memset(inverseSpacing, 0, sizeof(inverseSpacing));
+	memset(nodes, 0, sizeof(nodes));
+	seed = 0;
+	for(int i = 0; i < WIND_FRAMES; i++)
+		frameKeys[i] = -1;
+	buildingKey = -1;
+	unitsDone = 0;
+	unitsPerStep = 1;
+	buildMilliseconds = 0.0;
+}
+
+//Destructor.
+WindField::~WindField() {
+
+	MemoryStats::remove(MEMORY_WIND_FIELDS, numBytes());
+
+}
+
+void WindField::create(const float* low, const float* high, int resolution, unsigned int newSeed) {
+	MemoryStats::remove(MEMORY_WIND_FIELDS, numBytes());
+
+	seed = newSeed;
+	for(int axis = 0; axis < 3; axis++) {
+		nodes[axis] = resolution + 1;
+		origin[axis] = low[axis];
+		spacing[axis] = (high[axis] - low[axis]) / resolution;
+		inverseSpacing[axis] = 1.0f / spacing[axis];
+	}
+
+	int count = nodes[0] * nodes[1] * nodes[2];
+	for(int i = 0; i < WIND_FRAMES; i++) {
+		frames[i].assign(count * 4, 0.0f);
+		frameKeys[i] = -1;
+	}
+	blended.assign(count * 4, 0.0f);
+	potential.assign(count * 3, 0.0f);
+	buildingKey = -1;
+	unitsDone = 0;
+
+	//Finish a frame in half the time it has, so it's always ready early.
+	unitsPerStep = (numUnits() + WIND_KEY_STEPS / 2 - 1) / (WIND_KEY_STEPS / 2);
+
+	MemoryStats::add(MEMORY_WIND_FIELDS, numBytes());
+}
+
+bool WindField::isEmpty() {
+	return blended.empty();
+}
+
+int WindField::numUnits() {
+	return 2 * nodes[2];
+}
+
+int WindField::nodeIndex(int x, int y, int z) const {
+	return (z * nodes[1] + y) * nodes[0] + x;
+}
+
+void WindField::update(unsigned long long step) {
+	if(blended.empty())
+		return;
+
+	long long key = step / WIND_KEY_STEPS;
+
+	//Starting out, or restored somewhere new: build what's needed right now.
+	for(long long k = key; k <= key + 1; k++) {
+		if(frameKeys[k % WIND_FRAMES] != k)
+			buildFrame(k);
+	}
+
+	//Meanwhile, the one after.
+	long long next = key + 2;
+	if(frameKeys[next % WIND_FRAMES] != next) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if(buildingKey != next) {
+			buildingKey = next;
+			unitsDone = 0;
+			frameKeys[next % WIND_FRAMES] = -1;
+		}
+		for(int i = 0; i < unitsPerStep && unitsDone < numUnits(); i++)
+			buildUnit(next, unitsDone++);
+		if(unitsDone == numUnits()) {
+			frameKeys[next % WIND_FRAMES] = next;
+			buildingKey = -1;
+		}
+		buildMilliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+
+	//Ease from this key frame to the next.
+	float t = (float) (step % WIND_KEY_STEPS) / WIND_KEY_STEPS;
+	t = t * t * (3.0f - 2.0f * t);
+	const float* from = &frames[key % WIND_FRAMES][0];
+	const float* to = &frames[(key + 1) % WIND_FRAMES][0];
+	float* out = &blended[0];
+	int count = blended.size();
+	int i = 0;
+#ifdef WIND_FIELD_SSE
+	__m128 weight = _mm_set1_ps(t);
+	for(; i < count; i += 4) {
+		__m128 a = _mm_loadu_ps(from + i);
+		__m128 b = _mm_loadu_ps(to + i);
+		_mm_storeu_ps(out + i, _mm_add_ps(a, _mm_mul_ps(weight, _mm_sub_ps(b, a))));
+	}
+#endif
+	for(; i < count; i++)
+		out[i] = from[i] + t * (to[i] - from[i]);
+}
+
+//Everything in one go, when a frame is needed straight away.
+void WindField::buildFrame(long long key) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	//Anything half built for the same slot is lost.
+	if(buildingKey >= 0 && buildingKey % WIND_FRAMES == key % WIND_FRAMES)
+		buildingKey = -1;
+
+	for(int unit = 0; unit < numUnits(); unit++)
+		buildUnit(key, unit);
+	frameKeys[key % WIND_FRAMES] = key;
+
+	buildMilliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//One z slice of either the potential (first half of the units) or the
+//velocity, which is the potential's curl by central differences.
+void WindField::buildUnit(long long key, int unit) {
+	int w = (int) key;
+
+	if(unit < nodes[2]) {
+		int z = unit;
+		for(int y = 0; y < nodes[1]; y++) {
+			for(int x = 0; x < nodes[0]; x++) {
+				float p[3] = {
+					(origin[0] + x * spacing[0]) / WIND_NOISE_SCALE,
+					(origin[1] + y * spacing[1]) / WIND_NOISE_SCALE,
+					(origin[2] + z * spacing[2]) / WIND_NOISE_SCALE
+				};
+				float* out = &potential[nodeIndex(x, y, z) * 3];
+				for(int c = 0; c < 3; c++) {
+					unsigned int channel = seed + c * 0x9E3779B9u;
+					out[c] = valueNoise(channel, p[0], p[1], p[2], w) +
+						WIND_DETAIL * valueNoise(channel ^ 0x68E31DA4u, p[0] * 2.0f, p[1] * 2.0f, p[2] * 2.0f, w);
+				}
+			}
+		}
+		return;
+	}
+
+	int z = unit - nodes[2];
+	float* frame = &frames[key % WIND_FRAMES][0];
+	for(int y = 0; y < nodes[1]; y++) {
+		for(int x = 0; x < nodes[0]; x++) {
+			//Neighbours either side, one sided at the edges.
+			int x0 = x > 0 ? x - 1 : x, x1 = x + 1 < nodes[0] ? x + 1 : x;
+			int y0 = y > 0 ? y - 1 : y, y1 = y + 1 < nodes[1] ? y + 1 : y;
+			int z0 = z > 0 ? z - 1 : z, z1 = z + 1 < nodes[2] ? z + 1 : z;
+			const float* px0 = &potential[nodeIndex(x0, y, z) * 3];
+			const float* px1 = &potential[nodeIndex(x1, y, z) * 3];
+			const float* py0 = &potential[nodeIndex(x, y0, z) * 3];
+			const float* py1 = &potential[nodeIndex(x, y1, z) * 3];
+			const float* pz0 = &potential[nodeIndex(x, y, z0) * 3];
+			const float* pz1 = &potential[nodeIndex(x, y, z1) * 3];
+			float dx = 1.0f / ((x1 - x0) * spacing[0]);
+			float dy = 1.0f / ((y1 - y0) * spacing[1]);
+			float dz = 1.0f / ((z1 - z0) * spacing[2]);
+
+			float* out = &frame[nodeIndex(x, y, z) * 4];
+			out[0] = (py1[2] - py0[2]) * dy - (pz1[1] - pz0[1]) * dz;
+			out[1] = (pz1[0] - pz0[0]) * dz - (px1[2] - px0[2]) * dx;
+			out[2] = (px1[1] - px0[1]) * dx - (py1[0] - py0[0]) * dy;
+			out[3] = 0.0f;
+		}
+	}
+}
+
+//Trilinear over the eight nodes around each point. With a node in one
+//register the three components are filtered together.
+void WindField::sample(const float* points, int count, float* velocities) const {
+	if(blended.empty()) {
+		memset(velocities, 0, count * 3 * sizeof(float));
+		return;
+	}
+
+	const float* grid = &blended[0];
+	int strideY = nodes[0] * 4;
+	int strideZ = nodes[0] * nodes[1] * 4;
+	for(int i = 0; i < count; i++) {
+		int cell[3];
+		float fraction[3];
+		for(int axis = 0; axis < 3; axis++) {
+			float position = (points[i*3 + axis] - origin[axis]) * inverseSpacing[axis];
+			float highest = nodes[axis] - 1.001f;
+			position = position < 0.0f ? 0.0f : (position > highest ? highest : position);
+			cell[axis] = (int) position;
+			fraction[axis] = position - cell[axis];
+		}
+		const float* base = grid + nodeIndex(cell[0], cell[1], cell[2]) * 4;
+
+#ifdef WIND_FIELD_SSE
+		__m128 fx = _mm_set1_ps(fraction[0]);
+		__m128 c000 = _mm_loadu_ps(base);
+		__m128 c010 = _mm_loadu_ps(base + strideY);
+		__m128 c001 = _mm_loadu_ps(base + strideZ);
+		__m128 c011 = _mm_loadu_ps(base + strideZ + strideY);
+		__m128 c00 = _mm_add_ps(c000, _mm_mul_ps(fx, _mm_sub_ps(_mm_loadu_ps(base + 4), c000)));
+		__m128 c10 = _mm_add_ps(c010, _mm_mul_ps(fx, _mm_sub_ps(_mm_loadu_ps(base + strideY + 4), c010)));
+		__m128 c01 = _mm_add_ps(c001, _mm_mul_ps(fx, _mm_sub_ps(_mm_loadu_ps(base + strideZ + 4), c001)));
+		__m128 c11 = _mm_add_ps(c011, _mm_mul_ps(fx, _mm_sub_ps(_mm_loadu_ps(base + strideZ + strideY + 4), c011)));
+		__m128 fy = _mm_set1_ps(fraction[1]);
+		__m128 c0 = _mm_add_ps(c00, _mm_mul_ps(fy, _mm_sub_ps(c10, c00)));
+		__m128 c1 = _mm_add_ps(c01, _mm_mul_ps(fy, _mm_sub_ps(c11, c01)));
+		__m128 velocity = _mm_add_ps(c0, _mm_mul_ps(_mm_set1_ps(fraction[2]), _mm_sub_ps(c1, c0)));
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, velocity);
+		velocities[i*3+0] = lanes[0];
+		velocities[i*3+1] = lanes[1];
+		velocities[i*3+2] = lanes[2];
+#else
+		for(int c = 0; c < 3; c++) {
+			float c00 = base[c] + fraction[0] * (base[4 + c] - base[c]);
+			float c10 = base[strideY + c] + fraction[0] * (base[strideY + 4 + c] - base[strideY + c]);
+			float c01 = base[strideZ + c] + fraction[0] * (base[strideZ + 4 + c] - base[strideZ + c]);
+			float c11 = base[strideZ + strideY + c] + fraction[0] * (base[strideZ + strideY + 4 + c] - base[strideZ + strideY + c]);
+			float c0 = c00 + fraction[1] * (c10 - c00);
+			float c1 = c01 + fraction[1] * (c11 - c01);
+			velocities[i*3+c] = c0 + fraction[2] * (c1 - c0);
+		}
+#endif
+	}
+}
+
+size_t WindField::numBytes() {
+	size_t floats = blended.size() + potential.size();
+	for(int i = 0; i < WIND_FRAMES; i++)
+		floats += frames[i].size();
+	return floats * sizeof(float);
+}
+
+void WindField::printStats() {
+	printf("Wind: %dx%dx%d nodes, %d of %d units a step, %lu bytes, %.1f ms spent building frames\n",
+		nodes[0], nodes[1], nodes[2], unitsPerStep, numUnits(), (unsigned long) numBytes(), buildMilliseconds);
+}
@@ -0,0 +1,933 @@
+#include "include/World.h"
+#include "include/SnapshotPublisher.h"
+#include <string.h>
+
+//Which contact cell a point on the ground plan is in.
+static int contactCellOf(double position) {
+	return (int) floor(position / CONTACT_CELL_SIZE);
+}
+
+static unsigned long long contactKey(int x, int z) {
+	return ((unsigned long long) (unsigned int) x << 32) | (unsigned int) z;
+}
+
+//Constructor, the scene is empty until create() is called.
+World::World(bool isHeadless) {
+	headless = isHeadless;
+	nextBirdId = 0;
+	stepCount = 0;
+	changeCount = 0;
+	running = false;
+	checkpointRequested = false;
+	telemetry = NULL;
+	publisher = NULL;
+
+	//Wind covers the flying box, the same gusts every run.
+	float windLow[3] = { (float) -WORLD_HALF_SIZE, (float) -WORLD_HALF_SIZE, (float) -WORLD_HALF_SIZE };
+	float windHigh[3] = { (float) WORLD_HALF_SIZE, (float) WORLD_HALF_SIZE, (float) WORLD_HALF_SIZE };
+	wind.create(windLow, windHigh, WIND_RESOLUTION, 1);
+	windStrength = WIND_STRENGTH;
+	sleepingChanged = true;
+	sleepingGeneration = 0;
+	sleepingValidFrom = 1;
+	for(int i = 0; i < 3; i++)
+		sleepingLayers.slot(i).generation = 0;
+	nextSleepSerial = 1;
+	stepInterval = 1.0 / 60.0;
+
+	memset(&latency, 0, sizeof(latency));
+	lastPresentedStep = 0;
+	lastStepMilliseconds = 0.0;
+	lastActiveBirds = 0;
+	lastSleepingBirds = 0;
+}
+
+//Destructor.
+World::~World() {
+
+	stop();
+
+	scripts.cancelAll();
+	for(int i = 0; i < birds.size(); i++)
+		Bird::destroy(birds[i]);
+	for(int i = 0; i < statics.size(); i++)
+		Object::destroy(statics[i]);
+
+}
+
+//Set up the scene from its file, plus numBirds birds in the middle.
+void World::create(int numBirds, string sceneFile, bool sceneBirds) {
+	SceneFile scene;
+	if(!sceneFile.empty() && scene.load(sceneFile))
+		loadScene(scene, sceneBirds);
+
+	for(int i = 0; i < numBirds; i++)
+		spawnBird(0, 0, 0);
+
+	bakeObstacles();
+
+	//Publish the starting state so the first frame has something to draw.
+	publish(0.0);
+}
+
+//Each mesh is made once as the prototype for its instances, all of them
+//before any placing starts so the loader parses the files side by side in
+//the meantime. The rest are stamped out from the prototypes into pool space
+//set aside for them, and their transforms built in one pass.
+void World::loadScene(SceneFile& scene, bool sceneBirds) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	const vector<SceneMesh>& meshes = scene.getMeshes();
+	const vector<SceneGroup>& groups = scene.getGroups();
+	vector<Object*> prototypes(meshes.size(), (Object*) NULL);
+	for(int i = 0; i < groups.size(); i++) {
+		unsigned int mesh = groups[i].mesh;
+		if(groups[i].count == 0 || prototypes[mesh] != NULL)
+			continue;
+		prototypes[mesh] = Object::create((char*) meshes[mesh].fileName, meshes[mesh].name, KIND_STATIC);
+		if(!headless) {
+			prototypes[mesh]->setupData(mesh + 1);
+			if(meshes[mesh].texture[0] != '\0')
+				prototypes[mesh]->setTexture(meshes[mesh].texture);
+		}
+	}
+
+	unsigned int numPrototypes = 0;
+	for(int i = 0; i < prototypes.size(); i++)
+		numPrototypes += prototypes[i] != NULL;
+	if(scene.getNumPlacements() > numPrototypes)
+		Object::reservePool(KIND_STATIC, scene.getNumPlacements() - numPrototypes);
+
+	size_t firstNew = statics.size();
+	statics.reserve(firstNew + scene.getNumPlacements());
+	vector<bool> prototypePlaced(meshes.size(), false);
+	for(int i = 0; i < groups.size(); i++) {
+		Object* prototype = prototypes[groups[i].mesh];
+		const float* placement = scene.getPlacements() + groups[i].first * SCENE_PLACEMENT_FLOATS;
+		for(unsigned long long j = 0; j < groups[i].count; j++, placement += SCENE_PLACEMENT_FLOATS) {
+			Object* object = prototype;
+			if(prototypePlaced[groups[i].mesh])
+				object = Object::createInstance(prototype);
+			prototypePlaced[groups[i].mesh] = true;
+
+			object->setTranslation(placement[0], placement[1], placement[2]);
+			object->setRotation(placement[3], placement[4], placement[5]);
+			statics.push_back(object);
+			if(groups[i].flags & SCENE_SOLID)
+				solidStatics.push_back(object);
+		}
+	}
+
+	if(scene.hasTerrain())
+		setTerrain(scene.getTerrain());
+
+	//Scenery never moves, build its transform once and leave it asleep.
+	if(statics.size() > firstNew)
+		Object::updateStatics(&statics[firstNew], statics.size() - firstNew);
+	rebuildSleepingLayer();
+
+	unsigned long long numSceneBirds = sceneBirds ? scene.getNumBirds() : 0;
+	const float* positions = scene.getBirds();
+	if(numSceneBirds > 0)
+		Bird::reservePool(numSceneBirds);
+	for(unsigned long long i = 0; i < numSceneBirds; i++)
+		spawnBird(positions[i*3+0], positions[i*3+1], positions[i*3+2]);
+
+	printf("Scene: %llu objects from %u meshes and %llu birds placed in %.1f ms, read in %.1f ms\n",
+		scene.getNumPlacements(), numPrototypes, numSceneBirds,
+		chrono::duration<double, milli>(chrono::steady_clock::now() - start).count(), scene.getLoadMilliseconds());
+}
+
+Bird* World::spawnBird(double x, double y, double z) {
+	double bounds[3] = { WORLD_HALF_SIZE, WORLD_HALF_SIZE, WORLD_HALF_SIZE };
+	Bird* bird = Bird::create(x, y, z, bounds);
+	bird->id = nextBirdId++;
+	if(!headless)
+		bird->setupRendering();
+
+	addBird(bird);
+	return bird;
+}
+
+//Into the world awake.
+void World::addBird(Bird* bird) {
+	bird->worldIndex = birds.size();
+	birds.push_back(bird);
+	bird->asleep = false;
+	bird->listIndex = activeBirds.size();
+	activeBirds.push_back(bird);
+}
+
+void World::setNextBirdId(unsigned int id) {
+	nextBirdId = id;
+}
+
+Bird* World::adoptBird(const BirdRecord& record) {
+	Bird* bird = Bird::create(record);
+	if(!headless)
+		bird->setupRendering();
+	addBird(bird);
+	return bird;
+}
+
+void World::takeBirdsOutside(double minX, double maxX, vector<BirdRecord>& taken) {
+	for(int i = activeBirds.size() - 1; i >= 0; i--) {
+		double x = activeBirds[i]->getPart(KIND_BIRD_BODY)->getTranslation()[0];
+		if(x >= minX && x < maxX)
+			continue;
+
+		taken.push_back(BirdRecord());
+		activeBirds[i]->exportRecord(taken.back());
+		removeBird(activeBirds[i]);
+	}
+}
+
+//Drop a bird from every list. Any wake timer it has is left to go stale.
+void World::removeBird(Bird* bird) {
+	unsigned int index = bird->worldIndex;
+	birds[index] = birds.back();
+	birds[index]->worldIndex = index;
+	birds.pop_back();
+
+	if(bird->asleep)
+		removeSleeping(bird);
+	else
+		removeFromList(activeBirds, bird);
+
+	scripts.cancel(bird);
+	Bird::destroy(bird);
+}
+
+//Swap the last bird into this one's place.
+void World::removeFromList(vector<Bird*>& list, Bird* bird) {
+	unsigned int index = bird->listIndex;
+	list[index] = list.back();
+	list[index]->listIndex = index;
+	list.pop_back();
+}
+
+//Out of the sleeping list, the contact grid and the timers' reach.
+void World::removeSleeping(Bird* bird) {
+	unsigned int index = bird->listIndex;
+	removeFromList(sleepingBirds, bird);
+	if(index < sleepingBirds.size())
+		noteSleepingSlot(index);
+
+	vector<Bird*>& cell = contactGrid[bird->contactCell];
+	cell[bird->contactIndex] = cell.back();
+	cell[bird->contactIndex]->contactIndex = bird->contactIndex;
+	cell.pop_back();
+
+	sleepers.erase(bird->sleepSerial);
+	bird->sleepSerial = 0;
+	sleepingChanged = true;
+}
+
+//Every bird gone at once, for a restore.
+void World::clearBirds() {
+	scripts.cancelAll();
+	for(int i = 0; i < birds.size(); i++)
+		Bird::destroy(birds[i]);
+	birds.clear();
+	activeBirds.clear();
+	sleepingBirds.clear();
+	contactGrid.clear();
+	sleepers.clear();
+	wakeTimers = priority_queue<WakeTimer, vector<WakeTimer>, greater<WakeTimer> >();
+	rebuildSleepingLayer();
+}
+
+int World::numBirds() {
+	return birds.size();
+}
+
+const vector<Landing>& World::getLandings() {
+	return landings;
+}
+
+//Start stepping on the simulation thread at a fixed rate.
+void World::start(double stepsPerSecond) {
+	stepInterval = 1.0 / stepsPerSecond;
+	running = true;
+	simThread = thread(&World::run, this);
+}
+
+void World::stop() {
+	running = false;
+	if(simThread.joinable())
+		simThread.join();
+}
+
+//Fixed timestep loop. Sleeping until the next step is due means a slow
+//frame on the render thread never slows the simulation down.
+void World::run() {
+	chrono::steady_clock::time_point next = chrono::steady_clock::now();
+	chrono::steady_clock::duration interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(stepInterval));
+
+	while(running) {
+		step();
+
+		if(checkpointRequested.load()) {
+			string fileName;
+			{
+				lock_guard<mutex> guard(checkpointLock);
+				fileName = pendingCheckpoint;
+				checkpointRequested = false;
+			}
+			saveCheckpoint(fileName);
+		}
+
+		next += interval;
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		//Too far behind to catch up, don't try to make up every missed step.
+		if(next < now - interval * 4)
+			next = now;
+		this_thread::sleep_until(next);
+	}
+}
+
+void World::step() {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	processCommands();
+	wakeDueBirds();
+	runScripts();
+
+	//The environment, sampled for every awake bird in a batch.
+	wind.update(stepCount);
+	gatherFlock();
+	avoidObstacles();
+	followTerrain();
+
+	//Only awake birds cost anything. Bird level state first (ground
+	//contact), then every bird's parts.
+	landings.clear();
+	for(int i = 0; i < activeBirds.size(); i++) {
+		if(activeBirds[i]->prepareStep()) {
+			double* centre = activeBirds[i]->getCentre();
+			Landing landing = { { centre[0], centre[1], centre[2] } };
+			landings.push_back(landing);
+			wakeBirdsNear(centre, CONTACT_RADIUS);
+			scripts.signal(activeBirds[i], SCRIPT_EVENT_LANDED);
+		}
+	}
+
+	applyWind();
+
+	if(!activeBirds.empty())
+		Object::updateBirds(&activeBirds[0], activeBirds.size());
+
+	//Walk backwards so a bird going to sleep can be swapped out in place.
+	for(int i = activeBirds.size() - 1; i >= 0; i--) {
+		if(activeBirds[i]->isSettled())
+			sleepBird(i);
+	}
+
+	stepCount++;
+
+	TelemetryRecorder* recorder = telemetry.load();
+	if(recorder != NULL)
+		recorder->record(stepCount, birds);
+
+	publish(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+}
+
+//Copy every object's transform into the back snapshot and hand it over.
+void World::publish(double stepMilliseconds) {
+	WorldSnapshot& snapshot = snapshots.back();
+
+	snapshot.entries.clear();
+	for(int i = 0; i < activeBirds.size(); i++)
+		activeBirds[i]->writeSnapshot(snapshot.entries);
+
+	//Nothing awake and nobody falling asleep or waking means the picture
+	//hasn't changed, so an on-demand renderer can skip the frame.
+	if(!activeBirds.empty() || sleepingChanged)
+		changeCount++;
+
+	//The sleeping layer only goes out when its contents have changed, or to
+	//a viewer that has just attached.
+	SnapshotPublisher* viewers = publisher.load();
+	if(sleepingChanged || (viewers != NULL && viewers->wantsResting())) {
+		SleepingLayer& layer = sleepingLayers.back();
+		writeSleepingLayer(layer);
+		if(viewers != NULL)
+			viewers->publishResting(layer, stepCount);
+		sleepingLayers.publish();
+		sleepingChanged = false;
+	}
+
+	snapshot.step = stepCount;
+	snapshot.stepMilliseconds = stepMilliseconds;
+	snapshot.published = chrono::steady_clock::now();
+	snapshot.activeBirds = activeBirds.size();
+	snapshot.sleepingBirds = sleepingBirds.size();
+
+	if(viewers != NULL)
+		viewers->publish(snapshot);
+	snapshots.publish();
+}
+
+//Take a bird out of the update set until its crash timer runs out.
+void World::sleepBird(int activeIndex) {
+	Bird* bird = activeBirds[activeIndex];
+	removeFromList(activeBirds, bird);
+	putToSleep(bird, stepCount);
+}
+
+//Into the sleeping list and the contact grid, with a timer for when it's
+//due to wake counted from when it fell asleep.
+void World::putToSleep(Bird* bird, unsigned long long sleepStep) {
+	bird->asleep = true;
+	bird->sleepStep = sleepStep;
+	bird->listIndex = sleepingBirds.size();
+	sleepingBirds.push_back(bird);
+	noteSleepingSlot(bird->listIndex);
+
+	double* centre = bird->getCentre();
+	bird->contactCell = contactKey(contactCellOf(centre[0]), contactCellOf(centre[2]));
+	vector<Bird*>& cell = contactGrid[bird->contactCell];
+	bird->contactIndex = cell.size();
+	cell.push_back(bird);
+
+	bird->sleepSerial = nextSleepSerial++;
+	sleepers[bird->sleepSerial] = bird;
+	double stepsLeft = bird->crashStepsLeft();
+	wakeTimers.push(WakeTimer(sleepStep + (stepsLeft > 0 ? (unsigned long long) stepsLeft : 0), bird->sleepSerial));
+	sleepingChanged = true;
+}
+
+void World::wakeBird(Bird* bird) {
+	if(!bird->asleep)
+		return;
+
+	removeSleeping(bird);
+	bird->wake((double) (stepCount - bird->sleepStep));
+	bird->asleep = false;
+	bird->listIndex = activeBirds.size();
+	activeBirds.push_back(bird);
+	scripts.signal(bird, SCRIPT_EVENT_WOKEN);
+}
+
+//Input for the whole flock, everything resting gets up in one pass.
+void World::wakeAllBirds() {
+	if(sleepingBirds.empty())
+		return;
+
+	for(int i = 0; i < sleepingBirds.size(); i++) {
+		Bird* bird = sleepingBirds[i];
+		bird->wake((double) (stepCount - bird->sleepStep));
+		bird->asleep = false;
+		bird->sleepSerial = 0;
+		bird->listIndex = activeBirds.size();
+		activeBirds.push_back(bird);
+		scripts.signal(bird, SCRIPT_EVENT_WOKEN);
+	}
+
+	//Nobody is left for the grid or the timers, and the layer is back to
+	//just the scenery.
+	sleepingBirds.clear();
+	contactGrid.clear();
+	sleepers.clear();
+	wakeTimers = priority_queue<WakeTimer, vector<WakeTimer>, greater<WakeTimer> >();
+	sleepingChanged = true;
+}
+
+//Wake every bird whose timer has come up. Timers for sleeps that have
+//already ended are stale and skipped.
+void World::wakeDueBirds() {
+	while(!wakeTimers.empty() && wakeTimers.top().first <= stepCount) {
+		unordered_map<unsigned long long, Bird*>::iterator it = sleepers.find(wakeTimers.top().second);
+		wakeTimers.pop();
+		if(it == sleepers.end())
+			continue;
+
+		Bird* bird = it->second;
+		double stepsLeft = bird->crashStepsLeft() - (double) (stepCount - bird->sleepStep);
+		if(stepsLeft <= 0)
+			wakeBird(bird);
+		else
+			wakeTimers.push(WakeTimer(stepCount + (unsigned long long) ceil(stepsLeft), bird->sleepSerial));
+	}
+}
+
+//A slot of sleepingBirds holds a different bird, or a new one.
+void World::noteSleepingSlot(unsigned int index) {
+	pendingSleepingSlots.push_back(index);
+}
+
+//The scenery or everyone at once changed, every layer is written whole.
+void World::rebuildSleepingLayer() {
+	sleepingEdits.clear();
+	pendingSleepingSlots.clear();
+	sleepingValidFrom = sleepingGeneration + 1;
+	sleepingChanged = true;
+}
+
+void World::writeSleepingBird(SleepingLayer& layer, unsigned int index) {
+	SnapshotEntry* entries = &layer.entries[statics.size() + index * BIRD_SNAPSHOT_ENTRIES];
+	for(int i = 0; i < BIRD_SNAPSHOT_ENTRIES; i++)
+		sleepingBirds[index]->getPart((EntityKind) (FIRST_BIRD_KIND + i))->writeSnapshot(entries[i]);
+}
+
+//Catch the layer up from the edits since it was last written, or write it
+//whole if it's too far behind. Then this generation's edits are kept for the
+//other buffers and the oldest let go.
+void World::writeSleepingLayer(SleepingLayer& layer) {
+	if(!pendingSleepingSlots.empty() || sleepingGeneration < sleepingValidFrom) {
+		sleepingGeneration++;
+		for(int i = 0; i < pendingSleepingSlots.size(); i++)
+			sleepingEdits.push_back(make_pair(sleepingGeneration, pendingSleepingSlots[i]));
+		pendingSleepingSlots.clear();
+	}
+	if(sleepingGeneration > SLEEPING_LAYER_HISTORY && sleepingValidFrom < sleepingGeneration - SLEEPING_LAYER_HISTORY) {
+		sleepingValidFrom = sleepingGeneration - SLEEPING_LAYER_HISTORY;
+		size_t keep = 0;
+		while(keep < sleepingEdits.size() && sleepingEdits[keep].first <= sleepingValidFrom)
+			keep++;
+		sleepingEdits.erase(sleepingEdits.begin(), sleepingEdits.begin() + keep);
+	}
+
+	size_t numEntries = statics.size() + sleepingBirds.size() * BIRD_SNAPSHOT_ENTRIES;
+	if(layer.generation < sleepingValidFrom) {
+		layer.entries.resize(numEntries);
+		for(int i = 0; i < statics.size(); i++)
+			statics[i]->writeSnapshot(layer.entries[i]);
+		for(unsigned int i = 0; i < sleepingBirds.size(); i++)
+			writeSleepingBird(layer, i);
+	}
+	else {
+		layer.entries.resize(numEntries);
+		for(int i = sleepingEdits.size() - 1; i >= 0 && sleepingEdits[i].first > layer.generation; i--) {
+			if(sleepingEdits[i].second < sleepingBirds.size())
+				writeSleepingBird(layer, sleepingEdits[i].second);
+		}
+	}
+	layer.generation = sleepingGeneration;
+}
+
+//Resume whichever scripts are due. A resting bird a script acts on is
+//woken, as it would be by any other input.
+void World::runScripts() {
+	scriptedBirds.clear();
+	scripts.run(scriptedBirds);
+	for(int i = 0; i < scriptedBirds.size(); i++)
+		wakeBird(scriptedBirds[i]);
+}
+
+//Contact: something landed nearby, resting birds get disturbed. Only the
+//contact cells the radius reaches are looked in.
+void World::wakeBirdsNear(double* centre, double radius) {
+	if(sleepingBirds.empty())
+		return;
+
+	int lowX = contactCellOf(centre[0] - radius), highX = contactCellOf(centre[0] + radius);
+	int lowZ = contactCellOf(centre[2] - radius), highZ = contactCellOf(centre[2] + radius);
+	for(int z = lowZ; z <= highZ; z++) {
+		for(int x = lowX; x <= highX; x++) {
+			unordered_map<unsigned long long, vector<Bird*> >::iterator it = contactGrid.find(contactKey(x, z));
+			if(it == contactGrid.end())
+				continue;
+
+			//Backwards, so a bird woken and swapped out is replaced by one
+			//already looked at.
+			vector<Bird*>& cell = it->second;
+			for(int i = cell.size() - 1; i >= 0; i--) {
+				double* other = cell[i]->getCentre();
+				double dx = other[0] - centre[0];
+				double dy = other[1] - centre[1];
+				double dz = other[2] - centre[2];
+				if(dx*dx + dy*dy + dz*dz < radius*radius)
+					wakeBird(cell[i]);
+			}
+		}
+	}
+}
+
+//Every solid static mesh in world space, baked into one distance field
+//across all cores. The meshes may still be with the loader, they're small
+//so we wait.
+void World::bakeObstacles() {
+	vector<float> triangles;
+	for(int i = 0; i < solidStatics.size(); i++) {
+		Mesh* mesh = solidStatics[i]->getMesh();
+		while(mesh->getState() == MESH_QUEUED)
+			this_thread::sleep_for(chrono::milliseconds(1));
+		if(mesh->getState() == MESH_FAILED)
+			continue;
+
+		const GLdouble* positions = mesh->getPositions();
+		const GLuint* indices = mesh->getIndices();
+		for(int j = 0; j < mesh->getNumIndices(); j++) {
+			GLdouble corner[4];
+			solidStatics[i]->modelViewStack->transformd(&positions[indices[j]*4], corner);
+			triangles.push_back((float) corner[0]);
+			triangles.push_back((float) corner[1]);
+			triangles.push_back((float) corner[2]);
+		}
+	}
+
+	int numThreads = thread::hardware_concurrency();
+	obstacles.bake(triangles, OBSTACLE_VOXEL_SIZE, OBSTACLE_TRUNCATION, numThreads > 0 ? numThreads : 1);
+}
+
+//Where every awake bird from first on is, for sampling the environment in
+//batches.
+void World::gatherFlock(int first) {
+	int count = activeBirds.size();
+	flockPoints.resize(count * 3);
+	for(int i = first; i < count; i++) {
+		double* centre = activeBirds[i]->getPart(KIND_BIRD_BODY)->getTranslation();
+		flockPoints[i*3+0] = (float) centre[0];
+		flockPoints[i*3+1] = (float) centre[1];
+		flockPoints[i*3+2] = (float) centre[2];
+	}
+}
+
+//Birds heading into scenery turn away from it.
+void World::avoidObstacles() {
+	if(obstacles.isEmpty() || activeBirds.empty())
+		return;
+
+	int count = activeBirds.size();
+	avoidDistances.resize(count);
+	avoidGradients.resize(count * 3);
+	obstacles.sample(&flockPoints[0], count, &avoidDistances[0], &avoidGradients[0]);
+
+	for(int i = 0; i < count; i++) {
+		if(avoidDistances[i] < OBSTACLE_AVOID_DISTANCE) {
+			double urgency = 1.0 - avoidDistances[i] / OBSTACLE_AVOID_DISTANCE;
+			activeBirds[i]->steerAway(&avoidGradients[i*3], OBSTACLE_MAX_TURN * (urgency > 1.0 ? 1.0 : urgency));
+		}
+	}
+}
+
+//The ground under every awake bird, for prepareStep's contact check. Birds
+//flying low over a slope turn downhill, away from the rising ground, the
+//same way they turn away from scenery.
+void World::followTerrain() {
+	if(terrain.isEmpty() || activeBirds.empty())
+		return;
+
+	int count = activeBirds.size();
+	groundHeights.resize(count);
+	groundNormals.resize(count * 3);
+	terrain.sample(&flockPoints[0], count, &groundHeights[0], &groundNormals[0]);
+
+	for(int i = 0; i < count; i++) {
+		activeBirds[i]->setGround(groundHeights[i]);
+		double clearance = flockPoints[i*3+1] - groundHeights[i];
+		if(!activeBirds[i]->isFalling() && clearance < OBSTACLE_AVOID_DISTANCE) {
+			double urgency = 1.0 - clearance / OBSTACLE_AVOID_DISTANCE;
+			activeBirds[i]->steerAway(&groundNormals[i*3], OBSTACLE_MAX_TURN * (urgency > 1.0 ? 1.0 : urgency));
+		}
+	}
+}
+
+//After prepareStep, which works out the rest of each bird's step context.
+//Birds woken by landings since were added on the end, only they need
+//gathering.
+void World::applyWind() {
+	if(activeBirds.empty())
+		return;
+
+	gatherFlock(flockPoints.size() / 3);
+	int count = activeBirds.size();
+	windVelocities.resize(count * 3);
+	wind.sample(&flockPoints[0], count, &windVelocities[0]);
+	for(int i = 0; i < count; i++)
+		activeBirds[i]->setDrift(&windVelocities[i*3], windStrength);
+}
+
+const DistanceField& World::getObstacles() {
+	return obstacles;
+}
+
+void World::setTerrain(const TerrainSettings& settings) {
+	terrain.create(settings);
+}
+
+bool World::hasTerrain() {
+	return !terrain.isEmpty();
+}
+
+const TerrainSettings& World::getTerrainSettings() {
+	return terrain.getSettings();
+}
+
+//Written to a temporary file and renamed over the old checkpoint at the
+//end, so a crash mid-save never leaves a broken one behind.
+bool World::saveCheckpoint(string fileName) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	string tempName = fileName + ".tmp";
+	FILE* fp = fopen(tempName.c_str(), "wb");
+	if(fp == NULL) {
+		fprintf(stderr, "Checkpoint: can't write %s\n", tempName.c_str());
+		return false;
+	}
+	setvbuf(fp, NULL, _IOFBF, 1 << 20);
+
+	CheckpointHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.version = CHECKPOINT_VERSION;
+	header.headerBytes = sizeof(CheckpointHeader);
+	header.birdBytes = sizeof(CheckpointBird);
+	header.staticBytes = sizeof(PartState);
+	header.step = stepCount;
+	header.numBirds = birds.size();
+	header.numStatics = statics.size();
+	header.birdsOffset = checkpointAlign(sizeof(CheckpointHeader));
+	header.staticsOffset = checkpointAlign(header.birdsOffset + header.numBirds * sizeof(CheckpointBird));
+	header.fileBytes = header.staticsOffset + header.numStatics * sizeof(PartState);
+
+	char padding[CHECKPOINT_ALIGN];
+	memset(padding, 0, sizeof(padding));
+	bool written = fwrite(&header, sizeof(header), 1, fp) == 1;
+	written = written && fwrite(padding, 1, header.birdsOffset - sizeof(header), fp) == header.birdsOffset - sizeof(header);
+
+	//Exported a batch at a time so the write stays streaming.
+	vector<CheckpointBird> batch;
+	batch.reserve(1024);
+	for(int i = 0; i < birds.size() && written; i += batch.size()) {
+		batch.resize(birds.size() - i < 1024 ? birds.size() - i : 1024);
+		for(int j = 0; j < batch.size(); j++) {
+			Bird* bird = birds[i + j];
+			bird->exportRecord(batch[j].record);
+			batch[j].sleepStep = bird->sleepStep;
+			batch[j].asleep = bird->asleep;
+			batch[j].reserved = 0;
+		}
+		written = fwrite(&batch[0], sizeof(CheckpointBird), batch.size(), fp) == batch.size();
+	}
+
+	unsigned long long birdsEnd = header.birdsOffset + header.numBirds * sizeof(CheckpointBird);
+	written = written && fwrite(padding, 1, header.staticsOffset - birdsEnd, fp) == header.staticsOffset - birdsEnd;
+	for(int i = 0; i < statics.size() && written; i++) {
+		PartState state;
+		statics[i]->exportState(state);
+		written = fwrite(&state, sizeof(state), 1, fp) == 1;
+	}
+
+	written = fclose(fp) == 0 && written;
+#ifdef _WIN32
+	//Windows won't rename over an existing file.
+	if(written)
+		remove(fileName.c_str());
+#endif
+	if(!written || rename(tempName.c_str(), fileName.c_str()) != 0) {
+		fprintf(stderr, "Checkpoint: failed writing %s\n", fileName.c_str());
+		remove(tempName.c_str());
+		return false;
+	}
+
+	printf("Checkpoint: saved step %llu, %llu birds (%llu bytes) to %s in %.1f ms\n",
+		header.step, header.numBirds, header.fileBytes, fileName.c_str(),
+		chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	return true;
+}
+
+//Replace every bird with the ones in the file and carry on from its step.
+//The records are used straight out of the mapping.
+bool World::restoreCheckpoint(string fileName) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	MappedFile file;
+	if(!file.open(fileName))
+		return false;
+
+	const char* base = (const char*) file.getData();
+	const CheckpointHeader* header = (const CheckpointHeader*) base;
+	if(file.getSize() < sizeof(CheckpointHeader) || memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 ||
+	   header->version != CHECKPOINT_VERSION || header->headerBytes != sizeof(CheckpointHeader) ||
+	   header->birdBytes != sizeof(CheckpointBird) || header->staticBytes != sizeof(PartState)) {
+		fprintf(stderr, "Checkpoint: %s isn't a checkpoint this build can read\n", fileName.c_str());
+		return false;
+	}
+	//Counts are checked against the room left before anything is multiplied,
+	//so a damaged header can't wrap round and pass.
+	unsigned long long fileBytes = header->fileBytes;
+	bool intact = fileBytes <= file.getSize() &&
+		header->birdsOffset >= header->headerBytes && header->birdsOffset % CHECKPOINT_ALIGN == 0 &&
+		header->birdsOffset <= fileBytes &&
+		header->numBirds <= (fileBytes - header->birdsOffset) / sizeof(CheckpointBird);
+	intact = intact && header->staticsOffset % CHECKPOINT_ALIGN == 0 &&
+		header->staticsOffset >= header->birdsOffset + header->numBirds * sizeof(CheckpointBird) &&
+		header->staticsOffset <= fileBytes &&
+		header->numStatics <= (fileBytes - header->staticsOffset) / sizeof(PartState);
+	if(!intact) {
+		fprintf(stderr, "Checkpoint: %s is truncated or damaged\n", fileName.c_str());
+		return false;
+	}
+
+	//Everything goes in one pass, then the pool and lists are sized once and
+	//each bird is built straight from its record.
+	clearBirds();
+	const CheckpointBird* saved = (const CheckpointBird*) (base + header->birdsOffset);
+	if(header->numBirds > 0)
+		Bird::reservePool(header->numBirds);
+	birds.reserve(header->numBirds);
+	activeBirds.reserve(header->numBirds);
+	for(unsigned long long i = 0; i < header->numBirds; i++) {
+		Bird* bird = adoptBird(saved[i].record);
+		if(bird->id >= nextBirdId)
+			nextBirdId = bird->id + 1;
+
+		//Back to sleep, with its timer, as sleepBird() left it.
+		if(saved[i].asleep) {
+			removeFromList(activeBirds, bird);
+			putToSleep(bird, saved[i].sleepStep);
+		}
+	}
+
+	//Scenery is rebuilt by create(), only its state comes from the file.
+	const PartState* savedStatics = (const PartState*) (base + header->staticsOffset);
+	if(header->numStatics == statics.size() && !statics.empty()) {
+		for(int i = 0; i < statics.size(); i++)
+			statics[i]->importState(savedStatics[i]);
+		Object::updateStatics(&statics[0], statics.size());
+	}
+	else {
+		fprintf(stderr, "Checkpoint: %s has different scenery, keeping ours\n", fileName.c_str());
+	}
+
+	stepCount = header->step;
+	rebuildSleepingLayer();
+	publish(0.0);
+
+	printf("Checkpoint: restored step %llu, %llu birds from %s in %.1f ms\n",
+		header->step, header->numBirds, fileName.c_str(),
+		chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	return true;
+}
+
+void World::requestCheckpoint(string fileName) {
+	lock_guard<mutex> guard(checkpointLock);
+	pendingCheckpoint = fileName;
+	checkpointRequested = true;
+}
+
+void World::setTelemetry(TelemetryRecorder* recorder) {
+	telemetry = recorder;
+}
+
+void World::setPublisher(SnapshotPublisher* snapshotPublisher) {
+	if(snapshotPublisher != NULL && hasTerrain())
+		snapshotPublisher->publishTerrain(terrain.getSettings());
+	publisher = snapshotPublisher;
+}
+
+//Called from the input thread, returns false if the queue is full.
+bool World::sendCommand(WorldCommandType type, double value) {
+	WorldCommand command;
+	command.type = type;
+	command.value = value;
+	return commands.push(command);
+}
+
+//Same rules as queued input: it wakes the bird and is ignored mid fall.
+void World::steerBirds(const unsigned int* indices, const double* angles, int count) {
+	for(int i = 0; i < count; i++) {
+		Bird* bird = birds[indices != NULL ? indices[i] : i];
+		wakeBird(bird);
+		if(!bird->isFalling())
+			bird->steerBird(angles[i]);
+	}
+}
+
+void World::fallBirds(const unsigned int* indices, const unsigned char* drops, int count) {
+	for(int i = 0; i < count; i++) {
+		Bird* bird = birds[indices != NULL ? indices[i] : i];
+		wakeBird(bird);
+		if(!bird->isFalling())
+			bird->fall(drops[i] != 0);
+	}
+}
+
+const vector<Bird*>& World::getBirds() {
+	return birds;
+}
+
+unsigned long long World::getStepCount() {
+	return stepCount;
+}
+
+//Apply queued input before stepping. Input is ignored while falling, as before.
+void World::processCommands() {
+	WorldCommand command;
+	while(commands.pop(command)) {
+		if(command.type == COMMAND_PRINT_STATS) {
+			printSimulationStats();
+			continue;
+		}
+		if(command.type == COMMAND_WIND) {
+			windStrength = command.value;
+			continue;
+		}
+		//Scripts start on the next step, they wake their birds themselves.
+		if(command.type == COMMAND_SCRIPT) {
+			for(int i = 0; i < birds.size(); i++)
+				scripts.start(birds[i], makeBirdScript((BirdScriptKind) (int) command.value, birds[i]));
+			continue;
+		}
+		//Input always wakes a bird up, the whole flock at once.
+		wakeAllBirds();
+		for(int i = 0; i < birds.size(); i++) {
+			if(birds[i]->isFalling())
+				continue;
+			if(command.type == COMMAND_STEER)
+				birds[i]->steerBird(command.value);
+			else if(command.type == COMMAND_FALL)
+				birds[i]->fall(command.value != 0.0);
+		}
+	}
+}
+
+const WorldSnapshot& World::readSnapshot() {
+	return snapshots.read();
+}
+
+const SleepingLayer& World::readSleepingLayer() {
+	return sleepingLayers.read();
+}
+
+//Call once the frame showing this snapshot has been swapped.
+void World::notePresented(const WorldSnapshot& snapshot) {
+	double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - snapshot.published).count();
+
+	latency.lastMilliseconds = milliseconds;
+	if(milliseconds > latency.maxMilliseconds)
+		latency.maxMilliseconds = milliseconds;
+	latency.framesPresented++;
+	//Running average over roughly the last hundred frames.
+	latency.averageMilliseconds += (milliseconds - latency.averageMilliseconds) / (latency.framesPresented < 100 ? latency.framesPresented : 100);
+
+	if(snapshot.step > lastPresentedStep + 1)
+		latency.stepsSkipped += snapshot.step - lastPresentedStep - 1;
+	lastPresentedStep = snapshot.step;
+	lastStepMilliseconds = snapshot.stepMilliseconds;
+	lastActiveBirds = snapshot.activeBirds;
+	lastSleepingBirds = snapshot.sleepingBirds;
+}
+
+unsigned long long World::getChangeCount() {
+	return changeCount.load();
+}
+
+void World::printStats() {
+	printf("Simulation: step %llu took %.3f ms (%u birds awake, %u asleep), %llu steps never shown\n",
+		lastPresentedStep, lastStepMilliseconds, lastActiveBirds, lastSleepingBirds, latency.stepsSkipped);
+	printf("Latency (step to swap): last %.2f ms, average %.2f ms, max %.2f ms\n",
+		latency.lastMilliseconds, latency.averageMilliseconds, latency.maxMilliseconds);
+	sendCommand(COMMAND_PRINT_STATS, 0.0);
+}
+
+//Simulation thread, everything here changes as it steps.
+void World::printSimulationStats() {
+	obstacles.printStats();
+	terrain.printStats();
+	wind.printStats();
+	scripts.printStats();
+	Bird::printPoolStats();
+}
@@ -0,0 +1,127 @@
+#include "include/flocksim.h"
+#include "include/World.h"
+#include "include/RandomRange.h"
+#include <stdlib.h>
+
+static_assert(sizeof(bool) == 1, "falling flags are viewed as bytes");
+
+struct flocksim_world
+{
+	World* world;
+};
+
+flocksim_world* flocksim_create(unsigned int numBirds, unsigned int seed) {
+	flocksim_world* handle = new flocksim_world;
+	handle->world = new World(true);
+
+	//One slab per pool for the lot, so every view has a single stride. A
+	//world destroyed before leaves its slabs free, and they're used again.
+	Bird::reservePool(numBirds);
+
+	srand(seed);
+	for(unsigned int i = 0; i < numBirds; i++) {
+		double x = randomRange(-WORLD_HALF_SIZE, WORLD_HALF_SIZE);
+		double y = randomRange(-1.0, 1.5);
+		double z = randomRange(-WORLD_HALF_SIZE, WORLD_HALF_SIZE);
+		handle->world->spawnBird(x, y, z);
+	}
+	return handle;
+}
+
+void flocksim_destroy(flocksim_world* handle) {
+	if(handle == NULL)
+		return;
+	delete handle->world;
+	delete handle;
+}
+
+void flocksim_step(flocksim_world* handle, unsigned int steps) {
+	for(unsigned int i = 0; i < steps && handle != NULL; i++)
+		handle->world->step();
+}
+
+unsigned long long flocksim_step_count(flocksim_world* handle) {
+	return handle != NULL ? handle->world->getStepCount() : 0;
+}
+
+unsigned int flocksim_num_birds(flocksim_world* handle) {
+	return handle != NULL ? handle->world->numBirds() : 0;
+}
+
+//Fill in a view of one field, given where it is for every bird. Only a view
+//that really has one stride all the way through is handed out.
+template <class Field>
+static int makeView(flocksim_world* handle, flocksim_view* view, Field field, size_t components, int type) {
+	if(handle == NULL || view == NULL)
+		return FLOCKSIM_ERROR_ARGUMENT;
+
+	const vector<Bird*>& birds = handle->world->getBirds();
+	view->count = birds.size();
+	view->components = components;
+	view->type = type;
+	view->data = NULL;
+	view->stride = 0;
+	if(birds.empty())
+		return FLOCKSIM_OK;
+
+	const char* first = (const char*) field(birds[0]);
+	ptrdiff_t stride = birds.size() > 1 ? (const char*) field(birds[1]) - first : 0;
+	for(int i = 2; i < birds.size(); i++) {
+		if((const char*) field(birds[i]) != first + i * stride)
+			return FLOCKSIM_ERROR_LAYOUT;
+	}
+
+	view->data = (void*) first;
+	view->stride = stride;
+	return FLOCKSIM_OK;
+}
+
+static const void* birdPosition(Bird* bird)	{ return bird->getPart(KIND_BIRD_BODY)->getTranslation();		}
+static const void* birdHeading(Bird* bird)	{ return &bird->getPart(KIND_BIRD_BODY)->getRotation()[1];		}
+static const void* birdFalling(Bird* bird)	{ return bird->getFallingFlag();								}
+
+int flocksim_positions(flocksim_world* handle, flocksim_view* view) {
+	return makeView(handle, view, birdPosition, 3, FLOCKSIM_FLOAT64);
+}
+
+int flocksim_headings(flocksim_world* handle, flocksim_view* view) {
+	return makeView(handle, view, birdHeading, 1, FLOCKSIM_FLOAT64);
+}
+
+int flocksim_falling(flocksim_world* handle, flocksim_view* view) {
+	return makeView(handle, view, birdFalling, 1, FLOCKSIM_UINT8);
+}
+
+static bool indicesValid(flocksim_world* handle, const unsigned int* indices, size_t count) {
+	size_t numBirds = handle->world->numBirds();
+	if(indices == NULL)
+		return count <= numBirds;
+	for(size_t i = 0; i < count; i++) {
+		if(indices[i] >= numBirds)
+			return false;
+	}
+	return true;
+}
+
+int flocksim_steer(flocksim_world* handle, const unsigned int* indices, const double* angles, size_t count) {
+	if(handle == NULL || (angles == NULL && count > 0) || !indicesValid(handle, indices, count))
+		return FLOCKSIM_ERROR_ARGUMENT;
+	handle->world->steerBirds(indices, angles, count);
+	return FLOCKSIM_OK;
+}
+
+int flocksim_fall(flocksim_world* handle, const unsigned int* indices, const unsigned char* drops, size_t count) {
+	if(handle == NULL || (drops == NULL && count > 0) || !indicesValid(handle, indices, count))
+		return FLOCKSIM_ERROR_ARGUMENT;
+	handle->world->fallBirds(indices, drops, count);
+	return FLOCKSIM_OK;
+}
+
+const char* flocksim_error_string(int result) {
+	switch(result) {
+	case FLOCKSIM_OK:				return "ok";
+	case FLOCKSIM_ERROR_ARGUMENT:	return "bad argument";
+	case FLOCKSIM_ERROR_LAYOUT:		return "birds are not evenly spaced in memory";
+	}
+	return "unknown error";
+}
@@ -0,0 +1,64 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+#include "include/MemoryStats.h"
+
+using namespace std;
+
+//Counters for one arena, bytes are what was handed out, not what's reserved.
+struct ArenaStats
+{
+	unsigned long long allocations;
+	unsigned long long bytesAllocated;
+	size_t bytesReserved;
+	size_t peakBytesInUse;
+	unsigned int blocks;
+	unsigned int resets;
+};
+
+//A bump allocator for scratch memory with a clear lifetime (one file load,
+//one level, one frame). Allocating is a pointer bump, nothing is freed on its
+//own, reset() throws everything away at once but keeps the blocks for reuse.
+//Not thread safe, give each thread its own.
+class Arena
+{
+
+	public:
+
+		Arena(size_t blockSize = 1024 * 1024);
+		~Arena();
+
+		void* alloc(size_t bytes, size_t alignment = sizeof(double));
+
+		template <class T>
+		T* alloc(size_t count) { return (T*) alloc(count * sizeof(T), sizeof(T) < sizeof(double) ? sizeof(T) : sizeof(double)); }
+
+		void reset();
+
+		const ArenaStats& getStats();
+		void printStats(const char* name);
+
+	private:
+
+		struct Block
+		{
+			char* memory;
+			size_t size;
+		};
+
+		vector<Block> blocks;
+		size_t currentBlock;
+		size_t used;
+		size_t blockSize;
+
+		//Bytes used in blocks before currentBlock, for the peak figure.
+		size_t usedInEarlierBlocks;
+
+		ArenaStats stats;
+
+};
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include "include/Mesh.h"
+#include "include/GeometryPool.h"
+#include "include/Texture.h"
+#include <map>
+#include <deque>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+//What the loader did during the last drainUploads().
+struct AssetStats
+{
+	unsigned int meshesQueued;		//still waiting for a worker
+	unsigned int meshesPending;		//parsed, waiting on the GPU
+	unsigned int meshesCompleted;	//finished this frame
+	GLuint bytesUploaded;
+	double uploadMilliseconds;
+
+	unsigned int meshesParsed;		//since start
+	size_t scratchPeakBytes;		//most scratch one file has needed
+
+	unsigned int texturesQueued;
+	unsigned int texturesPending;
+	unsigned int texturesCompleted;
+	unsigned int texturesResident;
+	size_t textureResidentBytes;	//on the GPU
+	size_t textureMappedBytes;		//caches mapped, waiting to go up
+	unsigned int texturesTranscoded;	//since start, sources that weren't cached yet
+	unsigned int texturesEvicted;		//since start
+};
+
+//Textures kept on the GPU, and cache files mapped waiting to go up, before
+//the loader holds back. Textures drawn in the last frame are never evicted.
+//A cache's size is only known once it's mapped, so each worker may take the
+//mapped total over by one.
+#define TEXTURE_RESIDENT_BUDGET (64 * 1024 * 1024)
+#define TEXTURE_MAPPED_BUDGET (16 * 1024 * 1024)
+
+//Loads meshes and textures in the background. Worker threads read and
+//process files, then the render thread drains finished ones onto the GPU a
+//little each frame, bounded by a byte and time budget. Until a mesh is ready,
+//objects draw the placeholder instead, and until a texture is, plain white.
+//
+//Workers only map another texture cache while what's already mapped is
+//under budget, and textures nobody has drawn lately are evicted once the
+//ones on the GPU go over theirs, to be loaded again from the cache if
+//they're wanted.
+class AssetLoader
+{
+
+	public:
+
+		AssetLoader();
+		~AssetLoader();
+
+		void start(int numWorkers);
+		void stop();
+
+		//Returns the (possibly not yet loaded) mesh for a file, each file is
+		//only ever loaded once.
+		Mesh* requestMesh(string fileName);
+		Mesh* getPlaceholder();
+		//A mesh built in memory (see Mesh::createFromArrays) goes up with the
+		//loaded ones, in the same budget. It stays the caller's, and goes
+		//back through releaseMesh() whether it's been uploaded yet or not.
+		void submitMesh(Mesh* mesh);
+		void releaseMesh(Mesh* mesh);
+
+		//The same for a texture's source image.
+		Texture* requestTexture(string fileName);
+		//Render thread, what to bind for a texture this frame (white for none
+		//or one still loading). Counts as using it, and brings back an
+		//evicted one.
+		GLuint useTexture(Texture* texture);
+		GLuint getWhiteTexture();
+		void setTextureBudget(size_t residentBytes, size_t mappedBytes);
+
+		//Every uploaded mesh lives in here.
+		GeometryPool& getGeometry();
+
+		//Per-frame upload budget, the time budget is in milliseconds.
+		void setUploadBudget(GLuint bytesPerFrame, double millisecondsPerFrame);
+
+		//Render thread only, uploads what the budget allows.
+		void drainUploads();
+
+		//Blocks until everything requested so far is ready (for tools and tests).
+		void finishAll();
+
+		const AssetStats& getStats();
+		void printStats();
+
+	private:
+
+		void workerLoop();
+		void queueTexture(Texture* texture);
+		void evictTextures();
+
+		//Declared first so it outlives the meshes deleted in the destructor.
+		GeometryPool geometry;
+		void noteScratch(Arena& scratch);
+
+		map<string, Mesh*> meshes;
+		Mesh* placeholder;
+
+		map<string, Texture*> textures;
+		GLuint whiteTexture;
+		size_t textureResidentBudget;
+		size_t textureMappedBudget;
+		//Frames drained so far, what textures' lastUsed is counted in.
+		unsigned long long frame;
+
+		vector<thread> workers;
+		mutex queueLock;
+		condition_variable queueSignal;
+		bool stopping;
+
+		//Meshes waiting to be parsed, and parsed meshes waiting to upload.
+		deque<Mesh*> parseQueue;
+		deque<Mesh*> uploadQueue;
+		//The same for textures, with the bytes of the caches mapped so far.
+		deque<Texture*> textureQueue;
+		deque<Texture*> textureUploadQueue;
+		size_t mappedBytes;
+
+		GLuint uploadByteBudget;
+		double uploadTimeBudget;
+
+		AssetStats stats;
+
+		//Scratch for files parsed on the calling thread when there are no workers.
+		Arena inlineScratch;
+
+};
+
+//The one loader shared by everything that needs a mesh or texture.
+extern AssetLoader assetLoader;
+
+#endif
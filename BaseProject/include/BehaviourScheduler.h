@@ -0,0 +1,99 @@
+#ifndef BEHAVIOURSCHEDULER_H
+#define BEHAVIOURSCHEDULER_H
+
+#include <stdio.h>
+#include "include/BirdScript.h"
+#include "include/TimerWheel.h"
+#include <vector>
+
+using namespace std;
+
+//A bird flying somewhere is checked again once it could have got there at
+//its current speed, but at least this often in case it's been blown or
+//turned off course. Speeds below the minimum count as the minimum.
+#define SCRIPT_REAIM_STEPS 32
+#define SCRIPT_MIN_SPEED 0.005
+
+//What the last run() did.
+struct ScriptStats
+{
+	unsigned int scripts;
+	unsigned int pendingTimers;
+	unsigned int resumed;
+	unsigned int rechecked;		//flying birds checked and sent on again
+	unsigned int stale;			//timers outlived by their wait
+	unsigned long long totalResumed;
+	double runMilliseconds;
+};
+
+//Runs every bird's behaviour script, one step at a time. A script suspended
+//on a timer sits in a timer wheel, one waiting on an event is only looked
+//at when that event is signalled for its bird, and one flying somewhere is
+//put on a timer for when it could first have arrived. So a step only costs
+//for the scripts actually due, however many birds have one.
+//Scripts can't be saved with a checkpoint. Simulation thread only.
+class BehaviourScheduler
+{
+
+	public:
+
+		BehaviourScheduler();
+		~BehaviourScheduler();
+
+		//The bird's script from the next run() on, replacing any it had.
+		void start(Bird* bird, BirdScript script);
+		void cancel(Bird* bird);
+		void cancelAll();
+
+		//Something happened to a bird, wakes its script if waiting on it.
+		void signal(Bird* bird, ScriptEvent event);
+
+		//One step. Every bird a script acted on is added to acted, the world
+		//needs to wake it if it was asleep.
+		void run(vector<Bird*>& acted);
+
+		//From a script's co_await. False if there's nothing to wait for.
+		bool suspend(unsigned int slot, ScriptWait& wait);
+
+		unsigned int numScripts()		{ return stats.scripts; }
+		const ScriptStats& getStats();
+		void printStats();
+
+	private:
+
+		//A started script. Tags go up every time a script suspends or the
+		//slot is freed, so timers and ready entries left over from an older
+		//wait are told apart.
+		struct ScriptSlot
+		{
+			BirdScript::Handle handle;
+			Bird* bird;
+			unsigned int tag;
+			ScriptWaitType waiting;
+			ScriptEvent event;
+			double target[2];
+			double radius;
+			unsigned int nextFree;
+		};
+
+		void resume(unsigned int slot);
+		void release(unsigned int slot);
+		bool reached(ScriptSlot& script);
+		void headFor(unsigned int slot);
+
+		vector<ScriptSlot> slots;
+		//Free slots plus one, 0 for none.
+		unsigned int freeSlots;
+
+		TimerWheel timers;
+		vector<TimerEntry> fired;
+		//Started or signalled scripts, run at the next run().
+		vector<TimerEntry> ready;
+		vector<TimerEntry> resuming;
+		vector<Bird*>* acting;
+
+		ScriptStats stats;
+
+};
+
+#endif
@@ -1,45 +1,145 @@
 #ifndef BIRD_H
-#define BIRD
+#define BIRD_H
 
 #include <stdio.h>
 #include <GL/glew.h>
 #include <GL/glut.h>
 #define _USE_MATH_DEFINES
 #include "include/object.h"
+#include "include/Pool.h"
 #include <math.h>
 #include <vector>
 
 using namespace std;
 
+//The image every bird's parts are drawn with.
+#define BIRD_TEXTURE "textures/feathers.tga"
+
+//Snapshot entries a bird writes, one for each of its parts.
+#define BIRD_SNAPSHOT_ENTRIES (NUM_ENTITY_KINDS - FIRST_BIRD_KIND)
+
+//A whole bird as plain data, for handing it to another process. Parts are
+//indexed by kind, the static slot is unused.
+struct BirdRecord
+{
+	PartState parts[NUM_ENTITY_KINDS];
+	double flyingBounds[3];
+	double flapPhase;
+	double flapFrequency;
+	double flapAmplitude;
+	int falling;
+	int staticDrop;
+	unsigned int id;
+	//The ground under the bird when it last looked, so one crashed on it
+	//carries on following the terrain wherever it's picked up again.
+	int groundSampled;
+	double groundHeight;
+};
+
 class Bird
 {
 
 	public:
 		
+		//Birds are pooled, use these rather than new/delete.
+		static Bird* create(double locationX, double locationY, double locationZ, double flyingBounds[]);
+		//Straight from a record, exactly as it was exported.
+		static Bird* create(const BirdRecord& record);
+		static void destroy(Bird* bird);
+		static void printPoolStats();
+		//Birds (and their parts) from the next count creates sit one after
+		//the other in memory, see Pool::reserve.
+		static void reservePool(unsigned int count);
+
 		Bird(double locationX, double locationY, double locationZ, double flyingBounds[]);
+		Bird(const BirdRecord& record);
 		~Bird();
 
-		void updateObjectDisplays(MatrixStack projectionStack);
+		void setupRendering();
+
+		//Bird level half of a step: ground contact and the context every part
+		//is updated with. Returns true on the step the bird reaches the ground.
+		bool prepareStep();
+		const StepContext& getStepContext();
+		Object* getPart(EntityKind kind);
+		void writeSnapshot(vector<SnapshotEntry>& entries);
 		void fall(bool drop);
 		void steerBird(double angle);
+		//Face a point on the ground plan straight away.
+		void steerTowards(double x, double z);
+		//Keep turning by this many degrees a step, 0 to fly straight.
+		void setTurnRate(double degreesPerStep);
+		//Turn by up to maxTurn degrees towards away (a world space direction,
+		//only its horizontal part counts), unless already heading that way.
+		void steerAway(const float* away, double maxTurn);
+		//Wind velocity for this step, scaled to a distance. Anything that
+		//would carry the bird out of its flying bounds is dropped.
+		void setDrift(const float* velocity, double scale);
 
 		bool isFalling();
+		//Where the flag lives, for views over the simulation's own memory.
+		const bool* getFallingFlag();
+
+		//Height of the ground under the bird for this step, from the World's
+		//terrain. Without one it's the bottom of the flying bounds.
+		void setGround(double height);
+
+		//A crashed bird that has come to rest, nothing changes until its
+		//crash timer runs out so it can be put to sleep.
+		bool isSettled();
+		double crashStepsLeft();
+		void wake(double stepsAsleep);
+		double* getCentre();
+
+		void exportRecord(BirdRecord& record);
+		void importRecord(const BirdRecord& record);
+
+		//Unique within a run, kept when a bird moves between processes.
+		unsigned int id;
+
+		//Activity bookkeeping, owned by the World: where the bird is in its
+		//lists, and while it's asleep which sleep its wake timer is for and
+		//where it is in the contact grid.
+		bool asleep;
+		unsigned long long sleepStep;
+		unsigned int worldIndex;
+		unsigned int listIndex;
+		unsigned long long sleepSerial;
+		unsigned long long contactCell;
+		unsigned int contactIndex;
+		//Behaviour script slot plus one, 0 for none. Owned by the World's
+		//BehaviourScheduler.
+		unsigned int script;
 
 	private:
 
+		//Body parts, drawn and moved together. Indexed by kind, the static
+		//slot is unused.
+		Object* parts[NUM_ENTITY_KINDS];
+		StepContext stepContext;
+
+		void createParts();
 		void setupBirdSkeleton();
-		void wingMovement();
 		bool withinBounds();
 		
 		bool falling;
 		bool staticDrop;
 		double flyingBounds[3];
+		double groundHeight;
+		//False until the first setGround(), there's nothing to follow before.
+		bool groundSampled;
 		
-		double birdCentre[3];
 		double birdStartLocationX;
 		double birdStartLocationY;
 		double birdStartLocationZ;
 
+		static Pool<Bird> pool;
+
+		//Wing flap, animated on the GPU.
+		double flapPhase;
+		double flapFrequency;
+		double flapAmplitude;
+
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,101 @@
+#ifndef BIRDSCRIPT_H
+#define BIRDSCRIPT_H
+
+#include <stdio.h>
+#include <coroutine>
+#include <exception>
+
+using namespace std;
+
+class Bird;
+class BehaviourScheduler;
+
+//What a suspended script is waiting for.
+enum ScriptWaitType
+{
+	SCRIPT_WAIT_NONE,
+	SCRIPT_WAIT_STEPS,	//a number of simulation steps
+	SCRIPT_WAIT_REACH,	//the bird getting near a point
+	SCRIPT_WAIT_EVENT	//something happening to the bird
+};
+
+//Things that happen to a bird which a script can wait on.
+enum ScriptEvent
+{
+	SCRIPT_EVENT_LANDED,	//reached the ground
+	SCRIPT_EVENT_WOKEN		//woke up after resting
+};
+
+//A bird's behaviour written as a coroutine, suspending across simulation
+//steps at each co_await (see BirdScripts.h for the ones we have). Scripts
+//are run by a BehaviourScheduler, which owns them once started and only
+//resumes one when what it's waiting for has happened.
+class BirdScript
+{
+
+	public:
+
+		struct promise_type
+		{
+			BehaviourScheduler* scheduler;
+			Bird* bird;
+			unsigned int slot;
+
+			BirdScript get_return_object();
+			//Nothing runs until the scheduler first resumes it.
+			suspend_always initial_suspend() noexcept	{ return suspend_always(); }
+			//Kept around once finished so the scheduler can see it's done.
+			suspend_always final_suspend() noexcept		{ return suspend_always(); }
+			void return_void()							{}
+			void unhandled_exception()					{ terminate(); }
+		};
+
+		typedef coroutine_handle<promise_type> Handle;
+
+		BirdScript();
+		explicit BirdScript(Handle scriptHandle);
+		BirdScript(BirdScript&& other);
+		BirdScript& operator=(BirdScript&& other);
+		BirdScript(const BirdScript&) = delete;
+		BirdScript& operator=(const BirdScript&) = delete;
+		~BirdScript();
+
+		//Hand the coroutine over, the script no longer owns it.
+		Handle release();
+		bool isValid()			{ return (bool) handle; }
+
+	private:
+
+		Handle handle;
+
+};
+
+//Awaited from inside a script: an optional action on the bird followed by
+//a wait. Made by the functions below rather than directly.
+struct ScriptWait
+{
+	ScriptWaitType type;
+	unsigned long long steps;
+	ScriptEvent event;
+	double target[2];		//x and z, heights aren't steered
+	double radius;
+	double turnRate;		//degrees a step to circle at while waiting
+	bool dive;
+	Bird* bird;
+
+	bool await_ready()		{ return type == SCRIPT_WAIT_NONE; }
+	//Doesn't suspend if the wait is already over.
+	bool await_suspend(BirdScript::Handle script);
+	void await_resume();
+};
+
+ScriptWait waitSteps(unsigned long long steps);
+ScriptWait waitFor(ScriptEvent event);
+//Head for a point and keep heading for it until within radius.
+ScriptWait flyTo(double x, double z, double radius);
+//Fly round in a circle for a number of full turns.
+ScriptWait circle(double turns, double degreesPerStep);
+//Drop out of the sky and wait to hit the ground.
+ScriptWait dive();
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef BIRDSCRIPTS_H
+#define BIRDSCRIPTS_H
+
+#include <stdio.h>
+#include "include/BirdScript.h"
+#include "include/Bird.h"
+
+//The behaviours a bird can be given (see COMMAND_SCRIPT).
+enum BirdScriptKind
+{
+	SCRIPT_NONE,	//no script, the bird just flies
+	SCRIPT_PATROL,	//fly somewhere, circle three times, dive and go again
+	SCRIPT_WANDER,	//drift from one spot to the next, pausing between
+	NUM_SCRIPT_KINDS
+};
+
+//Places are picked within this of the middle, clear of the fences.
+#define SCRIPT_RANGE 1.5
+//Circling speed, degrees a step.
+#define SCRIPT_CIRCLE_RATE 4.0
+
+//Every bird picks its own places, starting from its id.
+BirdScript patrolScript(Bird* bird, unsigned int seed);
+BirdScript wanderScript(Bird* bird, unsigned int seed);
+
+//An empty script for SCRIPT_NONE.
+BirdScript makeBirdScript(BirdScriptKind kind, Bird* bird);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef CAMERARIG_H
+#define CAMERARIG_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include "include/World.h"
+#include "include/MatrixStack.h"
+#include "include/RenderQueue.h"
+
+using namespace std;
+
+//What each camera looks at.
+enum CameraMode
+{
+	CAMERA_ORBIT,	//round the arena, turned by hand
+	CAMERA_CHASE,	//behind the first bird in the snapshot
+	CAMERA_TOP,		//straight down over the arena
+	NUM_CAMERA_MODES
+};
+
+//Lens shared by every camera.
+#define CAMERA_FOV 75.0
+#define CAMERA_NEAR 0.1
+#define CAMERA_FAR 25.0
+
+//How far behind and above its bird the chase camera sits, and the height
+//the top-down camera looks down from.
+#define CHASE_DISTANCE 1.2
+#define CHASE_HEIGHT 0.4
+#define TOP_HEIGHT 4.0
+
+//The cameras on screen at once, the first so many modes in order. One fills
+//the render target, otherwise the orbit camera takes the left half and the
+//others share the right. The first camera is the main one: lighting is
+//clustered for it and anything drawn outside the render queue goes in it.
+class CameraRig
+{
+
+	public:
+
+		CameraRig();
+		~CameraRig();
+
+		//Between 1 and NUM_CAMERA_MODES.
+		void setNumViews(int count);
+		int getNumViews();
+
+		//Place this frame's cameras in a render target of the given size.
+		void update(double orbitAngle, const WorldSnapshot& snapshot, int width, int height);
+
+		const RenderView* getViews();
+		//The camera alone without its projection, and its lens shape.
+		const GLdouble* getViewMatrix(int index);
+		double getAspect(int index);
+		//Where the camera is in the world, xyz.
+		const GLdouble* getEye(int index);
+
+	private:
+
+		void place(int index, CameraMode mode, double orbitAngle, GLint x, GLint y, GLint width, GLint height);
+		void follow(const WorldSnapshot& snapshot);
+
+		int numViews;
+		RenderView views[MAX_VIEWS];
+		GLdouble viewMatrices[MAX_VIEWS][16];
+		GLdouble eyes[MAX_VIEWS][3];
+		double aspects[MAX_VIEWS];
+
+		//Where the chased bird was last seen and which way it was heading
+		//along the ground, kept while there's no bird to follow.
+		double chaseTarget[3];
+		double chaseHeading[2];
+
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "include/Bird.h"
+#include "include/object.h"
+
+//The checkpoint file is the simulation state laid out flat, exactly as it
+//sits in memory:
+//
+//	CheckpointHeader | CheckpointBird * numBirds | PartState * numStatics
+//
+//Every section starts on a CHECKPOINT_ALIGN boundary. Restoring maps the
+//file and copies the records straight back into the pools, nothing is
+//parsed. The sizes in the header catch a file from a build with a
+//different layout, files are native endian.
+
+#define CHECKPOINT_MAGIC "FLOCKCKP"
+#define CHECKPOINT_VERSION 3
+#define CHECKPOINT_ALIGN 64
+
+struct CheckpointHeader
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int headerBytes;
+	unsigned int birdBytes;
+	unsigned int staticBytes;
+
+	unsigned long long step;
+	unsigned long long numBirds;
+	unsigned long long numStatics;
+
+	unsigned long long birdsOffset;
+	unsigned long long staticsOffset;
+	unsigned long long fileBytes;
+};
+
+//One bird and whether the World had it asleep.
+struct CheckpointBird
+{
+	BirdRecord record;
+	unsigned long long sleepStep;
+	int asleep;
+	int reserved;
+};
+
+inline unsigned long long checkpointAlign(unsigned long long offset) {
+	return (offset + CHECKPOINT_ALIGN - 1) & ~(unsigned long long) (CHECKPOINT_ALIGN - 1);
+}
+
+#endif
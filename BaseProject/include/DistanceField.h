@@ -0,0 +1,76 @@
+#ifndef DISTANCEFIELD_H
+#define DISTANCEFIELD_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "include/MemoryStats.h"
+#include <vector>
+#include <atomic>
+
+using namespace std;
+
+//Cells along each side of a brick, and the samples a brick holds (its
+//corners are shared with the next brick over, so a lookup never needs two).
+#define DISTANCE_BRICK_CELLS 8
+#define DISTANCE_BRICK_SIDE (DISTANCE_BRICK_CELLS + 1)
+#define DISTANCE_BRICK_SAMPLES (DISTANCE_BRICK_SIDE * DISTANCE_BRICK_SIDE * DISTANCE_BRICK_SIDE)
+
+//Signed distance to a set of triangles on a regular grid, negative inside
+//anything the triangles close off and positive everywhere else. Distances are clamped to +-truncation, and only
+//bricks with something closer than that are stored; every other brick
+//points at one of two shared bricks holding +-truncation, so a lookup is
+//the same handful of loads wherever it lands. Samples are 16 bit.
+//Baking is slow and done once, sampling is a few nanoseconds a point no
+//matter how many triangles went in.
+class DistanceField
+{
+
+	public:
+
+		DistanceField();
+		~DistanceField();
+
+		//Triangles are world space xyz, three corners each. Bakes bricks on
+		//numThreads threads and replaces anything baked before.
+		void bake(const vector<float>& triangles, float voxelSize, float truncation, int numThreads);
+		void clear();
+		bool isEmpty();
+
+		//Distance and gradient at count points, xyz each. Gradients are xyz
+		//each and zero where the field is at its truncation. Anything outside
+		//the baked region reads as +truncation. Safe from any thread.
+		void sample(const float* points, int count, float* distances, float* gradients) const;
+
+		float getTruncation();
+		int numBricks();
+		int numStoredBricks();
+		size_t numBytes();
+		void printStats();
+
+	private:
+
+		void bakeBricks(const vector<float>& triangles, const vector<float>& bounds, vector<float>& distances, atomic<int>& nextBrick);
+		void bakeBrick(int brick, const vector<float>& triangles, const vector<float>& bounds, vector<float>& distances);
+		void applySigns(vector<float>& distances);
+		void packBricks(const vector<float>& distances);
+		int gridIndex(int x, int y, int z) const;
+		void sampleOne(const float* point, float* distance, float* gradient) const;
+		void sampleFour(const float* points, float* distances, float* gradients) const;
+
+		float origin[3];
+		float voxelSize;
+		float inverseVoxelSize;
+		float truncation;
+		int bricks[3];
+		int cells[3];
+
+		//Offset into samples for every brick, x fastest. The first two
+		//bricks in samples are the shared outside and inside ones.
+		vector<int> brickOffsets;
+		vector<short> samples;
+
+		double bakeMilliseconds;
+
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include <chrono>
+
+using namespace std;
+
+//Smallest fraction of the window (along each side) the scene is rendered at.
+#define RESOLUTION_MIN_SCALE 0.5
+
+//Render sizes are kept to multiples of this many pixels, so tiny changes in
+//frame time don't resize the image every frame.
+#define RESOLUTION_GRANULARITY 8
+
+//Frame time smoothing (fraction of each new frame taken in), how far under
+//the target it has to be before detail comes back, and how much of the way
+//to the ideal scale each adjustment goes.
+#define RESOLUTION_SMOOTHING 0.1
+#define RESOLUTION_DEADBAND 0.08
+#define RESOLUTION_GAIN 0.5
+
+//Timer queries in flight. Results are read back this many frames late,
+//which is also how long the controller waits after a change to see its effect.
+#define RESOLUTION_QUERIES 4
+
+//Once the scale is at its minimum the shading LOD bias takes over, a step at
+//a time. At bias 0 everything nearer than LOD_SHADING_FAR gets full per-pixel
+//lighting, at bias 1 only what's nearer than LOD_SHADING_NEAR does.
+#define LOD_BIAS_STEP 0.1
+#define LOD_SHADING_NEAR 3.0
+#define LOD_SHADING_FAR 25.0
+
+//What the controller measured and decided.
+struct ResolutionStats
+{
+	double frameMilliseconds;	//smoothed, what the controller steers on
+	double lastMilliseconds;
+	bool gpuTimed;				//from timer queries rather than CPU time spent on the frame
+
+	double scale;
+	double lodBias;
+	int renderWidth;
+	int renderHeight;
+
+	unsigned long long frames;
+	unsigned long long framesOverTarget;
+	unsigned long long scaleChanges;
+	unsigned long long lodChanges;
+};
+
+//Holds a frame time target by rendering the scene into an offscreen buffer
+//at a fraction of the window size and scaling it up, and past the smallest
+//size by shading distant objects more cheaply. Frame time comes from GPU
+//timer queries where the driver has them, otherwise from the wall time between
+//beginFrame() and endFrame() (not between frames, which includes pacing).
+//Render thread only.
+class DynamicResolution
+{
+
+	public:
+
+		DynamicResolution();
+		~DynamicResolution();
+
+		//Needs a GL context. Returns false (and renders straight to the window)
+		//if the offscreen buffer can't be made.
+		bool create(int width, int height);
+		void resize(int width, int height);
+
+		void setTarget(double milliseconds);
+		void setEnabled(bool enabled);
+		bool isEnabled();
+
+		//Everything drawn between these goes into the scaled down buffer,
+		//endFrame() scales it up to the window and feeds the controller.
+		void beginFrame();
+		void endFrame();
+
+		double getScale()					{ return stats.scale; }
+		double getLodBias()					{ return stats.lodBias; }
+
+		//View depth beyond which objects get the cheaper shading.
+		double getShadingDistance();
+
+		const ResolutionStats& getStats();
+		void printStats();
+
+	private:
+
+		void allocateTargets();
+		void releaseTargets();
+		bool readTimings(double* milliseconds);
+		void control(double milliseconds);
+		void updateRenderSize();
+
+		bool enabled;
+		bool created;
+		double target;
+
+		int width;
+		int height;
+
+		GLuint framebuffer;
+		GLuint colorBuffer;
+		GLuint depthBuffer;
+
+		//Ring of timer queries, one per frame. Only read once available, so
+		//checking on them never stalls the pipeline.
+		GLuint queries[RESOLUTION_QUERIES];
+		bool queryPending[RESOLUTION_QUERIES];
+		int nextQuery;
+		bool timerQueries;
+
+		chrono::steady_clock::time_point frameStart;
+
+		int framesSinceChange;
+		ResolutionStats stats;
+
+};
+
+#endif
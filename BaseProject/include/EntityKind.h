@@ -0,0 +1,52 @@
+#ifndef ENTITYKIND_H
+#define ENTITYKIND_H
+
+//What an object is, decided once when it's made. Behaviour is picked from
+//this (see KindTraits) rather than from the object's name.
+enum EntityKind
+{
+	KIND_STATIC,
+	KIND_BIRD_BODY,
+	KIND_BIRD_HEAD,
+	KIND_WING_LEFT,
+	KIND_WING_RIGHT,
+	NUM_ENTITY_KINDS
+};
+
+#define FIRST_BIRD_KIND KIND_BIRD_BODY
+
+//Per-kind constants. Every part of a bird steps the same way (see
+//Object::updateBirds), what differs by kind is only how it's drawn.
+template <EntityKind K>
+struct KindTraits
+{
+	//Wing hinge side for the procedural flap, 0 for no flap.
+	static const int flapSide = 0;
+};
+
+template <>
+struct KindTraits<KIND_WING_LEFT>
+{
+	static const int flapSide = -1;
+};
+
+template <>
+struct KindTraits<KIND_WING_RIGHT>
+{
+	static const int flapSide = 1;
+};
+
+//The owning bird's state for this step, worked out once per bird and
+//shared by all of its parts.
+struct StepContext
+{
+	bool falling;
+	bool reachedTop;
+	bool staticDrop;
+	bool inBounds;
+	double centre[3];
+	//How far the wind carries the bird this step.
+	double drift[3];
+};
+
+#endif
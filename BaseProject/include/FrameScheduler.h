@@ -0,0 +1,99 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include <chrono>
+
+using namespace std;
+
+//Frames remembered for the timing stats.
+#define FRAME_HISTORY 120
+
+//The last stretch before a frame is due is spent yielding rather than
+//sleeping, sleeps can overshoot by a millisecond or more.
+#define FRAME_SPIN_MILLISECONDS 1.5
+
+//Frame times over the last FRAME_HISTORY frames.
+struct FrameStats
+{
+	double averageMilliseconds;		//between presents
+	double jitterMilliseconds;		//standard deviation of the above
+	double worstMilliseconds;
+	double renderCpuMilliseconds;	//render thread CPU time per frame
+	double processCpuPercent;		//whole process, one core is 100
+
+	unsigned long long framesRendered;
+	unsigned long long framesSkipped;	//due but nothing had changed
+	unsigned long long framesLate;		//over one and a half intervals apart
+};
+
+//Paces rendering at a target rate from a GLUT timer instead of redrawing
+//from the idle callback, sleeping between frames rather than spinning.
+//In on-demand mode a due frame is only drawn if something asked for it or
+//the change check says the picture would be different.
+//Render thread only, there's one active scheduler.
+class FrameScheduler
+{
+
+	public:
+
+		FrameScheduler();
+		~FrameScheduler();
+
+		//Starts the timer, GLUT must have a window.
+		void start(double framesPerSecond);
+
+		void setRate(double framesPerSecond);
+		void setOnDemand(bool onDemand);
+		bool isOnDemand();
+
+		//Polled once per due frame in on-demand mode, true if there's
+		//anything new to draw.
+		void setChangeCheck(bool (*check)());
+
+		//Draw the next due frame whatever the mode (input, resize, ...).
+		void requestRedraw();
+
+		//Around everything display() does, swap included.
+		void beginFrame();
+		void endFrame();
+
+		const FrameStats& getStats();
+		void printStats();
+
+	private:
+
+		static void onTimer(int value);
+		void tick();
+		void arm(chrono::steady_clock::time_point now);
+		void updateStats();
+
+		static FrameScheduler* active;
+
+		chrono::steady_clock::duration interval;
+		chrono::steady_clock::time_point nextFrame;
+		double intervalMilliseconds;
+		bool onDemand;
+		bool redrawRequested;
+		bool (*changeCheck)();
+
+		//Render thread CPU time at beginFrame(), and the per-frame history.
+		double frameCpuStart;
+		chrono::steady_clock::time_point lastPresent;
+		bool havePresent;
+		double intervals[FRAME_HISTORY];
+		double cpuTimes[FRAME_HISTORY];
+		int historyCount;
+		int historyNext;
+
+		//Process CPU time and wall time when the stats were last worked out.
+		double processCpuMark;
+		chrono::steady_clock::time_point processWallMark;
+
+		FrameStats stats;
+
+};
+
+#endif
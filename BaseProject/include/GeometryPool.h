@@ -0,0 +1,80 @@
+#ifndef GEOMETRYPOOL_H
+#define GEOMETRYPOOL_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include "include/RangeAllocator.h"
+#include "include/MemoryStats.h"
+
+using namespace std;
+
+//Bytes per vertex in each of the position and normal buffers (xyzw doubles).
+#define GEOMETRY_VERTEX_BYTES (4 * sizeof(GLdouble))
+//Bytes per vertex in the texture coordinate buffer (uv floats).
+#define GEOMETRY_TEXCOORD_BYTES (2 * sizeof(GLfloat))
+//Everything a vertex takes across the three vertex buffers.
+#define GEOMETRY_BYTES_PER_VERTEX (2 * GEOMETRY_VERTEX_BYTES + GEOMETRY_TEXCOORD_BYTES)
+
+//Starting sizes, the buffers double whenever something doesn't fit.
+#define GEOMETRY_INITIAL_VERTICES 65536
+#define GEOMETRY_INITIAL_INDICES 262144
+
+//Where one mesh lives in the shared buffers. Indices are relative to
+//baseVertex, as glDrawElementsBaseVertex wants them.
+struct GeometryRange
+{
+	GLint baseVertex;
+	GLuint firstIndex;
+	GLuint numVertices;
+	GLuint numIndices;
+};
+
+//Every mesh's vertices and indices, suballocated from one position, one
+//normal, one texture coordinate and one index buffer behind a single vao. Drawing anything is then
+//never more than a program change away from drawing everything.
+//Render thread only, buffers are made on the first allocate().
+class GeometryPool
+{
+
+	public:
+
+		GeometryPool();
+		~GeometryPool();
+
+		//Grows the buffers if there's no room, existing ranges keep their
+		//place (and their data) when that happens.
+		void allocate(GLuint numVertices, GLuint numIndices, GeometryRange& range);
+		void release(const GeometryRange& range);
+
+		GLuint getVao()					{ return vao;				}
+		GLuint getPositionBuffer()		{ return positionBuffer;	}
+		GLuint getNormalBuffer()		{ return normalBuffer;		}
+		GLuint getTexCoordBuffer()		{ return texCoordBuffer;	}
+		GLuint getIndexBuffer()			{ return indexBuffer;		}
+
+		void printStats();
+
+	private:
+
+		void create();
+		void growVertices(GLuint needed);
+		void growIndices(GLuint needed);
+		void resizeBuffer(GLenum target, GLuint& buffer, GLuint oldBytes, GLuint newBytes);
+		void bindLayout();
+
+		GLuint vao;
+		GLuint positionBuffer;
+		GLuint normalBuffer;
+		GLuint texCoordBuffer;
+		GLuint indexBuffer;
+
+		RangeAllocator vertices;
+		RangeAllocator indices;
+
+		unsigned int numRanges;
+		unsigned int numGrows;
+
+};
+
+#endif
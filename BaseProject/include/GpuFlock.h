@@ -0,0 +1,110 @@
+#ifndef GPUFLOCK_H
+#define GPUFLOCK_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include "include/World.h"
+#include "include/Bird.h"
+#include <vector>
+
+using namespace std;
+
+//Floats a bird carries from step to step: translation and crash travel,
+//rotation and forward speed, rotation and vertical speed, flags (falling,
+//static drop, crashed, asleep) and the centre its parts turned about.
+#define GPU_BIRD_STATE_FLOATS 20
+
+//Floats fixed for a bird: flying bounds, then flap phase, frequency and
+//amplitude.
+#define GPU_BIRD_SHAPE_FLOATS 8
+
+//Commands a single step takes, any more wait for the next step.
+#define GPU_FLOCK_MAX_COMMANDS 8
+
+//Steps run in one frame when catching up, the rest are dropped.
+#define GPU_FLOCK_MAX_CATCHUP 4
+
+//What the flock has done so far.
+struct GpuFlockStats
+{
+	unsigned int birds;
+	unsigned long long steps;
+	unsigned long long stepsDropped;
+	double submitMilliseconds;	//CPU time to issue the last frame's steps
+};
+
+//A flock simulated entirely on the GPU. Each bird's state lives in a buffer
+//and a step is a transform feedback pass from one state buffer into the
+//other, followed by a second pass writing every part's model-view and flap
+//in the render queue's instance layout, which the parts are then drawn
+//from with one instanced draw a kind. Nothing comes back to the CPU.
+//The step matches World::step for the motion, falling, crashing, bounds
+//and sleeping; there's no wind, obstacle avoidance or waking on contact.
+//Render thread only.
+class GpuFlock
+{
+
+	public:
+
+		GpuFlock();
+		~GpuFlock();
+
+		//Transform feedback is GL 3.0, the shaders and instanced base vertex
+		//draws need 3.2.
+		static bool isSupported();
+
+		//Start the birds as the records describe them (Bird::exportRecord).
+		bool create(const vector<BirdRecord>& birds);
+
+		//Steer and fall reach every bird at the start of the next step, as
+		//World's commands do. Wind is not simulated here and is ignored.
+		void sendCommand(WorldCommandType type, double value);
+
+		void step();
+		//Run whatever steps are due at stepsPerSecond since the first call.
+		void advance(double seconds, double stepsPerSecond);
+
+		void draw(const GLfloat* projection, GLfloat seconds);
+
+		//For parity checks, these wait on the GPU. Laid out as the state and
+		//part buffers, parts by kind from FIRST_BIRD_KIND then by bird.
+		void readState(vector<GLfloat>& state);
+		void readParts(vector<GLfloat>& parts);
+
+		unsigned int getNumBirds()		{ return numBirds; }
+		const GpuFlockStats& getStats();
+		void printStats();
+
+	private:
+
+		void bindInputs(GLuint vao, GLuint stateBuffer);
+		void writeParts();
+
+		GLuint stepProgram;
+		GLuint partsProgram;
+		GLint numCommandsLocation;
+		GLint commandsLocation;
+
+		//Ping-ponged, the current one holds the latest step.
+		GLuint stateBuffers[2];
+		GLuint stateVaos[2];
+		int current;
+
+		GLuint shapeBuffer;
+		GLuint partBuffer;
+		GLuint drawVao;
+
+		//Stand-ins supplying the program and mesh to draw each kind with.
+		Object* proxies[NUM_ENTITY_KINDS];
+
+		unsigned int numBirds;
+		vector<GLfloat> commands;
+
+		bool started;
+		double startSeconds;
+		GpuFlockStats stats;
+
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef GPUPARITY_H
+#define GPUPARITY_H
+
+#include <stdio.h>
+#include "include/World.h"
+#include "include/GpuFlock.h"
+
+//Steps the check runs for by default, and how often it compares.
+#define GPU_PARITY_STEPS 600
+#define GPU_PARITY_INTERVAL 60
+
+//Largest difference allowed in any position or matrix entry by default.
+//The GPU works in floats and the CPU in doubles.
+#define GPU_PARITY_TOLERANCE 1e-3
+
+//Now and then a bird sits right on a bounds or ground test and the float
+//answer differs from the double one, after which the two copies are a step
+//out of phase for good. Up to this fraction of the flock may go that way.
+#define GPU_PARITY_MAX_DIVERGED 0.01
+
+//Runs the same flock on the CPU (a headless World, without wind or
+//scenery) and on the GPU (GpuFlock) from the same start with the same
+//input, comparing every bird's state and every part's model-view as it
+//goes. Input is scripted so birds climb, spin down, crash, sleep, wake,
+//drop and steer. Needs a current GL context. Returns the process exit
+//code, 0 when every bird that hasn't diverged stayed within tolerance.
+int runGpuParity(int numBirds, int steps, double tolerance);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HEADLESSRUN_H
+#define HEADLESSRUN_H
+
+#include <stdio.h>
+#include "include/World.h"
+#include "include/SnapshotPublisher.h"
+
+//Seconds between progress reports.
+#define HEADLESS_REPORT_SECONDS 10.0
+
+//A production run with no window: builds a world from the scene plus
+//numBirds birds scattered over the flying box and runs it at 60 steps a
+//second until the time is up or it's interrupted. With a publish name set
+//it can be watched from another process with --attach, and costs nothing
+//extra while nobody does. Runs until interrupted if seconds is 0. Returns
+//the process exit code.
+int runHeadless(double seconds, int numBirds, const char* sceneFile, const char* publishName);
+
+#endif
@@ -1,2 +1,19 @@
-//  Helper function to load vertex and fragment shader files
-GLuint InitShader( const char* vertexShaderFile, const char* fragmentShaderFile );
+#ifndef INITSHADER_H
+#define INITSHADER_H
+
+//  Helper function to load vertex and fragment shader files, and optionally a geometry
+//  shader. Defines (whole #define lines) are added to every stage after its #version.
+GLuint InitShader( const char* vertexShaderFile, const char* fragmentShaderFile,
+                   const char* geometryShaderFile = NULL, const char* defines = NULL );
+
+//  Same as above, but programs are cached so each combination is only compiled once
+GLuint GetShaderProgram( const char* vertexShaderFile, const char* fragmentShaderFile,
+                         const char* geometryShaderFile = NULL, const char* defines = NULL );
+
+//  A vertex shader alone whose outputs are captured by transform feedback (interleaved,
+//  in the order given) rather than rasterised. Inputs are bound to locations 0, 1, ...
+//  in the order given.
+GLuint InitFeedbackShader( const char* vertexShaderFile, const char** attributes, int numAttributes,
+                           const char** varyings, int numVaryings );
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+//The view frustum is cut into CLUSTER_TILES_X by CLUSTER_TILES_Y tiles on
+//screen and CLUSTER_SLICES slices in depth (thinner near the camera, the
+//slices are spaced evenly in log depth).
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 16
+#define CLUSTER_SLICES 24
+#define CLUSTER_COUNT (CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES)
+
+//Lights past this many (after culling to the view) are dropped.
+#define CLUSTER_MAX_LIGHTS 4096
+
+//Where the lighting block and the light textures are bound, shared by
+//every program.
+#define LIGHTING_BLOCK_BINDING 0
+#define LIGHT_DATA_UNIT 1
+#define CLUSTER_GRID_UNIT 2
+#define LIGHT_INDEX_UNIT 3
+
+//A point light in world space. It reaches nothing past its radius.
+struct PointLight
+{
+	float position[3];
+	float radius;
+	float colour[3];
+	float intensity;
+};
+
+//The "Lighting" uniform block, std140. The key light is the scene's main
+//light and is applied everywhere, the clustered point lights only where
+//they reach.
+struct LightingBlock
+{
+	GLfloat view[16];
+	GLfloat keyLight[4];		//view space position
+	GLfloat keyColour[4];
+	GLfloat ambient[4];
+	GLfloat clusterScale[4];	//tiles per pixel (x, y), slices per log depth, slice bias
+	GLint clusterDims[4];		//tiles x, tiles y, slices, lights
+};
+
+//What the last build() did.
+struct ClusterStats
+{
+	unsigned int lights;
+	unsigned int visibleLights;
+	unsigned int assignments;
+	unsigned int occupiedClusters;
+	unsigned int mostInCluster;
+	double buildMilliseconds;
+};
+
+//Clustered forward lighting. Each frame the lights are put into view space
+//and every cluster gets a list of the lights that reach it, built on
+//several threads a depth slice at a time. The lists go up as texture
+//buffers, and the fragment shader only loops over the lights in its own
+//cluster, so shading cost follows how many lights overlap rather than how
+//many there are.
+class LightClusters
+{
+
+	public:
+
+		LightClusters();
+		~LightClusters();
+
+		//Build threads besides the calling one, 0 to build on the caller alone.
+		void start(int numThreads);
+		void stop();
+
+		//Render thread, needs a GL context.
+		void create();
+
+		void setKeyLight(const GLfloat* position, const GLfloat* colour);
+		void setAmbient(const GLfloat* colour);
+
+		//Cluster the lights for this view. View is column major world to view,
+		//the projection is perspective(fovY, aspect, zNear, zFar).
+		void build(const vector<PointLight>& lights, const GLdouble* view,
+			double fovY, double aspect, double zNear, double zFar, int viewportWidth, int viewportHeight);
+
+		//Send the last build to the GPU and bind it for drawing.
+		void upload();
+
+		//Point a program's light samplers and lighting block at our bindings,
+		//with the program in use.
+		static void setupProgram(GLuint program);
+
+		const ClusterStats& getStats();
+		void printStats();
+
+	private:
+
+		//A light's tiles within one slice.
+		struct TileRect
+		{
+			unsigned int light;
+			int x0, y0, x1, y1;
+		};
+
+		void workerLoop(unsigned long long seen);
+		void runSlices();
+		void buildSlice(int slice);
+		bool projectRange(float centre, float depth, float radius, float nearDepth, float farDepth, float scale, int tiles, int& first, int& last);
+
+		//View space lights, xyz and radius then colour, as the shader reads them.
+		vector<GLfloat> lightData;
+		unsigned int numVisible;
+
+		double sliceDepths[CLUSTER_SLICES + 1];
+		float xScale;
+		float yScale;
+
+		//Offset and count per cluster, offsets within the slice until the
+		//slices are joined up.
+		vector<GLuint> grid;
+		vector<GLuint> sliceIndices[CLUSTER_SLICES];
+		vector<TileRect> sliceRects[CLUSTER_SLICES];
+		vector<GLuint> indices;
+
+		LightingBlock block;
+		GLfloat keyPosition[4];
+
+		GLuint blockBuffer;
+		GLuint buffers[3];
+		GLuint textures[3];
+		bool created;
+
+		vector<thread> workers;
+		mutex jobLock;
+		condition_variable jobSignal;
+		condition_variable doneSignal;
+		unsigned long long jobGeneration;
+		int busyWorkers;
+		bool stopping;
+		atomic<int> nextSlice;
+
+		ClusterStats stats;
+
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string>
+
+using namespace std;
+
+//A whole file mapped read-only into memory. Pages are only read in as
+//they're touched, so opening even a huge file costs next to nothing.
+class MappedFile
+{
+
+	public:
+
+		MappedFile();
+		~MappedFile();
+
+		//Returns false (and leaves nothing mapped) on failure.
+		bool open(string fileName);
+		void close();
+
+		const void* getData();
+		size_t getSize();
+
+	private:
+
+		const void* data;
+		size_t size;
+
+#ifdef _WIN32
+		void* file;
+		void* mapping;
+#endif
+
+};
+
+#endif
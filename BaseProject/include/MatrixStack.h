@@ -20,12 +20,16 @@ class MatrixStack
     GLfloat result_[16];
 
     GLuint tos;
+    GLuint size_;
+    bool ownsStack_;
     void mult(void);
     void mult2(void);
     void mult1(void);
 public:
 
     MatrixStack(unsigned int);
+    /* use the caller's storage (16*num doubles) rather than allocating */
+    MatrixStack(unsigned int, GLdouble *storage);
     ~MatrixStack(void);
     const GLfloat *getMatrixf();
     const GLdouble *getMatrixd();
@@ -0,0 +1,54 @@
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <atomic>
+
+using namespace std;
+
+//What the memory is held for. Every long-lived allocation in the simulation
+//is counted against one of these.
+enum MemoryCategory
+{
+	MEMORY_MESH_CPU,			//vertex streams kept in system memory
+	MEMORY_GL_BUFFERS,			//vertex and index buffers on the GPU
+	MEMORY_GL_TEXTURES,			//textures on the GPU
+	MEMORY_ENTITY_POOLS,		//pooled birds and objects
+	MEMORY_TRANSFORM_STACKS,	//model-view and projection stacks
+	MEMORY_SCRATCH,				//arena blocks for loading
+	MEMORY_DISTANCE_FIELDS,		//baked obstacle distances
+	MEMORY_WIND_FIELDS,			//wind key frames
+	MEMORY_TERRAIN,				//terrain height tiles
+	NUM_MEMORY_CATEGORIES
+};
+
+//Running byte counts per category, safe to update from any thread. These
+//only see what's reported to them, processBytes() is the operating system's
+//view of the whole process for catching anything that isn't.
+class MemoryStats
+{
+
+	public:
+
+		static void add(MemoryCategory category, long long bytes);
+		static void remove(MemoryCategory category, long long bytes);
+
+		static long long current(MemoryCategory category);
+		static long long peak(MemoryCategory category);
+		static long long total();
+
+		//Resident size of the whole process, 0 where it can't be read.
+		static size_t processBytes();
+
+		static const char* name(MemoryCategory category);
+		static void print();
+
+	private:
+
+		static atomic<long long> currentBytes[NUM_MEMORY_CATEGORIES];
+		static atomic<long long> peakBytes[NUM_MEMORY_CATEGORIES];
+
+};
+
+#endif
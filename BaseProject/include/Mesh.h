@@ -0,0 +1,129 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include "include/Arena.h"
+#include "include/MemoryStats.h"
+#include "include/GeometryPool.h"
+
+using namespace std;
+
+#define BUFFER_OFFSET( offset )   ((GLvoid*) (offset))
+
+//Fixed attribute slots, bound before linking so one vao suits every program.
+//The model-view matrix (four slots), flap and view come per draw rather
+//than per vertex, from the render queue's instance buffer.
+#define ATTRIBUTE_POSITION  0
+#define ATTRIBUTE_NORMAL    1
+#define ATTRIBUTE_MODELVIEW 2
+#define ATTRIBUTE_FLAP      6
+#define ATTRIBUTE_VIEW      7
+#define ATTRIBUTE_TEXCOORD  8
+
+//Where a mesh is in its life from file to GPU.
+enum MeshState
+{
+	MESH_QUEUED,	//waiting for a worker thread
+	MESH_PARSED,	//CPU data ready, waiting for upload
+	MESH_UPLOADING, //buffers created, data partly sent
+	MESH_READY,		//safe to draw
+	MESH_FAILED
+};
+
+//Geometry read from an .obj file. Parsing touches no GL state so it can run
+//on any thread; upload() must be called on the thread owning the context,
+//and puts the mesh in a range of the shared geometry buffers.
+//
+//Files with texture coordinates ("vt", and faces as v/vt or v/vt/vn) get a
+//vertex for every distinct position and uv pair. Files without have their
+//uvs projected from above across the mesh's bounds.
+class Mesh
+{
+
+	public:
+
+		Mesh(string fileName);
+		~Mesh();
+
+		string fileName;
+
+		//Temporaries go in scratch, which the caller can reset afterwards.
+		void parse(Arena& scratch);
+		//Positions are xyz, uvs (if given) two per vertex.
+		void createFromArrays(const GLdouble* positions, int vertexCount, const GLuint* indices, int indexCount, const GLfloat* texCoords = NULL);
+
+		//Send up to byteBudget bytes to the GPU, returns how many were sent.
+		GLuint upload(GeometryPool& pool, GLuint byteBudget);
+
+		MeshState getState();
+		void setState(MeshState state);
+
+		//The pool's vao, and where in it this mesh's vertices and indices start.
+		GLuint getVao();
+		GLint getBaseVertex();
+		GLuint getFirstIndex();
+		int getNumIndices();
+		int getNumVertices();
+		//Furthest any vertex is from the mesh's origin, for culling.
+		float getBoundingRadius();
+
+		//The parsed data, xyzw and uv per vertex and three indices a triangle.
+		//Valid from MESH_PARSED on and kept after upload.
+		const GLdouble* getPositions();
+		const GLfloat* getTexCoords();
+		const GLuint* getIndices();
+		GLuint numUploadBytes();
+		GLuint numRemainingUploadBytes();
+
+	private:
+
+		int numVertices;
+		int numIndices;
+		int numNormals;
+		float boundingRadius;
+
+		atomic<int> state;
+
+		void calcNormal(const GLdouble* p1, const GLdouble* p2, const GLdouble* p3, GLdouble* normal);
+		bool parseTexturedFaces(char* text, int numPositions, int numTexCoords, Arena& scratch);
+		void projectTexCoords();
+		void allocateStreams();
+		void finishBuild();
+
+		//Every stream below lives in this one block.
+		char* streamBlock;
+		GLdouble* vertexPositions;
+		GLdouble* vertexNormals;
+		GLfloat* vertexTexCoords;
+		GLuint* vertexIndices;
+		//False when the uvs are still to be projected in finishBuild().
+		bool hasTexCoords;
+
+		GLuint numVertexPositionBytes();
+		GLuint numVertexNormalBytes();
+		GLuint numUploadNormalBytes();
+		GLuint numVertexTexCoordBytes();
+		GLuint numVertexIndexBytes();
+		GLuint numStreamBytes();
+
+		//How far through the four streams (positions, normals, uvs, indices) we are.
+		GLuint uploadedBytes;
+
+		//----------------------------------------------------------------------------
+		//Set on the first upload() call.
+		GeometryPool* pool;
+		GeometryRange range;
+
+};
+
+#endif
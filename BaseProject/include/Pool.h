@@ -0,0 +1,179 @@
+/*
+A pool of fixed size slots for one type.
+Slots come from slabs of SLAB_SIZE at a time and are recycled through a free
+list, so creating and destroying lots of objects never goes back to malloc
+once the pool has grown to its working size, and objects made together sit
+next to each other in memory.
+Slots are handed out in address order within a slab, and reserve() sets
+aside one slab for the next count creates, so objects made in one batch can
+be walked with a fixed stride. A slab with nothing live in it that's big
+enough is used again rather than growing, so reserving the same batch over
+and over stays flat.
+Slabs are never given back until the pool itself goes. Not thread safe.
+*/
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdio.h>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+#include "include/MemoryStats.h"
+
+//Counters for one pool.
+struct PoolStats
+{
+    unsigned long long creates;
+    unsigned long long destroys;
+    unsigned int live;
+    unsigned int peakLive;
+    unsigned int capacity;
+    unsigned int slabs;
+    size_t bytesReserved;
+};
+
+template <class T, unsigned int SLAB_SIZE = 256>
+class Pool
+{
+
+    union Slot
+    {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type value;
+        Slot *next;
+    };
+
+    struct Slab
+    {
+        Slot *slots;
+        unsigned int count;
+    };
+
+    std::vector<Slab> slabs_;
+    Slot *free_;
+    PoolStats stats_;
+    MemoryCategory category_;
+
+    /* new slots go on the front of the free list, first slot first */
+    void grow(unsigned int count)
+    {
+        Slot *slab = new Slot[count];
+        Slab entry = { slab, count };
+        slabs_.push_back(entry);
+        for (unsigned int i = count; i-- > 0; )
+            {
+                slab[i].next = free_;
+                free_ = &slab[i];
+            }
+        stats_.slabs++;
+        stats_.capacity += count;
+        stats_.bytesReserved += count * sizeof(Slot);
+        MemoryStats::add(category_, count * sizeof(Slot));
+    }
+
+public:
+
+    /* slabs are counted against category in MemoryStats */
+    Pool(MemoryCategory category = MEMORY_ENTITY_POOLS) : free_(0), category_(category)
+    {
+        stats_.creates = stats_.destroys = 0;
+        stats_.live = stats_.peakLive = stats_.capacity = stats_.slabs = 0;
+        stats_.bytesReserved = 0;
+    }
+
+    /* everything still live is leaked on purpose, objects are expected to
+    be destroyed through the pool before it goes */
+    ~Pool()
+    {
+        for (unsigned int i = 0; i < slabs_.size(); i++)
+            delete [] slabs_[i].slots;
+        MemoryStats::remove(category_, stats_.bytesReserved);
+    }
+
+    template <class... Args>
+    T *create(Args&&... args)
+    {
+        if (!free_) grow(SLAB_SIZE);
+        Slot *slot = free_;
+        free_ = slot->next;
+
+        stats_.creates++;
+        stats_.live++;
+        if (stats_.live > stats_.peakLive) stats_.peakLive = stats_.live;
+
+        return new (&slot->value) T(std::forward<Args>(args)...);
+    }
+
+    /* the next count creates come from one slab, one after the other: the
+    smallest wholly free slab that holds them, or a new one */
+    void reserve(unsigned int count)
+    {
+        if (!count) return;
+
+        /* free slots per slab, found by address */
+        typedef std::vector<std::pair<Slot*, unsigned int> > SlabIndex;
+        SlabIndex byAddress(slabs_.size());
+        for (unsigned int i = 0; i < slabs_.size(); i++)
+            byAddress[i] = std::make_pair(slabs_[i].slots, i);
+        std::sort(byAddress.begin(), byAddress.end());
+        std::vector<unsigned int> freeSlots(slabs_.size(), 0);
+        for (Slot *slot = free_; slot; slot = slot->next)
+            {
+                typename SlabIndex::iterator it = std::upper_bound(byAddress.begin(), byAddress.end(), std::make_pair(slot, ~0u));
+                freeSlots[(it - 1)->second]++;
+            }
+
+        int best = -1;
+        for (unsigned int i = 0; i < slabs_.size(); i++)
+            if (freeSlots[i] == slabs_[i].count && slabs_[i].count >= count &&
+                (best < 0 || slabs_[i].count < slabs_[best].count))
+                best = i;
+        if (best < 0)
+            {
+                grow(count);
+                return;
+            }
+
+        /* take its slots off the free list and put them back on the front
+        in address order */
+        Slot *first = slabs_[best].slots;
+        Slot *last = first + slabs_[best].count;
+        for (Slot **link = &free_; *link; )
+            {
+                if (*link >= first && *link < last) *link = (*link)->next;
+                else link = &(*link)->next;
+            }
+        for (Slot *slot = last; slot-- > first; )
+            {
+                slot->next = free_;
+                free_ = slot;
+            }
+    }
+
+    /* distance between neighbouring slots */
+    static size_t stride() { return sizeof(Slot); }
+
+    void destroy(T *object)
+    {
+        if (!object) return;
+        object->~T();
+        Slot *slot = reinterpret_cast<Slot*>(object);
+        slot->next = free_;
+        free_ = slot;
+
+        stats_.destroys++;
+        stats_.live--;
+    }
+
+    const PoolStats &getStats() const { return stats_; }
+
+    void printStats(const char *name) const
+    {
+        printf("Pool %s: %u live (peak %u) of %u slots in %u slabs, %lu bytes, %llu creates, %llu destroys\n",
+               name, stats_.live, stats_.peakLive, stats_.capacity, stats_.slabs,
+               (unsigned long) stats_.bytesReserved, stats_.creates, stats_.destroys);
+    }
+};
+
+#endif //POOL_H
@@ -0,0 +1,11 @@
+#ifndef RANDOMRANGE_H
+#define RANDOMRANGE_H
+
+#include <stdlib.h>
+
+//A random value in [low, high), from rand() so a srand() seed repeats it.
+inline double randomRange(double low, double high) {
+	return low + (high - low) * (rand() / (RAND_MAX + 1.0));
+}
+
+#endif
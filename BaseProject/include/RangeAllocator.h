@@ -0,0 +1,42 @@
+#ifndef RANGEALLOCATOR_H
+#define RANGEALLOCATOR_H
+
+#include <stdio.h>
+#include <map>
+
+using namespace std;
+
+//Hands out ranges of a linear space (elements of a buffer, say) from a free
+//list kept in address order. Allocation is first fit, released ranges merge
+//with free neighbours so the space doesn't crumble into slivers.
+//Only book-keeping, nothing is stored. Not thread safe.
+class RangeAllocator
+{
+
+	public:
+
+		RangeAllocator();
+		~RangeAllocator();
+
+		//Start of a free range of count elements, or -1 if nothing fits.
+		long long allocate(unsigned int count);
+		void release(unsigned int start, unsigned int count);
+
+		//More space on the end, capacity only ever grows.
+		void grow(unsigned int newCapacity);
+
+		unsigned int getCapacity()			{ return capacity;	}
+		unsigned int getUsed()				{ return used;		}
+		unsigned int numFreeRanges()		{ return (unsigned int) freeRanges.size(); }
+		unsigned int largestFreeRange();
+
+	private:
+
+		//Free ranges by start, mapping to their length.
+		map<unsigned int, unsigned int> freeRanges;
+		unsigned int capacity;
+		unsigned int used;
+
+};
+
+#endif
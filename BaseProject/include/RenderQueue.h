@@ -0,0 +1,210 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+//Objects further away than the queue's shading distance are drawn with
+//cheaper lighting.
+enum ShadingLevel
+{
+	SHADING_FULL,	//per-pixel Blinn-Phong
+	SHADING_LOW,	//ambient and diffuse only
+	NUM_SHADING_LEVELS
+};
+
+//Views drawn in one frame, see RenderView.
+#define MAX_VIEWS 4
+
+//One camera's part of the frame: its projection (times its view) and the
+//rectangle of the render target it draws into.
+struct RenderView
+{
+	GLfloat projection[16];
+	GLint viewport[4];
+};
+
+//A single draw submitted by an object for this frame. The mesh is a range
+//of the vao's shared buffers.
+struct DrawPacket
+{
+	uint64_t key;
+
+	GLuint program;
+	GLuint vao;
+	GLuint texture;
+	GLsizei numIndices;
+	GLuint firstIndex;
+	GLint baseVertex;
+
+	//Per-frame uniforms, time is -1 if the program doesn't animate.
+	GLint projectionLocation;
+	GLint timeLocation;
+	GLint clusterViewLocation;
+
+	//Bit per view it's inside, from cull().
+	unsigned int views;
+
+	//Per-draw data, sent as instanced attributes. Flap is phase,
+	//frequency, amplitude and hinge.
+	GLfloat modelView[16];
+	GLfloat flap[4];
+};
+
+//Laid out as glMultiDrawElementsIndirect reads it.
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+//Floats of per-draw data in the instance buffer, model-view, flap then view.
+#define INSTANCE_FLOATS 21
+
+//What one view cost in the last flushed frame.
+struct ViewStats
+{
+	unsigned int draws;
+	unsigned int culled;
+	unsigned long long triangles;
+};
+
+//Counters for the last flushed frame.
+struct RenderStats
+{
+	unsigned int packets;
+	unsigned int drawCalls;
+	unsigned int programBinds;
+	unsigned int vaoBinds;
+	unsigned int textureBinds;
+	unsigned int uniformUploads;
+	unsigned int lowShadingDraws;
+	bool multiDraw;
+
+	//Views drawn, all in one pass if routed or else one pass each.
+	unsigned int numViews;
+	bool viewsRouted;
+	ViewStats views[MAX_VIEWS];
+
+	//Binds that were requested but skipped since the state was already set.
+	unsigned int redundantBinds;
+};
+
+//Objects submit draw packets here rather than drawing directly. On flush the
+//packets are sorted by key (program, mesh, texture, then front-to-back
+//depth), their per-draw data goes up in one buffer, and each run sharing a
+//program, vao and texture is a single glMultiDrawElementsIndirect. Where that isn't supported each
+//packet is drawn on its own with glDrawElementsInstancedBaseVertex. GL state
+//is tracked so repeated binds are skipped.
+//
+//A frame can have several views. Objects are culled against all of them
+//when submitted, and a draw visible in more than one becomes that many
+//instances. With viewport arrays a geometry shader sends each instance's
+//triangles to its own view, so every view is drawn in the same pass with
+//the objects' multi-view programs. Without, each view is a pass of its own.
+class RenderQueue
+{
+
+	public:
+
+		RenderQueue();
+		~RenderQueue();
+
+		static uint64_t makeKey(GLuint program, GLuint vao, GLuint texture, float depth);
+
+		//Multi-draw is used when the driver has it unless switched off here.
+		void setMultiDraw(bool allowed);
+
+		//One view covering the whole target, or several each in their own
+		//viewport. The projections and viewports are copied.
+		void beginFrame(const GLfloat* projectionMatrix, GLfloat seconds);
+		void beginFrame(const RenderView* frameViews, unsigned int count, GLfloat seconds);
+		//Which views a sphere round an object's origin, radius scaled with
+		//its model-view, can be seen in. A negative radius is never culled.
+		unsigned int cull(const GLfloat* modelView, float radius);
+		//Objects should submit with their multi-view programs this frame.
+		bool routesViews();
+		static bool viewRoutingSupported();
+		DrawPacket* submit();
+		//Take back everything submitted since mark(), for a reader that
+		//finds what it was drawing changed underneath it.
+		unsigned int mark();
+		void rewind(unsigned int mark);
+
+		//View depth beyond which objects should use SHADING_LOW.
+		void setShadingDistance(float distance);
+		ShadingLevel shadingFor(float depth);
+		void flush();
+
+		const RenderStats& getStats();
+		void printStats();
+
+	private:
+
+		void createBuffers();
+		void uploadDrawData();
+		void writeInstance(const DrawPacket& packet, unsigned int view);
+		void drawPass(unsigned int first, unsigned int end, int view);
+		void bindProgram(GLuint program);
+		void bindVertexArray(GLuint vao);
+		void bindTexture(GLuint texture);
+		void pointInstanceAttributes(GLuint instance);
+		void drawRun(unsigned int first, unsigned int count);
+
+		struct SortEntry
+		{
+			uint64_t key;
+			uint32_t index;
+			bool operator<(const SortEntry& other) const { return key < other.key; }
+		};
+
+		vector<DrawPacket> packets;
+		vector<SortEntry> sorted;
+		unsigned int numPackets;
+
+		//This frame's draws in sorted order, and the buffers they go up in.
+		//Commands are per packet when views are routed, otherwise per packet
+		//and view grouped by view, each view's starting at passStarts.
+		vector<GLfloat> instances;
+		vector<DrawElementsIndirectCommand> commands;
+		vector<uint32_t> commandPackets;
+		unsigned int passStarts[MAX_VIEWS + 1];
+		GLuint instanceBuffer;
+		GLuint indirectBuffer;
+		GLuint instanceCapacity;
+		GLuint indirectCapacity;
+		bool buffersCreated;
+		bool multiDrawAllowed;
+		bool multiDraw;
+
+		//Vaos whose instanced attributes already point at our buffer.
+		vector<GLuint> preparedVaos;
+		unsigned int numLowShading;
+
+		RenderView views[MAX_VIEWS];
+		unsigned int numViews;
+		bool viewsRouted;
+		//Each view's frustum as planes facing in, normalised.
+		GLfloat planes[MAX_VIEWS][6][4];
+		unsigned int culled[MAX_VIEWS];
+		GLfloat time;
+		float shadingDistance;
+		RenderStats stats;
+
+		//GL state as we last left it, 0 meaning unknown.
+		GLuint currentProgram;
+		GLuint currentVao;
+		GLuint currentTexture;
+		vector<GLuint> frameUniformsUploaded;
+
+};
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include <stdio.h>
+#include "include/MappedFile.h"
+#include "include/Terrain.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//A scene names each mesh once and then places it as a packed array of
+//transforms, SCENE_PLACEMENT_FLOATS to an instance: position x y z then
+//rotation x y z in degrees. Birds are just positions.
+//
+//The text form, # starts a comment:
+//
+//	terrain 7 -2.1 0.3 6 textures/grass.tga
+//	mesh fence fence.obj
+//	place fence 2 solid
+//	-2.5 -2 0  0 90 0
+//	2.5 -2 0  0 90 0
+//	birds 1
+//	0 0 0
+//
+//A mesh can name an image to be drawn with after its file. Solid groups are
+//baked into the obstacle field, the rest is only drawn. The terrain line is
+//optional: seed, base height, relief and feature size (see TerrainSettings)
+//and then an image, also optional.
+//
+//The binary form is the loaded scene laid out flat, mapped and used where
+//it lies, nothing is parsed:
+//
+//	SceneHeader | SceneMesh * numMeshes | SceneGroup * numGroups |
+//	float * placements | float * birds
+//
+//Every section starts on a SCENE_ALIGN boundary, files are native endian.
+
+#define SCENE_MAGIC "FLOCKSCN"
+#define SCENE_VERSION 3
+#define SCENE_ALIGN 64
+#define SCENE_NAME_BYTES 64
+#define SCENE_PLACEMENT_FLOATS 6
+
+//Group flags.
+#define SCENE_SOLID 1
+
+struct SceneHeader
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int headerBytes;
+	unsigned int numMeshes;
+	unsigned int numGroups;
+	unsigned int hasTerrain;
+	unsigned int reserved;
+	TerrainSettings terrain;
+
+	unsigned long long numPlacements;
+	unsigned long long numBirds;
+
+	unsigned long long meshesOffset;
+	unsigned long long groupsOffset;
+	unsigned long long placementsOffset;
+	unsigned long long birdsOffset;
+	unsigned long long fileBytes;
+};
+
+struct SceneMesh
+{
+	char name[SCENE_NAME_BYTES];
+	char fileName[SCENE_NAME_BYTES];
+	char texture[SCENE_NAME_BYTES];	//empty for none
+};
+
+//A run of placements of one mesh.
+struct SceneGroup
+{
+	unsigned int mesh;
+	unsigned int flags;
+	unsigned long long first;
+	unsigned long long count;
+};
+
+//A scene read from either form. Placements and birds point into the mapped
+//file for binary scenes, so they're only good while the SceneFile is.
+class SceneFile
+{
+
+	public:
+
+		SceneFile();
+		~SceneFile();
+
+		//Either form, told apart by the magic. Reports what's wrong and
+		//returns false if the file can't be used.
+		bool load(string fileName);
+		bool saveBinary(string fileName);
+
+		const vector<SceneMesh>& getMeshes()		{ return meshes;		}
+		const vector<SceneGroup>& getGroups()		{ return groups;		}
+		const float* getPlacements()				{ return placements;	}
+		unsigned long long getNumPlacements()		{ return numPlacements;	}
+		const float* getBirds()						{ return birds;			}
+		unsigned long long getNumBirds()			{ return numBirds;		}
+		bool hasTerrain()							{ return terrainSet;	}
+		const TerrainSettings& getTerrain()			{ return terrain;		}
+
+		double getLoadMilliseconds()				{ return loadMilliseconds; }
+
+	private:
+
+		bool loadText(string fileName, const char* text);
+		bool loadBinary(string fileName);
+		void clear();
+
+		MappedFile file;
+
+		vector<SceneMesh> meshes;
+		vector<SceneGroup> groups;
+
+		//Text scenes are parsed into these, binary ones are left in the file.
+		vector<float> placementStorage;
+		vector<float> birdStorage;
+
+		const float* placements;
+		unsigned long long numPlacements;
+		const float* birds;
+		unsigned long long numBirds;
+
+		bool terrainSet;
+		TerrainSettings terrain;
+
+		double loadMilliseconds;
+
+};
+
+inline unsigned long long sceneAlign(unsigned long long offset) {
+	return (offset + SCENE_ALIGN - 1) & ~(unsigned long long) (SCENE_ALIGN - 1);
+}
+
+#endif
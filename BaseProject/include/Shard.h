@@ -0,0 +1,45 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdio.h>
+#include "include/World.h"
+#include "include/SharedMemory.h"
+#include "include/ShardLayout.h"
+#include <vector>
+
+using namespace std;
+
+//One shard process. Simulates the birds in its slab of the world with a
+//headless World, hands birds that fly out to the neighbouring shard, passes
+//on landings near its edges and publishes what to draw for the coordinator.
+class Shard
+{
+
+	public:
+
+		Shard();
+
+		//Runs until the coordinator quits or goes away, returns the exit code.
+		int run(string memoryName, unsigned int shardIndex);
+
+	private:
+
+		void spawnBirds();
+		void receive();
+		void sendBirds();
+		void sendLandings();
+		void publishView(double stepMilliseconds);
+
+		SharedMemory memory;
+		ShardHeader* header;
+		ShardControl* control;
+		ShardControl* left;
+		ShardControl* right;
+		unsigned int index;
+
+		World* world;
+		vector<BirdRecord> outgoing;
+
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef SHARDCOORDINATOR_H
+#define SHARDCOORDINATOR_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include "include/object.h"
+#include "include/SharedMemory.h"
+#include "include/ShardLayout.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//Runs a flock too big for one process. The world is cut into slabs along x,
+//one shard process per slab (see Shard), all sharing one block of memory.
+//The coordinator lives in the windowed process: it starts the shards,
+//forwards input to them and gathers their views together for drawing.
+class ShardCoordinator
+{
+
+	public:
+
+		ShardCoordinator();
+		~ShardCoordinator();
+
+		//Starts numShards copies of this executable, returns false if the
+		//shared memory or any process couldn't be created. The shards' birds
+		//fly through the scenery and over the terrain of sceneFile if it's given.
+		bool start(int numShards, int totalBirds, string sceneFile = "");
+		void stop();
+
+		void sendCommand(WorldCommandType type, double value);
+
+		//Render thread, draws the latest complete view from every shard.
+		void submitDraws(MatrixStack& projectionStack, RenderQueue* queue);
+		void printStats();
+
+	private:
+
+		bool spawn(unsigned int shard);
+		void waitForShards();
+		bool readView(unsigned int shard);
+
+		SharedMemory memory;
+		string memoryName;
+		unsigned int numShards;
+
+		//Stand-ins supplying the program and mesh to draw each kind with.
+		Object* proxies[NUM_ENTITY_KINDS];
+
+		//The last complete view read from each shard.
+		vector< vector<ShardEntry> > views;
+		vector<unsigned long long> viewSteps;
+		unsigned long long readRetries;
+		unsigned long long staleFrames;
+
+#ifdef _WIN32
+		vector<void*> processes;
+#else
+		vector<int> processes;
+#endif
+
+};
+
+#endif
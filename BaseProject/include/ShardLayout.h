@@ -0,0 +1,139 @@
+#ifndef SHARDLAYOUT_H
+#define SHARDLAYOUT_H
+
+#include <GL/glew.h>
+#include <string.h>
+#include <atomic>
+#include "include/Bird.h"
+#include "include/World.h"
+#include "include/SpscRing.h"
+
+using namespace std;
+
+//The shared memory layout used between the coordinator and its shard
+//processes. Everything is plain data or lock-free atomics at fixed offsets:
+//
+//	ShardHeader | ShardControl * numShards | (ShardViewHeader + entries) * 2 * numShards
+//
+//Each shard owns a slab of the world along x. Birds crossing into a
+//neighbour's slab are handed over through the neighbour's inbox rings, and
+//each shard publishes what to draw through a pair of seqlocked views.
+
+#define SHARD_MAGIC 0x464C4B53	//"FLKS"
+#define SHARD_VERSION 4
+#define MAX_SHARDS 64
+#define SHARD_RING_SIZE 256
+
+//Shards wake each other's resting birds from landings this close to an edge.
+#define SHARD_CONTACT_MARGIN 0.5
+
+//Longest scene file name the coordinator can pass on.
+#define SHARD_NAME_BYTES 256
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "shared memory needs address-free atomics");
+
+enum ShardState
+{
+	SHARD_STARTING,
+	SHARD_RUNNING,
+	SHARD_EXITED
+};
+
+struct ShardHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int numShards;
+	unsigned int entriesPerView;
+
+	//The coordinator bumps the heartbeat every frame, shards quit if it stops.
+	atomic<bool> quit;
+	atomic<unsigned long long> heartbeat;
+
+	//Every shard loads the same scene for its scenery and terrain, without
+	//the scene's birds. Set before any start, empty for none.
+	char sceneFile[SHARD_NAME_BYTES];
+};
+
+//One part of a bird to draw. The coordinator supplies the program and mesh
+//for each kind.
+struct ShardEntry
+{
+	int kind;
+	GLfloat modelView[16];
+	GLfloat position[3];
+	GLfloat flap[4];
+};
+
+struct ShardViewHeader
+{
+	//Odd while the shard is writing, readers retry if it moved under them.
+	atomic<unsigned int> sequence;
+	unsigned int count;
+	unsigned int dropped;
+	unsigned long long step;
+	double stepMilliseconds;
+};
+
+struct ShardControl
+{
+	//This shard's slab, [minX, maxX).
+	double minX;
+	double maxX;
+	unsigned int initialBirds;
+	atomic<int> state;
+
+	//Which of the two views was written last.
+	atomic<unsigned int> latestView;
+
+	//Inboxes, each filled by the neighbour on that side.
+	SpscRing<BirdRecord, SHARD_RING_SIZE> birdsFromLeft;
+	SpscRing<BirdRecord, SHARD_RING_SIZE> birdsFromRight;
+	SpscRing<Landing, SHARD_RING_SIZE> landingsFromLeft;
+	SpscRing<Landing, SHARD_RING_SIZE> landingsFromRight;
+	SpscRing<WorldCommand, SHARD_RING_SIZE> commands;
+
+	//Written by the shard, read by the coordinator.
+	atomic<unsigned int> birds;
+	atomic<unsigned long long> steps;
+	atomic<unsigned long long> birdsSent;
+	atomic<unsigned long long> birdsReceived;
+	atomic<unsigned long long> landingsSent;
+	atomic<unsigned long long> handoffRetries;
+
+	ShardControl() : minX(0), maxX(0), initialBirds(0), state(SHARD_STARTING), latestView(0),
+		birds(0), steps(0), birdsSent(0), birdsReceived(0), landingsSent(0), handoffRetries(0) {}
+};
+
+//Keep every piece on its own cache lines.
+inline size_t shardAlign(size_t bytes) {
+	return (bytes + 63) & ~(size_t) 63;
+}
+
+inline size_t shardViewBytes(unsigned int entriesPerView) {
+	return shardAlign(sizeof(ShardViewHeader)) + shardAlign(entriesPerView * sizeof(ShardEntry));
+}
+
+inline size_t shardRegionBytes(unsigned int numShards, unsigned int entriesPerView) {
+	return shardAlign(sizeof(ShardHeader)) + numShards * shardAlign(sizeof(ShardControl)) + numShards * 2 * shardViewBytes(entriesPerView);
+}
+
+inline ShardHeader* shardHeader(void* base) {
+	return (ShardHeader*) base;
+}
+
+inline ShardControl* shardControl(void* base, unsigned int shard) {
+	return (ShardControl*) ((char*) base + shardAlign(sizeof(ShardHeader)) + shard * shardAlign(sizeof(ShardControl)));
+}
+
+inline ShardViewHeader* shardView(void* base, unsigned int shard, unsigned int side) {
+	ShardHeader* header = shardHeader(base);
+	return (ShardViewHeader*) ((char*) base + shardAlign(sizeof(ShardHeader)) + header->numShards * shardAlign(sizeof(ShardControl))
+		+ (shard * 2 + side) * shardViewBytes(header->entriesPerView));
+}
+
+inline ShardEntry* shardViewEntries(ShardViewHeader* view) {
+	return (ShardEntry*) ((char*) view + shardAlign(sizeof(ShardViewHeader)));
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SHAREDMEMORY_H
+#define SHAREDMEMORY_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string>
+
+using namespace std;
+
+//A named block of memory mapped into more than one process. The creator
+//owns the name and removes it again on close(), anyone else just opens it.
+//Only lock-free atomics and plain data belong in here, never pointers.
+class SharedMemory
+{
+
+	public:
+
+		SharedMemory();
+		~SharedMemory();
+
+		//Both return false (and leave nothing mapped) on failure.
+		bool create(string name, size_t bytes);
+		bool open(string name);
+		void close();
+
+		void* getData();
+		size_t getSize();
+
+		//A name unique to this process, for the block it creates.
+		static string uniqueName(const char* prefix);
+
+	private:
+
+		string name;
+		void* data;
+		size_t size;
+		bool owner;
+
+#ifdef _WIN32
+		void* mapping;
+#endif
+
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef SNAPSHOTPUBLISHER_H
+#define SNAPSHOTPUBLISHER_H
+
+#include <stdio.h>
+#include "include/World.h"
+#include "include/SharedMemory.h"
+#include "include/ViewLayout.h"
+#include <vector>
+#include <string>
+
+using namespace std;
+
+//What the publisher has done so far.
+struct PublishStats
+{
+	unsigned long long activePublished;
+	unsigned long long restingPublished;
+	unsigned long long stepsUnwatched;	//skipped with nobody watching
+	unsigned int entriesDropped;		//last step, for want of room or a mesh slot
+	bool watched;
+};
+
+//Publishes a world's snapshots into shared memory for SnapshotViewers in
+//other processes (see ViewLayout.h). Set on a World, it's called from the
+//simulation thread as each step is published. While no viewer is attached
+//nothing is written at all, so an unwatched run pays next to nothing.
+class SnapshotPublisher
+{
+
+	public:
+
+		SnapshotPublisher();
+		~SnapshotPublisher();
+
+		//Name is what viewers attach with.
+		bool create(string name, unsigned int activeCapacity = VIEW_ACTIVE_ENTRIES, unsigned int restingCapacity = VIEW_RESTING_ENTRIES);
+		void close();
+
+		//Simulation thread, from World::publish.
+		void publish(const WorldSnapshot& snapshot);
+		void publishResting(const SleepingLayer& layer, unsigned long long step);
+		//A viewer is watching that hasn't been sent the resting layer, the
+		//world should build one even though nothing has changed.
+		bool wantsResting();
+		//Once, before the world starts stepping.
+		void publishTerrain(const TerrainSettings& settings);
+
+		const PublishStats& getStats();
+		void printStats();
+
+	private:
+
+		bool checkWatched(unsigned long long step);
+		unsigned int meshIndex(Object* object);
+		void writeSlot(ViewSlotHeader* slot, unsigned int capacity, const vector<SnapshotEntry>& entries, unsigned long long step, double stepMilliseconds);
+
+		SharedMemory memory;
+		string name;
+
+		//Meshes published so far, by position in the shared table.
+		vector<Mesh*> meshes;
+		vector<Texture*> textures;
+		vector<EntityKind> kinds;
+		unsigned int lastMesh;
+
+		unsigned long long lastHeartbeat;
+		unsigned long long lastHeartbeatStep;
+		bool restingSent;
+
+		PublishStats stats;
+
+};
+
+#endif
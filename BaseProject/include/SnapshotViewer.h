@@ -0,0 +1,72 @@
+#ifndef SNAPSHOTVIEWER_H
+#define SNAPSHOTVIEWER_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include "include/World.h"
+#include "include/SharedMemory.h"
+#include "include/ViewLayout.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//What the viewer has seen so far.
+struct ViewerStats
+{
+	unsigned long long frames;
+	unsigned long long readRetries;
+	unsigned long long staleFrames;	//drawn without a clean read of some slot
+	unsigned long long activeStep;
+	unsigned long long restingStep;
+	double stepMilliseconds;
+	double restingMilliseconds;
+};
+
+//Draws a world running in another process from what its SnapshotPublisher
+//puts in shared memory. Entries go straight from the mapping into the
+//render queue through stand-in objects for each published mesh, nothing is
+//copied out first. A slot that changes while it's being read has its draws
+//taken back out of the queue and is read again.
+class SnapshotViewer
+{
+
+	public:
+
+		SnapshotViewer();
+		~SnapshotViewer();
+
+		//Returns false if nothing is published under that name.
+		bool attach(string name);
+		void detach();
+
+		//Render thread, draws the latest published step and resting layer.
+		void submitDraws(MatrixStack& projectionStack, RenderQueue* queue);
+
+		//False once the world has stopped publishing.
+		bool isLive();
+		//Goes up with everything new published, for on-demand drawing.
+		unsigned long long getChangeCount();
+		//The world's terrain, false if it has none.
+		bool getTerrain(TerrainSettings& settings);
+
+		const ViewerStats& getStats();
+		void printStats();
+
+	private:
+
+		bool drawSlot(ViewSlotHeader* slot, unsigned int capacity, unsigned long long& step, double& stepMilliseconds, MatrixStack& projectionStack, RenderQueue* queue);
+		Object* proxyFor(unsigned int mesh);
+
+		SharedMemory memory;
+		string name;
+
+		//Stand-ins supplying the program and mesh for each published mesh,
+		//made the first time an entry needs one.
+		vector<Object*> proxies;
+
+		ViewerStats stats;
+
+};
+
+#endif
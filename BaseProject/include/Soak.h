@@ -0,0 +1,23 @@
+#ifndef SOAK_H
+#define SOAK_H
+
+#include <stdio.h>
+#include "include/World.h"
+#include "include/Arena.h"
+#include "include/MemoryStats.h"
+
+//Birds per round on top of the scene's own, and steps each round runs for.
+#define SOAK_BIRDS 64
+#define SOAK_STEPS 300
+//Rounds before the baseline is taken, so every pool has reached its size.
+#define SOAK_WARMUP_ROUNDS 3
+//Resident growth allowed for allocator noise before it counts as a leak.
+#define SOAK_RESIDENT_SLACK (4 * 1024 * 1024)
+
+//Headless long-run check. Builds a world, spawns a flock, steps it, loads a
+//mesh and tears it all down again, over and over, failing as soon as any
+//tracked memory category doesn't come back to where it started or the
+//process keeps growing. Returns the process exit code.
+int runSoak(double seconds);
+
+#endif
@@ -0,0 +1,45 @@
+/*
+A fixed size single-producer single-consumer ring.
+push() is only ever called from one thread and pop() from one other, neither
+locks. The capacity must be a power of two; push() fails rather than blocks
+when the ring is full.
+*/
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+
+template <class T, unsigned int CAPACITY>
+class SpscRing
+{
+
+    T items_[CAPACITY];
+    std::atomic<unsigned int> head_;
+    std::atomic<unsigned int> tail_;
+
+public:
+
+    SpscRing() : head_(0), tail_(0) {}
+
+    bool push(const T &item)
+    {
+        unsigned int tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == CAPACITY)
+            return false;
+        items_[tail & (CAPACITY - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        unsigned int head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+            return false;
+        item = items_[head & (CAPACITY - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif //SPSCRING_H
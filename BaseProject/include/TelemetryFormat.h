@@ -0,0 +1,126 @@
+#ifndef TELEMETRYFORMAT_H
+#define TELEMETRYFORMAT_H
+
+#include <vector>
+
+using namespace std;
+
+//The telemetry file, written by TelemetryRecorder and read by TelemetryReader:
+//
+//	TelemetryFileHeader | chunk * n | TelemetryIndexEntry * n
+//
+//A chunk is TELEMETRY_CHUNK_STEPS (or fewer) consecutive steps of every bird,
+//stored column by column. Positions and headings are quantised to integers,
+//each value is stored as the zigzagged difference from the same bird in the
+//step before (or the bird before it when the set of birds changed) in a
+//variable length integer, so a bird that barely moved costs a byte or two.
+//State bytes are run length coded.
+//Chunks can land in any order, the index at the end (or a scan of the
+//chunks, if the recorder never got to write it) puts them in step order.
+
+#define TELEMETRY_MAGIC "FLOCKTLM"
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_CHUNK_MAGIC 0x4B484354	//"TCHK"
+#define TELEMETRY_CHUNK_STEPS 32
+
+//Quantisation, in world units and degrees per step of the integer.
+#define TELEMETRY_POSITION_SCALE 0.0001
+#define TELEMETRY_HEADING_SCALE 0.01
+
+//Bits of a sample's state byte.
+#define TELEMETRY_FALLING 1
+#define TELEMETRY_CRASHED 2
+#define TELEMETRY_ASLEEP 4
+
+enum TelemetryColumn
+{
+	COLUMN_COUNTS,		//birds in each step
+	COLUMN_SAME_IDS,	//1 if a step has the same birds as the one before
+	COLUMN_IDS,			//only for steps that don't
+	COLUMN_X,
+	COLUMN_Y,
+	COLUMN_Z,
+	COLUMN_HEADING,
+	COLUMN_STATE,
+	NUM_TELEMETRY_COLUMNS
+};
+
+struct TelemetryFileHeader
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int headerBytes;
+	double stepsPerSecond;
+	double positionScale;
+	double headingScale;
+
+	//Filled in when the recording is closed, 0 until then.
+	unsigned long long indexOffset;
+	unsigned long long indexCount;
+};
+
+struct TelemetryChunkHeader
+{
+	unsigned int magic;
+	unsigned int numSteps;
+	unsigned long long firstStep;
+	unsigned int numSamples;
+	unsigned int payloadBytes;
+	unsigned int columnBytes[NUM_TELEMETRY_COLUMNS];
+};
+
+struct TelemetryIndexEntry
+{
+	unsigned long long firstStep;
+	unsigned int numSteps;
+	unsigned int reserved;
+	unsigned long long offset;
+	unsigned long long bytes;
+};
+
+//One bird in one step, as read back.
+struct TelemetrySample
+{
+	unsigned int bird;
+	float position[3];
+	float heading;
+	unsigned char state;
+};
+
+struct TelemetryFrame
+{
+	unsigned long long step;
+	double seconds;
+	vector<TelemetrySample> samples;
+};
+
+//Small numbers near zero either side, ready for a varint.
+inline unsigned int telemetryZigzag(int value) {
+	return ((unsigned int) value << 1) ^ (unsigned int) (value >> 31);
+}
+
+inline int telemetryUnzigzag(unsigned int value) {
+	return (int) (value >> 1) ^ -(int) (value & 1);
+}
+
+//Seven bits a byte, low first, top bit set on all but the last.
+inline void telemetryPutVarint(vector<unsigned char>& out, unsigned int value) {
+	while(value >= 0x80) {
+		out.push_back((unsigned char) (value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char) value);
+}
+
+inline bool telemetryGetVarint(const unsigned char*& in, const unsigned char* end, unsigned int& value) {
+	value = 0;
+	for(int shift = 0; shift < 35 && in < end; shift += 7) {
+		unsigned char byte = *in++;
+		value |= (unsigned int) (byte & 0x7F) << shift;
+		if(!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+#endif
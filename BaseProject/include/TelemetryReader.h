@@ -0,0 +1,45 @@
+#ifndef TELEMETRYREADER_H
+#define TELEMETRYREADER_H
+
+#include <stdio.h>
+#include "include/TelemetryFormat.h"
+#include "include/MappedFile.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//Reads a telemetry recording back. The file is mapped and only the chunks
+//covering the asked for time range are decoded.
+class TelemetryReader
+{
+
+	public:
+
+		TelemetryReader();
+		~TelemetryReader();
+
+		bool open(string fileName);
+		void close();
+
+		//Every recorded step with fromSeconds <= time < toSeconds, in step
+		//order. Time is the step count over the recording's step rate.
+		bool read(double fromSeconds, double toSeconds, vector<TelemetryFrame>& frames);
+
+		double getStepsPerSecond();
+		unsigned long long getFirstStep();
+		unsigned long long getLastStep();
+		int numChunks();
+
+	private:
+
+		bool decode(const TelemetryIndexEntry& entry, unsigned long long fromStep, unsigned long long toStep, vector<TelemetryFrame>& frames);
+		void scanChunks();
+
+		MappedFile file;
+		TelemetryFileHeader header;
+		vector<TelemetryIndexEntry> index;
+
+};
+
+#endif
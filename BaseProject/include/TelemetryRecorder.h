@@ -0,0 +1,109 @@
+#ifndef TELEMETRYRECORDER_H
+#define TELEMETRYRECORDER_H
+
+#include <stdio.h>
+#include "include/Bird.h"
+#include "include/TelemetryFormat.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+struct TelemetryStats
+{
+	unsigned long long stepsRecorded;
+	unsigned long long stepsDropped;	//no free chunk, the compressors fell behind
+	unsigned long long chunksWritten;
+	unsigned long long rawBytes;		//quantised samples before compression
+	unsigned long long fileBytes;
+	double recordMilliseconds;			//total time spent in record()
+	double compressMilliseconds;		//total, across the workers
+};
+
+//Records every bird's position, heading and state each step. The simulation
+//thread only quantises into a chunk from a fixed set; full chunks go to
+//worker threads to be compressed, and one writer thread puts them in the
+//file in the order they were filled. The lock only ever covers the queues,
+//never the compressing or the file. If every chunk is in use the steps are
+//dropped and counted, record() never waits on the workers.
+class TelemetryRecorder
+{
+
+	public:
+
+		TelemetryRecorder();
+		~TelemetryRecorder();
+
+		bool start(string fileName, double stepsPerSecond, int numWorkers = 2, int numChunks = 8);
+		//Writes whatever's left and the index, then closes the file.
+		void stop();
+		bool isRecording();
+
+		//Simulation thread, once per step.
+		void record(unsigned long long step, const vector<Bird*>& birds);
+
+		TelemetryStats getStats();
+		void printStats();
+
+	private:
+
+		//Raw columns for up to TELEMETRY_CHUNK_STEPS steps. Vectors keep their
+		//capacity between uses, so a warmed up recorder doesn't allocate.
+		struct Chunk
+		{
+			unsigned long long sequence;	//order it was filled in
+			unsigned long long firstStep;
+			unsigned int numSteps;
+			vector<unsigned int> counts;
+			vector<unsigned int> ids;
+			vector<int> columns[4];		//x, y, z, heading
+			vector<unsigned char> states;
+			vector<unsigned char> encoded[NUM_TELEMETRY_COLUMNS];
+		};
+
+		void workerLoop();
+		void writerLoop();
+		void encode(Chunk* chunk);
+		void write(Chunk* chunk);
+		Chunk* takeFreeChunk();
+		void submitCurrent();
+
+		FILE* file;
+		vector<Chunk> chunks;
+		vector<Chunk*> freeChunks;
+		deque<Chunk*> fullChunks;
+		vector<Chunk*> encodedChunks;
+		vector<TelemetryIndexEntry> index;
+		unsigned long long nextSequence;
+		unsigned long long nextWrite;
+
+		//Owned by the writer thread while it runs.
+		unsigned long long fileOffset;
+
+		//Owned by the simulation thread.
+		Chunk* current;
+
+		vector<thread> workers;
+		thread writer;
+		mutex lock;
+		condition_variable signal;
+		condition_variable encodedSignal;
+		bool stopping;
+
+		//Written by the simulation thread alone, read from anywhere.
+		atomic<unsigned long long> stepsRecorded;
+		atomic<unsigned long long> stepsDropped;
+		atomic<unsigned long long> rawBytes;
+		atomic<double> recordMilliseconds;
+
+		//The rest, under the lock.
+		TelemetryStats stats;
+
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <stdio.h>
+#include <math.h>
+#include "include/MemoryStats.h"
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+//The ground is a heightfield with no edge, cut into square tiles of
+//TERRAIN_TILE_CELLS cells a side. Heights come from the settings alone, so
+//any tile can be made again exactly whenever it's wanted and nothing about
+//the terrain has to be stored or sent anywhere but the settings.
+#define TERRAIN_TILE_SIZE 4.0
+#define TERRAIN_TILE_CELLS 32
+#define TERRAIN_TILE_SIDE (TERRAIN_TILE_CELLS + 1)
+#define TERRAIN_CELL_SIZE (TERRAIN_TILE_SIZE / TERRAIN_TILE_CELLS)
+
+//Layers of noise summed for the height, each twice as fine and half as
+//tall as the one before.
+#define TERRAIN_OCTAVES 5
+
+//Tiles a Terrain keeps before dropping the least recently queried.
+#define TERRAIN_MAX_TILES 64
+
+#define TERRAIN_NAME_BYTES 64
+
+//Plain data, so it can go in scene files and shared memory as it is.
+struct TerrainSettings
+{
+	unsigned int seed;
+	float baseHeight;	//heights are within relief of this
+	float relief;
+	float featureSize;	//across the largest hills
+	char texture[TERRAIN_NAME_BYTES];	//empty for none
+};
+
+//Height of the ground at a point, straight from the noise. Tiles are
+//sampled with this at their grid points and nowhere else.
+double terrainHeight(const TerrainSettings& settings, double x, double z);
+
+//Which tile a point is on, and a tile's key in a hash map.
+inline int terrainTileOf(double position) {
+	return (int) floor(position / TERRAIN_TILE_SIZE);
+}
+
+inline unsigned long long terrainTileKey(int x, int z) {
+	return ((unsigned long long) (unsigned int) x << 32) | (unsigned int) z;
+}
+
+//What a Terrain has done since it was created.
+struct TerrainStats
+{
+	unsigned long long queries;
+	unsigned long long tilesBuilt;
+	unsigned long long tilesDropped;
+	double buildMilliseconds;
+};
+
+//The simulation's side of the ground: height tiles made when a query first
+//lands on them and dropped least recently used first, so memory and the
+//cost of a query stay the same however far the ground goes. Heights between
+//samples follow the same two triangles a cell is drawn with, so the ground
+//birds touch is the ground that's drawn up close. One thread only.
+class Terrain
+{
+
+	public:
+
+		Terrain();
+		~Terrain();
+
+		void create(const TerrainSettings& terrainSettings);
+		void clear();
+		bool isEmpty();
+		const TerrainSettings& getSettings();
+
+		//Height and normal at count points, xyz each (y is ignored). Normals
+		//are xyz each, or NULL if they're not wanted. Flat ground at the
+		//base height when there's no terrain.
+		void sample(const float* points, int count, float* heights, float* normals);
+
+		int numTiles();
+		size_t numBytes();
+		const TerrainStats& getStats();
+		void printStats();
+
+	private:
+
+		struct Tile
+		{
+			int x;
+			int z;
+			unsigned long long lastUsed;
+			float heights[TERRAIN_TILE_SIDE * TERRAIN_TILE_SIDE];
+		};
+
+		Tile* findTile(int x, int z);
+		void buildTile(Tile& tile, int x, int z);
+		void sampleOne(const float* point, float* height, float* normal);
+
+		bool enabled;
+		TerrainSettings settings;
+
+		//Every slot is allocated up front, the map only says which tile is
+		//in which slot.
+		vector<Tile> tiles;
+		unordered_map<unsigned long long, int> slots;
+		unsigned long long useCount;
+		//Flocks are close together, most queries land where the last did.
+		Tile* lastTile;
+
+		TerrainStats stats;
+
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef TERRAINRENDERER_H
+#define TERRAINRENDERER_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include "include/CameraRig.h"
+#include "include/Terrain.h"
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+//Terrain is drawn out to TERRAIN_VIEW_DISTANCE from any camera, just inside
+//the far plane. Level 0 is the full grid and each level after it halves
+//the one before; a tile drops a level every time its distance doubles past
+//TERRAIN_LOD_DISTANCE.
+#define TERRAIN_VIEW_DISTANCE 24.0
+#define TERRAIN_LOD_DISTANCE 6.0
+#define TERRAIN_LODS 4
+
+//Meshes made a frame at most, nearest first.
+#define TERRAIN_BUILDS_PER_FRAME 8
+
+//World units one copy of the terrain's image covers.
+#define TERRAIN_TEXTURE_SIZE 1.25
+
+//The last update() and the meshes held after it.
+struct TerrainRenderStats
+{
+	unsigned int patches;		//tiles in range of a camera
+	unsigned int drawable;		//with a mesh on the GPU
+	unsigned int pending;		//meshes built and still uploading
+	unsigned int built;			//this frame
+	unsigned int released;		//this frame, out of range or replaced
+	unsigned int perLevel[TERRAIN_LODS];
+	unsigned long long vertices;
+	double buildMilliseconds;
+};
+
+//Draws the terrain round the cameras. Each tile in range has a mesh at the
+//level of detail its distance calls for, built on the CPU from the settings
+//and uploaded through the asset loader like any other mesh. A tile keeps
+//drawing what it has until its new mesh is on the GPU, and the skirt round
+//every mesh hangs down far enough to hide cracks where levels meet. Tiles
+//out of range are let go, so only the view distance decides what's held.
+//Render thread only.
+class TerrainRenderer
+{
+
+	public:
+
+		TerrainRenderer();
+		~TerrainRenderer();
+
+		//Needs a GL context, for the programs and the texture.
+		void create(const TerrainSettings& terrainSettings);
+		void destroy();
+		bool isCreated();
+
+		//Work out which tiles every camera wants and at what level, then
+		//build a few of the missing meshes.
+		void update(CameraRig& cameras);
+		void submitDraws(MatrixStack& projectionStack, RenderQueue* queue);
+
+		//True once every tile in range is drawn at the level it wants.
+		bool isSettled();
+
+		const TerrainRenderStats& getStats();
+		void printStats();
+
+	private:
+
+		struct Patch
+		{
+			int x;
+			int z;
+			double distance;
+			int wantedLevel;
+			unsigned long long seen;
+
+			//Drawn with this, and the one replacing it while it uploads.
+			Mesh* mesh;
+			int level;
+			Mesh* pending;
+			int pendingLevel;
+			Object* object;
+		};
+
+		//Tiles with nothing to draw first, then nearest.
+		static bool buildsFirst(const Patch* a, const Patch* b);
+
+		Mesh* buildMesh(int x, int z, int level);
+		void releasePatch(Patch& patch);
+		void notePatch(int x, int z, double distance, bool inView);
+
+		bool created;
+		TerrainSettings settings;
+		Object* prototype;
+		unordered_map<unsigned long long, Patch> patches;
+		unsigned long long frame;
+
+		//Per-frame scratch, kept to save allocating.
+		vector<Patch*> wanting;
+		vector<GLdouble> positions;
+		vector<GLfloat> texCoords;
+		vector<GLuint> indices;
+
+		TerrainRenderStats stats;
+
+};
+
+#endif
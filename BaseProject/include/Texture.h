@@ -0,0 +1,87 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include "include/MappedFile.h"
+#include "include/TextureCompiler.h"
+#include "include/MemoryStats.h"
+#include <string>
+#include <vector>
+#include <atomic>
+
+using namespace std;
+
+//Where a texture is in its life from source image to GPU.
+enum TextureState
+{
+	TEXTURE_QUEUED,		//waiting for a worker thread
+	TEXTURE_MAPPED,		//cache mapped, waiting for upload
+	TEXTURE_UPLOADING,	//some levels sent, the smallest first
+	TEXTURE_READY,		//every level on the GPU, cache unmapped
+	TEXTURE_EVICTED,	//dropped from the GPU to stay in budget
+	TEXTURE_FAILED
+};
+
+//An image for objects to be drawn with. prepare() runs on a worker: it
+//brings the source's cache up to date, transcoding only when the source has
+//changed, and maps it. upload() must be called on the thread owning the
+//context and hands the levels to GL straight from the mapping, unmapping
+//once the last is up. An evicted texture is prepared again from its cache
+//the next time it's wanted.
+class Texture
+{
+
+	public:
+
+		Texture(string sourceFile);
+		~Texture();
+
+		string fileName;
+
+		void prepare();
+
+		//Send up to byteBudget bytes, a row of blocks at a time (always at
+		//least one), returns how many were sent.
+		GLuint upload(GLuint byteBudget);
+		void evict();
+
+		TextureState getState();
+		void setState(TextureState state);
+
+		//Drawable once its smallest level is up, the rest sharpen it as
+		//they arrive.
+		bool isDrawable();
+		GLuint getName();
+		GLuint getResidentBytes();
+		GLuint getMappedBytes();
+		//Whether the last prepare() had to transcode the source.
+		bool wasTranscoded();
+
+		//Render thread, the loader's frame this was last drawn in.
+		unsigned long long lastUsed;
+
+	private:
+
+		void uploadRows(unsigned int level, unsigned int firstRow, unsigned int numRows);
+
+		MappedFile cache;
+		const TextureHeader* header;
+		bool transcoded;
+
+		GLuint name;
+		//Levels from here down to 0 are still to send, this one from the
+		//given row of blocks on.
+		int nextLevel;
+		unsigned int nextRow;
+		GLuint residentBytes;
+
+		atomic<int> state;
+
+		//Decoded texels for drivers without BC1, a few rows at a time.
+		vector<unsigned char> decoded;
+
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef TEXTURECOMPILER_H
+#define TEXTURECOMPILER_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//Source images are turned once into a cache file the GPU can take as it
+//lies: every mip level, block compressed, end to end. After that a run
+//only maps the cache and hands the levels over, nothing is decoded.
+//
+//	TextureHeader | level 0 | level 1 | ... | level numLevels - 1
+//
+//Every level starts on a TEXTURE_ALIGN boundary, files are native endian.
+//The source's size and modification time are kept so a changed source is
+//transcoded again, a cache with no source beside it is used as it is.
+//
+//Sources are uncompressed or run length encoded TGA (24 or 32 bit) and
+//binary PPM. Levels are BC1 (DXT1), 4x4 texel blocks of two 565 colours
+//and sixteen 2 bit picks between them, eight bytes a block.
+
+#define TEXTURE_MAGIC "FLOCKTEX"
+#define TEXTURE_VERSION 1
+#define TEXTURE_ALIGN 64
+#define TEXTURE_MAX_LEVELS 16
+#define TEXTURE_CACHE_EXTENSION ".ftex"
+
+//Level formats.
+#define TEXTURE_FORMAT_BC1 1
+
+//Bytes of one BC1 block.
+#define TEXTURE_BLOCK_BYTES 8
+
+struct TextureLevel
+{
+	unsigned int width;
+	unsigned int height;
+	unsigned long long offset;
+	unsigned long long bytes;
+};
+
+struct TextureHeader
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int headerBytes;
+	unsigned int format;
+	unsigned int numLevels;
+	unsigned int width;
+	unsigned int height;
+
+	unsigned long long sourceBytes;
+	unsigned long long sourceModified;
+	unsigned long long fileBytes;
+
+	TextureLevel levels[TEXTURE_MAX_LEVELS];
+};
+
+//Where the cache for a source goes, beside it with the extension swapped.
+string textureCacheName(string sourceFile);
+
+//True if the cache is there, sound, and was made from the source as it is now.
+bool textureCacheCurrent(string sourceFile, string cacheFile);
+
+//Checks a cache already in memory against its own size, false if it
+//can't be used.
+bool textureHeaderValid(const void* data, size_t size);
+
+//Decode, mip and compress a source into its cache. The cache is written
+//beside the final name and moved over it, so a reader never sees half of it.
+bool compileTexture(string sourceFile, string cacheFile);
+
+//RGBA8 rows bottom up, as GL wants them.
+bool loadSourceImage(string fileName, vector<unsigned char>& rgba, unsigned int& width, unsigned int& height);
+
+//One 4x4 block of RGBA8 texels to and from BC1.
+void encodeBlockBC1(const unsigned char* texels, unsigned char* block);
+void decodeBlockBC1(const unsigned char* block, unsigned char* texels);
+
+inline unsigned long long textureLevelBytes(unsigned int width, unsigned int height) {
+	return (unsigned long long) ((width + 3) / 4) * ((height + 3) / 4) * TEXTURE_BLOCK_BYTES;
+}
+
+inline unsigned long long textureAlign(unsigned long long offset) {
+	return (offset + TEXTURE_ALIGN - 1) & ~(unsigned long long) (TEXTURE_ALIGN - 1);
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+//Slots per level and levels. Each level's slot covers a full turn of the
+//level below, so four levels of 256 reach 2^32 ticks. Anything further out
+//goes round the top level again until it's close enough.
+#define TIMER_WHEEL_BITS 8
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+//A timer as it comes due. Id and tag are whatever the caller scheduled it
+//with, a tag lets stale timers be told apart when ids are reused.
+struct TimerEntry
+{
+	unsigned long long due;
+	unsigned int id;
+	unsigned int tag;
+};
+
+//Hierarchical timer wheel. Scheduling is constant time, and a tick only
+//touches the one slot coming due (plus, every TIMER_WHEEL_SLOTS ticks, the
+//slot of the level above being spread back down), so a million sleeping
+//timers cost nothing until they're nearly up.
+//Timers can't be cancelled, callers tag them and ignore stale ones.
+//Not thread safe.
+class TimerWheel
+{
+
+	public:
+
+		TimerWheel();
+		~TimerWheel();
+
+		//Due at tick due, the next tick if that has already passed.
+		void schedule(unsigned long long due, unsigned int id, unsigned int tag);
+		//Move on a tick, adding every timer now due onto the end of fired.
+		void tick(vector<TimerEntry>& fired);
+
+		unsigned long long getNow()		{ return now;		}
+		unsigned int getPending()		{ return pending;	}
+
+	private:
+
+		void place(const TimerEntry& entry);
+
+		vector<TimerEntry> slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+		vector<TimerEntry> cascading;
+		unsigned long long now;
+		unsigned int pending;
+
+};
+
+#endif
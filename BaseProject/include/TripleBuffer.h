@@ -0,0 +1,63 @@
+/*
+A lock-free triple buffer for handing the latest value from one producer
+thread to one consumer thread.
+The producer always has a slot of its own to write, the consumer always has a
+slot of its own to read, and the third sits between them. Publishing swaps the
+producer's slot with the middle one, reading swaps the middle with the
+consumer's, so neither side ever waits on the other. Values the consumer was
+too slow to see are simply overwritten.
+*/
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+template <class T>
+class TripleBuffer
+{
+
+    T slots_[3];
+
+    //Index of the middle slot, FRESH is set when it holds an unread value.
+    std::atomic<int> middle_;
+    int back_;
+    int front_;
+
+    enum { INDEX_MASK = 3, FRESH = 4 };
+
+public:
+
+    TripleBuffer() : middle_(1), back_(0), front_(2) {}
+
+    /* producer: the slot to fill next, then publish() it */
+    T& back() { return slots_[back_]; }
+
+    void publish()
+    {
+        int previous = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+        back_ = previous & INDEX_MASK;
+    }
+
+    /* consumer: pick up the newest published value if there is one, and
+    return the slot to read. It stays valid until the next call. */
+    const T& read()
+    {
+        if (middle_.load(std::memory_order_relaxed) & FRESH)
+            {
+                int previous = middle_.exchange(front_, std::memory_order_acq_rel);
+                front_ = previous & INDEX_MASK;
+            }
+        return slots_[front_];
+    }
+
+    /* consumer: true if publish() has been called since the last read() */
+    bool hasFresh() const
+    {
+        return (middle_.load(std::memory_order_relaxed) & FRESH) != 0;
+    }
+
+    /* before any thread starts, e.g. to size every slot up front */
+    T& slot(int i) { return slots_[i]; }
+};
+
+#endif //TRIPLEBUFFER_H
@@ -0,0 +1,140 @@
+#ifndef VIEWLAYOUT_H
+#define VIEWLAYOUT_H
+
+#include <GL/glew.h>
+#include "include/Terrain.h"
+#include <stddef.h>
+#include <atomic>
+#include <string>
+
+using namespace std;
+
+//The shared memory a running world publishes what it looks like through,
+//for viewers in other processes. Plain data and lock-free atomics only:
+//
+//	ViewHeader | ViewMesh * VIEW_MAX_MESHES |
+//	(ViewSlotHeader + ViewEntry * activeCapacity) * VIEW_SLOTS |
+//	(ViewSlotHeader + ViewEntry * restingCapacity) * VIEW_SLOTS
+//
+//Awake birds go out every step, what's resting (sleeping birds and the
+//scenery) only when it changes. Each is written round a ring of seqlocked
+//slots, so a viewer reading the latest one is only torn if the world
+//laps the whole ring while it reads.
+
+#define VIEW_MAGIC 0x464C4B56	//"FLKV"
+#define VIEW_VERSION 3
+#define VIEW_SLOTS 3
+#define VIEW_MAX_MESHES 64
+#define VIEW_NAME_BYTES 64
+
+//Room published by default, in entries (a part of a bird or a static).
+#define VIEW_ACTIVE_ENTRIES 65536
+#define VIEW_RESTING_ENTRIES 131072
+
+//Steps without a viewer heartbeat before nobody counts as watching.
+#define VIEW_DETACH_STEPS 120
+
+struct ViewHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int activeCapacity;
+	unsigned int restingCapacity;
+
+	//Meshes are only ever added, a count includes everything below it.
+	atomic<unsigned int> numMeshes;
+
+	//Slots written last.
+	atomic<unsigned int> latestActive;
+	atomic<unsigned int> latestResting;
+	//Goes up with every slot written, for viewers drawing on demand.
+	atomic<unsigned long long> published;
+
+	//Viewers attach and detach through the count and bump the heartbeat
+	//every frame, one that dies without detaching times out.
+	atomic<unsigned int> viewers;
+	atomic<unsigned long long> heartbeat;
+
+	//Cleared by the world when it stops publishing for good.
+	atomic<bool> live;
+
+	//The world's ground, if it has terrain. Heights come from the settings
+	//alone, so viewers build their own; they're written before the flag.
+	atomic<bool> hasTerrain;
+	TerrainSettings terrain;
+};
+
+//What to draw an entry with, the mesh's file, its texture's (empty for
+//none) and the kind of object.
+struct ViewMesh
+{
+	char fileName[VIEW_NAME_BYTES];
+	char texture[VIEW_NAME_BYTES];
+	int kind;
+};
+
+struct ViewEntry
+{
+	unsigned int mesh;
+	GLfloat modelView[16];
+	GLfloat position[3];
+	GLfloat flap[4];
+};
+
+struct ViewSlotHeader
+{
+	//Odd while the world is writing, readers retry if it moved under them.
+	atomic<unsigned int> sequence;
+	unsigned int count;
+	unsigned int dropped;
+	unsigned long long step;
+	double stepMilliseconds;
+};
+
+//Keep every piece on its own cache lines.
+inline size_t viewAlign(size_t bytes) {
+	return (bytes + 63) & ~(size_t) 63;
+}
+
+inline size_t viewSlotBytes(unsigned int capacity) {
+	return viewAlign(sizeof(ViewSlotHeader)) + viewAlign(capacity * sizeof(ViewEntry));
+}
+
+inline size_t viewRegionBytes(unsigned int activeCapacity, unsigned int restingCapacity) {
+	return viewAlign(sizeof(ViewHeader)) + viewAlign(VIEW_MAX_MESHES * sizeof(ViewMesh))
+		+ VIEW_SLOTS * (viewSlotBytes(activeCapacity) + viewSlotBytes(restingCapacity));
+}
+
+//The shared memory name for a published world, as given on the command line.
+inline string viewMemoryName(string name) {
+#ifdef _WIN32
+	return "Local\\flockview-" + name;
+#else
+	return "/flockview-" + name;
+#endif
+}
+
+inline ViewHeader* viewHeader(void* base) {
+	return (ViewHeader*) base;
+}
+
+inline ViewMesh* viewMeshes(void* base) {
+	return (ViewMesh*) ((char*) base + viewAlign(sizeof(ViewHeader)));
+}
+
+inline ViewSlotHeader* viewActiveSlot(void* base, unsigned int slot) {
+	return (ViewSlotHeader*) ((char*) base + viewAlign(sizeof(ViewHeader)) + viewAlign(VIEW_MAX_MESHES * sizeof(ViewMesh))
+		+ slot * viewSlotBytes(viewHeader(base)->activeCapacity));
+}
+
+inline ViewSlotHeader* viewRestingSlot(void* base, unsigned int slot) {
+	ViewHeader* header = viewHeader(base);
+	return (ViewSlotHeader*) ((char*) base + viewAlign(sizeof(ViewHeader)) + viewAlign(VIEW_MAX_MESHES * sizeof(ViewMesh))
+		+ VIEW_SLOTS * viewSlotBytes(header->activeCapacity) + slot * viewSlotBytes(header->restingCapacity));
+}
+
+inline ViewEntry* viewSlotEntries(ViewSlotHeader* slot) {
+	return (ViewEntry*) ((char*) slot + viewAlign(sizeof(ViewSlotHeader)));
+}
+
+#endif
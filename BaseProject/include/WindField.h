@@ -0,0 +1,77 @@
+#ifndef WINDFIELD_H
+#define WINDFIELD_H
+
+#include <stdio.h>
+#include "include/MemoryStats.h"
+#include <vector>
+
+using namespace std;
+
+//Steps between wind key frames. The wind blends smoothly from one key
+//frame to the next over this many steps.
+#define WIND_KEY_STEPS 120
+
+//Key frames kept at once: the two being blended and the one being built.
+#define WIND_FRAMES 3
+
+//A time varying wind over a box, as a grid of velocities. Each key frame is
+//the curl of a noise potential, so the wind swirls without piling up or
+//draining anywhere. The next key frame but one is built a slice at a time
+//alongside the steps, so no single step pays for a whole frame.
+//Key frames only depend on the seed and their number, a world restored at
+//any step gets exactly the wind it would have had.
+class WindField
+{
+
+	public:
+
+		WindField();
+		~WindField();
+
+		//Nodes per side is resolution + 1. Frames are built on the first update().
+		void create(const float* low, const float* high, int resolution, unsigned int seed);
+		bool isEmpty();
+
+		//Simulation thread, once per step before sampling.
+		void update(unsigned long long step);
+
+		//Velocity at count points, xyz each in and out. Points outside the box
+		//get the wind at its edge.
+		void sample(const float* points, int count, float* velocities) const;
+
+		size_t numBytes();
+		void printStats();
+
+	private:
+
+		void buildFrame(long long key);
+		void buildUnit(long long key, int unit);
+		int numUnits();
+
+		int nodeIndex(int x, int y, int z) const;
+
+		float origin[3];
+		float inverseSpacing[3];
+		float spacing[3];
+		int nodes[3];
+		unsigned int seed;
+
+		//Velocities as xyz and a spare lane per node, so each node is a
+		//single four float load.
+		vector<float> frames[WIND_FRAMES];
+		long long frameKeys[WIND_FRAMES];
+		vector<float> blended;
+
+		//The frame being built: its key and how many units are done. The
+		//first half of the units fill in the potential a z slice at a time,
+		//the second half take its curl.
+		vector<float> potential;
+		long long buildingKey;
+		int unitsDone;
+		int unitsPerStep;
+
+		double buildMilliseconds;
+
+};
+
+#endif
@@ -1,5 +1,5 @@
 #ifndef WING_H
-#define WING
+#define WING_H
 
 #include <stdio.h>
 #include <GL/glew.h>
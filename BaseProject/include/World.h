@@ -0,0 +1,323 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <stdio.h>
+#include "include/Bird.h"
+#include "include/TripleBuffer.h"
+#include "include/SpscRing.h"
+#include "include/Checkpoint.h"
+#include "include/MappedFile.h"
+#include "include/TelemetryRecorder.h"
+#include "include/DistanceField.h"
+#include "include/WindField.h"
+#include "include/BehaviourScheduler.h"
+#include "include/BirdScripts.h"
+#include "include/SceneFile.h"
+#include "include/Terrain.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <queue>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+class SnapshotPublisher;
+
+//Birds fly within +-WORLD_HALF_SIZE on every axis.
+#define WORLD_HALF_SIZE 2.0
+
+//Obstacle field resolution and reach, and how birds react to it: they start
+//turning away inside OBSTACLE_AVOID_DISTANCE, up to OBSTACLE_MAX_TURN degrees
+//a step right up against something.
+#define OBSTACLE_VOXEL_SIZE 0.1f
+#define OBSTACLE_TRUNCATION 0.75f
+#define OBSTACLE_AVOID_DISTANCE 0.65
+#define OBSTACLE_MAX_TURN 6.0
+
+//What create() builds when not told otherwise, relative to the working
+//directory like the meshes it names.
+#define DEFAULT_SCENE_FILE "scenes/default.scene"
+
+//A bird landing wakes anything resting within CONTACT_RADIUS of it. Resting
+//birds are kept in a grid of cells that size over the ground plan, so only
+//the cells round a landing are looked at.
+#define CONTACT_RADIUS 0.5
+#define CONTACT_CELL_SIZE 0.5
+
+//Generations of sleeping layer changes kept, a layer further behind than
+//this is rebuilt whole rather than caught up.
+#define SLEEPING_LAYER_HISTORY 4
+
+//Wind grid cells along each side of the flying box, and how far a unit of
+//wind velocity carries a bird in one step.
+#define WIND_RESOLUTION 16
+#define WIND_STRENGTH 0.004
+
+//One drawable in a snapshot. The object pointer is only used for its render
+//data (program, mesh, flap), everything the simulation changes is copied.
+struct SnapshotEntry
+{
+	Object* object;
+	GLfloat modelView[16];
+	GLfloat position[3];
+	GLfloat flap[4];
+};
+
+//Everything the render thread needs from one simulation step.
+struct WorldSnapshot
+{
+	vector<SnapshotEntry> entries;
+
+	unsigned long long step;
+	double stepMilliseconds;
+	chrono::steady_clock::time_point published;
+
+	unsigned int activeBirds;
+	unsigned int sleepingBirds;
+};
+
+//Entries for everything asleep: the static scenery, then BIRD_SNAPSHOT_ENTRIES
+//for each resting bird in the order the World keeps them. These don't change
+//from step to step, so they're only republished when something falls asleep
+//or wakes up, and then only the birds that moved are rewritten.
+struct SleepingLayer
+{
+	vector<SnapshotEntry> entries;
+	//Which change to the layer this is up to.
+	unsigned long long generation;
+};
+
+//A bird reaching the ground this step, anything resting nearby is disturbed.
+struct Landing
+{
+	double centre[3];
+};
+
+//Input is queued for the simulation thread rather than applied directly.
+enum WorldCommandType
+{
+	COMMAND_STEER,	//value is the angle to turn by
+	COMMAND_FALL,	//value is non-zero for a straight drop
+	COMMAND_WIND,	//value is the wind strength, 0 for calm
+	COMMAND_SCRIPT,	//value is the BirdScriptKind every bird runs from now on
+	COMMAND_PRINT_STATS	//value is unused, prints what only the simulation thread may read
+};
+
+struct WorldCommand
+{
+	WorldCommandType type;
+	double value;
+};
+
+//Sim step to swap latency, measured on the render thread.
+struct LatencyStats
+{
+	double lastMilliseconds;
+	double averageMilliseconds;
+	double maxMilliseconds;
+	unsigned long long framesPresented;
+	unsigned long long stepsSkipped;
+};
+
+//Owns the scene and steps it on its own thread. Each step is published
+//through a triple buffer so the render thread always picks up the latest
+//complete state without either side waiting on the other.
+class World
+{
+
+	public:
+
+		//A headless world never touches GL, for soak runs and tools.
+		World(bool headless = false);
+		~World();
+
+		//Build the scene, on the render thread since objects set up GL state.
+		//numBirds birds start in the middle, on top of any the scene places.
+		//An empty scene file name leaves out the scenery, and sceneBirds
+		//false leaves out the birds the scene places.
+		void create(int numBirds = 1, string sceneFile = DEFAULT_SCENE_FILE, bool sceneBirds = true);
+		//Add a scene's scenery and birds, before start() or while stepping by hand.
+		void loadScene(SceneFile& scene, bool sceneBirds = true);
+
+		//Adding and removing birds is only safe before start() or while
+		//stepping by hand.
+		Bird* spawnBird(double x, double y, double z);
+		Bird* adoptBird(const BirdRecord& record);
+		//Ids for new birds count up from here, so separate worlds can keep apart.
+		void setNextBirdId(unsigned int id);
+		//Export and remove every awake bird whose body has left [minX, maxX).
+		void takeBirdsOutside(double minX, double maxX, vector<BirdRecord>& taken);
+		int numBirds();
+
+		//Landings from the last step, and disturbing resting birds from outside.
+		const vector<Landing>& getLandings();
+		void wakeBirdsNear(double* centre, double radius);
+
+		//Distance to the scenery, baked when the world is created.
+		const DistanceField& getObstacles();
+
+		//Ground for the birds to land on, from the scene. Without it the
+		//ground is the bottom of the flying bounds. Only safe before start()
+		//or while stepping by hand.
+		void setTerrain(const TerrainSettings& settings);
+		bool hasTerrain();
+		const TerrainSettings& getTerrainSettings();
+
+		void start(double stepsPerSecond);
+		void stop();
+
+		//One simulation step and publish, normally run by the simulation thread.
+		void step();
+
+		bool sendCommand(WorldCommandType type, double value);
+
+		//Input for individual birds, by index into getBirds(). Only safe while
+		//stepping by hand, indices may be NULL for the first count birds.
+		void steerBirds(const unsigned int* indices, const double* angles, int count);
+		void fallBirds(const unsigned int* indices, const unsigned char* drops, int count);
+		const vector<Bird*>& getBirds();
+		unsigned long long getStepCount();
+
+		//Checkpoints. Saving and restoring directly is only safe before
+		//start() or while stepping by hand, a running world saves through
+		//requestCheckpoint() on its own thread between steps.
+		bool saveCheckpoint(string fileName);
+		bool restoreCheckpoint(string fileName);
+		void requestCheckpoint(string fileName);
+
+		//Every bird is recorded after each step while a recorder is set, NULL
+		//to stop. The recorder has to outlive the world or be unset first.
+		void setTelemetry(TelemetryRecorder* recorder);
+		//Each published step also goes out to viewers in other processes
+		//while a publisher is set, NULL to stop, and the terrain with the
+		//first. Same lifetime rule.
+		void setPublisher(SnapshotPublisher* publisher);
+
+		//Render thread only.
+		const WorldSnapshot& readSnapshot();
+		const SleepingLayer& readSleepingLayer();
+		void notePresented(const WorldSnapshot& snapshot);
+
+		//Goes up with every published step that would look different from
+		//the one before, safe from any thread.
+		unsigned long long getChangeCount();
+		//Render thread. Prints what's been presented straight away, the
+		//simulation's own stats follow from its thread before the next step.
+		void printStats();
+
+	private:
+
+		void run();
+		void processCommands();
+		void runScripts();
+		void publish(double stepMilliseconds);
+		void printSimulationStats();
+
+		//Activity, only awake birds are stepped. Every list a bird is in is
+		//indexed from the bird, so moving it between them is constant time.
+		void addBird(Bird* bird);
+		void sleepBird(int activeIndex);
+		void putToSleep(Bird* bird, unsigned long long sleepStep);
+		void wakeBird(Bird* bird);
+		void wakeAllBirds();
+		void wakeDueBirds();
+		void removeBird(Bird* bird);
+		void removeFromList(vector<Bird*>& list, Bird* bird);
+		void removeSleeping(Bird* bird);
+		void clearBirds();
+
+		//The sleeping layer, brought up to date in whichever buffer is next.
+		void writeSleepingLayer(SleepingLayer& layer);
+		void writeSleepingBird(SleepingLayer& layer, unsigned int index);
+		void noteSleepingSlot(unsigned int index);
+		void rebuildSleepingLayer();
+
+		void bakeObstacles();
+		void gatherFlock(int first = 0);
+		void avoidObstacles();
+		void followTerrain();
+		void applyWind();
+
+		bool headless;
+		unsigned int nextBirdId;
+
+		vector<Bird*> birds;
+		vector<Object*> statics;
+		//The ones the obstacle field is baked from.
+		vector<Object*> solidStatics;
+
+		vector<Bird*> activeBirds;
+		vector<Bird*> sleepingBirds;
+		bool sleepingChanged;
+		vector<Landing> landings;
+
+		//Resting birds by contact cell.
+		unordered_map<unsigned long long, vector<Bird*> > contactGrid;
+
+		//Slots of sleepingBirds changed by each generation of the sleeping
+		//layer, oldest first. A layer at sleepingValidFrom or later can be
+		//caught up from these, anything older is rebuilt.
+		vector<pair<unsigned long long, unsigned int> > sleepingEdits;
+		vector<unsigned int> pendingSleepingSlots;
+		unsigned long long sleepingGeneration;
+		unsigned long long sleepingValidFrom;
+
+		//Static scenery as a distance field, the wind, and per-step buffers
+		//for sampling them over the flock without allocating.
+		DistanceField obstacles;
+		WindField wind;
+		double windStrength;
+		vector<float> flockPoints;
+		vector<float> avoidDistances;
+		vector<float> avoidGradients;
+		vector<float> windVelocities;
+
+		//The ground, sampled the same way.
+		Terrain terrain;
+		vector<float> groundHeights;
+		vector<float> groundNormals;
+
+		//Timer wakeups, soonest step first, for a sleep serial rather than a
+		//bird. Sleepers only holds birds still in the sleep their timer is
+		//for, so timers for birds woken early or removed are skipped when
+		//they come up and never have to be searched for.
+		typedef pair<unsigned long long, unsigned long long> WakeTimer;
+		priority_queue<WakeTimer, vector<WakeTimer>, greater<WakeTimer> > wakeTimers;
+		unordered_map<unsigned long long, Bird*> sleepers;
+		unsigned long long nextSleepSerial;
+
+		//Behaviour scripts, and the birds they acted on this step.
+		BehaviourScheduler scripts;
+		vector<Bird*> scriptedBirds;
+
+		TripleBuffer<WorldSnapshot> snapshots;
+		TripleBuffer<SleepingLayer> sleepingLayers;
+		atomic<unsigned long long> changeCount;
+		SpscRing<WorldCommand, 256> commands;
+		unsigned long long stepCount;
+
+		mutex checkpointLock;
+		string pendingCheckpoint;
+		atomic<bool> checkpointRequested;
+
+		atomic<TelemetryRecorder*> telemetry;
+		atomic<SnapshotPublisher*> publisher;
+
+		thread simThread;
+		atomic<bool> running;
+		double stepInterval;
+
+		LatencyStats latency;
+		unsigned long long lastPresentedStep;
+		double lastStepMilliseconds;
+		unsigned int lastActiveBirds;
+		unsigned int lastSleepingBirds;
+
+};
+
+#endif
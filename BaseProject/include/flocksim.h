@@ -0,0 +1,86 @@
+/*
+flocksim, the simulation as a C library for analysis tools.
+
+A world made here is headless and stepped by the caller, on one thread. Its
+birds are laid out one after the other in memory, so positions, headings and
+fall state can be handed out as strided views straight over the simulation's
+own data: nothing is copied, a view sees every step as it happens and stays
+valid until the world is destroyed.
+
+To build it as a library compile every source except main.cpp with
+FLOCKSIM_BUILD_DLL defined (shared object or DLL). python/flocksim.py wraps
+it for NumPy.
+*/
+#ifndef FLOCKSIM_H
+#define FLOCKSIM_H
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#ifdef FLOCKSIM_BUILD_DLL
+#define FLOCKSIM_API __declspec(dllexport)
+#else
+#define FLOCKSIM_API
+#endif
+#else
+#define FLOCKSIM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct flocksim_world flocksim_world;
+
+enum flocksim_result
+{
+	FLOCKSIM_OK = 0,
+	FLOCKSIM_ERROR_ARGUMENT = -1,	/* NULL pointer or bird index out of range */
+	FLOCKSIM_ERROR_LAYOUT = -2		/* birds aren't evenly spaced, no view possible */
+};
+
+enum flocksim_type
+{
+	FLOCKSIM_FLOAT64,
+	FLOCKSIM_UINT8
+};
+
+/* count birds, each with components values of type side by side, starting
+at data and stride bytes apart */
+typedef struct flocksim_view
+{
+	void* data;
+	size_t count;
+	ptrdiff_t stride;
+	size_t components;
+	int type;
+} flocksim_view;
+
+/* numBirds spread at random (from seed) through the flying bounds */
+FLOCKSIM_API flocksim_world* flocksim_create(unsigned int numBirds, unsigned int seed);
+FLOCKSIM_API void flocksim_destroy(flocksim_world* world);
+
+FLOCKSIM_API void flocksim_step(flocksim_world* world, unsigned int steps);
+FLOCKSIM_API unsigned long long flocksim_step_count(flocksim_world* world);
+FLOCKSIM_API unsigned int flocksim_num_birds(flocksim_world* world);
+
+/* x, y, z of each bird's body as doubles */
+FLOCKSIM_API int flocksim_positions(flocksim_world* world, flocksim_view* view);
+/* heading about y in degrees, a double */
+FLOCKSIM_API int flocksim_headings(flocksim_world* world, flocksim_view* view);
+/* 1 while a bird is falling, a byte */
+FLOCKSIM_API int flocksim_falling(flocksim_world* world, flocksim_view* view);
+
+/* Batch input, like the keyboard but per bird. indices picks the birds (NULL
+for birds 0 to count-1); nothing is applied if any index is out of range.
+Birds already falling ignore input, as they do from the keyboard. */
+FLOCKSIM_API int flocksim_steer(flocksim_world* world, const unsigned int* indices, const double* angles, size_t count);
+FLOCKSIM_API int flocksim_fall(flocksim_world* world, const unsigned int* indices, const unsigned char* drops, size_t count);
+
+FLOCKSIM_API const char* flocksim_error_string(int result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,10 +3,25 @@
 #include <stdio.h>
 #include <GL/glew.h>
 #include <GL/glut.h>
-#include "include/Bird.h"
+#include "include/World.h"
+#include "include/Soak.h"
+#include "include/Shard.h"
+#include "include/ShardCoordinator.h"
+#include "include/DynamicResolution.h"
+#include "include/FrameScheduler.h"
+#include "include/LightClusters.h"
+#include "include/GpuFlock.h"
+#include "include/GpuParity.h"
+#include "include/HeadlessRun.h"
+#include "include/SnapshotPublisher.h"
+#include "include/SnapshotViewer.h"
+#include "include/CameraRig.h"
+#include "include/TerrainRenderer.h"
+#include "include/RandomRange.h"
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <vector>
+#include <string.h>
 
 using namespace std;
 
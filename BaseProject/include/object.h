@@ -1,5 +1,5 @@
 #ifndef OBJECT_H
-#define OBJECT
+#define OBJECT_H
 
 #include <stdio.h>
 #include <GL/glew.h>
@@ -7,6 +7,11 @@
 #define _USE_MATH_DEFINES
 #include "include/MatrixStack.h"
 #include "include/InitShader.h"
+#include "include/RenderQueue.h"
+#include "include/LightClusters.h"
+#include "include/AssetLoader.h"
+#include "include/EntityKind.h"
+#include "include/Pool.h"
 #include <math.h>
 #include <fstream>
 #include <sstream>
@@ -15,7 +20,50 @@
 
 using namespace std;
 
-#define BUFFER_OFFSET( offset )   ((GLvoid*) (offset))
+struct SnapshotEntry;
+class Bird;
+
+//Everything about an object's motion, as plain data so it can be copied
+//between processes (see BirdRecord).
+struct PartState
+{
+	double translation[3];
+	double translationSpeed[3];
+	double rotation[3];
+	double rotationSpeed[3];
+	double forwardSpeed;
+	double crashTravel;
+	int isCrashed;
+};
+
+//How deep each object's model-view stack goes.
+#define TRANSFORM_STACK_DEPTH 5
+
+//A model-view stack pooled together with the matrices it holds, so an
+//object's transforms are one allocation rather than two.
+struct TransformSlot
+{
+	MatrixStack stack;
+	GLdouble storage[16*TRANSFORM_STACK_DEPTH];
+
+	TransformSlot() : stack(TRANSFORM_STACK_DEPTH, storage) {}
+};
+
+//A shader program and where its per-frame uniforms are. Model-view and flap
+//are per-draw attributes, fed by the render queue.
+struct ShadingProgram
+{
+	GLuint program;
+	GLint projection;	// projection matrix uniform shader variable location
+	GLint time;			// animation time uniform, -1 for non-animated programs
+	GLint clusterView;	// which view point lights were clustered for
+};
+
+//The texture unit every program samples its object's texture from.
+#define DIFFUSE_TEXTURE_UNIT 0
+
+//Routes each triangle of a multi-view program to its view's viewport.
+#define VIEW_ROUTER_SHADER "shaders/viewRouter.glsl"
 
 class Object
 {
@@ -24,15 +72,40 @@ class Object
 		
 		int id;
 		string name;
-
-		Object(char* fileName, string objectName);
+		EntityKind kind;
+
+		//Objects come from a pool per kind, so parts of one kind that are
+		//updated together also sit together. Use these rather than new/delete.
+		static Object* create(char* fileName, string objectName, EntityKind objectKind);
+		static void destroy(Object* object);
+		static void printPoolStats();
+		static void reservePool(EntityKind kind, unsigned int count);
+		//Another object drawn as prototype is, sharing its mesh, programs and
+		//name but none of its motion. No file lookup or GL calls, for placing
+		//scenery in bulk.
+		static Object* createInstance(Object* prototype);
+
+		Object(char* fileName, string objectName, EntityKind objectKind);
+		Object(Object* prototype);
 		~Object();
 
 		bool isCrashed;
 
-		void updateDisplay(MatrixStack projectionStack, bool falling, bool reachedTop, 
-		bool staticDrop, bool inBounds, double objectCentre[]);
-		void setupData(int objectId);
+		//Simulation thread. Each bird's parts are stepped together, so its
+		//context is only fetched once.
+		static void updateBirds(Bird* const* birds, int count);
+		static void updateStatics(Object* const* objects, int count);
+		void writeSnapshot(SnapshotEntry& entry);
+
+		//Render thread, draws the object as it was in a snapshot.
+		void submitDraw(const SnapshotEntry& entry, MatrixStack& projectionStack, RenderQueue* queue);
+		void setupData(int objectId, const char* vertexShaderFile = "shaders/vertexShader.glsl");
+		//Draw with an image (TGA or PPM), loaded in the background. Objects
+		//without one are drawn plain.
+		void setTexture(const char* sourceFile);
+		//Draw with a mesh built in memory rather than one from a file, for
+		//objects created with a NULL file name. The caller owns the mesh.
+		void setMesh(Mesh* builtMesh);
 
 		MatrixStack* modelViewStack;
 
@@ -41,6 +114,7 @@ class Object
 		void setRotation(double x, double y, double z);
 		void setRotationSpeed(double x, double y, double z);
 		void setSpeed(double speed);
+		void setFlap(double phase, double frequency, double amplitude, double hinge);
 		void resetFall();
 		void initiateCrash();
 		
@@ -49,13 +123,17 @@ class Object
 		double* getRotation();
 		double* getRotationSpeed();
 		double getSpeed();
+		double getCrashTravel();
+		Mesh* getMesh();
+		Texture* getTexture();
+		const ShadingProgram& getShading(ShadingLevel level);
+		void skipCrashTravel(double steps);
+
+		void exportState(PartState& state);
+		void importState(const PartState& state);
 
 	private:
 	
-		int numVertices;
-		int numIndices;
-		int numNormals;
-
 		double crashTravel;
 		double objectForwardSpeed;
 
@@ -64,29 +142,32 @@ class Object
 		double currentRotation[3];
 		double currentRotationSpeed[3];
 		
-		GLdouble* calcNormal(GLdouble* p1, GLdouble* p2, GLdouble* p3);
-		void multiply(GLfloat *res, GLfloat *a, GLfloat *b);
 		void objectFall(bool spin);
-		void updateWings(MatrixStack projectionStack);
-		void readFile(char* fileName);
+		void clearMotion();
 
-		GLdouble* vertexPositions;
-		GLdouble* vertexNormals;
-		GLdouble* vertexColours;
-		GLuint* vertexIndices;
-		
-		GLuint  modelView;  // model-view matrix uniform shader variable location
-		GLuint  projection; // projection matrix uniform shader variable location
+		//Moves is false for scenery, which only has its transform built.
+		template <bool Moves>
+		void step(const StepContext& context);
+
+		//Shared with every other object using the same file, owned by the loader.
+		Mesh* mesh;
+		Texture* texture;
+
+		TransformSlot* transform;
+
+		static Pool<Object> pools[NUM_ENTITY_KINDS];
+		static Pool<TransformSlot> transformPool;
 		
-		GLuint numVertexPositionBytes();
-		GLuint numVertexNormalBytes();
-		GLuint numVertexColourBytes();
-		GLuint numVertexIndexBytes();
+		//Wing flap is evaluated in the vertex shader from these.
+		GLfloat flapParameters[4];
 
 		//----------------------------------------------------------------------------
-		GLuint vao;
-		GLuint program;
-		GLuint buffers[2];
+		//One program per shading level, picked by view depth when drawn,
+		//and the same drawing every view at once where that's supported.
+		ShadingProgram shading[NUM_SHADING_LEVELS];
+		ShadingProgram multiViewShading[NUM_SHADING_LEVELS];
+
+		void setupShading(ShadingProgram& use, const char* vertexShaderFile, const char* fragmentShaderFile, const char* geometryShaderFile, const char* defines);
 
 
 };
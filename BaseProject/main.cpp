@@ -3,11 +3,65 @@
 double camRotateValue = 0.0;
 double maxSpeed = 0.05;
 
-Bird* bird;
-Object* object;
-vector<Object*> fences;
+World* world;
+
+//Set from the command line, with shards the flock is simulated elsewhere.
+int shardCount = 0;
+int shardBirds = 10000;
+const char* restoreFile = NULL;
+const char* recordFile = NULL;
+const char* sceneFile = DEFAULT_SCENE_FILE;
+TelemetryRecorder telemetry;
+ShardCoordinator* shards = NULL;
+bool windBlowing = true;
+double frameTarget = 1000.0 / 60.0;
+double frameRate = 60.0;
+bool onDemand = false;
+int arenaLights = 128;
+int gpuBirds = 0;
+int parityBirds = 0;
+GpuFlock* gpuFlock = NULL;
+bool birdBeacons = true;
+int birdScript = SCRIPT_NONE;
+const char* publishName = NULL;
+const char* attachName = NULL;
+double headlessSeconds = -1.0;
+SnapshotPublisher publisher;
+SnapshotViewer* viewer = NULL;
+TerrainRenderer* terrain = NULL;
 
 MatrixStack projectionStack(5);
+MatrixStack viewStack(1);
+CameraRig cameras;
+RenderQueue renderQueue;
+DynamicResolution resolution;
+FrameScheduler scheduler;
+LightClusters lighting;
+vector<PointLight> lights;
+unsigned long long drawnChanges = 0;
+unsigned long long drawnViews = 0;
+
+//----------------------------------------------------------------------------
+//Birds for the GPU flock start out like any other, then live on the GPU.
+void startGpuFlock() {
+	double bounds[3] = { WORLD_HALF_SIZE, WORLD_HALF_SIZE, WORLD_HALF_SIZE };
+	vector<BirdRecord> records(gpuBirds);
+	srand(4321);
+	for(int i = 0; i < gpuBirds; i++) {
+		double x = randomRange(-WORLD_HALF_SIZE, WORLD_HALF_SIZE);
+		double y = randomRange(-1.0, 1.5);
+		double z = randomRange(-WORLD_HALF_SIZE, WORLD_HALF_SIZE);
+		Bird* bird = Bird::create(x, y, z, bounds);
+		bird->exportRecord(records[i]);
+		Bird::destroy(bird);
+	}
+
+	gpuFlock = new GpuFlock();
+	if(!gpuFlock->create(records)) {
+		delete gpuFlock;
+		gpuFlock = NULL;
+	}
+}
 
 //----------------------------------------------------------------------------
 
@@ -20,52 +74,206 @@ void init() {
 	//Grey Background
 	glClearColor(0.2, 0.2, 0.2, 1.0);
 
-	//Our bird
-	double bounds[3] = { 2.0, 2.0, 2.0 };
-	bird = new Bird(0, 0, 0, bounds);
+	//Render at whatever fraction of the window holds the frame time target.
+	resolution.setTarget(frameTarget);
+	resolution.create(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+
+	//Lights are clustered each frame, with a hand from a couple of threads.
+	lighting.create();
+	lighting.start(min(2, (int) thread::hardware_concurrency() - 1));
+
+	//Meshes load in the background, leave a core for the render thread.
+	assetLoader.start(thread::hardware_concurrency() - 1);
+
+	//Watching a world run by another process, ours stays empty and still.
+	if(attachName != NULL) {
+		world = new World();
+		world->create(0, "");
+		viewer = new SnapshotViewer();
+		if(!viewer->attach(attachName))
+			exit(EXIT_FAILURE);
+		return;
+	}
 
-	//The ground
-	object = new Object("plane.obj", "Ground");
-	object->setTranslation(0, -2, 0);
-	object->setupData(1);
+	//The bird and the scene. The simulation runs on its own thread from here.
+	world = new World();
+	world->create(shardCount > 0 || restoreFile != NULL ? 0 : 1, sceneFile);
+	if(restoreFile != NULL && !world->restoreCheckpoint(restoreFile))
+		world->spawnBird(0, 0, 0);
+
+	//Compression gets its own couple of threads, recording never holds up a step.
+	if(recordFile != NULL && telemetry.start(recordFile, 60.0, 2))
+		world->setTelemetry(&telemetry);
+	if(publishName != NULL && publisher.create(publishName))
+		world->setPublisher(&publisher);
+	world->start(60.0);
+
+	if(shardCount > 0) {
+		shards = new ShardCoordinator();
+		if(!shards->start(shardCount, shardBirds, sceneFile)) {
+			delete shards;
+			shards = NULL;
+		}
+	}
+
+	if(gpuBirds > 0)
+		startGpuFlock();
 
-	//Develop fences
-	for(int i = 0; i < 4; i++) {
-		fences.push_back(new Object("fence.obj", "Fence" + i));
-		fences.at(i)->setupData(2);
+	//Tiles paged in round the cameras, the world only knows the heights.
+	if(world->hasTerrain()) {
+		terrain = new TerrainRenderer();
+		terrain->create(world->getTerrainSettings());
+	}
+}
+
+//----------------------------------------------------------------------------
+//Checked by the scheduler in on-demand mode, a frame is only drawn if this
+//says there's something new to see.
+bool sceneChanged() {
+	//The shard and GPU flocks never rest, and meshes still loading replace
+	//placeholders, as do terrain tiles still coming in.
+	if(shards != NULL || gpuFlock != NULL)
+		return true;
+	if(terrain != NULL && !terrain->isSettled())
+		return true;
+	if(viewer != NULL && viewer->getChangeCount() != drawnViews)
+		return true;
+	const AssetStats& assets = assetLoader.getStats();
+	if(assets.meshesQueued > 0 || assets.meshesPending > 0)
+		return true;
+	return world->getChangeCount() != drawnChanges;
+}
+
+//----------------------------------------------------------------------------
+//A ring of coloured lights drifting around the arena, and a beacon over
+//every bird in flight.
+void gatherLights(const WorldSnapshot& snapshot) {
+	lights.clear();
+
+	double time = glutGet(GLUT_ELAPSED_TIME) / 1000.0;
+	for(int i = 0; i < arenaLights; i++) {
+		double angle = 2.0 * M_PI * i / arenaLights + time * 0.2;
+		PointLight light;
+		light.position[0] = (float) (cos(angle) * 3.0);
+		light.position[1] = (float) (0.3 + 0.2 * sin(angle * 3.0 + time));
+		light.position[2] = (float) (sin(angle) * 3.0);
+		light.radius = 1.0f;
+		light.colour[0] = (float) (0.5 + 0.5 * cos(angle));
+		light.colour[1] = (float) (0.5 + 0.5 * cos(angle + 2.0 * M_PI / 3.0));
+		light.colour[2] = (float) (0.5 + 0.5 * cos(angle + 4.0 * M_PI / 3.0));
+		light.intensity = 0.6f;
+		lights.push_back(light);
+	}
+
+	if(!birdBeacons)
+		return;
+	for(int i = 0; i < snapshot.entries.size(); i++) {
+		if(snapshot.entries[i].object->kind != KIND_BIRD_BODY)
+			continue;
+		PointLight light;
+		light.position[0] = snapshot.entries[i].position[0];
+		light.position[1] = snapshot.entries[i].position[1] + 0.3f;
+		light.position[2] = snapshot.entries[i].position[2];
+		light.radius = 0.6f;
+		light.colour[0] = 1.0f;
+		light.colour[1] = 0.8f;
+		light.colour[2] = 0.4f;
+		light.intensity = 0.8f;
+		lights.push_back(light);
 	}
-	//Setup fences around edge.
-	fences.at(0)->setRotation(0, 90, 0);
-	fences.at(1)->setRotation(0, 90, 0);
-	fences.at(0)->setTranslation(-2.5, -2, 0);
-	fences.at(1)->setTranslation(2.5, -2, 0);
-	fences.at(2)->setTranslation(-2.5, -2, 0);
-	fences.at(3)->setTranslation(2.5, -2, 0);
 }
 
 //----------------------------------------------------------------------------
 void display( void ) {
 
+	scheduler.beginFrame();
+	drawnChanges = world->getChangeCount();
+	if(viewer != NULL)
+		drawnViews = viewer->getChangeCount();
+
+	//Draw into the scaled down buffer, its size picked from recent frame times.
+	resolution.beginFrame();
+
 	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-	
-	//Load the camera projection
-	projectionStack.loadIdentity();
-	projectionStack.perspective(75, 1, 0.1, 25);
-	projectionStack.lookAt(sin(camRotateValue*2) * 5, 1, cos(camRotateValue*2) * 5, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
 
-	//Display the bird (and skeleton)
-	bird->updateObjectDisplays(projectionStack);
+	//Push whatever finished loading to the GPU, within this frame's budget.
+	assetLoader.drainUploads();
+
+	//The GPU flock steps here, on the render thread, at the simulation's rate.
+	if(gpuFlock != NULL)
+		gpuFlock->advance(glutGet(GLUT_ELAPSED_TIME) / 1000.0, 60.0);
 
-	//Display the plane (ground)
-	object->updateDisplay(projectionStack, false, true, false, true, NULL);
+	//The latest complete simulation step (bird, ground and fences).
+	const WorldSnapshot& snapshot = world->readSnapshot();
 	
-	//Display all fences
-	for(int i = 0; i < fences.size(); i++) {
-		fences.at(i)->updateDisplay(projectionStack, false, true, false, true, NULL);
+	//Place every camera in its part of the size we're actually rendering at.
+	//The main camera's projection picks depth and shading, its view alone
+	//is for lighting.
+	GLint target[4];
+	glGetIntegerv(GL_VIEWPORT, target);
+	cameras.update(camRotateValue, snapshot, target[2], target[3]);
+	const RenderView& mainView = cameras.getViews()[0];
+	projectionStack.loadMatrixf(mainView.projection);
+	viewStack.loadMatrixd(cameras.getViewMatrix(0));
+
+	//A viewer learns of the terrain from the world it's attached to.
+	TerrainSettings viewedTerrain;
+	if(terrain == NULL && viewer != NULL && viewer->getTerrain(viewedTerrain)) {
+		terrain = new TerrainRenderer();
+		terrain->create(viewedTerrain);
 	}
+	if(terrain != NULL)
+		terrain->update(cameras);
+
+	//Everything submits into the render queue, culled against every camera
+	//at once, and it sorts and draws them all on flush.
+	renderQueue.setShadingDistance(resolution.getShadingDistance());
+	renderQueue.beginFrame(cameras.getViews(), cameras.getNumViews(), glutGet(GLUT_ELAPSED_TIME) / 1000.0f);
+
+	for(int i = 0; i < snapshot.entries.size(); i++)
+		snapshot.entries[i].object->submitDraw(snapshot.entries[i], projectionStack, &renderQueue);
+
+	//Plus everything asleep, which only changes when something wakes.
+	const SleepingLayer& sleeping = world->readSleepingLayer();
+	for(int i = 0; i < sleeping.entries.size(); i++)
+		sleeping.entries[i].object->submitDraw(sleeping.entries[i], projectionStack, &renderQueue);
+
+	//The ground under it all.
+	if(terrain != NULL)
+		terrain->submitDraws(projectionStack, &renderQueue);
+
+	//And the flock from the shard processes.
+	if(shards != NULL)
+		shards->submitDraws(projectionStack, &renderQueue);
+
+	//Or the world another process is publishing.
+	if(viewer != NULL)
+		viewer->submitDraws(projectionStack, &renderQueue);
+
+	//Sort the lights into clusters for the main camera.
+	gatherLights(snapshot);
+	lighting.build(lights, viewStack.getMatrixd(), CAMERA_FOV, cameras.getAspect(0), CAMERA_NEAR, CAMERA_FAR,
+		mainView.viewport[2], mainView.viewport[3]);
+	lighting.upload();
+
+	renderQueue.flush();
+
+	//Drawn straight from the buffers its last step wrote, in the main view.
+	if(gpuFlock != NULL) {
+		glViewport(mainView.viewport[0], mainView.viewport[1], mainView.viewport[2], mainView.viewport[3]);
+		gpuFlock->draw(projectionStack.getMatrixf(), glutGet(GLUT_ELAPSED_TIME) / 1000.0f);
+		glViewport(target[0], target[1], target[2], target[3]);
+	}
+
+	//Scale up to the window.
+	resolution.endFrame();
 
 	glutSwapBuffers();
 
+	world->notePresented(snapshot);
+
+	scheduler.endFrame();
+
 }
 
 //----------------------------------------------------------------------------
@@ -75,6 +283,14 @@ void keyboard( unsigned char key, int x, int y ) {
 	//Quit
 	case 033: // Escape Key
 	case 'q': case 'Q':
+	world->stop();
+	world->setTelemetry(NULL);
+	world->setPublisher(NULL);
+	telemetry.stop();
+	delete viewer;
+	delete terrain;
+	if(shards != NULL)
+		shards->stop();
 	exit( EXIT_SUCCESS );
 	break;
 	
@@ -86,41 +302,173 @@ void keyboard( unsigned char key, int x, int y ) {
 	camRotateValue -= 0.1;
 	break;
 
-	//Drop the bird
+	//Drop the bird (handled on the simulation thread)
 	case 'x':
-	if(!bird->isFalling())
-		bird->fall(false);
+	world->sendCommand(COMMAND_FALL, 0);
+	if(shards != NULL) shards->sendCommand(COMMAND_FALL, 0);
+	if(gpuFlock != NULL) gpuFlock->sendCommand(COMMAND_FALL, 0);
 	break;
 	case 'z':
-	if(!bird->isFalling()) {
-		bird->fall(true);
-	}
+	world->sendCommand(COMMAND_FALL, 1);
+	if(shards != NULL) shards->sendCommand(COMMAND_FALL, 1);
+	if(gpuFlock != NULL) gpuFlock->sendCommand(COMMAND_FALL, 1);
+	break;
+
+	//Print render statistics for the last frame
+	case 'p':
+	renderQueue.printStats();
+	assetLoader.printStats();
+	world->printStats();
+	Object::printPoolStats();
+	MemoryStats::print();
+	resolution.printStats();
+	lighting.printStats();
+	scheduler.printStats();
+	if(telemetry.isRecording()) telemetry.printStats();
+	if(shards != NULL) shards->printStats();
+	if(gpuFlock != NULL) gpuFlock->printStats();
+	if(viewer != NULL) viewer->printStats();
+	if(terrain != NULL) terrain->printStats();
+	publisher.printStats();
+	break;
+
+	//Save the world, written by the simulation thread after its next step
+	case 'k':
+	world->requestCheckpoint("world.ckp");
+	break;
+
+	//Calm the wind, or let it blow again
+	case 'w':
+	windBlowing = !windBlowing;
+	world->sendCommand(COMMAND_WIND, windBlowing ? WIND_STRENGTH : 0.0);
+	if(shards != NULL) shards->sendCommand(COMMAND_WIND, windBlowing ? WIND_STRENGTH : 0.0);
+	break;
+
+	//Give every bird the next behaviour script, or none after the last
+	case 'b':
+	birdScript = (birdScript + 1) % NUM_SCRIPT_KINDS;
+	world->sendCommand(COMMAND_SCRIPT, birdScript);
+	if(shards != NULL) shards->sendCommand(COMMAND_SCRIPT, birdScript);
+	break;
+
+	//Hold the frame time target, or always render at full size and detail
+	case 'r':
+	resolution.setEnabled(!resolution.isEnabled());
+	break;
+
+	//Beacons over the birds, on or off
+	case 'l':
+	birdBeacons = !birdBeacons;
+	break;
+
+	//Another camera on screen, back to one after the last
+	case 'm':
+	cameras.setNumViews(cameras.getNumViews() % NUM_CAMERA_MODES + 1);
+	break;
+
+	//Only draw when something has changed, or draw every frame
+	case 'o':
+	scheduler.setOnDemand(!scheduler.isOnDemand());
 	break;
 
 	//Control the bird
 	case 'd':
-	if(!bird->isFalling())
-		bird->steerBird(-5);
+	world->sendCommand(COMMAND_STEER, -5);
+	if(shards != NULL) shards->sendCommand(COMMAND_STEER, -5);
+	if(gpuFlock != NULL) gpuFlock->sendCommand(COMMAND_STEER, -5);
 	break;
 	case 'a':
-	if(!bird->isFalling())
-		bird->steerBird(5);
+	world->sendCommand(COMMAND_STEER, 5);
+	if(shards != NULL) shards->sendCommand(COMMAND_STEER, 5);
+	if(gpuFlock != NULL) gpuFlock->sendCommand(COMMAND_STEER, 5);
 	break;
 
 	}
-	glutPostRedisplay();
+
+	//The camera or the scene may have changed, picked up on the next due frame.
+	scheduler.requestRedraw();
 }
 
 //----------------------------------------------------------------------------
 void reshape( int width, int height ) {
 
 	glViewport( 0, 0, width, height );
+	resolution.resize( width, height );
+	scheduler.requestRedraw();
 
 }
 
 //----------------------------------------------------------------------------
 int main( int argc, char **argv ) {
 
+	//Headless memory soak, no window or GL needed: --soak <seconds>
+	//Shards: --shards <processes> [--birds <total>]
+	//Carry on from a checkpoint: --restore <file>
+	//Record every bird's trajectory: --record <file>
+	//Frame time to hold by lowering resolution and detail: --frame-target <milliseconds>
+	//Frames a second to draw at: --fps <rate>, only when something changes: --on-demand
+	//Draw each packet on its own even where multi-draw works: --no-multi-draw
+	//Point lights around the arena: --lights <count>
+	//A flock simulated on the GPU as well: --gpu-flock <birds>
+	//Check the GPU flock against the CPU one and exit: --gpu-parity <birds>
+	//Scenery from a scene file: --scene <file>, turned binary and exit: --bake-scene <file> <binary file>
+	//Publish every step for viewers in other processes: --publish <name>
+	//Run with no window: --headless <seconds, 0 until interrupted> [--birds <count>] [--publish <name>]
+	//Watch a world another process publishes: --attach <name>
+	//Cameras on screen at once, orbit then chase then top-down: --views <count>
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--on-demand") == 0)
+			onDemand = true;
+		if(strcmp(argv[i], "--no-multi-draw") == 0)
+			renderQueue.setMultiDraw(false);
+	}
+	for(int i = 1; i < argc - 1; i++) {
+		if(strcmp(argv[i], "--soak") == 0)
+			return runSoak(atof(argv[i + 1]));
+		if(strcmp(argv[i], "--shards") == 0)
+			shardCount = atoi(argv[i + 1]);
+		if(strcmp(argv[i], "--birds") == 0)
+			shardBirds = atoi(argv[i + 1]);
+		if(strcmp(argv[i], "--restore") == 0)
+			restoreFile = argv[i + 1];
+		if(strcmp(argv[i], "--record") == 0)
+			recordFile = argv[i + 1];
+		if(strcmp(argv[i], "--frame-target") == 0)
+			frameTarget = atof(argv[i + 1]);
+		if(strcmp(argv[i], "--fps") == 0)
+			frameRate = atof(argv[i + 1]);
+		if(strcmp(argv[i], "--lights") == 0)
+			arenaLights = atoi(argv[i + 1]);
+		if(strcmp(argv[i], "--gpu-flock") == 0)
+			gpuBirds = atoi(argv[i + 1]);
+		if(strcmp(argv[i], "--gpu-parity") == 0)
+			parityBirds = atoi(argv[i + 1]);
+		if(strcmp(argv[i], "--scene") == 0)
+			sceneFile = argv[i + 1];
+		if(strcmp(argv[i], "--publish") == 0)
+			publishName = argv[i + 1];
+		if(strcmp(argv[i], "--attach") == 0)
+			attachName = argv[i + 1];
+		if(strcmp(argv[i], "--views") == 0)
+			cameras.setNumViews(atoi(argv[i + 1]));
+		if(strcmp(argv[i], "--headless") == 0)
+			headlessSeconds = atof(argv[i + 1]);
+
+		if(strcmp(argv[i], "--bake-scene") == 0 && i + 2 < argc) {
+			SceneFile scene;
+			return scene.load(argv[i + 1]) && scene.saveBinary(argv[i + 2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		//Started by a coordinator as one of its shards.
+		if(strcmp(argv[i], "--shard") == 0 && i + 2 < argc) {
+			Shard shard;
+			return shard.run(argv[i + 2], atoi(argv[i + 1]));
+		}
+	}
+
+	if(headlessSeconds >= 0.0)
+		return runHeadless(headlessSeconds, shardBirds, sceneFile, publishName);
+
 	glutInit( &argc, argv );
 	glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH );
 	glutInitWindowSize( 512, 512 );
@@ -128,11 +476,19 @@ int main( int argc, char **argv ) {
 
 	glewInit();
 
+	if(parityBirds > 0)
+		return runGpuParity(parityBirds, GPU_PARITY_STEPS, GPU_PARITY_TOLERANCE);
+
 	init();
 
-	glutIdleFunc( display );
+	//Frames are paced by the scheduler's timer rather than redrawn from the
+	//idle callback, which would spin a core flat out.
+	glutDisplayFunc( display );
 	glutKeyboardFunc( keyboard );
 	glutReshapeFunc( reshape );
+	scheduler.setOnDemand( onDemand );
+	scheduler.setChangeCheck( sceneChanged );
+	scheduler.start( frameRate );
 
 	glutMainLoop();
 
@@ -1,13 +1,75 @@
 #include "include/object.h"
+#include "include/World.h"
+#include "include/Bird.h"
+#include <string.h>
+
+Pool<Object> Object::pools[NUM_ENTITY_KINDS];
+Pool<TransformSlot> Object::transformPool(MEMORY_TRANSFORM_STACKS);
+
+Object* Object::create(char* fileName, string objectName, EntityKind objectKind) {
+	return pools[objectKind].create(fileName, objectName, objectKind);
+}
+
+Object* Object::createInstance(Object* prototype) {
+	return pools[prototype->kind].create(prototype);
+}
+
+void Object::destroy(Object* object) {
+	if(object != NULL)
+		pools[object->kind].destroy(object);
+}
+
+void Object::reservePool(EntityKind kind, unsigned int count) {
+	pools[kind].reserve(count);
+	transformPool.reserve(count);
+}
+
+void Object::printPoolStats() {
+	const char* names[NUM_ENTITY_KINDS] = { "static", "body", "head", "left wing", "right wing" };
+	for(int i = 0; i < NUM_ENTITY_KINDS; i++)
+		pools[i].printStats(names[i]);
+	transformPool.printStats("transform stacks");
+}
 
 //Constructor for the object, just initialises most variables.
-Object::Object(char* fileName, string objectName) {
+Object::Object(char* fileName, string objectName, EntityKind objectKind) {
+	id = 0;
 	name = objectName;
+	kind = objectKind;
 
-	numVertices = 0;
-	numIndices  = 0;
-	numNormals  = 0;
+	//Filled in by setupData, left empty for headless runs.
+	for(int i = 0; i < NUM_SHADING_LEVELS; i++) {
+		shading[i].program = multiViewShading[i].program = 0;
+		shading[i].projection = shading[i].time = shading[i].clusterView = -1;
+		multiViewShading[i] = shading[i];
+	}
 
+	clearMotion();
+	
+	//Loaded in the background, we draw a placeholder until it's ready.
+	//Without a file the mesh comes later, see setMesh.
+	mesh = fileName != NULL ? assetLoader.requestMesh(fileName) : NULL;
+	texture = NULL;
+}
+
+//Constructor for an instance of another object.
+Object::Object(Object* prototype) {
+	id = prototype->id;
+	name = prototype->name;
+	kind = prototype->kind;
+
+	for(int i = 0; i < NUM_SHADING_LEVELS; i++) {
+		shading[i] = prototype->shading[i];
+		multiViewShading[i] = prototype->multiViewShading[i];
+	}
+
+	clearMotion();
+	mesh = prototype->mesh;
+	texture = prototype->texture;
+}
+
+//At rest at the origin, with a transform of its own.
+void Object::clearMotion() {
 	isCrashed = false;
 	crashTravel = 150;
 	
@@ -20,130 +82,112 @@ Object::Object(char* fileName, string objectName) {
 	}
 	objectForwardSpeed = 0.0;
 
-	modelViewStack = new MatrixStack(5);
-	
-	readFile(fileName);
+	for(int i = 0; i < 4; i++)
+		flapParameters[i] = 0.0;
+
+	transform = transformPool.create();
+	modelViewStack = &transform->stack;
 }
 
 //Destructor.
 Object::~Object() {
 	
-	delete modelViewStack;
-	delete vertexPositions;
-	delete vertexNormals;
-	delete vertexColours;
-	delete vertexIndices;
+	transformPool.destroy(transform);
 
 }
 
-void Object::setupData(int objectId) {
+void Object::setupData(int objectId, const char* vertexShaderFile) {
 
 	id = objectId;
 
-	// Load shaders and use the resulting shader program
-	program = InitShader( "shaders/vertexShader.glsl", "shaders/pixelShader.glsl" );
-	glUseProgram( program );
-
-	modelView = glGetUniformLocation( program, "ModelView" );
-	projection = glGetUniformLocation( program, "Projection" );
+	// Load shaders and use the resulting shader programs
+	//Every object shares the same programs so the render queue can batch by them.
+	const char* pixelShaderFiles[NUM_SHADING_LEVELS] = { "shaders/pixelShader.glsl", "shaders/pixelShaderLow.glsl" };
+	string multiViewDefines = "#define MULTI_VIEW\n#define MAX_VIEWS " + to_string(MAX_VIEWS) + "\n";
+	for(int i = 0; i < NUM_SHADING_LEVELS; i++) {
+		setupShading(shading[i], vertexShaderFile, pixelShaderFiles[i], NULL, NULL);
+		if(RenderQueue::viewRoutingSupported())
+			setupShading(multiViewShading[i], vertexShaderFile, pixelShaderFiles[i], VIEW_ROUTER_SHADER, multiViewDefines.c_str());
+	}
 
-	// Create a vertex array object
-	glGenVertexArrays( 1, &vao );
-	glBindVertexArray( vao );
+}
 
-	// Create and initialize two buffer objects
-	glGenBuffers(2, buffers);
+void Object::setTexture(const char* sourceFile) {
+	texture = assetLoader.requestTexture(sourceFile);
+}
 
-	//one buffer for the vertices and colours
-	glBindBuffer( GL_ARRAY_BUFFER, buffers[0]);
-	glBufferData( GL_ARRAY_BUFFER, numVertexPositionBytes() + numVertexNormalBytes(), NULL, GL_STATIC_DRAW );
-	glBufferSubData( GL_ARRAY_BUFFER, 0, numVertexPositionBytes(), vertexPositions );
-	glBufferSubData( GL_ARRAY_BUFFER, numVertexPositionBytes(), numVertexNormalBytes(), vertexNormals);
+void Object::setMesh(Mesh* builtMesh) {
+	mesh = builtMesh;
+}
 
-	//one buffer for the indices
-	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
-	glBufferData( GL_ELEMENT_ARRAY_BUFFER, numVertexIndexBytes(), vertexIndices, GL_STATIC_DRAW );
+void Object::setupShading(ShadingProgram& use, const char* vertexShaderFile, const char* fragmentShaderFile, const char* geometryShaderFile, const char* defines) {
 
-	//Allow the program to communicate with the shader programs by passing and receiving refrences.
-	GLuint vPosition = glGetAttribLocation( program, "vPosition" );
-	glEnableVertexAttribArray( vPosition );
-	glVertexAttribPointer( vPosition, 4, GL_DOUBLE, GL_FALSE, 0, BUFFER_OFFSET(0) );
-	
-    GLuint vNormal = glGetAttribLocation( program, "vNormal" );
-    glEnableVertexAttribArray( vNormal );
-    glVertexAttribPointer( vNormal, 4, GL_DOUBLE, GL_FALSE, 0, BUFFER_OFFSET(numVertexPositionBytes()) );
+	GLuint program = GetShaderProgram( vertexShaderFile, fragmentShaderFile, geometryShaderFile, defines );
 
-    // Initialize shader lighting parameters
-    GLfloat light_position[] = { 1.0, 2.0, 0.0, 1.0 };
-	GLfloat light_ambient[] = { 0.2, 0.2, 0.6, 1.0 };
-	GLfloat light_diffuse[] = { 1.0, 1.0, 1.0, 1.0 };
-	GLfloat light_specular[] = { 1.0, 1.0, 1.0, 1.0};
+	use.program = program;
+	use.projection = glGetUniformLocation( program, "Projection" );
+	use.time = glGetUniformLocation( program, "Time" );
+	use.clusterView = glGetUniformLocation( program, "ClusterView" );
 
+	//The lights themselves come from the lighting block and textures, set
+	//up by LightClusters each frame; only the material is ours.
 	GLfloat material_ambient[] = { 0.0, 0.0, 1.0, 1.0 };
 	GLfloat material_diffuse[] = { 0.0, 0.0, 0.5, 1.0 };
 	GLfloat material_specular[] = { 0.5, 0.5, 1.0, 1.0 };
     float material_shininess = 20.0;
 
-    GLfloat ambient_product[4], diffuse_product[4], specular_product[4];
-
-    multiply(ambient_product, light_ambient, material_ambient);
-    multiply(diffuse_product, light_diffuse, material_diffuse);
-    multiply(specular_product , light_specular, material_specular);
-
-    glUniform4fv( glGetUniformLocation(program, "AmbientProduct"), 1, ambient_product );
-    glUniform4fv( glGetUniformLocation(program, "DiffuseProduct"), 1, diffuse_product );
-    glUniform4fv( glGetUniformLocation(program, "SpecularProduct"), 1, specular_product );
-    glUniform4fv( glGetUniformLocation(program, "LightPosition"), 1, light_position );
+    glUniform4fv( glGetUniformLocation(program, "MaterialAmbient"), 1, material_ambient );
+    glUniform4fv( glGetUniformLocation(program, "MaterialDiffuse"), 1, material_diffuse );
+    glUniform4fv( glGetUniformLocation(program, "MaterialSpecular"), 1, material_specular );
     glUniform1f( glGetUniformLocation(program, "Shininess"), material_shininess );
+	glUniform1i( glGetUniformLocation(program, "Diffuse"), DIFFUSE_TEXTURE_UNIT );
+	LightClusters::setupProgram(program);
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-}
-
-//Simple method for multiplication of material parameters
-void Object::multiply(GLfloat *res, GLfloat *a, GLfloat *b){
-  for (unsigned char i=0 ; i<4; i++) res[i] = a[i]*b[i];
 }
 
-void Object::updateDisplay(MatrixStack projectionStack, bool falling, bool reachedTop, 
-	bool staticDrop, bool inBounds, double objectCentre[]) {
+//Step the object's motion and rebuild its model-view matrix. Bird parts and
+//scenery are the only two instantiations, and scenery's has none of the
+//motion in it.
+template <bool Moves>
+inline void Object::step(const StepContext& context) {
 
 	//Load modelView Identity
 	modelViewStack->loadIdentity();
 
-	if(!reachedTop && !falling && !isCrashed)
-		currentTranslation[1] += currentTranslationSpeed[1];
-	if(isCrashed) {
-		crashTravel++;
-		if(objectForwardSpeed > 0.001)
-			objectForwardSpeed -= 0.001;
-		if(crashTravel > 150) {
-			isCrashed = false;
-			objectForwardSpeed = 0.02;
+	if(Moves) {
+		if(!context.reachedTop && !context.falling && !isCrashed)
+			currentTranslation[1] += currentTranslationSpeed[1];
+		if(isCrashed) {
+			crashTravel++;
+			if(objectForwardSpeed > 0.001)
+				objectForwardSpeed -= 0.001;
+			if(crashTravel > 150) {
+				isCrashed = false;
+				objectForwardSpeed = 0.02;
+			}
 		}
-	}
-		
-	//Are we dropping [straight] down? Initiate the drop.
-	if(staticDrop)
-		objectFall(false);
-	if(falling) {
-		if(inBounds && !staticDrop)
-			objectFall(true);
-		else if(!inBounds) 
+
+		//Are we dropping [straight] down? Initiate the drop.
+		if(context.staticDrop)
 			objectFall(false);
+		if(context.falling) {
+			if(context.inBounds && !context.staticDrop)
+				objectFall(true);
+			else if(!context.inBounds) 
+				objectFall(false);
+		}
 	}
 	
 	//OBJECT MOVEMENT AND ROTATION
-	if(objectCentre != NULL)
-		modelViewStack->translated(objectCentre[0], objectCentre[1], objectCentre[2]);
+	if(Moves)
+		modelViewStack->translated(context.centre[0], context.centre[1], context.centre[2]);
 
 	//Rotate the object based on it's rotation speed (and current rotation) AROUND AXI
-	if(!isCrashed) {
-		currentRotation[0] += currentRotationSpeed[0];
-		currentRotation[1] += currentRotationSpeed[1];
-		currentRotation[2] += currentRotationSpeed[2];
+	//Kept within a single turn so long sessions don't lose precision.
+	if(Moves && !isCrashed) {
+		currentRotation[0] = fmod(currentRotation[0] + currentRotationSpeed[0], 360.0);
+		currentRotation[1] = fmod(currentRotation[1] + currentRotationSpeed[1], 360.0);
+		currentRotation[2] = fmod(currentRotation[2] + currentRotationSpeed[2], 360.0);
 	}
 
 	//Rotate on all axi if we have changes from our rotation speed.
@@ -151,34 +195,91 @@ void Object::updateDisplay(MatrixStack projectionStack, bool falling, bool reach
 	modelViewStack->rotated(currentRotation[1], 0, 1, 0);
 	modelViewStack->rotated(currentRotation[2], 0, 0, 1);
 
-	if(objectCentre != NULL)
-		modelViewStack->translated(-objectCentre[0], -objectCentre[1], -objectCentre[2]);
+	if(Moves)
+		modelViewStack->translated(-context.centre[0], -context.centre[1], -context.centre[2]);
 
-	if(inBounds && !falling) {
-		//Steering motors
-		if(name != "Ground") {
-			currentTranslation[0] += sin(M_PI * currentRotation[1] / 180) * objectForwardSpeed;
-			currentTranslation[2] += cos(M_PI * currentRotation[1] / 180) * objectForwardSpeed;
-		}
+	//Steering motors
+	if(Moves && context.inBounds && !context.falling) {
+		currentTranslation[0] += sin(M_PI * currentRotation[1] / 180) * objectForwardSpeed;
+		currentTranslation[2] += cos(M_PI * currentRotation[1] / 180) * objectForwardSpeed;
+	}
+
+	//Carried by the wind, every part of a bird by the same amount.
+	if(Moves && !isCrashed) {
+		currentTranslation[0] += context.drift[0];
+		currentTranslation[1] += context.drift[1];
+		currentTranslation[2] += context.drift[2];
 	}
 
 	//Translate the object in space.
 	modelViewStack->translated(currentTranslation[0], currentTranslation[1], currentTranslation[2]);
 
-		
-	//Wing movements
-	if(name == "WingLeft" || name == "WingRight")
-		updateWings(projectionStack);
-	
-	glUniformMatrix4fv(modelView, 1, GL_FALSE, modelViewStack->getMatrixf());
-	glUniformMatrix4fv(projection, 1, GL_FALSE, projectionStack.getMatrixf());
-	
-	//Bind vao
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
-	//Indexing into vertices we need to use glDrawElements
-	glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, 0);
+	//Wing movements are left to the vertex shader (see setFlap).
+}
+
+//Update every part of every bird given, each bird's off its one context.
+void Object::updateBirds(Bird* const* birds, int count) {
+	for(int i = 0; i < count; i++) {
+		const StepContext& context = birds[i]->getStepContext();
+		for(int kind = FIRST_BIRD_KIND; kind < NUM_ENTITY_KINDS; kind++)
+			birds[i]->getPart((EntityKind) kind)->step<true>(context);
+	}
+}
+
+//Scenery only needs its transform built, nothing moves.
+void Object::updateStatics(Object* const* objects, int count) {
+	StepContext context = { false, true, false, true, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+	for(int i = 0; i < count; i++)
+		objects[i]->step<false>(context);
+}
+
+//Copy out what the render thread needs to draw us as we are now.
+void Object::writeSnapshot(SnapshotEntry& entry) {
+	entry.object = this;
+	memcpy(entry.modelView, modelViewStack->getMatrixf(), sizeof(entry.modelView));
+	entry.position[0] = (GLfloat) currentTranslation[0];
+	entry.position[1] = (GLfloat) currentTranslation[1];
+	entry.position[2] = (GLfloat) currentTranslation[2];
+	memcpy(entry.flap, flapParameters, sizeof(entry.flap));
+}
+
+//Hand our draw to the render queue, keyed so it sorts by program, mesh and
+//then front-to-back from the camera. Only render data is read from the
+//object itself, anything the simulation changes comes from the snapshot.
+void Object::submitDraw(const SnapshotEntry& entry, MatrixStack& projectionStack, RenderQueue* queue) {
+	//Clip-space w of our origin is its distance along the view direction.
+	GLdouble origin[4] = { entry.position[0], entry.position[1], entry.position[2], 1.0 };
+	GLdouble clip[4];
+	projectionStack.transformd(origin, clip);
+
+	Mesh* drawMesh = mesh != NULL && mesh->getState() == MESH_READY ? mesh : assetLoader.getPlaceholder();
+
+	//Once against every view, and nothing more if none of them can see it.
+	unsigned int views = queue->cull(entry.modelView, drawMesh->getBoundingRadius());
+	if(views == 0)
+		return;
+
+	//Far enough away (or the frame is behind enough) for cheaper lighting.
+	ShadingLevel level = queue->shadingFor((float) clip[3]);
+	const ShadingProgram& use = queue->routesViews() && multiViewShading[level].program != 0 ? multiViewShading[level] : shading[level];
+
+	//Plain white until ours is on the GPU.
+	GLuint drawTexture = assetLoader.useTexture(texture);
+
+	DrawPacket* packet = queue->submit();
+	packet->key = RenderQueue::makeKey(use.program, drawMesh->getVao(), drawTexture, (float) clip[3]);
+	packet->program = use.program;
+	packet->vao = drawMesh->getVao();
+	packet->texture = drawTexture;
+	packet->numIndices = drawMesh->getNumIndices();
+	packet->firstIndex = drawMesh->getFirstIndex();
+	packet->baseVertex = drawMesh->getBaseVertex();
+	packet->projectionLocation = use.projection;
+	packet->timeLocation = use.time;
+	packet->clusterViewLocation = use.clusterView;
+	packet->views = views;
+	memcpy(packet->flap, entry.flap, sizeof(packet->flap));
+	memcpy(packet->modelView, entry.modelView, sizeof(packet->modelView));
 }
 
 void Object::objectFall(bool spin) {
@@ -207,144 +308,6 @@ void Object::initiateCrash() {
 	isCrashed = true;
 }
 
-void Object::updateWings(MatrixStack projectionStack) {
-	//WING FLAPPING
-	//Translate the object in space.
-	modelViewStack->translated(name == "WingRight" ? 0.3 : -0.3, 0, 0);
-
-	currentRotation[2] += currentRotationSpeed[2];
-	//Rotate the object based on it's rotation speed (and current rotation) AROUND Z AXIS
-	modelViewStack->rotated(currentRotation[2], 0, 0, 1);
-		
-	modelViewStack->translated(name == "WingRight" ? -0.3 : 0.3, 0, 0);
-}
-
-//Calculate the normal of object triangles using 3 vertices.
-GLdouble* Object::calcNormal(GLdouble* p1, GLdouble* p2, GLdouble* p3) {
-	GLdouble V1[3] = { p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2] };
-	GLdouble V2[3] = { p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2] };
-	GLdouble* normal = new double[3];
-    normal[0] =  (V1[1] * V2[2]) - (V1[2] * V2[1]);
-    normal[1] =  (V1[2] * V2[0]) - (V1[0] * V2[2]);
-    normal[2] =  (V1[0] * V2[1]) - (V1[1] * V2[0]);
-
-	GLdouble length = sqrt(normal[0]*normal[0]+normal[1]*normal[1]+normal[2]*normal[2]);
-
-	normal[0] /= length;
-	normal[1] /= length;
-	normal[2] /= length;
-
-	//cout << normal[0] << " " << normal[1] << " " << normal[2] << "\n";
-    // Dont forget to normalize if needed
-    return normal;
-}
-
-//Reads the file in and grabs vertex information, face information etc.
-void Object::readFile(char* fileName) {
-	ifstream in(fileName);
-
-	//Use vectors for now so we know how to assign global arrays space in memory later.
-	vector<GLdouble> tempPositions;
-	vector<GLdouble> tempNormals;
-	vector<GLuint> tempIndices;
-
-	//Keep track of what line we're on.
-	int currentLine = 0;
-
-	string lineStr;
-    while(getline(in, lineStr)) {
-
-        istringstream lineSS( lineStr );
-        string lineType;
-        lineSS >> lineType;
-
-        //Fetch a line with vertices
-        if(lineType == "v") {
-            GLdouble x = 0.0, y = 0.0, z = 0.0, w = 1.0;
-            lineSS >> x >> y >> z;
-
-			//Debug text.
-            //cout << currentLine + 1 << " " << x << " " << y << " " << z << " " << w << endl;
-
-			tempPositions.push_back(x);
-			tempPositions.push_back(y);
-			tempPositions.push_back(z);
-			tempPositions.push_back(w);
-
-			numVertices += 1;
-        }
-
-		//Fetch a line with vertex indices
-        if(lineType == "f") {
-            GLuint x = 0, y = 0, z = 0;
-            lineSS >> x >> y >> z;
-
-			//Debug text.
-            //cout << currentLine + 1 << " " << x << " " << y << " " << z << endl;
-			
-			tempIndices.push_back(x);
-			tempIndices.push_back(y);
-			tempIndices.push_back(z);
-
-			numIndices += 3;
-        }
-
-		currentLine++;
-    }
-
-	//Setup normal array for insertion
-	vertexNormals = new GLdouble[numIndices*4];
-	for(int i = 0; i < numIndices*4; i++)
-		vertexNormals[i] = 0.0;
-	
-	//Calculate normals
-	for(int i = 0; i < numIndices; i += 3) {
-		int x = tempIndices[i+0];
-		int y = tempIndices[i+1];
-		int z = tempIndices[i+2];
-
-		GLdouble p1[3] = {tempPositions[(x-1)*4], tempPositions[(x-1)*4+1], tempPositions[(x-1)*4+2]};
-		GLdouble p2[3] = {tempPositions[(y-1)*4], tempPositions[(y-1)*4+1], tempPositions[(y-1)*4+2]};
-		GLdouble p3[3] = {tempPositions[(z-1)*4], tempPositions[(z-1)*4+1], tempPositions[(z-1)*4+2]};
-		double* pointNormals = new double[3];
-		pointNormals = calcNormal(p1, p2, p3);
-
-		vertexNormals[(x-1)*4+0] += pointNormals[0];
-        vertexNormals[(x-1)*4+1] += pointNormals[1];
-        vertexNormals[(x-1)*4+2] += pointNormals[2];
- 
-        vertexNormals[(y-1)*4+0] += pointNormals[0];
-        vertexNormals[(y-1)*4+1] += pointNormals[1];
-        vertexNormals[(y-1)*4+2] += pointNormals[2];
- 
-        vertexNormals[(z-1)*4+0] += pointNormals[0];
-        vertexNormals[(z-1)*4+1] += pointNormals[1];
-        vertexNormals[(z-1)*4+2] += pointNormals[2];
-	}
-
-	//cout << numVertices / 3 << "  ";
-	//cout << numIndices << "  ";
-
-	//Store contents of vectors in global array.
-	vertexPositions = new GLdouble[numVertices*4];
-	for(int i = 0; i < numVertices*4; i++) {
-		vertexPositions[i] = tempPositions.at(i);
-		//cout << tempPositions.at(i) << " ";
-	}
-	vertexIndices = new GLuint[numIndices];
-	for(int i = 0; i < numIndices; i++) {
-		vertexIndices[i] = tempIndices.at(i) - 1;
-		//cout << tempIndices.at(i) << " ";
-	}
-	vertexColours = new GLdouble[numVertices*4];
-	int modifier = 0;
-	for(int i = 0; i < numVertices*4; i++) {
-		modifier += 1;
-		vertexColours[i] = (modifier % 10) * 0.1;
-		//cout << vertexColours[i] << " ";
-	}
-}
-
 //ACCESSORS AND SETTERS ARE BELOW
 void Object::setTranslation(double x, double y, double z) { 
 	currentTranslation[0] = x;	
@@ -372,14 +335,49 @@ void Object::setSpeed(double speed) {
 	objectForwardSpeed = speed;
 }
 
+//Procedural wing flap, rotation about Z at the hinge is
+//amplitude * sin(phase + 2*PI*frequency*time) degrees.
+void Object::setFlap(double phase, double frequency, double amplitude, double hinge) {
+	flapParameters[0] = phase;
+	flapParameters[1] = frequency;
+	flapParameters[2] = amplitude;
+	flapParameters[3] = hinge;
+}
+
 double* Object::getTranslation()	 { return currentTranslation;	}
 double* Object::getRotation()		 { return currentRotation;		}
 double Object::getSpeed()			 { return objectForwardSpeed;	}
+double Object::getCrashTravel()		 { return crashTravel;			}
+Mesh* Object::getMesh()				 { return mesh;					}
+Texture* Object::getTexture()			 { return texture;				}
+const ShadingProgram& Object::getShading(ShadingLevel level) { return shading[level]; }
+
+//Account for crash steps that passed while the object was asleep.
+void Object::skipCrashTravel(double steps) {
+	crashTravel += steps;
+}
+
+void Object::exportState(PartState& state) {
+	//Cleared first so padding doesn't carry junk into saved files.
+	memset(&state, 0, sizeof(state));
+	memcpy(state.translation, currentTranslation, sizeof(state.translation));
+	memcpy(state.translationSpeed, currentTranslationSpeed, sizeof(state.translationSpeed));
+	memcpy(state.rotation, currentRotation, sizeof(state.rotation));
+	memcpy(state.rotationSpeed, currentRotationSpeed, sizeof(state.rotationSpeed));
+	state.forwardSpeed = objectForwardSpeed;
+	state.crashTravel = crashTravel;
+	state.isCrashed = isCrashed;
+}
+
+void Object::importState(const PartState& state) {
+	memcpy(currentTranslation, state.translation, sizeof(currentTranslation));
+	memcpy(currentTranslationSpeed, state.translationSpeed, sizeof(currentTranslationSpeed));
+	memcpy(currentRotation, state.rotation, sizeof(currentRotation));
+	memcpy(currentRotationSpeed, state.rotationSpeed, sizeof(currentRotationSpeed));
+	objectForwardSpeed = state.forwardSpeed;
+	crashTravel = state.crashTravel;
+	isCrashed = state.isCrashed != 0;
+}
 
 double* Object::getTranslationSpeed()	{ return currentTranslationSpeed;	}
 double* Object::getRotationSpeed()		{ return currentRotationSpeed;		}
-
-GLuint Object::numVertexPositionBytes() { return numVertices*4*sizeof(GLdouble);	}
-GLuint Object::numVertexColourBytes()	{ return numVertices*4*sizeof(GLdouble);	}
-GLuint Object::numVertexNormalBytes()	{ return numIndices*4*sizeof(GLdouble);	}
-GLuint Object::numVertexIndexBytes()	{ return numIndices*sizeof(GLuint);			}
\ No newline at end of file
@@ -0,0 +1,133 @@
+"""NumPy access to the flock simulation through the flocksim C library.
+
+Views are NumPy arrays over the simulation's own memory, made through the
+buffer protocol of a ctypes array at the view's address. Nothing is copied,
+so a view shows the state after every step; keep the World alive for as long
+as any view is in use.
+
+    world = World(1000000, seed=1)
+    positions = world.positions()      # (n, 3) float64
+    world.steer(np.full(1000000, 5.0))
+    world.step(60)
+    print(positions[:, 1].mean())
+"""
+
+import ctypes
+import ctypes.util
+import os
+import sys
+
+import numpy as np
+
+FLOAT64 = 0
+UINT8 = 1
+
+
+class _View(ctypes.Structure):
+    _fields_ = [("data", ctypes.c_void_p),
+                ("count", ctypes.c_size_t),
+                ("stride", ctypes.c_ssize_t),
+                ("components", ctypes.c_size_t),
+                ("type", ctypes.c_int)]
+
+
+def _load():
+    name = "flocksim.dll" if sys.platform == "win32" else "libflocksim.so"
+    path = os.environ.get("FLOCKSIM_LIBRARY", os.path.join(os.path.dirname(os.path.abspath(__file__)), name))
+    lib = ctypes.CDLL(path)
+
+    lib.flocksim_create.restype = ctypes.c_void_p
+    lib.flocksim_create.argtypes = [ctypes.c_uint, ctypes.c_uint]
+    lib.flocksim_destroy.argtypes = [ctypes.c_void_p]
+    lib.flocksim_step.argtypes = [ctypes.c_void_p, ctypes.c_uint]
+    lib.flocksim_step_count.restype = ctypes.c_ulonglong
+    lib.flocksim_step_count.argtypes = [ctypes.c_void_p]
+    lib.flocksim_num_birds.restype = ctypes.c_uint
+    lib.flocksim_num_birds.argtypes = [ctypes.c_void_p]
+    for view in ("positions", "headings", "falling"):
+        getattr(lib, "flocksim_" + view).argtypes = [ctypes.c_void_p, ctypes.POINTER(_View)]
+    lib.flocksim_steer.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t]
+    lib.flocksim_fall.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t]
+    lib.flocksim_error_string.restype = ctypes.c_char_p
+    lib.flocksim_error_string.argtypes = [ctypes.c_int]
+    return lib
+
+
+_lib = _load()
+
+
+def _check(result):
+    if result != 0:
+        raise RuntimeError("flocksim: " + _lib.flocksim_error_string(result).decode())
+
+
+def _inputs(name, values, dtype, indices):
+    # The library reads one index per value, so the lengths have to agree here.
+    # ascontiguousarray makes scalars 1-D, so the shapes are checked first.
+    values = np.asarray(values, dtype)
+    if values.ndim != 1:
+        raise ValueError("flocksim: %s must be 1-D" % name)
+    if indices is None:
+        return np.ascontiguousarray(values), None
+    indices = np.asarray(indices, np.uint32)
+    if indices.ndim != 1 or len(indices) != len(values):
+        raise ValueError("flocksim: indices must be 1-D with one per entry of %s" % name)
+    return np.ascontiguousarray(values), np.ascontiguousarray(indices)
+
+
+class World(object):
+
+    def __init__(self, birds, seed=1):
+        self._handle = _lib.flocksim_create(birds, seed)
+
+    def close(self):
+        if self._handle:
+            _lib.flocksim_destroy(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def step(self, steps=1):
+        _lib.flocksim_step(self._handle, steps)
+
+    @property
+    def step_count(self):
+        return _lib.flocksim_step_count(self._handle)
+
+    def __len__(self):
+        return _lib.flocksim_num_birds(self._handle)
+
+    def _view(self, which):
+        view = _View()
+        _check(getattr(_lib, "flocksim_" + which)(self._handle, ctypes.byref(view)))
+        dtype = np.dtype(np.float64 if view.type == FLOAT64 else np.uint8)
+        if view.count == 0:
+            return np.empty((0, view.components), dtype)
+
+        # Just enough bytes to cover the last element, wrapped without copying.
+        span = (view.count - 1) * view.stride + view.components * dtype.itemsize
+        memory = (ctypes.c_char * span).from_address(view.data)
+        array = np.ndarray((view.count, view.components), dtype, memory, 0,
+                           (view.stride, dtype.itemsize))
+        array.flags.writeable = False
+        return array if view.components > 1 else array[:, 0]
+
+    def positions(self):
+        return self._view("positions")
+
+    def headings(self):
+        return self._view("headings")
+
+    def falling(self):
+        return self._view("falling")
+
+    def steer(self, angles, indices=None):
+        angles, indices = _inputs("angles", angles, np.float64, indices)
+        _check(_lib.flocksim_steer(self._handle, None if indices is None else indices.ctypes.data,
+                                   angles.ctypes.data, len(angles)))
+
+    def fall(self, drops, indices=None):
+        drops, indices = _inputs("drops", drops, np.uint8, indices)
+        _check(_lib.flocksim_fall(self._handle, None if indices is None else indices.ctypes.data,
+                                  drops.ctypes.data, len(drops)))
@@ -0,0 +1,73 @@
+#version 150 
+
+in   vec4 vPosition;
+in   vec3 vNormal;
+in   vec2 vTexCoord;
+
+// per draw, from the render queue's instance buffer
+in   mat4 vModelView;
+
+// per-part flap: x = phase (radians), y = frequency (Hz), z = amplitude (degrees), w = hinge x offset
+in   vec4 vFlap;
+
+#ifdef MULTI_VIEW
+// which view this instance is for, every view's projection, and the
+// geometry shader in between passing these on under their usual names
+in   float vView;
+uniform mat4 Projection[MAX_VIEWS];
+#define fN gN
+#define fPosition gPosition
+#define fTexCoord gTexCoord
+flat out int gView;
+#else
+uniform mat4 Projection;
+#endif
+
+// output values that will be interpolated per-fragment, in view space
+out vec3 fN;
+out vec3 fPosition;
+out vec2 fTexCoord;
+
+// the camera and the scene lights, shared by every program
+layout(std140) uniform Lighting
+{
+    mat4 View;
+    vec4 KeyLight;
+    vec4 KeyColour;
+    vec4 Ambient;
+    vec4 ClusterScale;
+    ivec4 ClusterDims;
+};
+
+// seconds since start, shared by every bird
+uniform float Time;
+
+void main()
+{
+    // wing hinge rotation about Z, computed here rather than on the CPU
+    float angle = radians(vFlap.z) * sin(vFlap.x + 6.28318530718 * vFlap.y * Time);
+    float s = sin(angle);
+    float c = cos(angle);
+
+    // translate to the hinge, rotate, translate back
+    mat4 flap = mat4( c,   s,   0.0, 0.0,
+                     -s,   c,   0.0, 0.0,
+                      0.0, 0.0, 1.0, 0.0,
+                      vFlap.w - c*vFlap.w, -s*vFlap.w, 0.0, 1.0 );
+
+    vec4 position = flap*vPosition;
+
+    mat4 modelView = View*vModelView;
+    fN = mat3(modelView)*mat3(flap)*vNormal;
+    fPosition = (modelView*position).xyz;
+
+    fTexCoord = vTexCoord;
+
+#ifdef MULTI_VIEW
+    gView = int(vView);
+    mat4 projection = Projection[gView];
+#else
+    mat4 projection = Projection;
+#endif
+    gl_Position = projection*vModelView*position;
+}
@@ -0,0 +1,60 @@
+#version 150 
+
+// Per-part draw data for one bird per vertex and one part per instance,
+// captured by transform feedback in the render queue's instance layout
+// (model-view then flap) so it can be drawn from directly.
+
+in   vec4 vTranslation;    // body translation, crash travel
+in   vec4 vRotation;       // rotation in degrees, forward speed
+in   vec4 vPivot;          // centre the parts turn about
+in   vec4 vFlapShape;      // flap phase, frequency and amplitude
+
+out vec4 oModelView0;
+out vec4 oModelView1;
+out vec4 oModelView2;
+out vec4 oModelView3;
+out vec4 oFlap;
+
+// body, head, left wing, right wing: where each sits from the body, as
+// Bird::setupBirdSkeleton lays them out, and which way the wings hinge
+const vec3 offsets[4] = vec3[4]( vec3(0.0, 0.0, 0.0), vec3(0.0, 0.3, 0.3), vec3(0.3, 0.1, 0.0), vec3(-0.3, 0.1, 0.0) );
+const float sides[4] = float[4]( 0.0, 0.0, -1.0, 1.0 );
+
+mat4 translate(vec3 t)
+{
+    return mat4( 1.0, 0.0, 0.0, 0.0,
+                 0.0, 1.0, 0.0, 0.0,
+                 0.0, 0.0, 1.0, 0.0,
+                 t.x, t.y, t.z, 1.0 );
+}
+
+void main()
+{
+    vec3 a = radians(vRotation.xyz);
+    vec3 s = sin(a);
+    vec3 c = cos(a);
+
+    mat4 rx = mat4( 1.0, 0.0,  0.0,  0.0,
+                    0.0, c.x,  s.x,  0.0,
+                    0.0, -s.x, c.x,  0.0,
+                    0.0, 0.0,  0.0,  1.0 );
+    mat4 ry = mat4( c.y, 0.0, -s.y, 0.0,
+                    0.0, 1.0, 0.0,  0.0,
+                    s.y, 0.0, c.y,  0.0,
+                    0.0, 0.0, 0.0,  1.0 );
+    mat4 rz = mat4( c.z,  s.z, 0.0, 0.0,
+                    -s.z, c.z, 0.0, 0.0,
+                    0.0,  0.0, 1.0, 0.0,
+                    0.0,  0.0, 0.0, 1.0 );
+
+    // turn about the bird's centre, then out to where the part is
+    mat4 modelView = translate(vPivot.xyz)*rx*ry*rz*translate(-vPivot.xyz)*translate(vTranslation.xyz + offsets[gl_InstanceID]);
+
+    oModelView0 = modelView[0];
+    oModelView1 = modelView[1];
+    oModelView2 = modelView[2];
+    oModelView3 = modelView[3];
+
+    float side = sides[gl_InstanceID];
+    oFlap = vec4(vFlapShape.x, vFlapShape.y, side*vFlapShape.z, side*0.3);
+}
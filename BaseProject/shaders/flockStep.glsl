@@ -0,0 +1,179 @@
+#version 150 
+
+// One simulation step for one bird per vertex, captured by transform
+// feedback into the other state buffer. Mirrors the CPU path, World::step
+// without the wind and obstacle avoidance: commands (World::processCommands),
+// sleeping, ground contact and bounds (Bird::prepareStep) and the motion
+// itself (Object::step and Object::objectFall).
+
+// state carried from step to step
+in   vec4 vTranslation;    // body translation, crash travel
+in   vec4 vRotation;       // rotation in degrees, forward speed
+in   vec4 vMotion;         // rotation speed, vertical speed
+in   vec4 vFlags;          // falling, static drop, crashed, asleep
+in   vec4 vPivot;          // centre the parts turned about last step
+
+// fixed for each bird
+in   vec4 vBounds;         // flying bounds
+
+out vec4 oTranslation;
+out vec4 oRotation;
+out vec4 oMotion;
+out vec4 oFlags;
+out vec4 oPivot;
+
+// this step's input, type as in WorldCommandType and its value
+uniform int NumCommands;
+uniform vec2 Commands[8];
+
+const float COMMAND_STEER = 0.0;
+const float COMMAND_FALL = 1.0;
+
+vec3 translation;
+vec3 rotation;
+vec3 rotationSpeed;
+float verticalSpeed;
+float forwardSpeed;
+float crashTravel;
+bool falling;
+bool staticDrop;
+bool crashed;
+bool asleep;
+
+// fmod, keeping the sign of x as the CPU does
+float wrap(float x)
+{
+    return x - 360.0*trunc(x/360.0);
+}
+
+vec2 heading()
+{
+    return vec2(sin(radians(rotation.y)), cos(radians(rotation.y)));
+}
+
+void objectFall(bool spin)
+{
+    if( rotationSpeed.y < 15.0 ) {
+		rotationSpeed.y += 0.04;
+    }
+    translation.y -= rotationSpeed.y*0.005;
+    if( spin ) {
+		translation.xz += heading()*forwardSpeed;
+    }
+}
+
+bool withinBounds()
+{
+    vec2 next = translation.xz + heading()*forwardSpeed;
+    return all(lessThanEqual(abs(next), vBounds.xz));
+}
+
+void main()
+{
+    translation = vTranslation.xyz;
+    crashTravel = vTranslation.w;
+    rotation = vRotation.xyz;
+    forwardSpeed = vRotation.w;
+    rotationSpeed = vMotion.xyz;
+    verticalSpeed = vMotion.w;
+    falling = vFlags.x != 0.0;
+    staticDrop = vFlags.y != 0.0;
+    crashed = vFlags.z != 0.0;
+    asleep = vFlags.w != 0.0;
+    vec3 pivot = vPivot.xyz;
+
+    // asleep the crash timer still runs, as World catches it up on waking
+    if( asleep ) {
+		crashTravel += 1.0;
+    }
+
+    // input always wakes a bird, falling ones ignore it
+    for( int i = 0; i < NumCommands; i++ ) {
+		asleep = false;
+		if( falling ) {
+			continue;
+		}
+		if( Commands[i].x == COMMAND_STEER ) {
+			if( !crashed ) {
+				rotation.y += Commands[i].y;
+			}
+		}
+		else if( Commands[i].x == COMMAND_FALL ) {
+			staticDrop = Commands[i].y != 0.0;
+			falling = true;
+			if( !staticDrop ) {
+				verticalSpeed = 0.01;
+				forwardSpeed = 0.05;
+			}
+		}
+    }
+
+    if( asleep && crashTravel >= 150.0 ) {
+		asleep = false;
+    }
+
+    if( !asleep ) {
+		// ground contact
+		pivot = translation;
+		if( pivot.y <= -vBounds.y ) {
+			translation.y += 0.1;
+			verticalSpeed = 0.01;
+			forwardSpeed = 0.02;
+			rotationSpeed.y = 0.0;
+			if( !staticDrop ) {
+				forwardSpeed = 0.05;
+				crashTravel = 0.0;
+				crashed = true;
+			}
+			staticDrop = false;
+			falling = false;
+		}
+
+		bool reachedTop = pivot.y >= vBounds.y;
+		bool inBounds = withinBounds();
+
+		if( !reachedTop && !falling && !crashed ) {
+			translation.y += verticalSpeed;
+		}
+		if( crashed ) {
+			crashTravel += 1.0;
+			if( forwardSpeed > 0.001 ) {
+				forwardSpeed -= 0.001;
+			}
+			if( crashTravel > 150.0 ) {
+				crashed = false;
+				forwardSpeed = 0.02;
+			}
+		}
+
+		if( staticDrop ) {
+			objectFall(false);
+		}
+		if( falling ) {
+			if( inBounds && !staticDrop ) {
+				objectFall(true);
+			}
+			else if( !inBounds ) {
+				objectFall(false);
+			}
+		}
+
+		if( !crashed ) {
+			rotation = vec3(wrap(rotation.x + rotationSpeed.x), wrap(rotation.y + rotationSpeed.y), wrap(rotation.z + rotationSpeed.z));
+		}
+
+		// steering motors
+		if( inBounds && !falling ) {
+			translation.xz += heading()*forwardSpeed;
+		}
+
+		// settled after a crash, sleeps until the crash wears off
+		asleep = crashed && !falling && forwardSpeed <= 0.0015;
+    }
+
+    oTranslation = vec4(translation, crashTravel);
+    oRotation = vec4(rotation, forwardSpeed);
+    oMotion = vec4(rotationSpeed, verticalSpeed);
+    oFlags = vec4(falling ? 1.0 : 0.0, staticDrop ? 1.0 : 0.0, crashed ? 1.0 : 0.0, asleep ? 1.0 : 0.0);
+    oPivot = vec4(pivot, 0.0);
+}
@@ -1,40 +1,101 @@
 #version 150 
 
-// per-fragment interpolated values from the vertex shader
+// per-fragment interpolated values from the vertex shader, in view space
 in vec3 fN;
-in vec3 fL;
-in vec3 fE;
+in vec3 fPosition;
+in vec2 fTexCoord;
 
 out vec4 fColor;
 
-uniform vec4 AmbientProduct, DiffuseProduct, SpecularProduct;
-uniform mat4 ModelView;
-uniform vec4 LightPosition;
+// the object's texture, one white texel for untextured objects
+uniform sampler2D Diffuse;
+
+uniform vec4 MaterialAmbient, MaterialDiffuse, MaterialSpecular;
 uniform float Shininess;
 
-void main() 
-{ 
-    // Normalize the input lighting vectors
-    vec3 N = normalize(fN);
-    vec3 E = normalize(fE);
-    vec3 L = normalize(fL);
+// the camera and the scene lights, shared by every program
+layout(std140) uniform Lighting
+{
+    mat4 View;
+    vec4 KeyLight;
+    vec4 KeyColour;
+    vec4 Ambient;
+    vec4 ClusterScale;
+    ivec4 ClusterDims;
+};
+
+// point lights as two texels each (xyz + radius, colour), the (offset, count)
+// of each cluster's list and the lists themselves, built by LightClusters
+uniform samplerBuffer LightData;
+uniform usamplerBuffer ClusterGrid;
+uniform usamplerBuffer LightIndices;
+
+// where the view the lights were clustered for starts in the target, and z
+// non-zero when drawing any other view, which only gets the key light
+uniform vec3 ClusterView;
 
+#ifdef MULTI_VIEW
+flat in int fView;
+#endif
+
+// the texture under this fragment, tinting ambient and diffuse light
+vec4 surface;
+
+vec4 shade(vec3 N, vec3 E, vec3 L, vec4 colour)
+{
     vec3 H = normalize( L + E );
-    
-    vec4 ambient = AmbientProduct;
 
     float Kd = max(dot(L, N), 0.0);
-    vec4 diffuse = Kd*DiffuseProduct;
-    
+    vec4 diffuse = Kd*colour*MaterialDiffuse*surface;
+
     float Ks = pow(max(dot(N, H), 0.0), Shininess);
-    vec4 specular = Ks*SpecularProduct;
+    vec4 specular = Ks*colour*MaterialSpecular;
 
     // discard the specular highlight if the light's behind the vertex
     if( dot(L, N) < 0.0 ) {
 		specular = vec4(0.0, 0.0, 0.0, 1.0);
     }
 
-    fColor = ambient + diffuse + specular;
+    return diffuse + specular;
+}
+
+void main() 
+{ 
+    vec3 N = normalize(fN);
+    vec3 E = normalize(-fPosition);
+
+    surface = texture(Diffuse, fTexCoord);
+    fColor = Ambient*MaterialAmbient*surface;
+
+    // the key light reaches everywhere
+    vec3 L = KeyLight.xyz;
+    if( KeyLight.w != 0.0 ) {
+		L = KeyLight.xyz - fPosition;
+    }
+    fColor += shade(N, E, normalize(L), KeyColour);
+
+    // then only the point lights in our cluster
+    bool clustered = ClusterView.z == 0.0;
+#ifdef MULTI_VIEW
+    clustered = clustered && fView == 0;
+#endif
+    uvec2 cluster = uvec2(0u);
+    if( clustered ) {
+		ivec2 tile = min(ivec2((gl_FragCoord.xy - ClusterView.xy)*ClusterScale.xy), ClusterDims.xy - 1);
+		int slice = clamp(int(log(-fPosition.z)*ClusterScale.z + ClusterScale.w), 0, ClusterDims.z - 1);
+		cluster = texelFetch(ClusterGrid, (slice*ClusterDims.y + tile.y)*ClusterDims.x + tile.x).xy;
+    }
+
+    for( uint i = 0u; i < cluster.y; i++ ) {
+		int light = int(texelFetch(LightIndices, int(cluster.x + i)).x);
+		vec4 position = texelFetch(LightData, light*2);
+		vec4 colour = texelFetch(LightData, light*2 + 1);
+
+		vec3 toLight = position.xyz - fPosition;
+		float distance = length(toLight);
+		float falloff = clamp(1.0 - (distance*distance)/(position.w*position.w), 0.0, 1.0);
+		fColor += falloff*falloff*shade(N, E, toLight/max(distance, 0.0001), colour);
+    }
+
     fColor.a = 1.0;
 } 
-
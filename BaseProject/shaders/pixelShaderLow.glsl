@@ -0,0 +1,73 @@
+#version 150 
+
+// per-fragment interpolated values from the vertex shader, in view space
+in vec3 fN;
+in vec3 fPosition;
+in vec2 fTexCoord;
+
+out vec4 fColor;
+
+// the object's texture, one white texel for untextured objects
+uniform sampler2D Diffuse;
+
+uniform vec4 MaterialAmbient, MaterialDiffuse;
+
+// the camera and the scene lights, shared by every program
+layout(std140) uniform Lighting
+{
+    mat4 View;
+    vec4 KeyLight;
+    vec4 KeyColour;
+    vec4 Ambient;
+    vec4 ClusterScale;
+    ivec4 ClusterDims;
+};
+
+uniform samplerBuffer LightData;
+uniform usamplerBuffer ClusterGrid;
+uniform usamplerBuffer LightIndices;
+
+// where the view the lights were clustered for starts in the target, and z
+// non-zero when drawing any other view, which only gets the key light
+uniform vec3 ClusterView;
+
+#ifdef MULTI_VIEW
+flat in int fView;
+#endif
+
+// cheaper shading for distant objects: ambient and diffuse only, the
+// specular highlight is too small to see at a distance anyway
+void main() 
+{ 
+    vec3 N = normalize(fN);
+
+    vec3 L = KeyLight.xyz;
+    if( KeyLight.w != 0.0 ) {
+		L = KeyLight.xyz - fPosition;
+    }
+    vec4 light = max(dot(normalize(L), N), 0.0)*KeyColour;
+
+    bool clustered = ClusterView.z == 0.0;
+#ifdef MULTI_VIEW
+    clustered = clustered && fView == 0;
+#endif
+    uvec2 cluster = uvec2(0u);
+    if( clustered ) {
+		ivec2 tile = min(ivec2((gl_FragCoord.xy - ClusterView.xy)*ClusterScale.xy), ClusterDims.xy - 1);
+		int slice = clamp(int(log(-fPosition.z)*ClusterScale.z + ClusterScale.w), 0, ClusterDims.z - 1);
+		cluster = texelFetch(ClusterGrid, (slice*ClusterDims.y + tile.y)*ClusterDims.x + tile.x).xy;
+    }
+
+    for( uint i = 0u; i < cluster.y; i++ ) {
+		int index = int(texelFetch(LightIndices, int(cluster.x + i)).x);
+		vec4 position = texelFetch(LightData, index*2);
+
+		vec3 toLight = position.xyz - fPosition;
+		float distance = length(toLight);
+		float falloff = clamp(1.0 - (distance*distance)/(position.w*position.w), 0.0, 1.0);
+		light += falloff*falloff*max(dot(toLight/max(distance, 0.0001), N), 0.0)*texelFetch(LightData, index*2 + 1);
+    }
+
+    fColor = (Ambient*MaterialAmbient + light*MaterialDiffuse)*texture(Diffuse, fTexCoord);
+    fColor.a = 1.0;
+} 
@@ -2,25 +2,53 @@
 
 in   vec4 vPosition;
 in   vec3 vNormal;
+in   vec2 vTexCoord;
 
-// output values that will be interpolated per-fragment
-out vec3 fN;
-out vec3 fE;
-out vec3 fL;
+// per draw, from the render queue's instance buffer
+in   mat4 vModelView;
 
-uniform mat4 ModelView;
-uniform vec4 LightPosition;
+#ifdef MULTI_VIEW
+// which view this instance is for, every view's projection, and the
+// geometry shader in between passing these on under their usual names
+in   float vView;
+uniform mat4 Projection[MAX_VIEWS];
+#define fN gN
+#define fPosition gPosition
+#define fTexCoord gTexCoord
+flat out int gView;
+#else
 uniform mat4 Projection;
+#endif
+
+// output values that will be interpolated per-fragment, in view space
+out vec3 fN;
+out vec3 fPosition;
+out vec2 fTexCoord;
+
+// the camera and the scene lights, shared by every program
+layout(std140) uniform Lighting
+{
+    mat4 View;
+    vec4 KeyLight;
+    vec4 KeyColour;
+    vec4 Ambient;
+    vec4 ClusterScale;
+    ivec4 ClusterDims;
+};
 
 void main()
 {
-    fN = vNormal;
-    fE = vPosition.xyz;
-    fL = LightPosition.xyz;
-    
-    if( LightPosition.w != 0.0 ) {
-		fL = LightPosition.xyz - vPosition.xyz;
-    }
-
-    gl_Position = Projection*ModelView*vPosition;
+    mat4 modelView = View*vModelView;
+    fN = mat3(modelView)*vNormal;
+    fPosition = (modelView*vPosition).xyz;
+
+    fTexCoord = vTexCoord;
+
+#ifdef MULTI_VIEW
+    gView = int(vView);
+    mat4 projection = Projection[gView];
+#else
+    mat4 projection = Projection;
+#endif
+    gl_Position = projection*vModelView*vPosition;
 }
@@ -0,0 +1,31 @@
+#version 150
+#extension GL_ARB_viewport_array : require
+
+// sends each triangle to the viewport of the view its instance was drawn
+// for, so every view is rasterised in the one pass
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+in vec3 gN[];
+in vec3 gPosition[];
+in vec2 gTexCoord[];
+flat in int gView[];
+
+out vec3 fN;
+out vec3 fPosition;
+out vec2 fTexCoord;
+flat out int fView;
+
+void main()
+{
+    for( int i = 0; i < 3; i++ ) {
+		gl_ViewportIndex = gView[0];
+		fView = gView[0];
+		fN = gN[i];
+		fPosition = gPosition[i];
+		fTexCoord = gTexCoord[i];
+		gl_Position = gl_in[i].gl_Position;
+		EmitVertex();
+    }
+    EndPrimitive();
+}